@@ -30,6 +30,7 @@ void usage()
 {
     fprintf(stderr, "Usage: hcat [normalize][prange [<rangeMin>:]<rangeMax>][pc <percentile>]\n"
                     "            [percent][count][range [<rangeMin>:]<rangeMax>]\n"
+                    "            [hdr <digits>][bins]\n"
                     "            <file1> [<file2> <file3> ...]\n");
 }
 
@@ -317,6 +318,477 @@ double Histogram::Percentile(double p)
     return max_val;
 }  // end Histogram::Percentile()
 
+// HDR-style log-linear histogram.  Each power-of-2 range of |value| is split 
+// into 2^sub_bits linear bins, enough to resolve values to "digits" significant
+// decimal digits, so recording is O(1) and needs no rescaling.  Bin counts
+// are kept (for negative and positive values) over the range of bins used so
+// far, with a sum per power-of-2 range for fast percentile queries.  The 
+// Write() text form merges losslessly with ReadLine() and Merge()
+class HdrHistogram
+{
+    public:
+        HdrHistogram();
+        ~HdrHistogram();
+        bool Init(unsigned int numDigits);  // (1 to DIGITS_MAX)
+        void Reset();  // (back to uninitialized)
+        unsigned int Digits() const {return digits;}
+        bool IsEmpty() const {return (0 == total_count);}
+        // (non-finite values are ignored)
+        bool Record(double value, unsigned long count = 1);
+        // Adds the counts of "h", keeping the lower precision of the two
+        bool Merge(const HdrHistogram& h);
+        unsigned long Count() const {return total_count;}
+        double Min() const {return min_val;}
+        double Max() const {return max_val;}
+        double Mean() const {return (total_count ? (sum / (double)total_count) : 0.0);}
+        // Returns the highest value equivalent (within precision) to the
+        // value at percentile "p" (0.0 - 1.0)
+        double Percentile(double p) const;
+        unsigned long CountInRange(double rangeMin, double rangeMax) const;
+        double PercentageInRange(double rangeMin, double rangeMax) const;
+        // Prints "value, count" (bin midpoint) lines for non-empty bins
+        void Print(FILE* file) const;
+        // Prints the compact text form: an "hdr" header line followed
+        // by "hdr+" lines of run-length encoded bin counts
+        void Write(FILE* file) const;
+        // Parses a Write() line (an "hdr" header line resets the histogram)
+        bool ReadLine(const char* text);
+        static bool IsHdrLine(const char* text) 
+            {return (0 == strncmp(text, "hdr", 3));}
+        
+        enum {DIGITS_MAX = 5};
+            
+    private:
+        HdrHistogram(const HdrHistogram&);  // (not copyable)
+        HdrHistogram& operator=(const HdrHistogram&);
+        
+        // Keeps the bin keys of all finite, non-zero |value| positive
+        enum {EXPONENT_BIAS = 1100, EXPONENT_MAX = 1024};
+        enum {WRITE_LINE_MAX = 800};  // (fits the 1024 byte hcat line buffer)
+        
+        // Bins for negative or positive values, by |value| key
+        typedef struct
+        {
+            unsigned long   offset;  // key of count[0] (first key of a power-of-2 range)
+            unsigned long   size;    // (a multiple of sub_count)
+            unsigned long*  count;
+            unsigned long*  range_count;  // per sub_count bins
+        } BinArray;
+        
+        unsigned long Key(double magnitude) const
+        {
+            int exponent;
+            double mantissa = frexp(magnitude, &exponent);  // 0.5 <= mantissa < 1.0
+            unsigned long sub = (unsigned long)((mantissa - 0.5) * (double)(2*sub_count));
+            return ((((unsigned long)(exponent + EXPONENT_BIAS)) << sub_bits) + sub);
+        }
+        // Lowest |value| in the bin for "key" (its width is BinLow(key+1) - BinLow(key))
+        double BinLow(unsigned long key) const
+        {
+            return ldexp((double)(sub_count + (key & (sub_count - 1))),
+                         ((int)(key >> sub_bits)) - EXPONENT_BIAS - 1 - sub_bits);
+        }
+        double BinMid(unsigned long key) const
+            {return (0.5 * (BinLow(key) + BinLow(key + 1)));}
+        // Maps a "key" to its bin at "toBits" (<= "fromBits") precision
+        static unsigned long ConvertKey(unsigned long key, unsigned int fromBits, unsigned int toBits)
+        {
+            return (((key >> fromBits) << toBits) | 
+                    ((key & ((1UL << fromBits) - 1)) >> (fromBits - toBits)));
+        }
+        double Clamp(double value) const
+            {return ((value < min_val) ? min_val : ((value > max_val) ? max_val : value));}
+        bool AddCount(BinArray& bins, unsigned long key, unsigned long count);
+        bool MergeBins(BinArray& bins, const BinArray& from, unsigned int fromBits);
+        void WriteBins(FILE* file, const BinArray& bins, const char* sign) const;
+        void Clear(BinArray& bins);
+        void Take(HdrHistogram& h);
+        
+        unsigned int    digits;    // 0 until Init()
+        unsigned int    sub_bits;  
+        unsigned long   sub_count; // bins per power-of-2 range
+        unsigned long   total_count;
+        unsigned long   zero_count;
+        double          min_val;
+        double          max_val;
+        double          sum;
+        BinArray        neg;
+        BinArray        pos;
+};  // end class HdrHistogram
+
+HdrHistogram::HdrHistogram()
+ : digits(0), sub_bits(0), sub_count(1), total_count(0), zero_count(0),
+   min_val(0.0), max_val(0.0), sum(0.0)
+{
+    memset(&neg, 0, sizeof(BinArray));
+    memset(&pos, 0, sizeof(BinArray));
+}
+
+HdrHistogram::~HdrHistogram()
+{
+    Clear(neg);
+    Clear(pos);
+}
+
+void HdrHistogram::Clear(BinArray& bins)
+{
+    if (bins.count) delete[] bins.count;
+    if (bins.range_count) delete[] bins.range_count;
+    memset(&bins, 0, sizeof(BinArray));
+}  // end HdrHistogram::Clear()
+
+bool HdrHistogram::Init(unsigned int numDigits)
+{
+    if ((numDigits < 1) || (numDigits > DIGITS_MAX)) return false;
+    Clear(neg);
+    Clear(pos);
+    // Enough linear bins per power-of-2 range to resolve 2*10^digits 
+    // values (i.e. the relative bin width is at most 1/(2*10^digits))
+    unsigned long resolution = 2;
+    for (unsigned int i = 0; i < numDigits; i++) resolution *= 10;
+    digits = numDigits;
+    sub_bits = 0;
+    while ((1UL << sub_bits) < resolution) sub_bits++;
+    sub_count = 1UL << sub_bits;
+    total_count = zero_count = 0;
+    min_val = max_val = sum = 0.0;
+    return true;
+}  // end HdrHistogram::Init()
+
+void HdrHistogram::Reset()
+{
+    Clear(neg);
+    Clear(pos);
+    digits = 0;
+    total_count = zero_count = 0;
+    min_val = max_val = sum = 0.0;
+}  // end HdrHistogram::Reset()
+
+bool HdrHistogram::AddCount(BinArray& bins, unsigned long key, unsigned long count)
+{
+    if ((NULL == bins.count) || (key < bins.offset) || (key >= (bins.offset + bins.size)))
+    {
+        // Grow the bin array to cover the power-of-2 range of "key"
+        unsigned long lo = key & ~(sub_count - 1);
+        unsigned long hi = lo + sub_count;
+        if (bins.count)
+        {
+            if (bins.offset < lo) lo = bins.offset;
+            if ((bins.offset + bins.size) > hi) hi = bins.offset + bins.size;
+        }
+        unsigned long newSize = hi - lo;
+        unsigned long* newCount = new unsigned long[newSize];
+        unsigned long* newRangeCount = new unsigned long[newSize >> sub_bits];
+        if (!newCount || !newRangeCount)
+        {
+            perror("hcat: HdrHistogram::AddCount() Error allocating bins");
+            if (newCount) delete[] newCount;
+            return false;
+        }
+        memset(newCount, 0, newSize*sizeof(unsigned long));
+        memset(newRangeCount, 0, (newSize >> sub_bits)*sizeof(unsigned long));
+        if (bins.count)
+        {
+            unsigned long shift = bins.offset - lo;
+            memcpy(newCount + shift, bins.count, bins.size*sizeof(unsigned long));
+            memcpy(newRangeCount + (shift >> sub_bits), bins.range_count, 
+                   (bins.size >> sub_bits)*sizeof(unsigned long));
+            delete[] bins.count;
+            delete[] bins.range_count;
+        }
+        bins.offset = lo;
+        bins.size = newSize;
+        bins.count = newCount;
+        bins.range_count = newRangeCount;
+    }
+    unsigned long index = key - bins.offset;
+    bins.count[index] += count;
+    bins.range_count[index >> sub_bits] += count;
+    return true;
+}  // end HdrHistogram::AddCount()
+
+bool HdrHistogram::Record(double value, unsigned long count)
+{
+    if ((0 == count) || !(fabs(value) < HUGE_VAL)) return true;
+    if (0.0 == value)
+        zero_count += count;
+    else if (!AddCount((value < 0.0) ? neg : pos, Key(fabs(value)), count))
+        return false;
+    if (0 == total_count)
+    {
+        min_val = max_val = value;
+    }
+    else
+    {
+        if (value < min_val) min_val = value;
+        if (value > max_val) max_val = value;
+    }
+    total_count += count;
+    sum += value * (double)count;
+    return true;
+}  // end HdrHistogram::Record()
+
+bool HdrHistogram::MergeBins(BinArray& bins, const BinArray& from, unsigned int fromBits)
+{
+    for (unsigned long i = 0; i < from.size; i++)
+    {
+        if (0 == from.count[i]) continue;
+        unsigned long key = ConvertKey(from.offset + i, fromBits, sub_bits);
+        if (!AddCount(bins, key, from.count[i])) return false;
+    }
+    return true;
+}  // end HdrHistogram::MergeBins()
+
+// Moves the content of "h" to this histogram
+void HdrHistogram::Take(HdrHistogram& h)
+{
+    Clear(neg);
+    Clear(pos);
+    digits = h.digits;
+    sub_bits = h.sub_bits;
+    sub_count = h.sub_count;
+    total_count = h.total_count;
+    zero_count = h.zero_count;
+    min_val = h.min_val;
+    max_val = h.max_val;
+    sum = h.sum;
+    neg = h.neg;
+    pos = h.pos;
+    memset(&h.neg, 0, sizeof(BinArray));
+    memset(&h.pos, 0, sizeof(BinArray));
+    h.total_count = h.zero_count = 0;
+}  // end HdrHistogram::Take()
+
+bool HdrHistogram::Merge(const HdrHistogram& h)
+{
+    if (h.IsEmpty()) return true;
+    if (0 == digits)
+    {
+        if (!Init(h.digits)) return false;
+    }
+    else if (h.digits < digits)
+    {
+        // Reduce our precision to that of "h" first
+        HdrHistogram reduced;
+        reduced.Init(h.digits);
+        if (!reduced.Merge(*this)) return false;
+        Take(reduced);
+    }
+    if (!MergeBins(neg, h.neg, h.sub_bits) || !MergeBins(pos, h.pos, h.sub_bits))
+        return false;
+    if (IsEmpty())
+    {
+        min_val = h.min_val;
+        max_val = h.max_val;
+    }
+    else
+    {
+        if (h.min_val < min_val) min_val = h.min_val;
+        if (h.max_val > max_val) max_val = h.max_val;
+    }
+    total_count += h.total_count;
+    zero_count += h.zero_count;
+    sum += h.sum;
+    return true;
+}  // end HdrHistogram::Merge()
+
+double HdrHistogram::Percentile(double p) const
+{
+    unsigned long goal = (unsigned long)(((double)total_count) * p + 0.5);
+    if (0 == goal) return min_val;
+    unsigned long count = 0;
+    // Negative values, from the largest magnitude down
+    unsigned long r = neg.size >> sub_bits;
+    while (r-- > 0)
+    {
+        if ((count + neg.range_count[r]) < goal)
+        {
+            count += neg.range_count[r];
+            continue;
+        }
+        unsigned long i = (r + 1) << sub_bits;
+        while (i-- > (r << sub_bits))
+        {
+            count += neg.count[i];
+            if (count >= goal) return Clamp(-BinLow(neg.offset + i));
+        }
+    }
+    count += zero_count;
+    if (count >= goal) return Clamp(0.0);
+    // Positive values, from the smallest magnitude up
+    unsigned long numRanges = pos.size >> sub_bits;
+    for (r = 0; r < numRanges; r++)
+    {
+        if ((count + pos.range_count[r]) < goal)
+        {
+            count += pos.range_count[r];
+            continue;
+        }
+        unsigned long end = (r + 1) << sub_bits;
+        for (unsigned long i = r << sub_bits; i < end; i++)
+        {
+            count += pos.count[i];
+            if (count >= goal) return Clamp(BinLow(pos.offset + i + 1));
+        }
+    }
+    return max_val;
+}  // end HdrHistogram::Percentile()
+
+unsigned long HdrHistogram::CountInRange(double rangeMin, double rangeMax) const
+{
+    unsigned long rangeTotal = 0;
+    unsigned long i;
+    for (i = 0; i < neg.size; i++)
+    {
+        if (0 == neg.count[i]) continue;
+        double value = -BinMid(neg.offset + i);
+        if ((value >= rangeMin) && (value <= rangeMax)) rangeTotal += neg.count[i];
+    }
+    if ((0.0 >= rangeMin) && (0.0 <= rangeMax)) rangeTotal += zero_count;
+    for (i = 0; i < pos.size; i++)
+    {
+        if (0 == pos.count[i]) continue;
+        double value = BinMid(pos.offset + i);
+        if ((value >= rangeMin) && (value <= rangeMax)) rangeTotal += pos.count[i];
+    }
+    return rangeTotal;
+}  // end HdrHistogram::CountInRange()
+
+double HdrHistogram::PercentageInRange(double rangeMin, double rangeMax) const
+{
+    if (0 == total_count) return 0.0;
+    return (100.0 * ((double)CountInRange(rangeMin, rangeMax)) / ((double)total_count));
+}  // end HdrHistogram::PercentageInRange()
+
+void HdrHistogram::Print(FILE* file) const
+{
+    unsigned long i = neg.size;
+    while (i-- > 0)
+    {
+        if (neg.count[i])
+            fprintf(file, "%.9g, %lu\n", -BinMid(neg.offset + i), neg.count[i]);
+    }
+    if (zero_count) fprintf(file, "0, %lu\n", zero_count);
+    for (i = 0; i < pos.size; i++)
+    {
+        if (pos.count[i])
+            fprintf(file, "%.9g, %lu\n", BinMid(pos.offset + i), pos.count[i]);
+    }
+}  // end HdrHistogram::Print()
+
+// Bin counts are written as "hdr+ <sign>><firstKey>:<count>,<count>,-<emptyRun>,..."
+// lines, each starting at a non-empty bin
+void HdrHistogram::WriteBins(FILE* file, const BinArray& bins, const char* sign) const
+{
+    int len = 0;  // length of the current line (0 if none started)
+    unsigned long i = 0;
+    while (i < bins.size)
+    {
+        if (0 == bins.count[i])
+        {
+            unsigned long run = 1;
+            while (((i + run) < bins.size) && (0 == bins.count[i + run])) run++;
+            if (len > 0)
+            {
+                if (((i + run) < bins.size) && (len < WRITE_LINE_MAX))
+                {
+                    len += fprintf(file, ",-%lu", run);
+                }
+                else
+                {
+                    fprintf(file, "\n");
+                    len = 0;
+                }
+            }
+            i += run;
+            continue;
+        }
+        if (0 == len)
+            len = fprintf(file, "hdr+ %s>%lu:%lu", sign, bins.offset + i, bins.count[i]);
+        else
+            len += fprintf(file, ",%lu", bins.count[i]);
+        if (len >= WRITE_LINE_MAX)
+        {
+            fprintf(file, "\n");
+            len = 0;
+        }
+        i++;
+    }
+    if (len > 0) fprintf(file, "\n");
+}  // end HdrHistogram::WriteBins()
+
+void HdrHistogram::Write(FILE* file) const
+{
+    fprintf(file, "hdr digits>%u count>%lu min>%.17g max>%.17g sum>%.17g zero>%lu\n",
+            digits, total_count, min_val, max_val, sum, zero_count);
+    WriteBins(file, neg, "neg");
+    WriteBins(file, pos, "pos");
+}  // end HdrHistogram::Write()
+
+bool HdrHistogram::ReadLine(const char* text)
+{
+    if (!strncmp(text, "hdr+ ", 5))
+    {
+        if (0 == digits) return false;  // no header line yet
+        text += 5;
+        BinArray* bins;
+        if (!strncmp(text, "neg>", 4))
+            bins = &neg;
+        else if (!strncmp(text, "pos>", 4))
+            bins = &pos;
+        else
+            return false;
+        text += 4;
+        char* ptr;
+        unsigned long key = strtoul(text, &ptr, 10);
+        if ((ptr == text) || (':' != *ptr)) return false;
+        unsigned long keyMax = ((unsigned long)(EXPONENT_MAX + EXPONENT_BIAS + 1)) << sub_bits;
+        text = ptr + 1;
+        while ('\0' != *text)
+        {
+            long value = strtol(text, &ptr, 10);
+            if (ptr == text) return false;
+            if (value < 0)
+            {
+                key += (unsigned long)(-value);  // run of empty bins
+            }
+            else
+            {
+                if (key >= keyMax) return false;
+                if (!AddCount(*bins, key, value)) return false;
+                total_count += value;
+                key++;
+            }
+            text = ptr;
+            if (',' == *text) 
+                text++;
+            else if (('\0' != *text) && !isspace(*text))
+                return false;
+            else
+                break;
+        }
+        return true;
+    }
+    else if (!strncmp(text, "hdr ", 4))
+    {
+        unsigned int theDigits;
+        unsigned long count, zero;
+        double minVal, maxVal, theSum;
+        if (6 != sscanf(text, "hdr digits>%u count>%lu min>%lf max>%lf sum>%lf zero>%lu",
+                        &theDigits, &count, &minVal, &maxVal, &theSum, &zero))
+            return false;
+        if (!Init(theDigits)) return false;
+        // (the "count" is restored as the bin lines are read)
+        total_count = zero_count = zero;
+        min_val = minVal;
+        max_val = maxVal;
+        sum = theSum;
+        return true;
+    }
+    return false;
+}  // end HdrHistogram::ReadLine()
+
+
 int main(int argc, char* argv[])
 {
     bool doNormalize = false;
@@ -332,6 +804,12 @@ int main(int argc, char* argv[])
     double presetRangeMin = 0.0;
     double presetRangeMax = 0.0;
     
+    // HDR histogram output is used if "hdr" is given or any
+    // input file has HDR histogram ("hdr" lines) content
+    bool useHdr = false;
+    unsigned int hdrDigits = 3;  // for tallying non-HDR input
+    bool printBins = false;
+    
     // Process command line options
     int i = 1;
     while(i < argc)
@@ -368,6 +846,29 @@ int main(int argc, char* argv[])
             getCount = true;
             i++;
         }
+        else if (!strncmp(argv[i], "hdr", len))
+        {
+            if (++i >= argc)
+            {
+                fprintf(stderr, "hcat: missing \"hdr\" args!\n");
+                usage();
+                exit(-1); 
+            }
+            if ((1 != sscanf(argv[i], "%u", &hdrDigits)) || 
+                (hdrDigits < 1) || (hdrDigits > HdrHistogram::DIGITS_MAX))
+            {
+                fprintf(stderr, "hcat: invalid hdr <digits>!\n");
+                usage();
+                exit(-1);
+            }
+            useHdr = true;
+            i++;
+        }
+        else if (!strncmp(argv[i], "bins", len))
+        {
+            printBins = true;
+            i++;
+        }
         else if (!strncmp(argv[i], "pc", len))
         {
             getPercentile = true;
@@ -474,6 +975,13 @@ int main(int argc, char* argv[])
         }   
     }
     
+    HdrHistogram hdr;       // merged HDR histogram
+    HdrHistogram hdrInput;  // HDR histogram being read from input
+    HdrHistogram hdrTally;  // non-HDR input values
+    hdrTally.Init(hdrDigits);
+    bool hdrInputSeen = false;
+    if (useHdr) hdr.Init(hdrDigits);  // (merged at no more than "hdrDigits" precision)
+    
     bool firstBin = true;
     double minimum = 0.0;
     double mean = 0.0;
@@ -499,8 +1007,23 @@ int main(int argc, char* argv[])
                 continue;
             }
             len = MAX_LINE;
+            if (HdrHistogram::IsHdrLine(buffer))
+            {
+                // A header line starts a new histogram, so merge the last one
+                if (('+' != buffer[3]) && !hdr.Merge(hdrInput))
+                {
+                    fprintf(stderr, "hcat: Error merging hdr histogram!\n");
+                    exit(-1);
+                }
+                if (!hdrInput.ReadLine(buffer))
+                    fprintf(stderr, "hcat: Warning! Bad hdr histogram line in file: %s\n", argv[i]);
+                else if (doNormalize && !hdrInputSeen)
+                    fprintf(stderr, "hcat: Warning! \"normalize\" not applied to hdr histograms\n");
+                hdrInputSeen = useHdr = true;
+                continue;
+            }
             double value;
-            unsigned int count;
+            unsigned long count;
             
             int result = sscanf(buffer, "%lf, %lu", &value, &count);
             if (1 == result)
@@ -525,7 +1048,7 @@ int main(int argc, char* argv[])
                     value -= minimum;   
                 }
             }
-            if (!h.Tally(value, count))
+            if (!h.Tally(value, count) || !hdrTally.Record(value, count))
             {
                 fprintf(stderr, "hcat: Error adding tallying data point!\n");
                 exit(-1);
@@ -535,8 +1058,59 @@ int main(int argc, char* argv[])
         }  // end while(reader.Readline())   
         fclose(file);  
         firstBin = true;   
+        if (!hdr.Merge(hdrInput))
+        {
+            fprintf(stderr, "hcat: Error merging hdr histogram!\n");
+            exit(-1);
+        }
+        hdrInput.Reset();
     }  // end for(i=1..argc)
     
+    if (useHdr)
+    {
+        if (!hdr.Merge(hdrTally))
+        {
+            fprintf(stderr, "hcat: Error merging hdr histogram!\n");
+            exit(-1);
+        }
+        if (hdr.IsEmpty()) 
+        {
+            fprintf(stderr, "hcat: Warning! Empty histogram.\n");
+            exit(0);  // nothing to output
+        }
+        if (getPercentage)
+        {
+            fprintf(stdout, "%lf\n", hdr.PercentageInRange(rangeMin, rangeMax));
+        }
+        else if (getCount)
+        {
+            fprintf(stdout, "%lu\n", hdr.CountInRange(rangeMin, rangeMax));
+        }
+        else if (getPercentile)
+        {
+            fprintf(stdout, "%lf\n", hdr.Percentile(pc));
+        }
+        else
+        {
+            // Output merged histogram w/ percentile info, in the 
+            // compact form (for further merging) unless "bins" is given
+            const double p[6] = {0.99, 0.95, 0.9, 0.8, 0.75, 0.5};
+            fprintf(stdout, "#histogram: ");
+            fprintf(stdout, "min:%f max:%f mean:%lf percentiles: ", hdr.Min(), hdr.Max(), hdr.Mean());
+            for (int j = 0; j < 6; j++)
+            {
+                double percentile = hdr.Percentile(p[j]);
+                fprintf(stdout, "%2d>%f ", (int)(p[j]*100.0+0.5), percentile);
+            }
+            fprintf(stdout, "\n");
+            if (printBins)
+                hdr.Print(stdout);
+            else
+                hdr.Write(stdout);
+        }
+        return 0;
+    }
+    
     mean /= meanCount;
     
     if (h.IsEmpty()) 
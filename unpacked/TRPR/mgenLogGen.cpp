@@ -0,0 +1,121 @@
+// mgenLogGen: Synthetic MGEN log generator for timing "trpr"
+
+// Writes an MGEN text log of RECV events for many concurrent
+// UDP flows to stdout.  Each flow has its own source address
+// and port, destination port and flow id, so "trpr auto X"
+// enumerates every flow.  The output depends only on the
+// command line options, so logs for different "trpr" builds
+// can be compared byte-for-byte (see "bench" in Makefile.linux).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void usage()
+{
+    fprintf(stderr, "Usage: mgenLogGen [flows <count>][events <count>][rate <pps>]\n"
+                    "                  [loss <percent>][seed <value>]\n");
+}
+
+// Simple linear congruential generator so the log is
+// the same regardless of the C library's rand()
+class Random
+{
+    public:
+        Random(unsigned long seed) : state(seed) {}
+        unsigned long Next()
+        {
+            state = (state * 1103515245UL + 12345UL) & 0x7fffffffUL;
+            return (state >> 8);
+        }
+        double Uniform()  // [0.0, 1.0)
+            {return ((double)Next() / (double)(0x7fffffffUL >> 8));}
+
+    private:
+        unsigned long state;
+};  // end class Random
+
+void PrintTime(double t)
+{
+    unsigned long sec = (unsigned long)t;
+    unsigned long usec = (unsigned long)((t - (double)sec) * 1.0e+06);
+    if (usec > 999999) usec = 999999;
+    unsigned long hr = (sec / 3600) % 24;
+    unsigned long min = (sec / 60) % 60;
+    sec = sec % 60;
+    printf("%02lu:%02lu:%02lu.%06lu", hr, min, sec, usec);
+}  // end PrintTime()
+
+int main(int argc, char* argv[])
+{
+    unsigned long flowCount = 10000;
+    unsigned long eventCount = 300000;
+    double rate = 5000.0;   // aggregate packets per second
+    double lossPercent = 2.0;
+    unsigned long seed = 1;
+
+    int i = 1;
+    while (i < argc)
+    {
+        if ((i + 1) >= argc)
+        {
+            usage();
+            exit(-1);
+        }
+        const char* cmd = argv[i++];
+        const char* val = argv[i++];
+        if (!strcmp(cmd, "flows"))
+            flowCount = strtoul(val, NULL, 10);
+        else if (!strcmp(cmd, "events"))
+            eventCount = strtoul(val, NULL, 10);
+        else if (!strcmp(cmd, "rate"))
+            rate = atof(val);
+        else if (!strcmp(cmd, "loss"))
+            lossPercent = atof(val);
+        else if (!strcmp(cmd, "seed"))
+            seed = strtoul(val, NULL, 10);
+        else
+        {
+            fprintf(stderr, "mgenLogGen: invalid command \"%s\"\n", cmd);
+            usage();
+            exit(-1);
+        }
+    }
+    if ((0 == flowCount) || (flowCount > 65000) || (rate <= 0.0))
+    {
+        fprintf(stderr, "mgenLogGen: invalid flows (1-65000) or rate\n");
+        exit(-1);
+    }
+
+    unsigned long* seq = new unsigned long[flowCount];
+    if (NULL == seq)
+    {
+        perror("mgenLogGen: error allocating sequence numbers");
+        exit(-1);
+    }
+    memset(seq, 0, flowCount * sizeof(unsigned long));
+
+    Random rng(seed);
+    double t = 12.0 * 3600.0;  // start at noon
+    double interval = 1.0 / rate;
+    for (unsigned long n = 0; n < eventCount; n++)
+    {
+        t += 2.0 * interval * rng.Uniform();
+        unsigned long f = rng.Next() % flowCount;
+        if ((100.0 * rng.Uniform()) < lossPercent)
+        {
+            seq[f]++;  // a lost packet leaves a sequence gap
+            continue;
+        }
+        unsigned long flowId = f + 1;
+        double sent = t - 0.001 - 0.009 * rng.Uniform();
+        PrintTime(t);
+        printf(" RECV proto>UDP flow>%lu seq>%lu src>10.%lu.%lu.1/%lu dst>192.168.1.1/%lu sent>",
+               flowId, seq[f]++, (flowId >> 8) & 0xff, flowId & 0xff,
+               4000 + (flowId % 1000), 5000 + flowId);
+        PrintTime(sent);
+        printf(" size>%lu\n", 64 + 8 * (flowId % 128));
+    }
+    delete[] seq;
+    return 0;
+}  // end main()
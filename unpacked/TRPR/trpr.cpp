@@ -40,6 +40,7 @@
 #include <string.h>
 #include <math.h>
 #include <ctype.h>  // for isspace()
+#include <time.h>   // for localtime()
 
 #include <assert.h>
 
@@ -56,6 +57,10 @@ inline int isnan(double x) {return _isnan(x);}
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/stat.h>
+#include <sys/mman.h>  // for mmap()
+#include <fcntl.h>
+#include <pthread.h>
 #endif // !WIN32
 
 #define VERSION "2.1b3"
@@ -67,7 +72,7 @@ inline int isnan(double x) {return _isnan(x);}
 
 const int MAX_LINE = 256;
 
-enum TraceFormat {TCPDUMP, DREC, NS};
+enum TraceFormat {TCPDUMP, DREC, NS, PCAP, MGEN_BINARY};
 enum PlotMode {RATE, INTERARRIVAL, LATENCY, DROPS, LOSS, LOSS2, COUNT, VELOCITY};
 
 class FastReader
@@ -79,12 +84,15 @@ class FastReader
                                 double timeout = -1.0);
         FastReader::Result Readline(FILE* filePtr, char* buffer, unsigned int* len,
                                     double timeout = -1.0);
+        // true once all input has been consumed
+        bool AtEnd() const {return at_end;}
 
     private:
         enum {BUFSIZE = 2048};
         char         savebuf[BUFSIZE];
         char*        saveptr;
         unsigned int savecount;
+        bool         at_end;
 };  // end class FastReader
 
 #ifndef WIN32
@@ -237,7 +245,9 @@ class PacketEvent
         enum EventType {INVALID, RECEPTION, TRANSMISSION, DROP, LOSS, TIMEOUT};
     
         PacketEvent();
+        PacketEvent(const PacketEvent& e);
         ~PacketEvent();
+        PacketEvent& operator=(const PacketEvent& e);
         
         
         // Generalized tracepoint node(a,[b]) NS
@@ -359,10 +369,41 @@ class PacketEvent
 
 PacketEvent::PacketEvent()
 : type(INVALID), time(-1.0), src_port(-1), dst_port(-1), size(0), protocol(NULL),
-  pos_x(999.0), pos_y(999.0)
+  tx_time(-1.0), rx_time(-1.0), sequence(0), pos_x(999.0), pos_y(999.0)
 {
 }
 
+PacketEvent::PacketEvent(const PacketEvent& e)
+ : protocol(NULL)
+{
+    *this = e;
+}
+
+PacketEvent& PacketEvent::operator=(const PacketEvent& e)
+{
+    if (this != &e)
+    {
+        // Only reallocate the protocol name when it changes
+        if (!protocol || !e.protocol || strcmp(protocol, e.protocol))
+            SetProtocol(e.protocol);
+        type = e.type;
+        time = e.time;
+        link = e.link;
+        src_addr = e.src_addr;
+        src_port = e.src_port;
+        dst_addr = e.dst_addr;
+        dst_port = e.dst_port;
+        size = e.size;
+        tx_time = e.tx_time;
+        rx_time = e.rx_time;
+        sequence = e.sequence;
+        flow_id = e.flow_id;
+        pos_x = e.pos_x;
+        pos_y = e.pos_y;
+    }
+    return *this;
+}  // end PacketEvent::operator=()
+
 PacketEvent::~PacketEvent()
 {
     if (protocol) delete protocol;
@@ -418,6 +459,10 @@ class EventParser
                                         PacketEvent*    theEvent, 
                                         double          timeout = -1.0) = 0;
         
+        // true if parsing stopped because the input was exhausted
+        // (as opposed to a read error)
+        virtual bool AtEnd() const {return reader.AtEnd();}
+        
     protected:
         FastReader	reader;
         
@@ -440,6 +485,8 @@ class TcpdumpEventParser : public EventParser
                                 PacketEvent*    theEvent, 
                                 double          timeout = -1.0);
         unsigned int PackHexLine(char* text, char* buf, unsigned int buflen);
+        // Fills in "theEvent" from a packed IP header (up to 44 bytes)
+        void SetEvent(PacketEvent* theEvent, const char* hdr, double theTime);
 
         unsigned int Version(const char* hdr) const
             {  return (((unsigned char)hdr[0] >> 4 ) & 0x0f);}
@@ -461,7 +508,7 @@ class TcpdumpEventParser : public EventParser
 	      else
 		    return (PayloadLength(hdr) + 40);
         }
-        unsigned char Protocol(char* hdr)
+        unsigned char Protocol(const char* hdr)
         {
             if(Version(hdr) == 4)
                 return ((unsigned char)hdr[9]);
@@ -513,7 +560,7 @@ class TcpdumpEventParser : public EventParser
 	        {
 	            unsigned long buf[4];
 	            Address theAddress;
-	            for(unsigned int i = 0; i<=4 ; i++)
+	            for(unsigned int i = 0; i < 4; i++)
 	            {
 
                     buf[i] = ((256*256*256)*((unsigned char)hdr[(i*4)+24]) +
@@ -560,6 +607,172 @@ class DrecEventParser : public EventParser
                                 double          timeout = -1.0);
 };  // end class DrecEventParser
 
+// Reads libpcap ("tcpdump -w") and pcapng capture files directly,
+// decoding the link layer to find the IP header of each packet
+class PcapEventParser : public TcpdumpEventParser
+{
+    public:
+        PcapEventParser();
+        bool GetNextPacketEvent(FILE*           filePtr, 
+                                PacketEvent*    theEvent, 
+                                double          timeout = -1.0);
+        bool AtEnd() const {return at_end;}
+        
+    private:
+        // (IP_HEADER_MAX covers an IPv4 header with options plus ports)
+        enum {MAX_INTERFACES = 32, MAX_LINK_HEADER = 64, IP_HEADER_MAX = 64};
+        
+        bool ReadFileHeader(FILE* filePtr);
+        bool ReadSectionHeader(FILE* filePtr, const unsigned char* lengthField);
+        bool ReadPcapRecord(FILE* filePtr, PacketEvent* theEvent, bool& gotEvent);
+        bool ReadPcapngBlock(FILE* filePtr, PacketEvent* theEvent, bool& gotEvent);
+        bool ReadPacket(FILE*           filePtr, 
+                        unsigned int    linkType, 
+                        unsigned long   captureLength,
+                        double          theTime,
+                        PacketEvent*    theEvent,
+                        bool&           gotEvent);
+        bool Skip(FILE* filePtr, unsigned long numBytes);
+        
+        unsigned long Get16(const unsigned char* p) const
+        {
+            return (little_endian ? (p[0] | (p[1] << 8)) : ((p[0] << 8) | p[1]));
+        }
+        unsigned long Get32(const unsigned char* p) const
+        {
+            return (little_endian ? 
+                    ((unsigned long)p[0] | ((unsigned long)p[1] << 8) | 
+                     ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24)) :
+                    (((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) | 
+                     ((unsigned long)p[2] << 8) | (unsigned long)p[3]));
+        }
+        // Local time of day, as printed by tcpdump
+        double TimeOfDay(unsigned long seconds, double fraction);
+        
+        bool            started;
+        bool            at_end;
+        bool            pcapng;
+        bool            little_endian;
+        bool            seekable;
+        // libpcap file link type and timestamp units per second
+        unsigned int    link_type;
+        double          ts_units;
+        // pcapng per-interface link types and timestamp units
+        unsigned int    if_count;
+        unsigned int    if_link_type[MAX_INTERFACES];
+        double          if_ts_units[MAX_INTERFACES];
+        bool            spb_warned;
+        // Cached local time offset for the current 15 minute interval
+        unsigned long   tz_interval;
+        long            tz_offset;
+        unsigned char   block_buffer[65536];
+};  // end class PcapEventParser
+
+// Reads MGEN binary log files (as written with MGEN's "binary" logging 
+// option) directly, without conversion to text
+class MgenBinaryEventParser : public EventParser
+{
+    public:
+        MgenBinaryEventParser();
+        bool GetNextPacketEvent(FILE*           filePtr, 
+                                PacketEvent*    theEvent, 
+                                double          timeout = -1.0);
+        bool AtEnd() const {return at_end;}
+        
+    private:
+        // (these values are from MGEN's "mgenGlobals.h" and "mgenMsg.h")
+        enum RecordType {RECV_EVENT = 1, SEND_EVENT = 3};
+        enum Protocol {TCP = 2};
+        enum AddressType {IPv4 = 1, IPv6 = 2};
+        enum GPSStatus {CURRENT = 2};
+        enum {MSG_VERSION = 2, MSG_MIN_SIZE = 28, HEADER_MAX = 128};
+        
+        bool ReadFileHeader(FILE* filePtr);
+        bool ParseMessage(const unsigned char*  buffer, 
+                          unsigned int          bufferLen, 
+                          PacketEvent*          theEvent);
+        static bool GetAddress(const unsigned char* buffer, 
+                               unsigned int         addrType, 
+                               unsigned int         addrLen, 
+                               Address&             theAddress);
+        static unsigned long Get16(const unsigned char* p)
+            {return ((p[0] << 8) | p[1]);}
+        static unsigned long Get32(const unsigned char* p)
+        {
+            return (((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) | 
+                    ((unsigned long)p[2] << 8) | (unsigned long)p[3]);
+        }
+        // (MGEN logs GMT time of day by default)
+        static double TimeOfDay(unsigned long seconds, unsigned long microseconds)
+            {return ((double)(seconds % 86400) + (1.0e-06 * (double)microseconds));}
+        
+        bool            started;
+        bool            at_end;
+        unsigned char   record[65536];
+};  // end class MgenBinaryEventParser
+
+#ifndef WIN32
+// (No parallel TRPR input support for WIN32 yet)
+// The ParallelEventParser memory-maps an input trace file and splits it at
+// line (or tcpdump record) boundaries into chunks that are parsed concurrently
+// by worker threads, each using its own private EventParser.  Parsed events
+// are handed out strictly in file order so that flow matching and analysis
+// remain sequential and the output is identical to single-threaded parsing.
+// Parsing of the next batch of chunks overlaps analysis of the current one.
+class ParallelEventParser : public EventParser
+{
+    public:
+        ParallelEventParser(TraceFormat traceFormat, unsigned int threadCount);
+        ~ParallelEventParser();
+        
+        bool Open(const char* path);
+        void Close();
+        bool GetNextPacketEvent(FILE*           filePtr, 
+                                PacketEvent*    theEvent, 
+                                double          timeout = -1.0);
+        bool AtEnd() const {return at_end;}
+        
+    private:
+        enum {CHUNK_SIZE = 1048576};
+        
+        class Chunk
+        {
+            public:
+                Chunk();
+                ~Chunk();
+                
+                void Parse();
+                static void* DoParse(void* arg);
+                
+                TraceFormat     format;
+                const char*     text;
+                unsigned long   length;
+                PacketEvent*    event_list;
+                unsigned long   event_max;
+                unsigned long   event_count;
+                bool            complete;  // false if parsing stopped early
+                bool            started;   // true if worker thread is running
+                pthread_t       thread;
+        };  // end class ParallelEventParser::Chunk
+        
+        void StartBatch(unsigned int batch);
+        void FinishBatch(unsigned int batch);
+        
+        TraceFormat     format;
+        unsigned int    thread_count;
+        char*           map_ptr;
+        unsigned long   map_size;
+        unsigned long   map_offset;       // start of next unparsed chunk
+        Chunk*          chunk_list[2];    // double-buffered chunk batches
+        unsigned int    chunk_count[2];
+        unsigned int    current_batch;
+        bool            current_ready;    // current batch parsing is finished
+        unsigned int    current_chunk;
+        unsigned long   current_event;
+        bool            at_end;
+};  // end class ParallelEventParser
+#endif // !WIN32
+
 
 class Point
 {
@@ -725,6 +938,8 @@ class LossTracker3
             seq_qtr = seqMax >> 2;
             init = true;
             packet_count = 0;
+            wrap_count = 0;
+            duplicate_count = 0;
         }
         void Reset()
         {
@@ -1080,6 +1295,476 @@ double Histogram::Percentile(double p)
     return max_val;
 }  // end Histogram::Percentile()
 
+// HDR-style log-linear histogram.  Each power-of-2 range of |value| is split 
+// into 2^sub_bits linear bins, enough to resolve values to "digits" significant
+// decimal digits, so recording is O(1) and needs no rescaling.  Bin counts
+// are kept (for negative and positive values) over the range of bins used so
+// far, with a sum per power-of-2 range for fast percentile queries.  The 
+// Write() text form merges losslessly with ReadLine() and Merge()
+class HdrHistogram
+{
+    public:
+        HdrHistogram();
+        ~HdrHistogram();
+        bool Init(unsigned int numDigits);  // (1 to DIGITS_MAX)
+        void Reset();  // (back to uninitialized)
+        unsigned int Digits() const {return digits;}
+        bool IsEmpty() const {return (0 == total_count);}
+        // (non-finite values are ignored)
+        bool Record(double value, unsigned long count = 1);
+        // Adds the counts of "h", keeping the lower precision of the two
+        bool Merge(const HdrHistogram& h);
+        unsigned long Count() const {return total_count;}
+        double Min() const {return min_val;}
+        double Max() const {return max_val;}
+        double Mean() const {return (total_count ? (sum / (double)total_count) : 0.0);}
+        // Returns the highest value equivalent (within precision) to the
+        // value at percentile "p" (0.0 - 1.0)
+        double Percentile(double p) const;
+        unsigned long CountInRange(double rangeMin, double rangeMax) const;
+        double PercentageInRange(double rangeMin, double rangeMax) const;
+        // Prints "value, count" (bin midpoint) lines for non-empty bins
+        void Print(FILE* file) const;
+        // Prints the compact text form: an "hdr" header line followed
+        // by "hdr+" lines of run-length encoded bin counts
+        void Write(FILE* file) const;
+        // Parses a Write() line (an "hdr" header line resets the histogram)
+        bool ReadLine(const char* text);
+        static bool IsHdrLine(const char* text) 
+            {return (0 == strncmp(text, "hdr", 3));}
+        
+        enum {DIGITS_MAX = 5};
+            
+    private:
+        HdrHistogram(const HdrHistogram&);  // (not copyable)
+        HdrHistogram& operator=(const HdrHistogram&);
+        
+        // Keeps the bin keys of all finite, non-zero |value| positive
+        enum {EXPONENT_BIAS = 1100, EXPONENT_MAX = 1024};
+        enum {WRITE_LINE_MAX = 800};  // (fits the 1024 byte hcat line buffer)
+        
+        // Bins for negative or positive values, by |value| key
+        typedef struct
+        {
+            unsigned long   offset;  // key of count[0] (first key of a power-of-2 range)
+            unsigned long   size;    // (a multiple of sub_count)
+            unsigned long*  count;
+            unsigned long*  range_count;  // per sub_count bins
+        } BinArray;
+        
+        unsigned long Key(double magnitude) const
+        {
+            int exponent;
+            double mantissa = frexp(magnitude, &exponent);  // 0.5 <= mantissa < 1.0
+            unsigned long sub = (unsigned long)((mantissa - 0.5) * (double)(2*sub_count));
+            return ((((unsigned long)(exponent + EXPONENT_BIAS)) << sub_bits) + sub);
+        }
+        // Lowest |value| in the bin for "key" (its width is BinLow(key+1) - BinLow(key))
+        double BinLow(unsigned long key) const
+        {
+            return ldexp((double)(sub_count + (key & (sub_count - 1))),
+                         ((int)(key >> sub_bits)) - EXPONENT_BIAS - 1 - sub_bits);
+        }
+        double BinMid(unsigned long key) const
+            {return (0.5 * (BinLow(key) + BinLow(key + 1)));}
+        // Maps a "key" to its bin at "toBits" (<= "fromBits") precision
+        static unsigned long ConvertKey(unsigned long key, unsigned int fromBits, unsigned int toBits)
+        {
+            return (((key >> fromBits) << toBits) | 
+                    ((key & ((1UL << fromBits) - 1)) >> (fromBits - toBits)));
+        }
+        double Clamp(double value) const
+            {return ((value < min_val) ? min_val : ((value > max_val) ? max_val : value));}
+        bool AddCount(BinArray& bins, unsigned long key, unsigned long count);
+        bool MergeBins(BinArray& bins, const BinArray& from, unsigned int fromBits);
+        void WriteBins(FILE* file, const BinArray& bins, const char* sign) const;
+        void Clear(BinArray& bins);
+        void Take(HdrHistogram& h);
+        
+        unsigned int    digits;    // 0 until Init()
+        unsigned int    sub_bits;  
+        unsigned long   sub_count; // bins per power-of-2 range
+        unsigned long   total_count;
+        unsigned long   zero_count;
+        double          min_val;
+        double          max_val;
+        double          sum;
+        BinArray        neg;
+        BinArray        pos;
+};  // end class HdrHistogram
+
+HdrHistogram::HdrHistogram()
+ : digits(0), sub_bits(0), sub_count(1), total_count(0), zero_count(0),
+   min_val(0.0), max_val(0.0), sum(0.0)
+{
+    memset(&neg, 0, sizeof(BinArray));
+    memset(&pos, 0, sizeof(BinArray));
+}
+
+HdrHistogram::~HdrHistogram()
+{
+    Clear(neg);
+    Clear(pos);
+}
+
+void HdrHistogram::Clear(BinArray& bins)
+{
+    if (bins.count) delete[] bins.count;
+    if (bins.range_count) delete[] bins.range_count;
+    memset(&bins, 0, sizeof(BinArray));
+}  // end HdrHistogram::Clear()
+
+bool HdrHistogram::Init(unsigned int numDigits)
+{
+    if ((numDigits < 1) || (numDigits > DIGITS_MAX)) return false;
+    Clear(neg);
+    Clear(pos);
+    // Enough linear bins per power-of-2 range to resolve 2*10^digits 
+    // values (i.e. the relative bin width is at most 1/(2*10^digits))
+    unsigned long resolution = 2;
+    for (unsigned int i = 0; i < numDigits; i++) resolution *= 10;
+    digits = numDigits;
+    sub_bits = 0;
+    while ((1UL << sub_bits) < resolution) sub_bits++;
+    sub_count = 1UL << sub_bits;
+    total_count = zero_count = 0;
+    min_val = max_val = sum = 0.0;
+    return true;
+}  // end HdrHistogram::Init()
+
+void HdrHistogram::Reset()
+{
+    Clear(neg);
+    Clear(pos);
+    digits = 0;
+    total_count = zero_count = 0;
+    min_val = max_val = sum = 0.0;
+}  // end HdrHistogram::Reset()
+
+bool HdrHistogram::AddCount(BinArray& bins, unsigned long key, unsigned long count)
+{
+    if ((NULL == bins.count) || (key < bins.offset) || (key >= (bins.offset + bins.size)))
+    {
+        // Grow the bin array to cover the power-of-2 range of "key"
+        unsigned long lo = key & ~(sub_count - 1);
+        unsigned long hi = lo + sub_count;
+        if (bins.count)
+        {
+            if (bins.offset < lo) lo = bins.offset;
+            if ((bins.offset + bins.size) > hi) hi = bins.offset + bins.size;
+        }
+        unsigned long newSize = hi - lo;
+        unsigned long* newCount = new unsigned long[newSize];
+        unsigned long* newRangeCount = new unsigned long[newSize >> sub_bits];
+        if (!newCount || !newRangeCount)
+        {
+            perror("trpr: HdrHistogram::AddCount() Error allocating bins");
+            if (newCount) delete[] newCount;
+            return false;
+        }
+        memset(newCount, 0, newSize*sizeof(unsigned long));
+        memset(newRangeCount, 0, (newSize >> sub_bits)*sizeof(unsigned long));
+        if (bins.count)
+        {
+            unsigned long shift = bins.offset - lo;
+            memcpy(newCount + shift, bins.count, bins.size*sizeof(unsigned long));
+            memcpy(newRangeCount + (shift >> sub_bits), bins.range_count, 
+                   (bins.size >> sub_bits)*sizeof(unsigned long));
+            delete[] bins.count;
+            delete[] bins.range_count;
+        }
+        bins.offset = lo;
+        bins.size = newSize;
+        bins.count = newCount;
+        bins.range_count = newRangeCount;
+    }
+    unsigned long index = key - bins.offset;
+    bins.count[index] += count;
+    bins.range_count[index >> sub_bits] += count;
+    return true;
+}  // end HdrHistogram::AddCount()
+
+bool HdrHistogram::Record(double value, unsigned long count)
+{
+    if ((0 == count) || !(fabs(value) < HUGE_VAL)) return true;
+    if (0.0 == value)
+        zero_count += count;
+    else if (!AddCount((value < 0.0) ? neg : pos, Key(fabs(value)), count))
+        return false;
+    if (0 == total_count)
+    {
+        min_val = max_val = value;
+    }
+    else
+    {
+        if (value < min_val) min_val = value;
+        if (value > max_val) max_val = value;
+    }
+    total_count += count;
+    sum += value * (double)count;
+    return true;
+}  // end HdrHistogram::Record()
+
+bool HdrHistogram::MergeBins(BinArray& bins, const BinArray& from, unsigned int fromBits)
+{
+    for (unsigned long i = 0; i < from.size; i++)
+    {
+        if (0 == from.count[i]) continue;
+        unsigned long key = ConvertKey(from.offset + i, fromBits, sub_bits);
+        if (!AddCount(bins, key, from.count[i])) return false;
+    }
+    return true;
+}  // end HdrHistogram::MergeBins()
+
+// Moves the content of "h" to this histogram
+void HdrHistogram::Take(HdrHistogram& h)
+{
+    Clear(neg);
+    Clear(pos);
+    digits = h.digits;
+    sub_bits = h.sub_bits;
+    sub_count = h.sub_count;
+    total_count = h.total_count;
+    zero_count = h.zero_count;
+    min_val = h.min_val;
+    max_val = h.max_val;
+    sum = h.sum;
+    neg = h.neg;
+    pos = h.pos;
+    memset(&h.neg, 0, sizeof(BinArray));
+    memset(&h.pos, 0, sizeof(BinArray));
+    h.total_count = h.zero_count = 0;
+}  // end HdrHistogram::Take()
+
+bool HdrHistogram::Merge(const HdrHistogram& h)
+{
+    if (h.IsEmpty()) return true;
+    if (0 == digits)
+    {
+        if (!Init(h.digits)) return false;
+    }
+    else if (h.digits < digits)
+    {
+        // Reduce our precision to that of "h" first
+        HdrHistogram reduced;
+        reduced.Init(h.digits);
+        if (!reduced.Merge(*this)) return false;
+        Take(reduced);
+    }
+    if (!MergeBins(neg, h.neg, h.sub_bits) || !MergeBins(pos, h.pos, h.sub_bits))
+        return false;
+    if (IsEmpty())
+    {
+        min_val = h.min_val;
+        max_val = h.max_val;
+    }
+    else
+    {
+        if (h.min_val < min_val) min_val = h.min_val;
+        if (h.max_val > max_val) max_val = h.max_val;
+    }
+    total_count += h.total_count;
+    zero_count += h.zero_count;
+    sum += h.sum;
+    return true;
+}  // end HdrHistogram::Merge()
+
+double HdrHistogram::Percentile(double p) const
+{
+    unsigned long goal = (unsigned long)(((double)total_count) * p + 0.5);
+    if (0 == goal) return min_val;
+    unsigned long count = 0;
+    // Negative values, from the largest magnitude down
+    unsigned long r = neg.size >> sub_bits;
+    while (r-- > 0)
+    {
+        if ((count + neg.range_count[r]) < goal)
+        {
+            count += neg.range_count[r];
+            continue;
+        }
+        unsigned long i = (r + 1) << sub_bits;
+        while (i-- > (r << sub_bits))
+        {
+            count += neg.count[i];
+            if (count >= goal) return Clamp(-BinLow(neg.offset + i));
+        }
+    }
+    count += zero_count;
+    if (count >= goal) return Clamp(0.0);
+    // Positive values, from the smallest magnitude up
+    unsigned long numRanges = pos.size >> sub_bits;
+    for (r = 0; r < numRanges; r++)
+    {
+        if ((count + pos.range_count[r]) < goal)
+        {
+            count += pos.range_count[r];
+            continue;
+        }
+        unsigned long end = (r + 1) << sub_bits;
+        for (unsigned long i = r << sub_bits; i < end; i++)
+        {
+            count += pos.count[i];
+            if (count >= goal) return Clamp(BinLow(pos.offset + i + 1));
+        }
+    }
+    return max_val;
+}  // end HdrHistogram::Percentile()
+
+unsigned long HdrHistogram::CountInRange(double rangeMin, double rangeMax) const
+{
+    unsigned long rangeTotal = 0;
+    unsigned long i;
+    for (i = 0; i < neg.size; i++)
+    {
+        if (0 == neg.count[i]) continue;
+        double value = -BinMid(neg.offset + i);
+        if ((value >= rangeMin) && (value <= rangeMax)) rangeTotal += neg.count[i];
+    }
+    if ((0.0 >= rangeMin) && (0.0 <= rangeMax)) rangeTotal += zero_count;
+    for (i = 0; i < pos.size; i++)
+    {
+        if (0 == pos.count[i]) continue;
+        double value = BinMid(pos.offset + i);
+        if ((value >= rangeMin) && (value <= rangeMax)) rangeTotal += pos.count[i];
+    }
+    return rangeTotal;
+}  // end HdrHistogram::CountInRange()
+
+double HdrHistogram::PercentageInRange(double rangeMin, double rangeMax) const
+{
+    if (0 == total_count) return 0.0;
+    return (100.0 * ((double)CountInRange(rangeMin, rangeMax)) / ((double)total_count));
+}  // end HdrHistogram::PercentageInRange()
+
+void HdrHistogram::Print(FILE* file) const
+{
+    unsigned long i = neg.size;
+    while (i-- > 0)
+    {
+        if (neg.count[i])
+            fprintf(file, "%.9g, %lu\n", -BinMid(neg.offset + i), neg.count[i]);
+    }
+    if (zero_count) fprintf(file, "0, %lu\n", zero_count);
+    for (i = 0; i < pos.size; i++)
+    {
+        if (pos.count[i])
+            fprintf(file, "%.9g, %lu\n", BinMid(pos.offset + i), pos.count[i]);
+    }
+}  // end HdrHistogram::Print()
+
+// Bin counts are written as "hdr+ <sign>><firstKey>:<count>,<count>,-<emptyRun>,..."
+// lines, each starting at a non-empty bin
+void HdrHistogram::WriteBins(FILE* file, const BinArray& bins, const char* sign) const
+{
+    int len = 0;  // length of the current line (0 if none started)
+    unsigned long i = 0;
+    while (i < bins.size)
+    {
+        if (0 == bins.count[i])
+        {
+            unsigned long run = 1;
+            while (((i + run) < bins.size) && (0 == bins.count[i + run])) run++;
+            if (len > 0)
+            {
+                if (((i + run) < bins.size) && (len < WRITE_LINE_MAX))
+                {
+                    len += fprintf(file, ",-%lu", run);
+                }
+                else
+                {
+                    fprintf(file, "\n");
+                    len = 0;
+                }
+            }
+            i += run;
+            continue;
+        }
+        if (0 == len)
+            len = fprintf(file, "hdr+ %s>%lu:%lu", sign, bins.offset + i, bins.count[i]);
+        else
+            len += fprintf(file, ",%lu", bins.count[i]);
+        if (len >= WRITE_LINE_MAX)
+        {
+            fprintf(file, "\n");
+            len = 0;
+        }
+        i++;
+    }
+    if (len > 0) fprintf(file, "\n");
+}  // end HdrHistogram::WriteBins()
+
+void HdrHistogram::Write(FILE* file) const
+{
+    fprintf(file, "hdr digits>%u count>%lu min>%.17g max>%.17g sum>%.17g zero>%lu\n",
+            digits, total_count, min_val, max_val, sum, zero_count);
+    WriteBins(file, neg, "neg");
+    WriteBins(file, pos, "pos");
+}  // end HdrHistogram::Write()
+
+bool HdrHistogram::ReadLine(const char* text)
+{
+    if (!strncmp(text, "hdr+ ", 5))
+    {
+        if (0 == digits) return false;  // no header line yet
+        text += 5;
+        BinArray* bins;
+        if (!strncmp(text, "neg>", 4))
+            bins = &neg;
+        else if (!strncmp(text, "pos>", 4))
+            bins = &pos;
+        else
+            return false;
+        text += 4;
+        char* ptr;
+        unsigned long key = strtoul(text, &ptr, 10);
+        if ((ptr == text) || (':' != *ptr)) return false;
+        unsigned long keyMax = ((unsigned long)(EXPONENT_MAX + EXPONENT_BIAS + 1)) << sub_bits;
+        text = ptr + 1;
+        while ('\0' != *text)
+        {
+            long value = strtol(text, &ptr, 10);
+            if (ptr == text) return false;
+            if (value < 0)
+            {
+                key += (unsigned long)(-value);  // run of empty bins
+            }
+            else
+            {
+                if (key >= keyMax) return false;
+                if (!AddCount(*bins, key, value)) return false;
+                total_count += value;
+                key++;
+            }
+            text = ptr;
+            if (',' == *text) 
+                text++;
+            else if (('\0' != *text) && !isspace(*text))
+                return false;
+            else
+                break;
+        }
+        return true;
+    }
+    else if (!strncmp(text, "hdr ", 4))
+    {
+        unsigned int theDigits;
+        unsigned long count, zero;
+        double minVal, maxVal, theSum;
+        if (6 != sscanf(text, "hdr digits>%u count>%lu min>%lf max>%lf sum>%lf zero>%lu",
+                        &theDigits, &count, &minVal, &maxVal, &theSum, &zero))
+            return false;
+        if (!Init(theDigits)) return false;
+        // (the "count" is restored as the bin lines are read)
+        total_count = zero_count = zero;
+        min_val = minVal;
+        max_val = maxVal;
+        sum = theSum;
+        return true;
+    }
+    return false;
+}  // end HdrHistogram::ReadLine()
+
 
 class Flow
 {
@@ -1089,6 +1774,7 @@ class Flow
         Flow(bool presetFlow = false);
         ~Flow();        
         bool InitFromDescription(char* flowInfo);
+        bool CopyDescription(const Flow& theFlow);
         void PrintDescription(FILE* f);
         const char* Type() {return type;}
         bool SetType(const char* theType);
@@ -1104,6 +1790,8 @@ class Flow
         unsigned long FlowId() {return flow_id.Value();}
         
         bool IsPreset() {return preset;}
+        // Position in its FlowList (1 for the head)
+        unsigned long Index() const {return index;}
         
         bool TypeMatch(const char* theType) const
         {
@@ -1192,7 +1880,10 @@ class Flow
                 if (value < sum_min) sum_min = value;
                 if (value > sum_max) sum_max = value;
             }
-            histogram.Tally(value);
+            if (hdr_histogram.Digits())
+                hdr_histogram.Record(value);
+            else
+                histogram.Tally(value);
         }
         double SummaryAverage() {return (sum_total / sum_weight);}
         double SummaryVariance() 
@@ -1214,8 +1905,21 @@ class Flow
         }
         double UpdatePosition(double theTime, double x, double y);
         
-        void PrintHistogram(FILE* file) {histogram.Print(file);}
-        double Percentile(double p) {return histogram.Percentile(p);}
+        // Selects an HDR histogram (instead of the default self-scaling one)
+        bool InitHdrHistogram(unsigned int digits) {return hdr_histogram.Init(digits);}
+        unsigned int HdrDigits() const {return hdr_histogram.Digits();}
+        void PrintHistogram(FILE* file) 
+        {
+            if (hdr_histogram.Digits())
+                hdr_histogram.Write(file);
+            else
+                histogram.Print(file);
+        }
+        double Percentile(double p) 
+        {
+            return (hdr_histogram.Digits() ? hdr_histogram.Percentile(p) :
+                                             histogram.Percentile(p));
+        }
         
             
     private:
@@ -1257,7 +1961,12 @@ class Flow
         
         // histogram
         Histogram       histogram;
+        HdrHistogram    hdr_histogram;  // (used instead if initialized)
         
+        // FlowList position and match index linkage
+        unsigned long   index;
+        bool            indexed;    // in hash index (else in wildcard list)
+        Flow*           hash_next;  // hash bucket or wildcard list link
             
         Flow* prev;
         Flow* next;  
@@ -1269,21 +1978,62 @@ class FlowList
         FlowList();
         ~FlowList();
         void Destroy();
+        // (a flow's addresses, ports and flow id must not change once appended)
         void Append(Flow* theFlow);
         void Remove(Flow* theFlow);
         Flow* Head() {return head;}
         unsigned long Count() {return count;}
+        
+        // Returns the next flow after "prevFlow" (NULL to start at the head),
+        // in list order, that matches the given packet.  Flows with exact 
+        // addresses, ports and flow id (e.g. auto-matched flows) are found 
+        // with a hash index, so only flows with wildcards are walked.
+        Flow* FindNextMatch(Flow*           prevFlow,
+                            const char*     theType, 
+                            const Address&  srcAddr, unsigned short srcPort, 
+                            const Address&  dstAddr, unsigned short dstPort, 
+                            unsigned long   flowId);
     
     private:
+        static bool IsExact(const Flow* theFlow)
+        {
+            return (theFlow->src_addr.IsValid() && (theFlow->src_port >= 0) &&
+                    theFlow->dst_addr.IsValid() && (theFlow->dst_port >= 0) &&
+                    theFlow->flow_id.IsValid());
+        }
+        static unsigned long HashKey(const Address& srcAddr, unsigned short srcPort, 
+                                     const Address& dstAddr, unsigned short dstPort, 
+                                     unsigned long flowId);
+        bool ResizeIndex(unsigned long newSize);
+        
         Flow*           head;
         Flow*           tail;
         unsigned long   count;
+        
+        Flow**          hash_table;     // exact flows, by HashKey()
+        unsigned long   hash_size;      // (power of 2)
+        Flow*           wildcard_head;  // other flows, in list order
+        Flow*           wildcard_tail;
     
 };  // end class FlowList
 
 void UpdateWindowPlot(PlotMode plotMode, FlowList& flowList, FILE* outfile,
                       double theTime, double windowStart, double windowEnd, 
                       bool realTime, bool stairStep);
+void UpdateFlow(PlotMode plotMode, Flow* theFlow, Flow* matchFlow, 
+                unsigned int flowNumber, PacketEvent& theEvent, double theTime, 
+                double windowSize, bool realTime, bool stairStep, FILE* outfile);
+void FinishPlot(PlotMode plotMode, FlowList& flowList, FILE* outfile, double theTime,
+                double windowSize, double windowStart, double startTime, 
+                bool noEvents, bool realTime, bool stairStep);
+void WriteGnuplotFile(PlotMode plotMode, FlowList& flowList, 
+                      const char* outputFile, const char* tempFile, 
+                      const char* pngFile, const char* postFile, const char* surname,
+                      bool multiplot, bool autoScale, bool legend, 
+                      double minYRange, double maxYRange, double windowSize);
+void PrintSummary(PlotMode plotMode, FlowList& flowList, double startTime, 
+                  double stopTime, double theTime, double windowSize, const char* label);
+void PrintHistograms(FlowList& flowList, const char* label);
 void UpdateGnuplot(PlotMode plotMode, FlowList* flowList, double xMin, double xMax, 
                    const char* pngFile, const char* postFile, bool scatter, 
                    bool autoScale, bool legend, double minYRange, double maxYRange);
@@ -1291,6 +2041,59 @@ void UpdateMultiGnuplot(PlotMode plotMode, FlowList* flowList, double xMin, doub
                         const char* pngFile, const char* postFile, bool scatter,
                         bool autoScale, bool legend, double minYRange, double maxYRange);
 
+// An additional plot mode computed in the same pass over the input (see the
+// "metrics" command).  A Metric's flows mirror those of the primary flow list 
+// (same order and index), so packets are parsed and matched to flows only once.
+class Metric
+{
+    public:
+        Metric(PlotMode theMode, const char* theName);
+        ~Metric();
+        PlotMode Mode() const {return mode;}
+        const char* Name() const {return name;}
+        double WindowSize() const {return window_size;}
+        void SetWindowSize(double value) {window_size = value;}
+        FlowList& Flows() {return flow_list;}
+        
+        // Derives this metric's file names from the primary ones and opens
+        // its (temporary, if "useGnuplot") output file
+        bool OpenOutput(const char* outputFile, const char* pngFile, 
+                        const char* postFile, bool useGnuplot);
+        void CloseOutput();
+        FILE* Output() {return outfile;}
+        const char* OutputFile() {return output_file[0] ? output_file : NULL;}
+        const char* TempFile() {return temp_file;}
+        const char* PngFile() {return png_file[0] ? png_file : NULL;}
+        const char* PostFile() {return post_file[0] ? post_file : NULL;}
+        
+        // Appends a copy of "theFlow" (a flow newly added to the primary list)
+        bool AddFlow(Flow& theFlow, bool discardDuplicates);
+        void PrintKey();
+        // Incorporates a packet matched to primary flow number "flowNumber"
+        void Update(unsigned long flowNumber, bool flowMatch, PacketEvent& theEvent, 
+                    double theTime, bool discardDuplicates, bool stairStep);
+        
+        Metric* Next() {return next;}
+        void SetNext(Metric* theMetric) {next = theMetric;}
+        
+        // Inserts ".<metricName>" before the "fileName" extension, if any
+        static void MakeFileName(char* buffer, const char* fileName, const char* metricName);
+        
+    private:
+        PlotMode        mode;
+        const char*     name;
+        double          window_size;
+        FlowList        flow_list;
+        Flow**          flow_index;  // flow_list by Flow::Index() - 1
+        unsigned long   index_size;
+        FILE*           outfile;
+        char            output_file[PATH_MAX];
+        char            temp_file[PATH_MAX];
+        char            png_file[PATH_MAX];
+        char            post_file[PATH_MAX];
+        Metric*         next;
+};  // end class Metric
+
 
 
 Point::Point(double x, double y)
@@ -1671,6 +2474,7 @@ Flow::Flow(bool presetFlow)
       last_time(-1.0), pos_x(999.0), pos_y(999.0),
       sum_init(true), sum_total(0.0), sum_var(0.0), 
       sum_min(0.0), sum_max(0.0), sum_weight(0.0),
+      index(0), indexed(false), hash_next(NULL),
       prev(NULL), next(NULL)
 {
     histogram.Init(1000, 0.5);
@@ -1800,13 +2604,16 @@ double Flow::UpdatePosition(double theTime, double x, double y)
 }  // end Flow::UpdatePosition()
 
 FlowList::FlowList()
-    : head(NULL), tail(NULL), count(0)
+    : head(NULL), tail(NULL), count(0),
+      hash_table(NULL), hash_size(0), 
+      wildcard_head(NULL), wildcard_tail(NULL)
 {
 }
 
 FlowList::~FlowList()
 {
     Destroy();
+    if (hash_table) delete[] hash_table;
 }
 
 void FlowList::Append(Flow* theFlow)
@@ -1818,6 +2625,34 @@ void FlowList::Append(Flow* theFlow)
     theFlow->next = NULL;
     tail = theFlow;
     count++;
+    theFlow->index = tail->prev ? (tail->prev->index + 1) : 1;
+    
+    theFlow->hash_next = NULL;
+    theFlow->indexed = false;
+    if (IsExact(theFlow))
+    {
+        // Keep the hash index load at or under one flow per bucket
+        if ((count > hash_size) && !ResizeIndex(hash_size ? (2*hash_size) : 256))
+        {
+            if (hash_table)
+                fprintf(stderr, "trpr: FlowList::Append() warning: unable to grow flow index\n");
+        }
+        if (hash_table)
+        {
+            unsigned long i = HashKey(theFlow->src_addr, theFlow->src_port, 
+                                      theFlow->dst_addr, theFlow->dst_port,
+                                      theFlow->flow_id) & (hash_size - 1);
+            theFlow->hash_next = hash_table[i];
+            hash_table[i] = theFlow;
+            theFlow->indexed = true;
+            return;
+        }
+    }
+    if (wildcard_tail)
+        wildcard_tail->hash_next = theFlow;
+    else
+        wildcard_head = theFlow;
+    wildcard_tail = theFlow;
 }  // end FlowList::Append()
 
 
@@ -1833,6 +2668,25 @@ void FlowList::Remove(Flow* theFlow)
     else
         tail = theFlow->prev;
     count--;
+    
+    // Unlink from its hash bucket or the wildcard list
+    Flow** link = &wildcard_head;
+    if (theFlow->indexed)
+    {
+        link = hash_table + (HashKey(theFlow->src_addr, theFlow->src_port, 
+                                     theFlow->dst_addr, theFlow->dst_port,
+                                     theFlow->flow_id) & (hash_size - 1));
+    }
+    Flow* prevLink = NULL;
+    while ((NULL != *link) && (theFlow != *link))
+    {
+        prevLink = *link;
+        link = &((*link)->hash_next);
+    }
+    if (NULL != *link) *link = theFlow->hash_next;
+    if (wildcard_tail == theFlow) wildcard_tail = prevLink;
+    theFlow->hash_next = NULL;
+    theFlow->indexed = false;
 }  // end FlowList::Remove()
         
 
@@ -1846,22 +2700,105 @@ void FlowList::Destroy()
     }   
 }  // end Destroy()
 
+unsigned long FlowList::HashKey(const Address& srcAddr, unsigned short srcPort, 
+                                const Address& dstAddr, unsigned short dstPort, 
+                                unsigned long flowId)
+{
+    // FNV-1a over the addresses, ports and flow id
+    unsigned long hash = 2166136261UL;
+    const char* ptr;
+    for (ptr = srcAddr.addr; '\0' != *ptr; ptr++)
+        hash = (hash ^ (unsigned char)*ptr) * 16777619UL;
+    for (ptr = dstAddr.addr; '\0' != *ptr; ptr++)
+        hash = (hash ^ (unsigned char)*ptr) * 16777619UL;
+    unsigned long values[3] = {srcPort, dstPort, flowId};
+    for (int i = 0; i < 3; i++)
+    {
+        for (int j = 0; j < 4; j++)
+            hash = (hash ^ ((values[i] >> (8*j)) & 0xff)) * 16777619UL;
+    }
+    return hash;
+}  // end FlowList::HashKey()
+
+bool FlowList::ResizeIndex(unsigned long newSize)
+{
+    Flow** newTable = new Flow*[newSize];
+    if (!newTable)
+    {
+        perror("trpr: FlowList::ResizeIndex() Error allocating flow index");
+        return false;
+    }
+    memset(newTable, 0, newSize*sizeof(Flow*));
+    // Re-hash the indexed flows
+    for (Flow* f = head; NULL != f; f = f->next)
+    {
+        if (!f->indexed) continue;
+        unsigned long i = HashKey(f->src_addr, f->src_port, f->dst_addr, 
+                                  f->dst_port, f->flow_id) & (newSize - 1);
+        f->hash_next = newTable[i];
+        newTable[i] = f;
+    }
+    if (hash_table) delete[] hash_table;
+    hash_table = newTable;
+    hash_size = newSize;
+    return true;
+}  // end FlowList::ResizeIndex()
+
+Flow* FlowList::FindNextMatch(Flow*           prevFlow,
+                              const char*     theType, 
+                              const Address&  srcAddr, unsigned short srcPort, 
+                              const Address&  dstAddr, unsigned short dstPort, 
+                              unsigned long   flowId)
+{
+    unsigned long prevIndex = prevFlow ? prevFlow->index : 0;
+    Flow* match = NULL;
+    // Wildcard flows are in list order, so the first match will do
+    Flow* f;
+    for (f = wildcard_head; NULL != f; f = f->hash_next)
+    {
+        if ((f->index > prevIndex) && 
+            f->Match(theType, srcAddr, srcPort, dstAddr, dstPort, flowId))
+        {
+            match = f;
+            break;
+        }
+    }
+    // Indexed flows can only match packets with their exact key, but 
+    // still need Match() for their type (and any hash collisions)
+    if (hash_table)
+    {
+        f = hash_table[HashKey(srcAddr, srcPort, dstAddr, dstPort, flowId) & (hash_size - 1)];
+        for (; NULL != f; f = f->hash_next)
+        {
+            if ((f->index > prevIndex) && 
+                ((NULL == match) || (f->index < match->index)) &&
+                f->Match(theType, srcAddr, srcPort, dstAddr, dstPort, flowId))
+            {
+                match = f;
+            }
+        }
+    }
+    return match;
+}  // end FlowList::FindNextMatch()
+
 
 const char WILDCARD = 'X';
 
 inline void usage()
 {
     fprintf(stderr, "TRPR Version %s\n", VERSION);
-    fprintf(stderr, "Usage: trpr [version][mgen][ns][raw][key][real][loss][latency|interarrival]\n"
+    fprintf(stderr, "Usage: trpr [version][mgen][mgenbin][ns][pcap][raw][key]\n"
+                    "            [real][loss][latency|interarrival]\n"
+                    "            [metrics <mode>[,<mode>...]]\n"
                     "            [window <sec>] [history <sec>]\n"
                     "            [flow <type,srcAddr/port,dstAddr/port,flowId>]\n"
                     "            [auto <type,srcAddr/port,dstAddr/port,flowId>]\n"
                     "            [exclude <type,srcAddr/port,dstAddr/port,flowId>]\n"
                     "            [input <inputFile>] [output <outputFile>]\n"
-                    "            [link <src>[,<dst>]][send|recv][nodup]\n"
+                    "            [link <src>[,<dst>]][send|recv][nodup][threads <count>]\n"
                     "            [xrange <min>[:<max>]][yrange <min>[:<max>]\n"
                     "            [offset <hh:mm:ss>][absolute]\n"
-                    "            [summary][histogram][replay <factor>]\n"
+                    "            [summary][histogram][hdr <digits>][replay <factor>]\n"
                     "            [png <pngFile>][post <postFile>][multiplot]\n"
                     "            [surname <titlePrefix>][ramp][scale]\n"
                     "            [nolegend]\n");
@@ -1926,13 +2863,215 @@ bool Flow::InitFromDescription(char* flowInfo)
     return true;
 }  // end Flow::InitFromDescription()
 
-static const double SECONDS_PER_DAY = (24.0 * 60.0 * 60.0);
-                    
-int main(int argc, char* argv[])
-{ 
-    FlowList flowList;
-    FlowList autoList;
-    FlowList excludeList;
+bool Flow::CopyDescription(const Flow& theFlow)
+{
+    if (theFlow.type && !SetType(theFlow.type)) return false;
+    src_addr = theFlow.src_addr;
+    src_port = theFlow.src_port;
+    dst_addr = theFlow.dst_addr;
+    dst_port = theFlow.dst_port;
+    flow_id = theFlow.flow_id;
+    return true;
+}  // end Flow::CopyDescription()
+
+Metric::Metric(PlotMode theMode, const char* theName)
+ : mode(theMode), name(theName), window_size(1.0),
+   flow_index(NULL), index_size(0), outfile(NULL), next(NULL)
+{
+    output_file[0] = temp_file[0] = png_file[0] = post_file[0] = '\0';
+}
+
+Metric::~Metric()
+{
+    CloseOutput();
+    if (flow_index) delete[] flow_index;
+}
+
+void Metric::MakeFileName(char* buffer, const char* fileName, const char* metricName)
+{
+    const char* ext = strrchr(fileName, '.');
+    const char* base = strrchr(fileName, '/');
+    if (!ext || (base && (ext < base)) || (ext == fileName) || (base && (ext == (base + 1))))
+        ext = fileName + strlen(fileName);
+    size_t len = ext - fileName;
+    if ((len + strlen(metricName) + strlen(ext) + 2) > PATH_MAX)
+    {
+        fprintf(stderr, "trpr: Metric file name too long: %s\n", fileName);
+        exit(-1);
+    }
+    memcpy(buffer, fileName, len);
+    sprintf(buffer + len, ".%s%s", metricName, ext);
+}  // end Metric::MakeFileName()
+
+bool Metric::OpenOutput(const char* outputFile, const char* pngFile, 
+                        const char* postFile, bool useGnuplot)
+{
+    if (pngFile) MakeFileName(png_file, pngFile, name);
+    if (postFile) MakeFileName(post_file, postFile, name);
+    if (!outputFile) return true;
+    MakeFileName(output_file, outputFile, name);
+    strcpy(temp_file, output_file);
+    if (useGnuplot) strcat(temp_file, ".tmp");
+    return (NULL != (outfile = fopen(temp_file, "w+")));
+}  // end Metric::OpenOutput()
+
+void Metric::CloseOutput()
+{
+    if (outfile)
+    {
+        fclose(outfile);
+        outfile = NULL;
+    }
+}  // end Metric::CloseOutput()
+
+bool Metric::AddFlow(Flow& theFlow, bool discardDuplicates)
+{
+    if (flow_list.Count() >= index_size)
+    {
+        unsigned long newSize = index_size ? (2*index_size) : 64;
+        Flow** newIndex = new Flow*[newSize];
+        if (!newIndex)
+        {
+            perror("trpr: Metric::AddFlow() Error allocating flow index");
+            return false;
+        }
+        if (flow_index)
+        {
+            memcpy(newIndex, flow_index, index_size*sizeof(Flow*));
+            delete[] flow_index;
+        }
+        flow_index = newIndex;
+        index_size = newSize;
+    }
+    Flow* f = new Flow(theFlow.IsPreset());
+    if (!f || !f->CopyDescription(theFlow))
+    {
+        perror("trpr: Metric::AddFlow() Error allocating flow");
+        if (f) delete f;
+        return false;
+    }
+    flow_list.Append(f);
+    flow_index[f->Index() - 1] = f;
+    if ((LOSS2 == mode) || (discardDuplicates))
+        f->InitLossTracker2(window_size);
+    if (theFlow.HdrDigits()) f->InitHdrHistogram(theFlow.HdrDigits());
+    return true;
+}  // end Metric::AddFlow()
+
+void Metric::PrintKey()
+{
+    if (!outfile) return;
+    fprintf(outfile, "#Time");
+    Flow* next = flow_list.Head();
+    while (next)
+    {
+        fprintf(outfile, ", ");  
+        next->PrintDescription(outfile);
+        next = next->Next(); 
+    }   
+    fprintf(outfile, "\n");
+}  // end Metric::PrintKey()
+
+void Metric::Update(unsigned long flowNumber, bool flowMatch, PacketEvent& theEvent, 
+                    double theTime, bool discardDuplicates, bool stairStep)
+{
+    if ((flowNumber < 1) || (flowNumber > flow_list.Count())) return;
+    Flow* theFlow = flow_index[flowNumber - 1];
+    // (a duplicate for the primary flow is a duplicate here, too, but
+    //  the check also keeps this flow's loss tracking in step)
+    if (discardDuplicates && theFlow->IsDuplicate(theTime, theEvent.Sequence()))
+        return;
+    UpdateFlow(mode, theFlow, flowMatch ? theFlow : NULL, flowNumber, 
+               theEvent, theTime, window_size, false, stairStep, outfile);
+}  // end Metric::Update()
+
+// Parses a plot mode name (as for the corresponding commands)
+bool ParsePlotMode(const char* text, PlotMode& plotMode)
+{
+    if (!strcmp("rate", text))
+        plotMode = RATE;
+    else if (!strcmp("latency", text))
+        plotMode = LATENCY;
+    else if (!strncmp("inter", text, 5))
+        plotMode = INTERARRIVAL;
+    else if (!strncmp("drops", text, 4))
+        plotMode = DROPS;
+    else if (!strncmp("loss", text, 5))
+        plotMode = LOSS2;  // LOSS2 is our default loss tracking algorithm
+    else if (!strncmp("loss2", text, 5))
+        plotMode = LOSS;
+    else if (!strncmp("count", text, 5))
+        plotMode = COUNT;
+    else if (!strncmp("velocity", text, 5))
+        plotMode = VELOCITY;
+    else
+        return false;
+    return true;
+}  // end ParsePlotMode()
+
+const char* PlotModeName(PlotMode plotMode)
+{
+    switch (plotMode)
+    {
+        case RATE:          return "rate";
+        case INTERARRIVAL:  return "interarrival";
+        case LATENCY:       return "latency";
+        case DROPS:         return "drops";
+        case LOSS:          return "loss2";
+        case LOSS2:         return "loss";
+        case COUNT:         return "count";
+        case VELOCITY:      return "velocity";
+    }
+    return "unknown";
+}  // end PlotModeName()
+
+// Validates the "plotMode" against the trace format and returns the
+// window size to use for it (modes plotting individual packets default to 0.0)
+double ValidatePlotMode(PlotMode plotMode, TraceFormat traceFormat, 
+                        double windowSize, bool useDefaultWindow)
+{
+    switch(plotMode)
+    {
+        case LOSS:
+        case LOSS2:  
+            if ((windowSize == 0.0))
+            {
+                fprintf(stderr, "trpr: LOSS plots require non-zero window size!\n"); 
+                exit(-1);  
+            } 
+            if ((DREC != traceFormat) && (MGEN_BINARY != traceFormat))
+            {
+                fprintf(stderr, "trpr: LOSS and LATENCY plots currently "
+                                "available for \"drec\" only.\n");
+                exit(-1);
+            } 
+            break;
+                
+        case LATENCY:
+        case VELOCITY:
+            if ((DREC != traceFormat) && (MGEN_BINARY != traceFormat))
+            {
+                fprintf(stderr, "trpr: LATENCY and VELOCITY plots currently "
+                                "available for \"drec\" only.\n");
+                exit(-1);
+            }
+        case INTERARRIVAL:
+            if (useDefaultWindow) windowSize = 0.0;
+            break;
+            
+        default:
+            break;
+    }
+    return windowSize;
+}  // end ValidatePlotMode()
+
+static const double SECONDS_PER_DAY = (24.0 * 60.0 * 60.0);
+                    
+int main(int argc, char* argv[])
+{ 
+    FlowList flowList;
+    FlowList autoList;
+    FlowList excludeList;
     
     bool defaultMatching = true;
     double windowSize = 1.0;
@@ -1958,11 +3097,15 @@ int main(int argc, char* argv[])
     double offsetTime = -1.0;
     bool summarize = false;
     bool make_histogram = false;
+    unsigned int hdrDigits = 0;  // HDR histogram precision (0 for default histograms)
     unsigned int detect_proto_len = 0;
     bool normalize = true;
     bool stairStep = true;
+    unsigned int threadCount = 1;  // number of input parsing threads
     bool autoScale = false;
     bool discardDuplicates = false;
+    Metric* metricList = NULL;  // additional plot modes (see "metrics")
+    Metric* metricTail = NULL;
     
     char* surname = NULL;
     
@@ -2063,6 +3206,29 @@ int main(int argc, char* argv[])
             discardDuplicates = true;
             i++;
         } 
+        else if (!strcmp("threads", argv[i]))
+        {            
+            i++;
+            if (i >= argc)
+            {
+                fprintf(stderr, "trpr: Insufficient \"threads\" arguments!\n");
+                usage();
+                exit(-1);
+            }
+            int count = atoi(argv[i]);
+            if (count < 0)
+            {
+                fprintf(stderr, "trpr: Invalid \"threads\" value!\n");
+                usage();
+                exit(-1);
+            }
+#ifndef WIN32
+            // A count of zero means use all available processors
+            if (0 == count) count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif // !WIN32
+            threadCount = (count > 0) ? count : 1;
+            i++;
+        } 
         else if (!strcmp("range", argv[i]) || (!strcmp("xrange", argv[i])))
         {            
             i++;
@@ -2135,12 +3301,22 @@ int main(int argc, char* argv[])
             i++;
             traceFormat = DREC;
         }  
+        else if (!strcmp("mgenbin", argv[i]))
+        {
+            i++;
+            traceFormat = MGEN_BINARY;
+        }  
         else if (!strcmp("ns", argv[i]))
         {
             i++;
             traceFormat = NS;
             //domain = NUM;
         }   
+        else if (!strcmp("pcap", argv[i]))
+        {
+            i++;
+            traceFormat = PCAP;
+        }   
         else if (!strncmp("real", argv[i], 4))
         {
             i++;
@@ -2186,6 +3362,58 @@ int main(int argc, char* argv[])
             i++;
             plotMode = VELOCITY;
         }
+        else if (!strcmp("metrics", argv[i]))
+        {
+            i++;
+            if (i >= argc)
+            {
+                fprintf(stderr, "trpr: Insufficient \"metrics\" arguments!\n");
+                usage();
+                exit(-1);
+            }
+            // The first mode listed is the primary "plotMode", the
+            // rest are computed alongside it as additional "Metrics"
+            bool primary = true;
+            char* modeName = strtok(argv[i++], ",");
+            while (modeName)
+            {
+                PlotMode theMode;
+                if (!ParsePlotMode(modeName, theMode))
+                {
+                    fprintf(stderr, "trpr: Invalid \"metrics\" mode: %s\n", modeName);
+                    usage();
+                    exit(-1);
+                }
+                if (primary)
+                {
+                    plotMode = theMode;
+                    primary = false;
+                }
+                else
+                {
+                    for (Metric* m = metricList; NULL != m; m = m->Next())
+                    {
+                        if (m->Mode() == theMode)
+                        {
+                            fprintf(stderr, "trpr: Duplicate \"metrics\" mode: %s\n", modeName);
+                            exit(-1);
+                        }
+                    }
+                    Metric* theMetric = new Metric(theMode, PlotModeName(theMode));
+                    if (!theMetric)
+                    {
+                        perror("trpr: Error allocating memory for metric");
+                        exit(-1);
+                    }
+                    if (metricTail)
+                        metricTail->SetNext(theMetric);
+                    else
+                        metricList = theMetric;
+                    metricTail = theMetric;
+                }
+                modeName = strtok(NULL, ",");
+            }
+        }
         else if (!strcmp("raw", argv[i]))
         {
             i++;
@@ -2382,6 +3610,26 @@ int main(int argc, char* argv[])
             make_histogram = true;  
             i++; 
         }     
+        else if (!strcmp("hdr", argv[i]))
+        {
+            i++;
+            if (i >= argc)
+            {
+                fprintf(stderr, "trpr: Insufficient \"hdr\" arguments!\n");
+                usage();
+                exit(-1);
+            }
+            int d = atoi(argv[i]);
+            if ((d < 1) || (d > HdrHistogram::DIGITS_MAX))
+            {
+                fprintf(stderr, "trpr: Invalid \"hdr\" digits (1-%d)!\n", 
+                        HdrHistogram::DIGITS_MAX);
+                usage();
+                exit(-1);
+            }
+            hdrDigits = d;
+            i++;
+        }
         else if (!strcmp("version", argv[i]))
         {
             exit(0);   
@@ -2420,49 +3668,34 @@ int main(int argc, char* argv[])
     }
     
     // Validate command combinations
-    switch(plotMode)
+    double baseWindow = windowSize;
+    windowSize = ValidatePlotMode(plotMode, traceFormat, baseWindow, use_default_window);
+    for (Metric* m = metricList; NULL != m; m = m->Next())
     {
-        case LOSS:
-        case LOSS2:  
-            if ((windowSize == 0.0))
-            {
-                fprintf(stderr, "trpr: LOSS plots require non-zero window size!\n"); 
-                exit(-1);  
-            } 
-            if (DREC != traceFormat)
-            {
-                fprintf(stderr, "trpr: LOSS and LATENCY plots currently "
-                                "available for \"drec\" only.\n");
-                exit(-1);
-            } 
-            break;
-                
-        case LATENCY:
-        case VELOCITY:
-            if (DREC != traceFormat)
-            {
-                fprintf(stderr, "trpr: LATENCY and VELOCITY plots currently "
-                                "available for \"drec\" only.\n");
-                exit(-1);
-            }
-        case INTERARRIVAL:
-            if (use_default_window) windowSize = 0.0;
-            break;
-            
-        default:
-            break;
+        if (m->Mode() == plotMode)
+        {
+            fprintf(stderr, "trpr: Duplicate \"metrics\" mode: %s\n", m->Name());
+            exit(-1);
+        }
+        m->SetWindowSize(ValidatePlotMode(m->Mode(), traceFormat, 
+                                          baseWindow, use_default_window));
+    }
+    if (metricList && realTime)
+    {
+        fprintf(stderr, "trpr: \"metrics\" not supported for \"real\" time plotting!\n");
+        exit(-1);
     }
 
     if (linkSrc || linkDst)
     {
         if (!strcmp(linkSrc, "X")) linkSrc = NULL;
         if (!strcmp(linkDst, "X")) linkDst = NULL;
-        if (DREC == traceFormat)
+        if ((DREC == traceFormat) || (MGEN_BINARY == traceFormat))
         {
             fprintf(stderr, "trpr: \"link\" tracepoint command not applicable to \"drec\"!\n");
             exit(-1);   
         }
-        else if (TCPDUMP == traceFormat)
+        else if ((TCPDUMP == traceFormat) || (PCAP == traceFormat))
         {
             fprintf(stderr, "trpr: \"link\" tracepoint command not yet supported for \"tcpdump\"!\n");
             exit(-1);
@@ -2481,6 +3714,11 @@ int main(int argc, char* argv[])
     {
         if ((LOSS2 == plotMode) || (discardDuplicates))
             f->InitLossTracker2(windowSize);
+        if (hdrDigits) f->InitHdrHistogram(hdrDigits);
+        for (Metric* m = metricList; NULL != m; m = m->Next())
+        {
+            if (!m->AddFlow(*f, discardDuplicates)) exit(-1);
+        }
         f = f->Next();
     }
     
@@ -2489,7 +3727,8 @@ int main(int argc, char* argv[])
     FILE* infile;
     if (input_file)
     {
-        if(!(infile = fopen(input_file, "r")))
+        bool binary = (PCAP == traceFormat) || (MGEN_BINARY == traceFormat);
+        if(!(infile = fopen(input_file, binary ? "rb" : "r")))
         {
             perror("trpr: Error opening input file");
             usage();
@@ -2502,9 +3741,38 @@ int main(int argc, char* argv[])
         infile = stdin;
     }
     
-    // Open output file
+    // Open output file(s), each named for its metric when there are "metrics"
     FILE* outfile = NULL;
     char temp_file[PATH_MAX];
+    char primary_output[PATH_MAX], primary_png[PATH_MAX], primary_post[PATH_MAX];
+    const char* primaryName = metricList ? PlotModeName(plotMode) : NULL;
+    for (Metric* m = metricList; NULL != m; m = m->Next())
+    {
+        if (!m->OpenOutput(output_file, png_file, post_file, use_gnuplot))
+        {
+            perror("trpr: Error opening output file");
+            usage();
+            exit(-1);
+        }
+    }
+    if (primaryName)
+    {
+        if (output_file) 
+        {
+            Metric::MakeFileName(primary_output, output_file, primaryName);
+            output_file = primary_output;
+        }
+        if (png_file)
+        {
+            Metric::MakeFileName(primary_png, png_file, primaryName);
+            png_file = primary_png;
+        }
+        if (post_file)
+        {
+            Metric::MakeFileName(primary_post, post_file, primaryName);
+            post_file = primary_post;
+        }
+    }
     if (output_file)
     {
 	    strcpy(temp_file, output_file);
@@ -2533,6 +3801,12 @@ int main(int argc, char* argv[])
     
     double updateWindow = 1.0;
     if (windowSize > 0.0) updateWindow = windowSize;
+    for (Metric* m = metricList; NULL != m; m = m->Next())
+    {
+        if (print_key) m->PrintKey();
+        // (all windowed metrics share the same window size)
+        if (m->WindowSize() > 0.0) updateWindow = m->WindowSize();
+    }
      
     double theTime = updateWindow;  
     double windowStart = -1.0;
@@ -2548,6 +3822,8 @@ int main(int argc, char* argv[])
     DrecEventParser drecParser;
     TcpdumpEventParser tcpdumpParser;
     NsEventParser nsParser;
+    PcapEventParser pcapParser;
+    MgenBinaryEventParser mgenBinaryParser;
     EventParser* parser = NULL;
     switch (traceFormat)
     {
@@ -2560,7 +3836,30 @@ int main(int argc, char* argv[])
         case NS:
             parser = &nsParser;
             break;
+        case PCAP:
+            parser = &pcapParser;
+            break;
+        case MGEN_BINARY:
+            parser = &mgenBinaryParser;
+            break;
     }
+#ifndef WIN32
+    ParallelEventParser parallelParser(traceFormat, threadCount);
+    if (threadCount > 1)
+    {
+        if (realTime || !input_file)
+            fprintf(stderr, "trpr: \"threads\" requires an offline \"input\" file (using one thread)\n");
+        else if ((PCAP == traceFormat) || (MGEN_BINARY == traceFormat))
+            fprintf(stderr, "trpr: \"threads\" not supported for binary input (using one thread)\n");
+        else if (parallelParser.Open(input_file))
+            parser = &parallelParser;
+        else
+            fprintf(stderr, "trpr: Unable to map input file for parallel parsing (using one thread)\n");
+    }
+#else
+    if (threadCount > 1)
+        fprintf(stderr, "trpr: \"threads\" not supported on WIN32 (using one thread)\n");
+#endif // if/else !WIN32
 
     PacketEvent theEvent;
     double timeout = -1.0;   
@@ -2578,10 +3877,7 @@ int main(int argc, char* argv[])
         unsigned short srcPort = theEvent.SrcPort();
         const Address& dstAddr = theEvent.DstAddr();
         unsigned short dstPort = theEvent.DstPort();
-        unsigned int pktSize = theEvent.Size();
         theTime = theEvent.Time();
-        double rxTime = theEvent.RxTime();
-        double txTime = theEvent.TxTime();
         unsigned long sequence = theEvent.Sequence();
         unsigned long flowId = theEvent.FlowId();
         
@@ -2716,6 +4012,12 @@ int main(int argc, char* argv[])
                     minTime = theTime - historyDepth;
                 }
             }
+            for (Metric* m = metricList; NULL != m; m = m->Next())
+            {
+                if (m->WindowSize() > 0.0)
+                    UpdateWindowPlot(m->Mode(), m->Flows(), m->Output(), theTime,
+                                     windowStart, windowEnd, false, stairStep);
+            }
         }  // end if (theTime > windowEnd) && !(windowSize < 0.0)
         
         bool match = false;
@@ -2739,20 +4041,31 @@ int main(int argc, char* argv[])
         
         // First match any already-discovered or preset flows
         MatchingPhase matchPhase = exclude ? STOP_MATCH : FLOW_MATCH;
-        nextFlow = flowList.Head();
         bool matched = false;
         unsigned int flowNumber = 0;
         
         // No flow match for invalid events
         if (PacketEvent::TIMEOUT == theEvent.Type()) matchPhase = STOP_MATCH;
+        if (realTime && (STOP_MATCH != matchPhase))
+        {
+            nextFlow = flowList.Head();
+            while (nextFlow)
+            {
+                nextFlow->PruneData(minTime);
+                nextFlow = nextFlow->Next();
+            }
+        }
+        // (the flow list is indexed, so only matching flows are visited)
+        if (STOP_MATCH != matchPhase)
+            nextFlow = flowList.FindNextMatch(NULL, proto, srcAddr, srcPort, dstAddr, dstPort, flowId);
         while (STOP_MATCH != matchPhase)
         {         
             if (nextFlow)
             {
-                if (FLOW_MATCH == matchPhase) flowNumber++;
-                if (realTime) nextFlow->PruneData(minTime);  
+                if (FLOW_MATCH == matchPhase) flowNumber = nextFlow->Index();
                 Flow* theFlow; 
-                if (nextFlow->Match(proto, srcAddr, srcPort, dstAddr, dstPort, flowId))
+                if ((FLOW_MATCH == matchPhase) ||
+                    nextFlow->Match(proto, srcAddr, srcPort, dstAddr, dstPort, flowId))
                 {
                     if (AUTO_MATCH == matchPhase)
                     {
@@ -2769,6 +4082,12 @@ int main(int argc, char* argv[])
                             
                             if ((LOSS2 == plotMode) || (discardDuplicates))
                                 theFlow->InitLossTracker2(windowSize);
+                            if (hdrDigits) theFlow->InitHdrHistogram(hdrDigits);
+                            for (Metric* m = metricList; NULL != m; m = m->Next())
+                            {
+                                if (!m->AddFlow(*theFlow, discardDuplicates)) exit(-1);
+                                if (print_key) m->PrintKey();
+                            }
 
                             fprintf(stderr, "trpr: At time %f - Adding flow: ", theTime);
                             theFlow->PrintDescription(stderr);
@@ -2810,6 +4129,10 @@ int main(int argc, char* argv[])
                 // If we have a match, update the flow accordingly
                 if (theFlow)
                 {
+                    for (Metric* m = metricList; NULL != m; m = m->Next())
+                        m->Update(flowNumber, (FLOW_MATCH == matchPhase), theEvent, 
+                                  theTime, discardDuplicates, stairStep);
+                    
                     if (discardDuplicates && ((LOSS != plotMode) || (LOSS2 != plotMode)))
                     {
                         if (theFlow->IsDuplicate(theTime, sequence))
@@ -2818,301 +4141,29 @@ int main(int argc, char* argv[])
                         }  
                     }
                     
-                    switch(plotMode)
-                    {
-
-                        case RATE:
-                            if (0.0 != windowSize)
-                            {                            
-                                theFlow->AddBytes(pktSize);
-                            }
-                            else
-                            {
-                                // Instantaneous data rate = pktSize/interarrival time
-                                // (can't count first packet this way)
-                                double delay = theFlow->MarkReception(theTime);
-                                //if (delay > 0.0)
-                                {
-                                    //double rate = (8.0/1000.0) * ((double)pktSize) / delay;
-                                    double rate = (8.0/1000.0) * ((double)pktSize);
-                                    theFlow->UpdateSummary(rate);
-                                    if (realTime)
-                                    {
-                                        if (stairStep)
-                                            theFlow->AppendData(theTime, 0.0);
-                                        if (!theFlow->AppendData(theTime, rate))
-                                        {
-                                            perror("trpr: Memory error adding data");
-                                            exit(-1);
-                                        }
-                                        if (stairStep)
-                                            theFlow->AppendData(theTime, 0.0);
-                                    }
-                                    if (outfile)
-                                    {
-                                        fprintf(outfile, "%7.3f", theTime);
-                                        unsigned int n = flowNumber;
-                                        while (--n) fprintf(outfile, ", ");
-                                        fprintf(outfile, ", %7.3f\n", rate);
-                                    }
-                                }    
-                            }                            
-                            break;
-                        case LOSS:
-                            //fprintf(stderr, "UpdateLossTracker: t:%f s:%lu\n", theTime, sequence);
-                            if (!theFlow->UpdateLossTracker(theTime, sequence))
-                            {
-                                
-                                fprintf(stderr, "trpr: Loss tracker warning!\n");
-                                fprintf(stderr, "trpr: flow ");
-                                theFlow->PrintDescription(stderr);
-                                fprintf(stderr, "\n");
-                                //exit(-1);   
-                            }
-                            break;
-                        case LOSS2:
+                    UpdateFlow(plotMode, theFlow, (FLOW_MATCH == matchPhase) ? theFlow : NULL,
+                               flowNumber, theEvent, theTime, windowSize, realTime, 
+                               stairStep, outfile);
+                }  // end if (theFlow)
+                if (FLOW_MATCH == matchPhase)
+                    nextFlow = flowList.FindNextMatch(nextFlow, proto, srcAddr, srcPort, dstAddr, dstPort, flowId);
+                else
+                    nextFlow = nextFlow->Next();
+            }  // end if(nextFlow)
+            //fprintf(stderr, "nextFlow:%p\n", nextFlow);
+            if (!nextFlow)
+            {
+                switch (matchPhase)
+                {
+                    case FLOW_MATCH:
+                        if (matched)
                         {
-                            // This one has it's own window
-                            int result = theFlow->UpdateLossTracker2(theTime, sequence);
-                            switch (result)
-                            {
-                                case 0:
-                                    // Data not yet ready
-                                    break;
-                                case 1:
-                                {
-                                    // Loss tracker 2 has data ready
-                                    double lossFraction = theFlow->LossFraction2();
-                                    if (lossFraction < 0.0) lossFraction = 1.0;
-                                    double weight = (theTime - theFlow->LossWindowStart2()) / windowSize;
-                                    theFlow->UpdateSummary(lossFraction, weight);
-                                    if (realTime)
-                                    {
-                                        if (!theFlow->AppendData(theFlow->LossWindowStart2(), lossFraction))
-                                        {
-                                            perror("trpr: Memory error adding data");
-                                            exit(-1);
-                                        }
-                                        if (!theFlow->AppendData(theTime, lossFraction))
-                                        {
-                                            perror("trpr: Memory error adding data");
-                                            exit(-1);
-                                        }
-                                    }
-                                    if (outfile)
-                                    {
-                                        // Window start
-                                        fprintf(outfile, "%7.3f", theFlow->LossWindowStart2());
-                                        unsigned int n = flowNumber;
-                                        while (--n) fprintf(outfile, ", ");
-                                        fprintf(outfile, ", %7.3f\n", lossFraction);
-                                        // Window end
-                                        fprintf(outfile, "%7.3f", theTime);
-                                        n = flowNumber;
-                                        while (--n) fprintf(outfile, ", ");
-                                        fprintf(outfile, ", %7.3f\n", lossFraction);
-                                    }
-                                    theFlow->ResetLossTracker2();
-                                    break;
-                                }
-                                    
-                                default:
-                                    // Error/warning of some type occurred. 
-                                    fprintf(stderr, "trpr: Loss tracker warning!\n");
-                                    fprintf(stderr, "trpr: flow ");
-                                    theFlow->PrintDescription(stderr);
-                                    fprintf(stderr, "\n");
-                                    break;  
-                            }
-                            break;
+                            matchPhase = STOP_MATCH;
                         }
-			
-			            case DROPS:
-			            {
-                            if (0.0 != windowSize)
-			                {
-			    	            if (PacketEvent::DROP == theEvent.Type())
-				                   theFlow->Accumulate(1.0);
-				                else if (PacketEvent::RECEPTION == theEvent.Type())     
-                                    theFlow->Accumulate(0.0);
-			                }
-			                else
-			                {
-                                if (PacketEvent::DROP == theEvent.Type())
-                                { 
-                                    theFlow->UpdateSummary(1);
-                                    if (realTime)
-                                    {
-                                        if (!theFlow->AppendData(theTime, 1))
-                                        {
-                                            perror("trpr: Memory error adding data");
-                                            exit(-1);
-                                        }
-                                    }
-                                    if (outfile)
-                                    {
-                                        fprintf(outfile, "%7.3f", theTime);
-                                        unsigned int n = flowNumber;
-                                        while (--n) fprintf(outfile, ", ");
-                                        fprintf(outfile, ", %7.3f\n", 1.0);
-                                    }
-                                }
-			                }
-                            break;
-			            }
-                        
-                        case COUNT:
-			            {
-                            if (0.0 != windowSize)
-			                {
-			    	            if (PacketEvent::DROP != theEvent.Type())
-				                   theFlow->Accumulate(1.0);
-				                else // don't COUNT drops
-				                   theFlow->Accumulate(0.0);
-			                }
-			                else
-			                {
-                                if (PacketEvent::DROP != theEvent.Type())
-                                { 
-                                    theFlow->UpdateSummary(1);
-                                    if (realTime)
-                                    {
-                                        if (!theFlow->AppendData(theTime, 1))
-                                        {
-                                            perror("trpr: Memory error adding data");
-                                            exit(-1);
-                                        }
-                                    }
-                                    if (outfile)
-                                    {
-                                        fprintf(outfile, "%7.3f", theTime);
-                                        unsigned int n = flowNumber;
-                                        while (--n) fprintf(outfile, ", ");
-                                        fprintf(outfile, ", %7.3f\n", 1.0);
-                                    }
-                                }
-			                }
-                            break;
-			            }
-			
-			            case INTERARRIVAL:
-                        {
-                            double delay = theFlow->MarkReception(theTime);
-                            if (0.0 != windowSize)
-                            {
-                                if (delay >= 0.0) nextFlow->Accumulate(delay);   
-                            }
-                            else
-                            {
-                                if (delay >= 0.0)
-                                {
-                                    theFlow->UpdateSummary(delay);
-                                    if (realTime)
-                                    {
-                                        if (!theFlow->AppendData(theTime, delay))
-                                        {
-                                            perror("trpr: Memory error adding data");
-                                            exit(-1);
-                                        }
-                                    }
-                                    if (outfile)
-                                    {
-                                        fprintf(outfile, "%7.3f", theTime);
-                                        unsigned int n = flowNumber;
-                                        while (--n) fprintf(outfile, ", ");
-                                        fprintf(outfile, ", %7.3f\n", delay);
-                                    }
-                                    
-                                }
-                            }
-                            break;
-                        }  // end case INTERARRIVAL
-
-                        case LATENCY:
-                        {
-                            double delay = rxTime - txTime;
-                            // Assume clock wrap if delay too negative
-                            if (delay < -(SECONDS_PER_DAY/2.0)) delay += SECONDS_PER_DAY;
-                            if (0.0 != windowSize)
-                            {
-                                nextFlow->Accumulate(delay);   
-                            }
-                            else
-                            {
-                                theFlow->UpdateSummary(delay);
-                                if (realTime)
-                                {
-                                    if (!theFlow->AppendData(theTime, delay))
-                                    {
-                                        perror("trpr: Memory error adding data");
-                                        exit(-1);
-                                    }
-                                }
-                                if (outfile)
-                                {
-                                    fprintf(outfile, "%7.3f", theTime);
-                                    unsigned int n = flowNumber;
-                                    while (--n) fprintf(outfile, ", ");
-                                    fprintf(outfile, ", %7.3f\n", delay);
-                                }
-                            }
-                            break;
-                        }  // end case LATENCY
-                        
-                        case VELOCITY:
-                        {
-                            double velocity = 
-                                theFlow->UpdatePosition(theTime, theEvent.PosX(), theEvent.PosY());
-                            
-                            if (0.0 != windowSize)
-                            {
-                                if (velocity >= 0.0) theFlow->Accumulate(velocity);
-                            }
-                            else
-                            {
-                                if (velocity >= 0.0)
-                                {
-                                    theFlow->UpdateSummary(velocity);
-                                    if (realTime)
-                                    {
-                                        if (!theFlow->AppendData(theTime, velocity))
-                                        {
-                                            perror("trpr: Memory error adding data");
-                                            exit(-1);
-                                        }
-                                    }
-                                    if (outfile)
-                                    {
-                                        fprintf(outfile, "%7.3f", theTime);
-                                        unsigned int n = flowNumber;
-                                        while (--n) fprintf(outfile, ", ");
-                                        fprintf(outfile, ", %7.3e\n", velocity);
-                                    }
-                                }
-                            }
-                            break;
-                        }
-                        
-                        default:
-                            fprintf(stderr, "trpr: Unsupported plot mode!\n");
-                            exit(-1);
-                    }  // end switch(plotMode)
-                }  // end if (theFlow)
-                nextFlow = nextFlow->Next();
-            }  // end if(nextFlow)
-            //fprintf(stderr, "nextFlow:%p\n", nextFlow);
-            if (!nextFlow)
-            {
-                switch (matchPhase)
-                {
-                    case FLOW_MATCH:
-                        if (matched)
-                        {
-                            matchPhase = STOP_MATCH;
-                        }
-                        else
+                        else
                         {
                             // Second, attempt auto match
+                            flowNumber = flowList.Count();
                             nextFlow = autoList.Head();   
                             matchPhase = AUTO_MATCH;
                         }
@@ -3152,66 +4203,8 @@ int main(int argc, char* argv[])
     
     // Use this for a single window plot of the entire interval
     theTime = stopTime < 0.0 ? theTime : stopTime;
-    double theStart, theEnd;
-    if ((windowSize < 0.0) || noEvents || (windowStart < 0.0))
-    {
-        theStart = startTime < 0.0 ? 0.0 : startTime;
-        theEnd = theTime;
-    }
-    else
-    {
-        theStart = windowStart;
-        theEnd = windowStart + windowSize;
-    }
-    
-    
-
-    if ((0.0 != windowSize) && !noEvents) 
-    {
-        UpdateWindowPlot(plotMode, flowList, outfile, theTime+0.1, 
-                         theStart, theEnd, realTime, stairStep); 
-    } 
-
-    if (LOSS2 == plotMode)
-    {
-        Flow* nextFlow = flowList.Head();
-        unsigned int flowNumber = 0;
-        while (nextFlow)
-        {
-            flowNumber++;
-            double lossFraction = nextFlow->LossFraction2();
-            if (lossFraction < 0.0) lossFraction = 1.0;  // assume total loss for no data
-            double weight = (theTime - nextFlow->LossWindowStart2()) / windowSize;
-            nextFlow->UpdateSummary(lossFraction, weight);
-            if (realTime)
-            {
-                if (!nextFlow->AppendData(nextFlow->LossWindowStart2(), lossFraction))
-                {
-                    perror("trpr: Memory error adding data");
-                    exit(-1);
-                }
-                if (!nextFlow->AppendData(nextFlow->LossWindowEnd2(), lossFraction))
-                {
-                    perror("trpr: Memory error adding data");
-                    exit(-1);
-                }
-            }
-            if (outfile)
-            {
-                // Window start
-                fprintf(outfile, "%7.3f", nextFlow->LossWindowStart2());
-                unsigned int n = flowNumber;
-                while (--n) fprintf(outfile, ", ");
-                fprintf(outfile, ", %7.3e\n", lossFraction);
-                // Window end
-                fprintf(outfile, "%7.3f", nextFlow->LossWindowEnd2());
-                n = flowNumber;
-                while (--n) fprintf(outfile, ", ");
-                fprintf(outfile, ", %7.3e\n", lossFraction);
-            }
-            nextFlow = nextFlow->Next();
-        } 
-    }  // end if (LOSS2 == plotMode)
+    FinishPlot(plotMode, flowList, outfile, theTime, windowSize, windowStart,
+               startTime, noEvents, realTime, stairStep);
 
     if (realTime)
     {
@@ -3231,309 +4224,44 @@ int main(int argc, char* argv[])
     
     // Create final output file with gnuplot header if applicable
     if (output_file && use_gnuplot)
-    {
-    	if(!(outfile = fopen(output_file, "w+")))
-	    {
-	        perror("trpr: Error opening output file");
-	        exit(-1);
-	    }	
-        if (post_file)
-        {
-            fprintf(outfile, "set term post color solid\n");
-            fprintf(outfile, "set output '%s'\n", post_file); 
-        }
-        else if (png_file)
-        {           
-            fprintf(outfile, "set term png\n");
-            fprintf(outfile, "set output '%s'\n", png_file);   
-        }
-        if (!multiplot)
-            fprintf(outfile, "set title '%s %s'\n", 
-                       surname? surname : "", output_file);
-        fprintf(outfile, "set xlabel 'Time (sec)'\n");
-        double min = 0.0, max = 0.0;
-        switch (plotMode)
-        {
-            case RATE:            
-                fprintf(outfile, "set ylabel 'Rate (kbps)'\n");
-                fprintf(outfile, "set style data lines\n");
-		min = minYRange < 0.0 ? 0.0 : minYRange;
-		max = maxYRange < 0.0 ? -1.0 : maxYRange;
-		if (max < 0.0)
-		  fprintf(outfile, "set yrange[%f:*]\n",min);
-		else 
-		  fprintf(outfile, "set yrange[%f:%f]\n",min,max);
-                break;
-                
-            case LOSS:            
-            case LOSS2:            
-                fprintf(outfile, "set ylabel 'Loss Fraction'\n");
-                fprintf(outfile, "set style data lines\n");
-
-		max = maxYRange < 0.0 ? 1.1 : maxYRange;
-		if (autoScale)
-		{
-		  min = minYRange < 0.0 ? -0.01 : minYRange;
-		  if (maxYRange < 0.0)
-		    fprintf(outfile, "set yrange[%f:*]\n",min);
-		  else
-		    fprintf(outfile, "set yrange[%f:%f]\n",min,max);
-		}
-		else
-		{
-		  min = minYRange < 0.0 ? -0.1 : minYRange;
-		  fprintf(outfile, "set yrange[%f:%f]\n",min,max);
-		}
-                break;
-            
-	        case DROPS:
-	    	    fprintf(outfile, "set ylabel 'Drop Percentage'\n");
-		        if (windowSize != 0.0)
-                    fprintf(outfile, "set style data lines\n");
-                else
-                    fprintf(outfile, "set style data points\n");
-                break;
-                
-            case COUNT:
-	    	    fprintf(outfile, "set ylabel 'Packet Count'\n");
-		        if (windowSize != 0.0)
-                    fprintf(outfile, "set style data lines\n");
-                else
-                    fprintf(outfile, "set style data points\n");
-                break;
-	        
-            case INTERARRIVAL:
-                fprintf(outfile, "set ylabel 'Interarrival (sec)'\n");
-                if (windowSize != 0.0)
-                    fprintf(outfile, "set style data lines\n");
-                else
-                    fprintf(outfile, "set style data points\n");
-                break;
-                
-            case LATENCY:
-                fprintf(outfile, "set ylabel xx'Latency (sec)'\n");
-                if (windowSize != 0.0)
-                    fprintf(outfile, "set style data lines\n");
-                else
-                    fprintf(outfile, "set style data points\n");
-                break;
-                
-            case VELOCITY:            
-                fprintf(outfile, "set ylabel 'Velocity (meters/sec)'\n");
-                fprintf(outfile, "set style data lines\n");
-                break;
-                
-            default:
-                fprintf(stderr, "trpr: Unsupport plotting mode!\n");
-                exit(-1);
-        }  // end switch(plotMode)
-        
-	if (legend)
-	  fprintf(outfile, "set key bottom right\n");
-	else
-	  fprintf(outfile, "set key off\n");
-        double origin = 0.0;
-        double scale = 1.0 / ((double)flowList.Count());
-        Flow* nextFlow = flowList.Head();
-        if (nextFlow) 
-        {
-            if (multiplot)
-            {
-                fprintf(outfile, "set size 1.0,1.0\n");
-                fprintf(outfile, "set multiplot\n");
-            }
-            else
-            {
-                fprintf(outfile, "plot ");
-            }
-        }
-        int x = 2;
-        while (nextFlow)
-        {
-            if (multiplot) 
-            {
-                fprintf(outfile, "set size 1.0,%f\n", scale);
-                fprintf(outfile, "set origin 0.0,%f\n", origin);
-                fprintf(outfile, "plot ");
-                origin += scale;
-            }
-            fprintf(outfile, "\\\n'%s' index 1 using 1:%d t '",
-                              output_file, x++);
-            nextFlow->PrintDescription(outfile);
-            fprintf(outfile, "'");
-            nextFlow = nextFlow->Next();
-            if (nextFlow)
-            {
-                if (multiplot) 
-                    fprintf(outfile, "\n");
-                else
-                    fprintf(outfile, ", ");
-            }
-        }  // end while(nextFlow)
-        fprintf(outfile, "\nexit\n\n\n");
-        fflush(outfile);
-	
-	    // Append data from temp file to output file
-	    if(!(infile = fopen(temp_file, "r")))
-	    {
-	        perror("trpr: Error opening our temp file");
-	        exit(-1);
-	    }
-	    int result;
-	    char buffer[1024];
-	    while ((result = fread(buffer, sizeof(char), 1024, infile)))
-	    {
-	         fwrite(buffer, sizeof(char), result, outfile);
-	    }
-	    fclose(infile);
-        unlink(temp_file);
-	    fclose(outfile);
-    }  // end if (output_file && use_gnuplot)
+        WriteGnuplotFile(plotMode, flowList, output_file, temp_file, png_file, post_file,
+                         surname, multiplot, autoScale, legend, minYRange, maxYRange,
+                         windowSize);
     
     
+    // Finish any additional "metrics" the same way
+    for (Metric* m = metricList; NULL != m; m = m->Next())
+    {
+        FinishPlot(m->Mode(), m->Flows(), m->Output(), theTime, m->WindowSize(),
+                   windowStart, startTime, noEvents, false, stairStep);
+        m->CloseOutput();
+        if (m->OutputFile() && use_gnuplot)
+            WriteGnuplotFile(m->Mode(), m->Flows(), m->OutputFile(), m->TempFile(), 
+                             m->PngFile(), m->PostFile(), surname, multiplot, autoScale, 
+                             legend, minYRange, maxYRange, m->WindowSize());
+    }
+    
     if (summarize)
     {
-        double total = 0.0;
-        double variance = 0.0;
-        double min = 0.0, max = 0.0;
-        unsigned long count;
-        bool init = true;
-       
-        fprintf(stdout, "#TRPR Summaries: ");
-        double theStart = (startTime < 0.0) ? 0.0 : startTime;
-        double theEnd = (stopTime < 0.0) ? theTime : stopTime;
-        
-        double window = (windowSize < 0.0) ? (theEnd - theStart) : windowSize;
-        fprintf(stdout, "range>%.3f-%.3f, windowSize>%.3f\n", theStart,  theEnd, window);
-        const char* type;
-        const char* units;
-        switch(plotMode)
-        {
-            case RATE:
-                type = "rate";
-                units = "kbps";
-                break;
-            case LOSS:
-            case LOSS2:
-                type = "loss fraction";
-                units = "";
-                break;
-	        case DROPS:
-	    	    type = "drop percentage";
-		        units = "";
-                break;
-	        case COUNT:
-	    	    type = "count";
-		        units = "";
-                break;
-            case LATENCY:
-                type = "latency";
-                units = "sec";
-                break;
-            case INTERARRIVAL:
-                type = "interarrival";
-                units = "sec";
-                break;
-            case VELOCITY:
-                type = "velocity";
-                units = "meters/sec";
-                break;
-        }
-        Flow* nextFlow = flowList.Head();
-        while (nextFlow)
-        {
-            double fave = nextFlow->SummaryAverage();
-            double fmin = nextFlow->SummaryMin();
-            double fmax = nextFlow->SummaryMax();
-            double fvar = nextFlow->SummaryVariance();
-            if (isnan(fave))
-            {
-                switch (plotMode)
-                {
-                    case RATE:
-                    case VELOCITY:
-                    case COUNT:
-                    case DROPS:
-                        fave = fmin = fmax = fvar = 0.0;  // no packets for flow
-                        break;
-                    case LOSS:
-                    case LOSS2:
-                        fave = fmin = fmax = 1.0;  // no packets for flow
-                        fvar = 0.0;
-                        break;
-                    case LATENCY:
-                    case INTERARRIVAL:
-                        nextFlow = nextFlow->Next();
-                        continue;
-                        break;
-                }
-            }
-            
-            fprintf(stdout, "#flow>", type, units);
-            nextFlow->PrintDescription(stdout);            
-            fprintf(stdout, ", %s(%s), ", type, units);
-            fprintf(stdout, "ave>%lf, ", fave); 
-            fprintf(stdout, "min>%lf, ", fmin);  
-            fprintf(stdout, "max>%lf, ", fmax);  
-            fprintf(stdout, "dev>%lf ", sqrt(fvar));  
-            fprintf(stdout, "\n");
-            
-            if (init)
-            {
-                count = 1;
-                total = fave;
-                variance = total * total;
-                min = fmin;
-                max = fmax;
-                init = false;
-            }
-            else
-            {
-                count++;
-                total += fave;
-                variance += (fave*fave);
-                if (fmin < min) min = fmin;
-                if (fmax > max) max = fmax;
-            }           
-            nextFlow = nextFlow->Next();           
-        }   
-        
-        if (count > 1)
-        {
-            fprintf(stdout, "#flow>Summary, ");
-            double mean = total/((double)count);
-            variance = (variance/((double)count)) - (mean*mean);
-            fprintf(stdout, "%s(%s), ", type, units);
-            fprintf(stdout, "ave>%lf, ", mean);
-            fprintf(stdout, "min>%lf, ", min);
-            fprintf(stdout, "max>%lf, ", max);
-            fprintf(stdout, "dev>%lf, ", sqrt(variance));  
-            fprintf(stdout, "\n");
-        }
-    }  // end if (summarize)
+        PrintSummary(plotMode, flowList, startTime, stopTime, theTime, windowSize, primaryName);
+        for (Metric* m = metricList; NULL != m; m = m->Next())
+            PrintSummary(m->Mode(), m->Flows(), startTime, stopTime, theTime, 
+                         m->WindowSize(), m->Name());
+    }
     
-    if (make_histogram)
+    if (make_histogram) 
     {
-        fprintf(stdout, "#TRPR Histograms\n");
-        const double p[6] = {0.99, 0.95, 0.9, 0.8, 0.75, 0.5};        
-        Flow* nextFlow = flowList.Head();
-        while (nextFlow)
-        { 
-            fprintf(stdout, "#flow>");
-            nextFlow->PrintDescription(stdout);
-            fprintf(stdout, " min>%f max>%f percentiles(", 
-                    nextFlow->SummaryMin(), nextFlow->SummaryMax());
-            for (int j = 0; j < 6; j++)
-            {
-                double percentile = nextFlow->Percentile(p[j]);
-                fprintf(stdout, "%2d>%f ", (int)(p[j]*100.0+0.5), percentile);
-            }
-            fprintf(stdout, ")\n");
-            nextFlow->PrintHistogram(stdout);
-            fprintf(stdout, "\n\n\n");
-            nextFlow = nextFlow->Next();
-        }
-    }  // end if (make_histogram)
+        PrintHistograms(flowList, primaryName);
+        for (Metric* m = metricList; NULL != m; m = m->Next())
+            PrintHistograms(m->Flows(), m->Name());
+    }
+    
+    while (metricList)
+    {
+        Metric* m = metricList;
+        metricList = m->Next();
+        delete m;
+    }
     
     fflush(stdout);
     fprintf(stderr, "trpr: Done.\n");
@@ -3991,35 +4719,40 @@ bool TcpdumpEventParser::GetNextPacketEvent(FILE*        inFile,
 
             
             // Fill in values read from tcpdump line
-            unsigned char protocol = Protocol(headerBuffer);
-            theEvent->SetProtocol(ProtocolType(protocol));
-            theEvent->SetSrcAddr(SourceAddress(headerBuffer));
-            theEvent->SetDstAddr(DestinationAddress(headerBuffer));
-            switch (protocol)
-            {
-                case 6:   // TCP
-                case 17:  // UDP
-                    theEvent->SetSrcPort(SourcePort(headerBuffer));
-                    theEvent->SetDstPort(DestinationPort(headerBuffer));
-                    break;
-
-                default:
-                    theEvent->SetSrcPort(0);
-                    theEvent->SetDstPort(0);
-                    break;
-            }      
-            theEvent->SetSize(pktSize); 
             double theTime = (((double)hrs) * 3600.0) +
                              (((double)min) * 60.0) +
                              (double)sec;
-            theEvent->SetTime(theTime);
-            theEvent->SetType(PacketEvent::RECEPTION);
+            SetEvent(theEvent, headerBuffer, theTime);
             return true;
         }
     }  // end while(1)
     return true;
 }  // end TcpdumpEventParser::GetNextPacketEvent()
 
+void TcpdumpEventParser::SetEvent(PacketEvent* theEvent, const char* hdr, double theTime)
+{
+    unsigned char protocol = Protocol(hdr);
+    theEvent->SetProtocol(ProtocolType(protocol));
+    theEvent->SetSrcAddr(SourceAddress(hdr));
+    theEvent->SetDstAddr(DestinationAddress(hdr));
+    switch (protocol)
+    {
+        case 6:   // TCP
+        case 17:  // UDP
+            theEvent->SetSrcPort(SourcePort(hdr));
+            theEvent->SetDstPort(DestinationPort(hdr));
+            break;
+
+        default:
+            theEvent->SetSrcPort(0);
+            theEvent->SetDstPort(0);
+            break;
+    }      
+    theEvent->SetSize(TotalLength(hdr)); 
+    theEvent->SetTime(theTime);
+    theEvent->SetType(PacketEvent::RECEPTION);
+}  // end TcpdumpEventParser::SetEvent()
+
 const char* TcpdumpEventParser::ProtocolType(unsigned char value) const
 {
     static char type[8];
@@ -4092,17 +4825,588 @@ unsigned int TcpdumpEventParser::PackHexLine(char* text, char* buf, unsigned int
     return byteCount;
 }  // end TcpdumpEventParser::PackHexLine()
 
-
-FastReader::FastReader()
-    : savecount(0)
+PcapEventParser::PcapEventParser()
+ : started(false), at_end(false), pcapng(false), little_endian(true), 
+   seekable(false), link_type(0), ts_units(1.0e+06), if_count(0),
+   spb_warned(false), tz_interval((unsigned long)-1), tz_offset(0)
 {
-    
 }
 
-FastReader::Result FastReader::Read(FILE*           filePtr, 
-                                    char*           buffer, 
-                                    unsigned int*   len,
-                                    double          timeout)
+bool PcapEventParser::GetNextPacketEvent(FILE*          inFile, 
+                                         PacketEvent*   theEvent, 
+                                         double         /*timeout*/)
+{
+    // (Binary input is read with blocking reads, so no TIMEOUT events)
+    if (!started)
+    {
+        started = true;
+        if (!ReadFileHeader(inFile)) return false;
+    }
+    bool gotEvent = false;
+    while (!gotEvent)
+    {
+        if (pcapng)
+        {
+            if (!ReadPcapngBlock(inFile, theEvent, gotEvent)) return false;
+        }
+        else
+        {
+            if (!ReadPcapRecord(inFile, theEvent, gotEvent)) return false;
+        }
+    }
+    return true;
+}  // end PcapEventParser::GetNextPacketEvent()
+
+bool PcapEventParser::ReadFileHeader(FILE* inFile)
+{
+    unsigned char buf[20];
+    size_t result = fread(buf, 1, 4, inFile);
+    if (0 == result)
+    {
+        at_end = true;  // empty input
+        return false;
+    }
+    else if (result < 4)
+    {
+        fprintf(stderr, "trpr: Invalid pcap input (truncated file header)\n");
+        return false;
+    }
+#ifdef WIN32
+    seekable = (0 == fseek(inFile, 0, SEEK_CUR));
+#else
+    seekable = (0 == fseeko(inFile, 0, SEEK_CUR));
+#endif // if/else WIN32
+    unsigned long magic = ((unsigned long)buf[0] << 24) | ((unsigned long)buf[1] << 16) |
+                          ((unsigned long)buf[2] << 8) | (unsigned long)buf[3];
+    switch (magic)
+    {
+        case 0xa1b2c3d4:  // libpcap, microsecond timestamps
+        case 0xd4c3b2a1:
+            little_endian = (0xd4c3b2a1 == magic);
+            ts_units = 1.0e+06;
+            break;
+        case 0xa1b23c4d:  // libpcap, nanosecond timestamps
+        case 0x4d3cb2a1:
+            little_endian = (0x4d3cb2a1 == magic);
+            ts_units = 1.0e+09;
+            break;
+        case 0x0a0d0d0a:  // pcapng Section Header Block
+            pcapng = true;
+            if (4 != fread(buf, 1, 4, inFile))
+            {
+                fprintf(stderr, "trpr: Invalid pcapng input (truncated section header)\n");
+                return false;
+            }
+            return ReadSectionHeader(inFile, buf);
+        default:
+            fprintf(stderr, "trpr: Input is not a pcap or pcapng file\n");
+            return false;
+    }
+    // version, thiszone, sigfigs, snaplen and network (link type)
+    if (20 != fread(buf, 1, 20, inFile))
+    {
+        fprintf(stderr, "trpr: Invalid pcap input (truncated file header)\n");
+        return false;
+    }
+    // (the upper bits of the link type field may hold FCS information)
+    link_type = Get32(buf + 16) & 0xffff;
+    return true;
+}  // end PcapEventParser::ReadFileHeader()
+
+// Reads the remainder of a pcapng Section Header Block following its 
+// block type and "lengthField" (whose byte order is not yet known)
+bool PcapEventParser::ReadSectionHeader(FILE* inFile, const unsigned char* lengthField)
+{
+    unsigned char buf[4];
+    if (4 != fread(buf, 1, 4, inFile))
+    {
+        fprintf(stderr, "trpr: Invalid pcapng input (truncated section header)\n");
+        return false;
+    }
+    if ((0x1a == buf[0]) && (0x2b == buf[1]) && (0x3c == buf[2]) && (0x4d == buf[3]))
+    {
+        little_endian = false;
+    }
+    else if ((0x4d == buf[0]) && (0x3c == buf[1]) && (0x2b == buf[2]) && (0x1a == buf[3]))
+    {
+        little_endian = true;
+    }
+    else
+    {
+        fprintf(stderr, "trpr: Invalid pcapng input (bad byte-order magic)\n");
+        return false;
+    }
+    unsigned long blockLength = Get32(lengthField);
+    if ((blockLength < 28) || (0 != (blockLength & 0x03)))
+    {
+        fprintf(stderr, "trpr: Invalid pcapng input (bad section header length)\n");
+        return false;
+    }
+    // Interface ids are numbered per section
+    if_count = 0;
+    return Skip(inFile, blockLength - 12);
+}  // end PcapEventParser::ReadSectionHeader()
+
+bool PcapEventParser::ReadPcapRecord(FILE* inFile, PacketEvent* theEvent, bool& gotEvent)
+{
+    // ts_sec, ts_usec (or ts_nsec), incl_len, orig_len
+    unsigned char buf[16];
+    size_t result = fread(buf, 1, 16, inFile);
+    if (0 == result)
+    {
+        at_end = true;
+        return false;
+    }
+    else if (result < 16)
+    {
+        fprintf(stderr, "trpr: Invalid pcap input (truncated record header)\n");
+        return false;
+    }
+    double theTime = TimeOfDay(Get32(buf), ((double)Get32(buf + 4)) / ts_units);
+    return ReadPacket(inFile, link_type, Get32(buf + 8), theTime, theEvent, gotEvent);
+}  // end PcapEventParser::ReadPcapRecord()
+
+bool PcapEventParser::ReadPcapngBlock(FILE* inFile, PacketEvent* theEvent, bool& gotEvent)
+{
+    unsigned char buf[20];
+    size_t result = fread(buf, 1, 8, inFile);
+    if (0 == result)
+    {
+        at_end = true;
+        return false;
+    }
+    else if (result < 8)
+    {
+        fprintf(stderr, "trpr: Invalid pcapng input (truncated block header)\n");
+        return false;
+    }
+    unsigned long blockType = Get32(buf);
+    if (0x0a0d0d0a == blockType)  // new section (which may change byte order)
+        return ReadSectionHeader(inFile, buf + 4);
+    unsigned long blockLength = Get32(buf + 4);
+    if ((blockLength < 12) || (0 != (blockLength & 0x03)))
+    {
+        fprintf(stderr, "trpr: Invalid pcapng input (bad block length)\n");
+        return false;
+    }
+    // (the block body is followed by a trailing copy of the block length)
+    unsigned long bodyLength = blockLength - 12;
+    switch (blockType)
+    {
+        case 1:  // Interface Description Block
+        {
+            if ((bodyLength < 8) || (bodyLength > sizeof(block_buffer)))
+            {
+                fprintf(stderr, "trpr: Invalid pcapng input (bad interface description)\n");
+                return false;
+            }
+            if (bodyLength != fread(block_buffer, 1, bodyLength, inFile))
+            {
+                fprintf(stderr, "trpr: Invalid pcapng input (truncated interface description)\n");
+                return false;
+            }
+            // LinkType, reserved, SnapLen, then options
+            double units = 1.0e+06;
+            unsigned long offset = 8;
+            while ((offset + 4) <= bodyLength)
+            {
+                unsigned long optCode = Get16(block_buffer + offset);
+                unsigned long optLength = Get16(block_buffer + offset + 2);
+                if (0 == optCode) break;  // opt_endofopt
+                if ((9 == optCode) && (optLength >= 1) && ((offset + 5) <= bodyLength))
+                {
+                    // if_tsresol is a negative power of 10 (or of 2 with the high bit set)
+                    unsigned int exponent = block_buffer[offset + 4];
+                    if (0 != (exponent & 0x80))
+                        units = ((exponent & 0x7f) < 64) ? ldexp(1.0, exponent & 0x7f) : 0.0;
+                    else
+                        units = (exponent < 20) ? pow(10.0, (double)exponent) : 0.0;
+                    if (0.0 == units)
+                    {
+                        fprintf(stderr, "trpr: Invalid pcapng input (bad timestamp resolution)\n");
+                        return false;
+                    }
+                }
+                offset += 4 + ((optLength + 3) & ~0x03);
+            }
+            if (if_count < MAX_INTERFACES)
+            {
+                if_link_type[if_count] = Get16(block_buffer);
+                if_ts_units[if_count] = units;
+            }
+            else
+            {
+                fprintf(stderr, "trpr: Warning! pcapng input has too many interfaces\n");
+            }
+            if_count++;
+            return Skip(inFile, 4);
+        }
+        case 2:  // (obsolete) Packet Block
+        case 6:  // Enhanced Packet Block
+        {
+            if ((bodyLength < 20) || (20 != fread(buf, 1, 20, inFile)))
+            {
+                fprintf(stderr, "trpr: Invalid pcapng input (truncated packet block)\n");
+                return false;
+            }
+            // Interface ID (16 bits in the Packet Block, followed by a drops count)
+            unsigned long ifIndex = (2 == blockType) ? Get16(buf) : Get32(buf);
+            unsigned long captureLength = Get32(buf + 12);
+            if ((ifIndex >= if_count) || (ifIndex >= MAX_INTERFACES))
+            {
+                fprintf(stderr, "trpr: Invalid pcapng input (unknown interface id)\n");
+                return false;
+            }
+            if (captureLength > (bodyLength - 20))
+            {
+                fprintf(stderr, "trpr: Invalid pcapng input (bad packet capture length)\n");
+                return false;
+            }
+            unsigned long long timestamp = 
+                ((unsigned long long)Get32(buf + 4) << 32) | (unsigned long long)Get32(buf + 8);
+            double units = if_ts_units[ifIndex];
+            unsigned long long wholeUnits = (unsigned long long)units;
+            double theTime = TimeOfDay((unsigned long)(timestamp / wholeUnits),
+                                       ((double)(timestamp % wholeUnits)) / units);
+            if (!ReadPacket(inFile, if_link_type[ifIndex], captureLength, theTime, theEvent, gotEvent))
+                return false;
+            // Skip padding, options and trailing block length
+            return Skip(inFile, bodyLength - 20 - captureLength + 4);
+        }
+        case 3:  // Simple Packet Block
+            // (these carry no timestamp so TRPR can not use them)
+            if (!spb_warned)
+            {
+                fprintf(stderr, "trpr: Warning! ignoring pcapng simple packet blocks\n");
+                spb_warned = true;
+            }
+            return Skip(inFile, bodyLength + 4);
+        default:
+            return Skip(inFile, bodyLength + 4);
+    }
+}  // end PcapEventParser::ReadPcapngBlock()
+
+// Reads a captured packet of "captureLength" bytes, extracting
+// the IP header that follows its link layer header
+bool PcapEventParser::ReadPacket(FILE*           inFile, 
+                                 unsigned int    linkType, 
+                                 unsigned long   captureLength,
+                                 double          theTime,
+                                 PacketEvent*    theEvent,
+                                 bool&           gotEvent)
+{
+    // Only the leading headers are read, the remainder is skipped
+    unsigned char pkt[MAX_LINK_HEADER + IP_HEADER_MAX];
+    unsigned long numBytes = MIN(captureLength, (unsigned long)sizeof(pkt));
+    if (numBytes != fread(pkt, 1, numBytes, inFile))
+    {
+        fprintf(stderr, "trpr: Invalid pcap input (truncated packet)\n");
+        return false;
+    }
+    if (!Skip(inFile, captureLength - numBytes)) return false;
+    
+    // Find the IP header (with the link layer protocol type, if given)
+    unsigned long offset;
+    int typeOffset = -1;
+    switch (linkType)
+    {
+        case 0:    // DLT_NULL (BSD loopback)
+        case 108:  // DLT_LOOP
+            offset = 4;
+            break;
+        case 1:    // DLT_EN10MB (Ethernet)
+            offset = 14;
+            typeOffset = 12;
+            break;
+        case 12:   // DLT_RAW (platform-specific values)
+        case 14:
+        case 101:  // LINKTYPE_RAW
+        case 228:  // LINKTYPE_IPV4
+        case 229:  // LINKTYPE_IPV6
+            offset = 0;
+            break;
+        case 113:  // DLT_LINUX_SLL
+            offset = 16;
+            typeOffset = 14;
+            break;
+        case 276:  // DLT_LINUX_SLL2
+            offset = 20;
+            typeOffset = 0;
+            break;
+        default:
+            fprintf(stderr, "trpr: Unsupported pcap link type %u\n", linkType);
+            return false;
+    }
+    if (numBytes < offset) return true;  // not an IP packet
+    if (typeOffset >= 0)
+    {
+        unsigned int etherType = (pkt[typeOffset] << 8) | pkt[typeOffset + 1];
+        if (1 == linkType)
+        {
+            // Step over any 802.1Q / 802.1ad VLAN tags
+            while (((0x8100 == etherType) || (0x88a8 == etherType)) && ((offset + 4) <= numBytes))
+            {
+                etherType = (pkt[offset + 2] << 8) | pkt[offset + 3];
+                offset += 4;
+            }
+        }
+        if ((0x0800 != etherType) && (0x86dd != etherType)) return true;
+    }
+    const unsigned char* ip = pkt + offset;
+    unsigned long ipBytes = numBytes - offset;
+    unsigned int version = (ipBytes > 0) ? (ip[0] >> 4) : 0;
+    if (((4 != version) || (ipBytes < 20)) && ((6 != version) || (ipBytes < 40)))
+        return true;  // not an IP packet (or too short)
+    
+    char hdr[IP_HEADER_MAX];
+    memset(hdr, 0, IP_HEADER_MAX);
+    memcpy(hdr, ip, MIN(ipBytes, (unsigned long)IP_HEADER_MAX));
+    SetEvent(theEvent, hdr, theTime);
+    gotEvent = true;
+    return true;
+}  // end PcapEventParser::ReadPacket()
+
+bool PcapEventParser::Skip(FILE* inFile, unsigned long numBytes)
+{
+    if (0 == numBytes) return true;
+    if (seekable)
+    {
+#ifdef WIN32
+        if (0 == fseek(inFile, (long)numBytes, SEEK_CUR)) return true;
+#else
+        if (0 == fseeko(inFile, (off_t)numBytes, SEEK_CUR)) return true;
+#endif // if/else WIN32
+    }
+    // Non-seekable input (e.g. a pipe) is read and discarded
+    while (numBytes > 0)
+    {
+        size_t count = MIN(numBytes, (unsigned long)sizeof(block_buffer));
+        if (count != fread(block_buffer, 1, count, inFile))
+        {
+            fprintf(stderr, "trpr: Invalid pcap input (truncated block)\n");
+            return false;
+        }
+        numBytes -= count;
+    }
+    return true;
+}  // end PcapEventParser::Skip()
+
+double PcapEventParser::TimeOfDay(unsigned long seconds, double fraction)
+{
+    // The local time offset is looked up once per 15 minute interval,
+    // (time zone changes fall on such boundaries)
+    unsigned long interval = seconds / 900;
+    if (interval != tz_interval)
+    {
+        time_t timeSec = (time_t)seconds;
+#ifdef WIN32
+        struct tm* timePtr = localtime(&timeSec);
+#else
+        struct tm timeStruct;
+        struct tm* timePtr = localtime_r(&timeSec, &timeStruct);
+#endif // if/else WIN32
+        long localSeconds = timePtr ? 
+            ((3600 * timePtr->tm_hour) + (60 * timePtr->tm_min) + timePtr->tm_sec) :
+            (long)(seconds % 86400);
+        tz_offset = localSeconds - (long)(seconds % 86400);
+        tz_interval = interval;
+    }
+    long daySeconds = ((long)(seconds % 86400) + tz_offset) % 86400;
+    if (daySeconds < 0) daySeconds += 86400;
+    return ((double)daySeconds + fraction);
+}  // end PcapEventParser::TimeOfDay()
+
+MgenBinaryEventParser::MgenBinaryEventParser()
+ : started(false), at_end(false)
+{
+}
+
+bool MgenBinaryEventParser::GetNextPacketEvent(FILE*          inFile, 
+                                               PacketEvent*   theEvent, 
+                                               double         /*timeout*/)
+{
+    // (Binary input is read with blocking reads, so no TIMEOUT events)
+    if (!started)
+    {
+        started = true;
+        if (!ReadFileHeader(inFile)) return false;
+    }
+    while (1)
+    {
+        // eventType, reserved (protocol), recordLength
+        unsigned char header[4];
+        size_t result = fread(header, 1, 4, inFile);
+        if (0 == result)
+        {
+            at_end = true;
+            return false;
+        }
+        unsigned int recordLength = (result < 4) ? 0 : Get16(header + 2);
+        if ((result < 4) || (recordLength != fread(record, 1, recordLength, inFile)))
+        {
+            fprintf(stderr, "trpr: Invalid MGEN binary log (truncated record)\n");
+            return false;
+        }
+        switch (header[0])
+        {
+            case RECV_EVENT:
+            {
+                // eventTime, srcPort, srcAddrType, srcAddrLen, srcAddr, then message
+                Address srcAddr;
+                unsigned int index = (recordLength < 12) ? recordLength + 1 : 12 + record[11];
+                if ((index > recordLength) ||
+                    !GetAddress(record + 12, record[10], record[11], srcAddr) ||
+                    !ParseMessage(record + index, recordLength - index, theEvent))
+                {
+                    fprintf(stderr, "trpr: Invalid MGEN binary log RECV record\n");
+                    continue;
+                }
+                double rxTime = TimeOfDay(Get32(record), Get32(record + 4));
+                theEvent->SetType(PacketEvent::RECEPTION);
+                theEvent->SetTime(rxTime);
+                theEvent->SetRxTime(rxTime);
+                theEvent->SetSrcAddr(srcAddr);
+                theEvent->SetSrcPort((unsigned short)Get16(record + 8));
+                return true;
+            }
+            case SEND_EVENT:
+            {
+                // [mgen_msg_len (TCP)], then message
+                unsigned int index = (TCP == header[1]) ? 4 : 0;
+                if ((index > recordLength) ||
+                    !ParseMessage(record + index, recordLength - index, theEvent))
+                {
+                    fprintf(stderr, "trpr: Invalid MGEN binary log SEND record\n");
+                    continue;
+                }
+                // (as for text logs, the source is left unspecified)
+                theEvent->SetType(PacketEvent::TRANSMISSION);
+                theEvent->SetTime(theEvent->TxTime());
+                theEvent->SetRxTime(theEvent->TxTime());
+                theEvent->SetSrcAddr("0.0.0.0");
+                theEvent->SetSrcPort(0);
+                if (TCP == header[1]) theEvent->SetSize(Get32(record));
+                return true;
+            }
+            default:
+                // (other MGEN events are not packet events)
+                continue;
+        }
+    }  // end while (1)
+}  // end MgenBinaryEventParser::GetNextPacketEvent()
+
+bool MgenBinaryEventParser::ReadFileHeader(FILE* inFile)
+{
+    // ASCII header line (e.g. "mgen version=5.02c type=binary_log\n"),
+    // terminated with a NULL character
+    char header[HEADER_MAX];
+    unsigned int len = 0;
+    int c = EOF;
+    while ((len < HEADER_MAX) && (EOF != (c = getc(inFile))))
+    {
+        header[len++] = (char)c;
+        if ('\0' == c) break;
+    }
+    if (0 == len)
+    {
+        at_end = true;  // empty input
+        return false;
+    }
+    if (('\0' != c) || strncmp(header, "mgen", 4) || !strstr(header, "type=binary_log"))
+    {
+        fprintf(stderr, "trpr: Input is not an MGEN binary log file\n");
+        return false;
+    }
+    const char* ptr = strstr(header, "version=");
+    int version;
+    if (!ptr || (1 != sscanf(ptr, "version=%d", &version)) || ((4 != version) && (5 != version)))
+    {
+        fprintf(stderr, "trpr: Unsupported MGEN binary log version\n");
+        return false;
+    }
+    return true;
+}  // end MgenBinaryEventParser::ReadFileHeader()
+
+// Fills in "theEvent" from a packed MGEN message (as in MgenMsg::Unpack())
+bool MgenBinaryEventParser::ParseMessage(const unsigned char*  buffer, 
+                                         unsigned int          bufferLen, 
+                                         PacketEvent*          theEvent)
+{
+    // msg_len, version, flags, flow_id, seq_num, tx_time, dst_port, 
+    // dst_addr (type, len, addr), then optional host_addr and GPS fields
+    if ((bufferLen < MSG_MIN_SIZE) || (MSG_VERSION != buffer[2])) return false;
+    unsigned int addrLen = buffer[23];
+    unsigned int index = 24 + addrLen;
+    Address dstAddr;
+    if ((index > bufferLen) || !GetAddress(buffer + 24, buffer[22], addrLen, dstAddr))
+        return false;
+    theEvent->SetProtocol("mgen");
+    theEvent->SetSize(Get16(buffer));
+    theEvent->SetFlowId(Get32(buffer + 4));
+    theEvent->SetSequence(Get32(buffer + 8));
+    theEvent->SetTxTime(TimeOfDay(Get32(buffer + 12), Get32(buffer + 16)));
+    theEvent->SetDstAddr(dstAddr);
+    theEvent->SetDstPort((unsigned short)Get16(buffer + 20));
+    // Skip host_addr (port, type, len, addr) to get the GPS position, if any
+    double x = 999.0;
+    double y = 999.0;
+    if ((index + 4) <= bufferLen)
+    {
+        index += 4 + buffer[index + 3];
+        if (((index + 13) <= bufferLen) && (CURRENT == buffer[index + 12]))
+        {
+            y = ((double)Get32(buffer + index)) / 60000.0 - 180.0;      // latitude
+            x = ((double)Get32(buffer + index + 4)) / 60000.0 - 180.0;  // longitude
+        }
+    }
+    theEvent->SetPosition(x, y);
+    return true;
+}  // end MgenBinaryEventParser::ParseMessage()
+
+bool MgenBinaryEventParser::GetAddress(const unsigned char* buffer, 
+                                       unsigned int         addrType, 
+                                       unsigned int         addrLen, 
+                                       Address&             theAddress)
+{
+    char text[64];
+    if ((IPv4 == addrType) && (4 == addrLen))
+    {
+        sprintf(text, "%u.%u.%u.%u", buffer[0], buffer[1], buffer[2], buffer[3]);
+        theAddress.Set(text);
+        return true;
+    }
+    else if ((IPv6 == addrType) && (16 == addrLen))
+    {
+#ifdef WIN32
+        unsigned long buf[4];
+        for (unsigned int i = 0; i < 4; i++)
+            buf[i] = htonl(Get32(buffer + (4*i)));
+        theAddress.SetIPv6(buf);
+        return true;
+#else
+        // (inet_ntop() gives the same form as MGEN text logs)
+        if (!inet_ntop(AF_INET6, buffer, text, sizeof(text))) return false;
+        theAddress.Set(text);
+        return true;
+#endif // if/else WIN32
+    }
+    else
+    {
+        return false;
+    }
+}  // end MgenBinaryEventParser::GetAddress()
+
+
+FastReader::FastReader()
+    : savecount(0), at_end(false)
+{
+    
+}
+
+FastReader::Result FastReader::Read(FILE*           filePtr, 
+                                    char*           buffer, 
+                                    unsigned int*   len,
+                                    double          timeout)
 {
     unsigned int want = *len;   
     if (savecount)
@@ -4182,9 +5486,14 @@ FastReader::Result FastReader::Read(FILE*           filePtr,
 #endif // !WIN32
             *len -= want;
             if (*len)
+            {
                 return OK;  // we read at least something
+            }
             else
+            {
+                at_end = true;
                 return DONE; // we read nothing
+            }
         }
     }  // end while(want)
     return OK;
@@ -4251,26 +5560,283 @@ FastReader::Result FastReader::Readline(FILE*         filePtr,
     return ERROR_;
 }  // end FastReader::Readline()
 
+#ifndef WIN32
+ParallelEventParser::Chunk::Chunk()
+ : format(TCPDUMP), text(NULL), length(0), event_list(NULL), event_max(0), 
+   event_count(0), complete(true), started(false)
+{
+}
 
-void UpdateWindowPlot(PlotMode plotMode, FlowList& flowList, FILE* outfile,
-                      double theTime, double windowStart, double windowEnd, 
-                      bool realTime, bool stairStep)
+ParallelEventParser::Chunk::~Chunk()
 {
-    double windowSize = windowEnd - windowStart;
-    if (windowSize <= 0.0) return;
-    
-    switch(plotMode)
+    if (event_list) delete[] event_list;
+}
+
+void* ParallelEventParser::Chunk::DoParse(void* arg)
+{
+    ((Chunk*)arg)->Parse();
+    return NULL;
+}  // end ParallelEventParser::Chunk::DoParse()
+
+void ParallelEventParser::Chunk::Parse()
+{
+    event_count = 0;
+    complete = false;
+    // Each line yields at most one event ('\r' also ends a line for FastReader)
+    unsigned long lineCount = 1;
+    const char* ptr = text;
+    const char* end = text + length;
+    while (ptr < end)
     {
-        case RATE:
-        case LOSS:
-	    case DROPS:
-        case COUNT:
-        case LATENCY:
-        case INTERARRIVAL:
-        case VELOCITY:
+        if (('\n' == *ptr) || ('\r' == *ptr)) lineCount++;
+        ptr++;
+    }
+    if (lineCount > event_max)
+    {
+        if (event_list) delete[] event_list;
+        event_max = 0;
+        if (!(event_list = new PacketEvent[lineCount]))
         {
-            if (stairStep)
-            {
+            perror("trpr: ParallelEventParser::Chunk::Parse() error allocating event list");
+            return;
+        }
+        event_max = lineCount;
+    }
+    FILE* filePtr = fmemopen((void*)text, length, "r");
+    if (!filePtr)
+    {
+        perror("trpr: ParallelEventParser::Chunk::Parse() fmemopen() error");
+        return;
+    }
+    DrecEventParser drecParser;
+    TcpdumpEventParser tcpdumpParser;
+    NsEventParser nsParser;
+    EventParser* parser = NULL;
+    switch (format)
+    {
+        case TCPDUMP:
+            parser = &tcpdumpParser;
+            break;
+        case DREC:
+            parser = &drecParser;
+            break;
+        case NS:
+            parser = &nsParser;
+            break;
+        default:
+            // (binary trace formats are not split into chunks)
+            break;
+    }
+    assert(NULL != parser);
+    // Events are parsed into a single working event, as with serial parsing,
+    // and then copied to the list
+    PacketEvent theEvent;
+    while ((event_count < event_max) && parser->GetNextPacketEvent(filePtr, &theEvent))
+        event_list[event_count++] = theEvent;
+    complete = parser->AtEnd();
+    fclose(filePtr);
+}  // end ParallelEventParser::Chunk::Parse()
+
+ParallelEventParser::ParallelEventParser(TraceFormat traceFormat, unsigned int threadCount)
+ : format(traceFormat), thread_count(threadCount ? threadCount : 1), 
+   map_ptr(NULL), map_size(0), map_offset(0), current_batch(0), 
+   current_ready(false), current_chunk(0), current_event(0), at_end(false)
+{
+    chunk_list[0] = chunk_list[1] = NULL;
+    chunk_count[0] = chunk_count[1] = 0;
+}
+
+ParallelEventParser::~ParallelEventParser()
+{
+    Close();
+}
+
+bool ParallelEventParser::Open(const char* path)
+{
+    Close();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        perror("trpr: ParallelEventParser::Open() open() error");
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0)
+    {
+        perror("trpr: ParallelEventParser::Open() fstat() error");
+        close(fd);
+        return false;
+    }
+    if (!S_ISREG(info.st_mode))
+    {
+        fprintf(stderr, "trpr: ParallelEventParser::Open() input is not a regular file\n");
+        close(fd);
+        return false;
+    }
+    map_size = info.st_size;
+    if (map_size)
+    {
+        void* ptr = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == ptr)
+        {
+            perror("trpr: ParallelEventParser::Open() mmap() error");
+            close(fd);
+            map_size = 0;
+            return false;
+        }
+        map_ptr = (char*)ptr;
+        madvise(map_ptr, map_size, MADV_SEQUENTIAL);
+    }
+    close(fd);  // the mapping remains valid
+    if (!(chunk_list[0] = new Chunk[thread_count]) ||
+        !(chunk_list[1] = new Chunk[thread_count]))
+    {
+        perror("trpr: ParallelEventParser::Open() error allocating chunks");
+        Close();
+        return false;
+    }
+    for (unsigned int i = 0; i < thread_count; i++)
+        chunk_list[0][i].format = chunk_list[1][i].format = format;
+    map_offset = 0;
+    current_batch = 0;
+    current_ready = false;
+    at_end = false;
+    StartBatch(0);
+    return true;
+}  // end ParallelEventParser::Open()
+
+void ParallelEventParser::Close()
+{
+    FinishBatch(0);
+    FinishBatch(1);
+    if (chunk_list[0]) delete[] chunk_list[0];
+    if (chunk_list[1]) delete[] chunk_list[1];
+    chunk_list[0] = chunk_list[1] = NULL;
+    chunk_count[0] = chunk_count[1] = 0;
+    if (map_ptr)
+    {
+        munmap(map_ptr, map_size);
+        map_ptr = NULL;
+    }
+    map_size = map_offset = 0;
+}  // end ParallelEventParser::Close()
+
+// Carve the next "thread_count" chunks from the mapped file and start parsing them
+void ParallelEventParser::StartBatch(unsigned int batch)
+{
+    chunk_count[batch] = 0;
+    const char* mapEnd = map_ptr + map_size;
+    while ((chunk_count[batch] < thread_count) && (map_offset < map_size))
+    {
+        // Find a chunk boundary at or beyond CHUNK_SIZE bytes, just after 
+        // a newline (and, for tcpdump, at the start of a new packet record)
+        unsigned long endOffset = map_size;
+        if ((map_size - map_offset) > CHUNK_SIZE)
+        {
+            const char* ptr = map_ptr + map_offset + CHUNK_SIZE;
+            while (ptr < mapEnd)
+            {
+                const char* eol = (const char*)memchr(ptr, '\n', mapEnd - ptr);
+                if (!eol) break;
+                ptr = eol + 1;
+                if ((ptr < mapEnd) && ((TCPDUMP != format) || !isspace((unsigned char)*ptr)))
+                {
+                    endOffset = ptr - map_ptr;
+                    break;
+                }
+            }
+        }
+        Chunk& chunk = chunk_list[batch][chunk_count[batch]++];
+        chunk.text = map_ptr + map_offset;
+        chunk.length = endOffset - map_offset;
+        map_offset = endOffset;
+        if (0 == pthread_create(&chunk.thread, NULL, Chunk::DoParse, &chunk))
+        {
+            chunk.started = true;
+        }
+        else
+        {
+            perror("trpr: ParallelEventParser::StartBatch() pthread_create() error");
+            chunk.Parse();  // so just parse it here
+        }
+    }
+}  // end ParallelEventParser::StartBatch()
+
+void ParallelEventParser::FinishBatch(unsigned int batch)
+{
+    if (!chunk_list[batch]) return;
+    for (unsigned int i = 0; i < chunk_count[batch]; i++)
+    {
+        Chunk& chunk = chunk_list[batch][i];
+        if (chunk.started)
+        {
+            pthread_join(chunk.thread, NULL);
+            chunk.started = false;
+        }
+    }
+}  // end ParallelEventParser::FinishBatch()
+
+bool ParallelEventParser::GetNextPacketEvent(FILE*        /*filePtr*/, 
+                                             PacketEvent* theEvent, 
+                                             double       /*timeout*/)
+{
+    if (!chunk_list[0]) return false;  // not open
+    while (1)
+    {
+        if (!current_ready)
+        {
+            // Wait for the current batch, then start parsing the next one
+            FinishBatch(current_batch);
+            StartBatch(current_batch ^ 1);
+            current_ready = true;
+            current_chunk = 0;
+            current_event = 0;
+        }
+        if (current_chunk >= chunk_count[current_batch])
+        {
+            if (0 == chunk_count[current_batch])
+            {
+                at_end = true;
+                return false;
+            }
+            current_batch ^= 1;
+            current_ready = false;
+            continue;
+        }
+        Chunk& chunk = chunk_list[current_batch][current_chunk];
+        if (current_event < chunk.event_count)
+        {
+            *theEvent = chunk.event_list[current_event++];
+            return true;
+        }
+        // A serial parser would have given up where this chunk's did
+        if (!chunk.complete) return false;
+        current_chunk++;
+        current_event = 0;
+    }
+}  // end ParallelEventParser::GetNextPacketEvent()
+#endif // !WIN32
+
+
+void UpdateWindowPlot(PlotMode plotMode, FlowList& flowList, FILE* outfile,
+                      double theTime, double windowStart, double windowEnd, 
+                      bool realTime, bool stairStep)
+{
+    double windowSize = windowEnd - windowStart;
+    if (windowSize <= 0.0) return;
+    
+    switch(plotMode)
+    {
+        case RATE:
+        case LOSS:
+	    case DROPS:
+        case COUNT:
+        case LATENCY:
+        case INTERARRIVAL:
+        case VELOCITY:
+        {
+            if (stairStep)
+            {
                 // Plot window start point (also prune/add "realTime" data for all flows)
                 Flow* nextFlow = flowList.Head();
                 if (outfile) fprintf(outfile, "%7.3f", windowStart);
@@ -4450,6 +6016,683 @@ void UpdateWindowPlot(PlotMode plotMode, FlowList& flowList, FILE* outfile,
     }  // end switch(plotMode)   
 }  // end UpdateWindowPlot()
 
+// Incorporates a packet event into "theFlow" for the given "plotMode",
+// writing any non-windowed data point to "outfile".  Windowed interarrival
+// and latency samples accumulate to "matchFlow" (NULL drops the sample, as
+// for the first packet of a newly auto-matched flow).
+void UpdateFlow(PlotMode plotMode, Flow* theFlow, Flow* matchFlow, 
+                unsigned int flowNumber, PacketEvent& theEvent, double theTime, 
+                double windowSize, bool realTime, bool stairStep, FILE* outfile)
+{
+    unsigned int pktSize = theEvent.Size();
+    double rxTime = theEvent.RxTime();
+    double txTime = theEvent.TxTime();
+    unsigned long sequence = theEvent.Sequence();
+    switch(plotMode)
+    {
+
+        case RATE:
+            if (0.0 != windowSize)
+            {                            
+                theFlow->AddBytes(pktSize);
+            }
+            else
+            {
+                // Instantaneous data rate = pktSize/interarrival time
+                // (can't count first packet this way)
+                double delay = theFlow->MarkReception(theTime);
+                //if (delay > 0.0)
+                {
+                    //double rate = (8.0/1000.0) * ((double)pktSize) / delay;
+                    double rate = (8.0/1000.0) * ((double)pktSize);
+                    theFlow->UpdateSummary(rate);
+                    if (realTime)
+                    {
+                        if (stairStep)
+                            theFlow->AppendData(theTime, 0.0);
+                        if (!theFlow->AppendData(theTime, rate))
+                        {
+                            perror("trpr: Memory error adding data");
+                            exit(-1);
+                        }
+                        if (stairStep)
+                            theFlow->AppendData(theTime, 0.0);
+                    }
+                    if (outfile)
+                    {
+                        fprintf(outfile, "%7.3f", theTime);
+                        unsigned int n = flowNumber;
+                        while (--n) fprintf(outfile, ", ");
+                        fprintf(outfile, ", %7.3f\n", rate);
+                    }
+                }    
+            }                            
+            break;
+        case LOSS:
+            //fprintf(stderr, "UpdateLossTracker: t:%f s:%lu\n", theTime, sequence);
+            if (!theFlow->UpdateLossTracker(theTime, sequence))
+            {
+
+                fprintf(stderr, "trpr: Loss tracker warning!\n");
+                fprintf(stderr, "trpr: flow ");
+                theFlow->PrintDescription(stderr);
+                fprintf(stderr, "\n");
+                //exit(-1);   
+            }
+            break;
+        case LOSS2:
+        {
+            // This one has it's own window
+            int result = theFlow->UpdateLossTracker2(theTime, sequence);
+            switch (result)
+            {
+                case 0:
+                    // Data not yet ready
+                    break;
+                case 1:
+                {
+                    // Loss tracker 2 has data ready
+                    double lossFraction = theFlow->LossFraction2();
+                    if (lossFraction < 0.0) lossFraction = 1.0;
+                    double weight = (theTime - theFlow->LossWindowStart2()) / windowSize;
+                    theFlow->UpdateSummary(lossFraction, weight);
+                    if (realTime)
+                    {
+                        if (!theFlow->AppendData(theFlow->LossWindowStart2(), lossFraction))
+                        {
+                            perror("trpr: Memory error adding data");
+                            exit(-1);
+                        }
+                        if (!theFlow->AppendData(theTime, lossFraction))
+                        {
+                            perror("trpr: Memory error adding data");
+                            exit(-1);
+                        }
+                    }
+                    if (outfile)
+                    {
+                        // Window start
+                        fprintf(outfile, "%7.3f", theFlow->LossWindowStart2());
+                        unsigned int n = flowNumber;
+                        while (--n) fprintf(outfile, ", ");
+                        fprintf(outfile, ", %7.3f\n", lossFraction);
+                        // Window end
+                        fprintf(outfile, "%7.3f", theTime);
+                        n = flowNumber;
+                        while (--n) fprintf(outfile, ", ");
+                        fprintf(outfile, ", %7.3f\n", lossFraction);
+                    }
+                    theFlow->ResetLossTracker2();
+                    break;
+                }
+
+                default:
+                    // Error/warning of some type occurred. 
+                    fprintf(stderr, "trpr: Loss tracker warning!\n");
+                    fprintf(stderr, "trpr: flow ");
+                    theFlow->PrintDescription(stderr);
+                    fprintf(stderr, "\n");
+                    break;  
+            }
+            break;
+        }
+
+                    case DROPS:
+                    {
+            if (0.0 != windowSize)
+                        {
+                            if (PacketEvent::DROP == theEvent.Type())
+                                   theFlow->Accumulate(1.0);
+                                else if (PacketEvent::RECEPTION == theEvent.Type())     
+                    theFlow->Accumulate(0.0);
+                        }
+                        else
+                        {
+                if (PacketEvent::DROP == theEvent.Type())
+                { 
+                    theFlow->UpdateSummary(1);
+                    if (realTime)
+                    {
+                        if (!theFlow->AppendData(theTime, 1))
+                        {
+                            perror("trpr: Memory error adding data");
+                            exit(-1);
+                        }
+                    }
+                    if (outfile)
+                    {
+                        fprintf(outfile, "%7.3f", theTime);
+                        unsigned int n = flowNumber;
+                        while (--n) fprintf(outfile, ", ");
+                        fprintf(outfile, ", %7.3f\n", 1.0);
+                    }
+                }
+                        }
+            break;
+                    }
+
+        case COUNT:
+                    {
+            if (0.0 != windowSize)
+                        {
+                            if (PacketEvent::DROP != theEvent.Type())
+                                   theFlow->Accumulate(1.0);
+                                else // don't COUNT drops
+                                   theFlow->Accumulate(0.0);
+                        }
+                        else
+                        {
+                if (PacketEvent::DROP != theEvent.Type())
+                { 
+                    theFlow->UpdateSummary(1);
+                    if (realTime)
+                    {
+                        if (!theFlow->AppendData(theTime, 1))
+                        {
+                            perror("trpr: Memory error adding data");
+                            exit(-1);
+                        }
+                    }
+                    if (outfile)
+                    {
+                        fprintf(outfile, "%7.3f", theTime);
+                        unsigned int n = flowNumber;
+                        while (--n) fprintf(outfile, ", ");
+                        fprintf(outfile, ", %7.3f\n", 1.0);
+                    }
+                }
+                        }
+            break;
+                    }
+
+                    case INTERARRIVAL:
+        {
+            double delay = theFlow->MarkReception(theTime);
+            if (0.0 != windowSize)
+            {
+                if ((delay >= 0.0) && matchFlow) matchFlow->Accumulate(delay);   
+            }
+            else
+            {
+                if (delay >= 0.0)
+                {
+                    theFlow->UpdateSummary(delay);
+                    if (realTime)
+                    {
+                        if (!theFlow->AppendData(theTime, delay))
+                        {
+                            perror("trpr: Memory error adding data");
+                            exit(-1);
+                        }
+                    }
+                    if (outfile)
+                    {
+                        fprintf(outfile, "%7.3f", theTime);
+                        unsigned int n = flowNumber;
+                        while (--n) fprintf(outfile, ", ");
+                        fprintf(outfile, ", %7.3f\n", delay);
+                    }
+
+                }
+            }
+            break;
+        }  // end case INTERARRIVAL
+
+        case LATENCY:
+        {
+            double delay = rxTime - txTime;
+            // Assume clock wrap if delay too negative
+            if (delay < -(SECONDS_PER_DAY/2.0)) delay += SECONDS_PER_DAY;
+            if (0.0 != windowSize)
+            {
+                if (matchFlow) matchFlow->Accumulate(delay);   
+            }
+            else
+            {
+                theFlow->UpdateSummary(delay);
+                if (realTime)
+                {
+                    if (!theFlow->AppendData(theTime, delay))
+                    {
+                        perror("trpr: Memory error adding data");
+                        exit(-1);
+                    }
+                }
+                if (outfile)
+                {
+                    fprintf(outfile, "%7.3f", theTime);
+                    unsigned int n = flowNumber;
+                    while (--n) fprintf(outfile, ", ");
+                    fprintf(outfile, ", %7.3f\n", delay);
+                }
+            }
+            break;
+        }  // end case LATENCY
+
+        case VELOCITY:
+        {
+            double velocity = 
+                theFlow->UpdatePosition(theTime, theEvent.PosX(), theEvent.PosY());
+
+            if (0.0 != windowSize)
+            {
+                if (velocity >= 0.0) theFlow->Accumulate(velocity);
+            }
+            else
+            {
+                if (velocity >= 0.0)
+                {
+                    theFlow->UpdateSummary(velocity);
+                    if (realTime)
+                    {
+                        if (!theFlow->AppendData(theTime, velocity))
+                        {
+                            perror("trpr: Memory error adding data");
+                            exit(-1);
+                        }
+                    }
+                    if (outfile)
+                    {
+                        fprintf(outfile, "%7.3f", theTime);
+                        unsigned int n = flowNumber;
+                        while (--n) fprintf(outfile, ", ");
+                        fprintf(outfile, ", %7.3e\n", velocity);
+                    }
+                }
+            }
+            break;
+        }
+
+        default:
+            fprintf(stderr, "trpr: Unsupported plot mode!\n");
+            exit(-1);
+    }  // end switch(plotMode)
+}  // end UpdateFlow()
+
+// Completes the plot data for the end of the input: the last (or single)
+// window of windowed plots and any pending LOSS2 windows
+void FinishPlot(PlotMode plotMode, FlowList& flowList, FILE* outfile, double theTime,
+                double windowSize, double windowStart, double startTime, 
+                bool noEvents, bool realTime, bool stairStep)
+{
+    double theStart, theEnd;
+    if ((windowSize < 0.0) || noEvents || (windowStart < 0.0))
+    {
+        theStart = startTime < 0.0 ? 0.0 : startTime;
+        theEnd = theTime;
+    }
+    else
+    {
+        theStart = windowStart;
+        theEnd = windowStart + windowSize;
+    }
+    if ((0.0 != windowSize) && !noEvents) 
+    {
+        UpdateWindowPlot(plotMode, flowList, outfile, theTime+0.1, 
+                         theStart, theEnd, realTime, stairStep); 
+    } 
+
+    if (LOSS2 == plotMode)
+    {
+        Flow* nextFlow = flowList.Head();
+        unsigned int flowNumber = 0;
+        while (nextFlow)
+        {
+            flowNumber++;
+            double lossFraction = nextFlow->LossFraction2();
+            if (lossFraction < 0.0) lossFraction = 1.0;  // assume total loss for no data
+            double weight = (theTime - nextFlow->LossWindowStart2()) / windowSize;
+            nextFlow->UpdateSummary(lossFraction, weight);
+            if (realTime)
+            {
+                if (!nextFlow->AppendData(nextFlow->LossWindowStart2(), lossFraction))
+                {
+                    perror("trpr: Memory error adding data");
+                    exit(-1);
+                }
+                if (!nextFlow->AppendData(nextFlow->LossWindowEnd2(), lossFraction))
+                {
+                    perror("trpr: Memory error adding data");
+                    exit(-1);
+                }
+            }
+            if (outfile)
+            {
+                // Window start
+                fprintf(outfile, "%7.3f", nextFlow->LossWindowStart2());
+                unsigned int n = flowNumber;
+                while (--n) fprintf(outfile, ", ");
+                fprintf(outfile, ", %7.3e\n", lossFraction);
+                // Window end
+                fprintf(outfile, "%7.3f", nextFlow->LossWindowEnd2());
+                n = flowNumber;
+                while (--n) fprintf(outfile, ", ");
+                fprintf(outfile, ", %7.3e\n", lossFraction);
+            }
+            nextFlow = nextFlow->Next();
+        } 
+    }  // end if (LOSS2 == plotMode)
+}  // end FinishPlot()
+
+// Writes "outputFile" as a gnuplot script with the plot data from "tempFile"
+// appended (and then removes the "tempFile")
+void WriteGnuplotFile(PlotMode plotMode, FlowList& flowList, 
+                      const char* outputFile, const char* tempFile, 
+                      const char* pngFile, const char* postFile, const char* surname,
+                      bool multiplot, bool autoScale, bool legend, 
+                      double minYRange, double maxYRange, double windowSize)
+{
+    FILE* outfile = fopen(outputFile, "w+");
+    if (!outfile)
+    {
+        perror("trpr: Error opening output file");
+        exit(-1);
+    }
+    if (postFile)
+    {
+        fprintf(outfile, "set term post color solid\n");
+        fprintf(outfile, "set output '%s'\n", postFile); 
+    }
+    else if (pngFile)
+    {           
+        fprintf(outfile, "set term png\n");
+        fprintf(outfile, "set output '%s'\n", pngFile);   
+    }
+    if (!multiplot)
+        fprintf(outfile, "set title '%s %s'\n", 
+                   surname? surname : "", outputFile);
+    fprintf(outfile, "set xlabel 'Time (sec)'\n");
+    double min = 0.0, max = 0.0;
+    switch (plotMode)
+    {
+        case RATE:            
+            fprintf(outfile, "set ylabel 'Rate (kbps)'\n");
+            fprintf(outfile, "set style data lines\n");
+            min = minYRange < 0.0 ? 0.0 : minYRange;
+            max = maxYRange < 0.0 ? -1.0 : maxYRange;
+            if (max < 0.0)
+              fprintf(outfile, "set yrange[%f:*]\n",min);
+            else 
+              fprintf(outfile, "set yrange[%f:%f]\n",min,max);
+            break;
+
+        case LOSS:            
+        case LOSS2:            
+            fprintf(outfile, "set ylabel 'Loss Fraction'\n");
+            fprintf(outfile, "set style data lines\n");
+
+            max = maxYRange < 0.0 ? 1.1 : maxYRange;
+            if (autoScale)
+            {
+              min = minYRange < 0.0 ? -0.01 : minYRange;
+              if (maxYRange < 0.0)
+                fprintf(outfile, "set yrange[%f:*]\n",min);
+              else
+                fprintf(outfile, "set yrange[%f:%f]\n",min,max);
+            }
+            else
+            {
+              min = minYRange < 0.0 ? -0.1 : minYRange;
+              fprintf(outfile, "set yrange[%f:%f]\n",min,max);
+            }
+            break;
+
+        case DROPS:
+            fprintf(outfile, "set ylabel 'Drop Percentage'\n");
+            if (windowSize != 0.0)
+                fprintf(outfile, "set style data lines\n");
+            else
+                fprintf(outfile, "set style data points\n");
+            break;
+
+        case COUNT:
+            fprintf(outfile, "set ylabel 'Packet Count'\n");
+            if (windowSize != 0.0)
+                fprintf(outfile, "set style data lines\n");
+            else
+                fprintf(outfile, "set style data points\n");
+            break;
+
+        case INTERARRIVAL:
+            fprintf(outfile, "set ylabel 'Interarrival (sec)'\n");
+            if (windowSize != 0.0)
+                fprintf(outfile, "set style data lines\n");
+            else
+                fprintf(outfile, "set style data points\n");
+            break;
+
+        case LATENCY:
+            fprintf(outfile, "set ylabel xx'Latency (sec)'\n");
+            if (windowSize != 0.0)
+                fprintf(outfile, "set style data lines\n");
+            else
+                fprintf(outfile, "set style data points\n");
+            break;
+
+        case VELOCITY:            
+            fprintf(outfile, "set ylabel 'Velocity (meters/sec)'\n");
+            fprintf(outfile, "set style data lines\n");
+            break;
+
+        default:
+            fprintf(stderr, "trpr: Unsupport plotting mode!\n");
+            exit(-1);
+    }  // end switch(plotMode)
+
+    if (legend)
+      fprintf(outfile, "set key bottom right\n");
+    else
+      fprintf(outfile, "set key off\n");
+    double origin = 0.0;
+    double scale = 1.0 / ((double)flowList.Count());
+    Flow* nextFlow = flowList.Head();
+    if (nextFlow) 
+    {
+        if (multiplot)
+        {
+            fprintf(outfile, "set size 1.0,1.0\n");
+            fprintf(outfile, "set multiplot\n");
+        }
+        else
+        {
+            fprintf(outfile, "plot ");
+        }
+    }
+    int x = 2;
+    while (nextFlow)
+    {
+        if (multiplot) 
+        {
+            fprintf(outfile, "set size 1.0,%f\n", scale);
+            fprintf(outfile, "set origin 0.0,%f\n", origin);
+            fprintf(outfile, "plot ");
+            origin += scale;
+        }
+        fprintf(outfile, "\\\n'%s' index 1 using 1:%d t '",
+                          outputFile, x++);
+        nextFlow->PrintDescription(outfile);
+        fprintf(outfile, "'");
+        nextFlow = nextFlow->Next();
+        if (nextFlow)
+        {
+            if (multiplot) 
+                fprintf(outfile, "\n");
+            else
+                fprintf(outfile, ", ");
+        }
+    }  // end while(nextFlow)
+    fprintf(outfile, "\nexit\n\n\n");
+    fflush(outfile);
+
+    // Append data from temp file to output file
+    FILE* infile = fopen(tempFile, "r");
+    if (!infile)
+    {
+        perror("trpr: Error opening our temp file");
+        exit(-1);
+    }
+    int result;
+    char buffer[1024];
+    while ((result = fread(buffer, sizeof(char), 1024, infile)))
+    {
+         fwrite(buffer, sizeof(char), result, outfile);
+    }
+    fclose(infile);
+    unlink(tempFile);
+    fclose(outfile);
+}  // end WriteGnuplotFile()
+
+// Prints per-flow summary statistics to stdout ("label" names the metric, if any)
+void PrintSummary(PlotMode plotMode, FlowList& flowList, double startTime, 
+                  double stopTime, double theTime, double windowSize, const char* label)
+{
+    double total = 0.0;
+    double variance = 0.0;
+    double min = 0.0, max = 0.0;
+    unsigned long count = 0;
+    bool init = true;
+
+    fprintf(stdout, "#TRPR Summaries: ");
+    if (label) fprintf(stdout, "metric>%s, ", label);
+    double theStart = (startTime < 0.0) ? 0.0 : startTime;
+    double theEnd = (stopTime < 0.0) ? theTime : stopTime;
+
+    double window = (windowSize < 0.0) ? (theEnd - theStart) : windowSize;
+    fprintf(stdout, "range>%.3f-%.3f, windowSize>%.3f\n", theStart,  theEnd, window);
+    const char* type = "";
+    const char* units = "";
+    switch(plotMode)
+    {
+        case RATE:
+            type = "rate";
+            units = "kbps";
+            break;
+        case LOSS:
+        case LOSS2:
+            type = "loss fraction";
+            units = "";
+            break;
+        case DROPS:
+            type = "drop percentage";
+            units = "";
+            break;
+        case COUNT:
+            type = "count";
+            units = "";
+            break;
+        case LATENCY:
+            type = "latency";
+            units = "sec";
+            break;
+        case INTERARRIVAL:
+            type = "interarrival";
+            units = "sec";
+            break;
+        case VELOCITY:
+            type = "velocity";
+            units = "meters/sec";
+            break;
+    }
+    Flow* nextFlow = flowList.Head();
+    while (nextFlow)
+    {
+        double fave = nextFlow->SummaryAverage();
+        double fmin = nextFlow->SummaryMin();
+        double fmax = nextFlow->SummaryMax();
+        double fvar = nextFlow->SummaryVariance();
+        if (isnan(fave))
+        {
+            switch (plotMode)
+            {
+                case RATE:
+                case VELOCITY:
+                case COUNT:
+                case DROPS:
+                    fave = fmin = fmax = fvar = 0.0;  // no packets for flow
+                    break;
+                case LOSS:
+                case LOSS2:
+                    fave = fmin = fmax = 1.0;  // no packets for flow
+                    fvar = 0.0;
+                    break;
+                case LATENCY:
+                case INTERARRIVAL:
+                    nextFlow = nextFlow->Next();
+                    continue;
+                    break;
+            }
+        }
+
+        fprintf(stdout, "#flow>", type, units);
+        nextFlow->PrintDescription(stdout);            
+        fprintf(stdout, ", %s(%s), ", type, units);
+        fprintf(stdout, "ave>%lf, ", fave); 
+        fprintf(stdout, "min>%lf, ", fmin);  
+        fprintf(stdout, "max>%lf, ", fmax);  
+        fprintf(stdout, "dev>%lf ", sqrt(fvar));  
+        fprintf(stdout, "\n");
+
+        if (init)
+        {
+            count = 1;
+            total = fave;
+            variance = total * total;
+            min = fmin;
+            max = fmax;
+            init = false;
+        }
+        else
+        {
+            count++;
+            total += fave;
+            variance += (fave*fave);
+            if (fmin < min) min = fmin;
+            if (fmax > max) max = fmax;
+        }           
+        nextFlow = nextFlow->Next();           
+    }   
+
+    if (count > 1)
+    {
+        fprintf(stdout, "#flow>Summary, ");
+        double mean = total/((double)count);
+        variance = (variance/((double)count)) - (mean*mean);
+        fprintf(stdout, "%s(%s), ", type, units);
+        fprintf(stdout, "ave>%lf, ", mean);
+        fprintf(stdout, "min>%lf, ", min);
+        fprintf(stdout, "max>%lf, ", max);
+        fprintf(stdout, "dev>%lf, ", sqrt(variance));  
+        fprintf(stdout, "\n");
+    }
+}  // end PrintSummary()
+
+// Prints per-flow histograms to stdout ("label" names the metric, if any)
+void PrintHistograms(FlowList& flowList, const char* label)
+{
+    if (label)
+        fprintf(stdout, "#TRPR Histograms metric>%s\n", label);
+    else
+        fprintf(stdout, "#TRPR Histograms\n");
+    const double p[6] = {0.99, 0.95, 0.9, 0.8, 0.75, 0.5};        
+    Flow* nextFlow = flowList.Head();
+    while (nextFlow)
+    { 
+        fprintf(stdout, "#flow>");
+        nextFlow->PrintDescription(stdout);
+        fprintf(stdout, " min>%f max>%f percentiles(", 
+                nextFlow->SummaryMin(), nextFlow->SummaryMax());
+        for (int j = 0; j < 6; j++)
+        {
+            double percentile = nextFlow->Percentile(p[j]);
+            fprintf(stdout, "%2d>%f ", (int)(p[j]*100.0+0.5), percentile);
+        }
+        fprintf(stdout, ")\n");
+        nextFlow->PrintHistogram(stdout);
+        fprintf(stdout, "\n\n\n");
+        nextFlow = nextFlow->Next();
+    }
+}  // end PrintHistograms()
+
 
 // Generates realTime update gnuplot commands
 void UpdateGnuplot(PlotMode plotMode, FlowList* flowList, double xMin, double xMax, 
@@ -36,6 +36,12 @@ class DetourExample : public ProtoApp
         void Usage();
         
         ProtoDetour*    detour;
+        // Optional additional NFQUEUE queues, each serviced by its own thread 
+        // (their detours use the default ProtoDetour listener that allows all)
+        enum {QUEUE_MAX = 32};
+        unsigned int        queue_count;
+        ProtoDetour*        queue_detour[QUEUE_MAX];
+        ProtoDispatcher*    queue_dispatcher[QUEUE_MAX];
         bool            ipv6_mode;
         bool            allow;  // toggled variable for test
         
@@ -44,6 +50,7 @@ class DetourExample : public ProtoApp
 const char* const DetourExample::CMD_LIST[] =
 {
     "-ipv6",     // IPv6 test (instead of IPv4)
+    "+queues",   // number of firewall queues (threads) to use
     NULL
 };
 
@@ -51,10 +58,11 @@ const char* const DetourExample::CMD_LIST[] =
 PROTO_INSTANTIATE_APP(DetourExample) 
         
 DetourExample::DetourExample()
- : detour(NULL), ipv6_mode(false), allow(true)
+ : detour(NULL), queue_count(1), ipv6_mode(false), allow(true)
    
 {       
-   
+    memset(queue_detour, 0, sizeof(queue_detour));
+    memset(queue_dispatcher, 0, sizeof(queue_dispatcher));
 }
 
 DetourExample::~DetourExample()
@@ -66,7 +74,7 @@ void DetourExample::Usage()
 #ifdef WIN32
     fprintf(stderr, "detourExample [ipv6][background]\n");
 #else
-    fprintf(stderr, "detourExample\n");
+    fprintf(stderr, "detourExample [ipv6][queues <count>]\n");
 #endif // if/else WIN32/UNIX
 }  // end DetourExample::Usage()
 
@@ -139,10 +147,39 @@ bool DetourExample::OnStartup(int argc, const char*const* argv)
         dstFilterMask = 4;
     }
     
+    if ((queue_count > 1) && !detour->SetQueueCount(queue_count))
+    {
+        PLOG(PL_ERROR, "detourExample::OnStartup() ProtoDetour::SetQueueCount() error\n");
+        return false;
+    }
+    
     if (!detour->Open(ProtoDetour::INPUT, srcFilter, 0, dstFilter, dstFilterMask))
     {
         PLOG(PL_ERROR, "detourExample::OnStartup() ProtoDetour::Open() error\n");
     }
+    else
+    {
+        // Service any additional queues with their own dispatcher threads
+        for (unsigned int i = 1; i < queue_count; i++)
+        {
+            if (NULL == (queue_detour[i] = detour->OpenQueueDetour(i)))
+            {
+                PLOG(PL_ERROR, "detourExample::OnStartup() ProtoDetour::OpenQueueDetour() error\n");
+                return false;
+            }
+            if (NULL == (queue_dispatcher[i] = new ProtoDispatcher()))
+            {
+                PLOG(PL_ERROR, "detourExample::OnStartup() new ProtoDispatcher error: %s\n", GetErrorString());
+                return false;
+            }
+            queue_detour[i]->SetNotifier(static_cast<ProtoChannel::Notifier*>(queue_dispatcher[i]));
+            if (!queue_dispatcher[i]->StartThread())
+            {
+                PLOG(PL_ERROR, "detourExample::OnStartup() ProtoDispatcher::StartThread() error\n");
+                return false;
+            }
+        }
+    }
     
 #ifdef NEVER //HAVE_SCHED
     // Boost process priority for real-time operation
@@ -174,6 +211,21 @@ bool DetourExample::OnStartup(int argc, const char*const* argv)
 
 void DetourExample::OnShutdown()
 {
+   for (unsigned int i = 1; i < QUEUE_MAX; i++)
+   {
+       if (NULL != queue_dispatcher[i]) queue_dispatcher[i]->Stop();
+       if (NULL != queue_detour[i])
+       {
+           queue_detour[i]->Close();
+           delete queue_detour[i];
+           queue_detour[i] = NULL;
+       }
+       if (NULL != queue_dispatcher[i])
+       {
+           delete queue_dispatcher[i];
+           queue_dispatcher[i] = NULL;
+       }
+   }
    if (NULL != detour)
    {
        detour->Close();
@@ -237,6 +289,16 @@ bool DetourExample::OnCommand(const char* cmd, const char* val)
     {
         ipv6_mode = true;
     }
+    else if (!strncmp("queues", cmd, len))
+    {
+        int count = atoi(val);
+        if ((count < 1) || (count >= QUEUE_MAX))
+        {
+            PLOG(PL_ERROR, "DetourExample::ProcessCommand(queues) invalid queue count\n");
+            return false;
+        }
+        queue_count = (unsigned int)count;
+    }
     else
     {
         PLOG(PL_ERROR, "detourExample:: invalid command\n");
@@ -252,7 +314,9 @@ void DetourExample::DetourEventHandler(ProtoChannel&               theChannel,
     {
         UINT32 buffer[8192/4];
         unsigned int numBytes = 8192; 
-        if (detour->Recv((char*)buffer, numBytes))
+        // Packets are read until Recv() returns zero bytes, since in multi-queue
+        // mode the input must be drained for its verdicts to be batched
+        while (detour->Recv((char*)buffer, numBytes))
         {
             TRACE("detour recv'd packet ...\n");
             if (0 != numBytes)
@@ -338,6 +402,10 @@ void DetourExample::DetourEventHandler(ProtoChannel&               theChannel,
                     allow = true;
                 }
             }
+            else
+            {
+                break;  // no more input pending
+            }
             numBytes = 8192;
         }                  
     }
@@ -0,0 +1,186 @@
+// This program compares the cost of ProtoTimerMgr timer activation,
+// rescheduling, timeout processing and deactivation for the
+// SORTED_LIST and TIMING_WHEEL timer engines with large numbers
+// (10^3 - 10^5 by default) of concurrently active timers.
+//
+// Usage: timerBench [min <count>][max <count>][listmax <count>]
+//                   [run <sec>][engine {list|wheel|both}]
+//
+// Note the SORTED_LIST engine insertion cost grows linearly with
+// the number of active timers, so its runs are limited to "listmax"
+// (10^4 by default) timers.  The defaults keep a plain run short; the
+// full sweep up to 10^6 timers (which takes several minutes) is:
+//
+//     timerBench max 1000000 listmax 100000
+
+#include "protoTimer.h"
+#include "protoTime.h"
+
+#include <stdio.h>
+#include <stdlib.h>  // for rand(), srand(), atoi(), atof()
+#include <string.h>
+
+// We don't need a real system timer, since we poll for timeouts
+class BenchTimerMgr : public ProtoTimerMgr
+{
+    public:
+        BenchTimerMgr(Engine theEngine) : ProtoTimerMgr(theEngine) {}
+
+    protected:
+        bool UpdateSystemTimer(ProtoTimer::Command /*command*/, double /*delay*/)
+            {return true;}
+};  // end class BenchTimerMgr
+
+class TimerBench
+{
+    public:
+        TimerBench() : timeout_count(0) {}
+
+        void Run(ProtoTimerMgr::Engine engine, unsigned int count, double runTime);
+
+    private:
+        void OnTimeout(ProtoTimer& /*theTimer*/)
+            {timeout_count++;}
+
+        unsigned long timeout_count;
+};  // end class TimerBench
+
+static double ElapsedUsec(const ProtoTime& start)
+{
+    ProtoTime now;
+    now.GetCurrentTime();
+    return (1.0e+06 * ProtoTime::Delta(now, start));
+}
+
+void TimerBench::Run(ProtoTimerMgr::Engine engine, unsigned int count, double runTime)
+{
+    BenchTimerMgr mgr(engine);
+    ProtoTimer* timerArray = new ProtoTimer[count];
+    if (NULL == timerArray)
+    {
+        perror("timerBench: new timerArray error");
+        return;
+    }
+    // Intervals are spread from 10 msec to 100 sec (so some
+    // "short" and some "long" timers for the SORTED_LIST engine)
+    for (unsigned int i = 0; i < count; i++)
+    {
+        timerArray[i].SetListener(this, &TimerBench::OnTimeout);
+        timerArray[i].SetInterval(0.010 + 100.0*((double)rand() / (double)RAND_MAX));
+        timerArray[i].SetRepeat(-1);
+    }
+
+    ProtoTime start;
+    start.GetCurrentTime();
+    for (unsigned int i = 0; i < count; i++)
+        mgr.ActivateTimer(timerArray[i]);
+    double activateUsec = ElapsedUsec(start) / count;
+
+    start.GetCurrentTime();
+    for (unsigned int i = 0; i < count; i++)
+        timerArray[rand() % count].Reschedule();
+    double rescheduleUsec = ElapsedUsec(start) / count;
+
+    // Poll for timeouts for "runTime" seconds.  The repeating
+    // timers are reactivated as they fire.  Only the polls that
+    // actually processed timeouts are counted toward their cost.
+    timeout_count = 0;
+    ProtoTime runStart;
+    runStart.GetCurrentTime();
+    double timeoutUsec = 0.0;
+    while ((1.0e-06 * ElapsedUsec(runStart)) < runTime)
+    {
+        unsigned long prevCount = timeout_count;
+        start.GetCurrentTime();
+        mgr.DoSystemTimeout();
+        if (timeout_count != prevCount) 
+            timeoutUsec += ElapsedUsec(start);
+    }
+    if (0 != timeout_count) timeoutUsec /= timeout_count;
+
+    start.GetCurrentTime();
+    for (unsigned int i = 0; i < count; i++)
+        mgr.DeactivateTimer(timerArray[i]);
+    double deactivateUsec = ElapsedUsec(start) / count;
+
+    printf("%-7s %8u %12.3f %12.3f %10lu %12.3f %12.3f\n",
+           (ProtoTimerMgr::TIMING_WHEEL == engine) ? "wheel" : "list", count,
+           activateUsec, rescheduleUsec, timeout_count, timeoutUsec, deactivateUsec);
+    fflush(stdout);
+    delete[] timerArray;
+}  // end TimerBench::Run()
+
+void Usage()
+{
+    fprintf(stderr, "Usage: timerBench [min <count>][max <count>][listmax <count>]\n"
+                    "                  [run <sec>][engine {list|wheel|both}]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int minCount = 1000;
+    unsigned int maxCount = 100000;
+    unsigned int listMax = 10000;
+    double runTime = 1.0;
+    bool doList = true;
+    bool doWheel = true;
+
+    int i = 1;
+    while (i < argc)
+    {
+        if ((i + 1) >= argc)
+        {
+            Usage();
+            return -1;
+        }
+        const char* cmd = argv[i++];
+        const char* val = argv[i++];
+        if (!strcmp(cmd, "min"))
+        {
+            minCount = atoi(val);
+        }
+        else if (!strcmp(cmd, "max"))
+        {
+            maxCount = atoi(val);
+        }
+        else if (!strcmp(cmd, "listmax"))
+        {
+            listMax = atoi(val);
+        }
+        else if (!strcmp(cmd, "run"))
+        {
+            runTime = atof(val);
+        }
+        else if (!strcmp(cmd, "engine"))
+        {
+            doList = (!strcmp(val, "list") || !strcmp(val, "both"));
+            doWheel = (!strcmp(val, "wheel") || !strcmp(val, "both"));
+        }
+        else
+        {
+            Usage();
+            return -1;
+        }
+    }
+    if (0 == minCount) minCount = 1;
+
+    srand(1);
+    printf("(times in usec per operation)\n");
+    printf("%-7s %8s %12s %12s %10s %12s %12s\n", "engine", "timers",
+           "activate", "reschedule", "timeouts", "per-timeout", "deactivate");
+    TimerBench bench;
+    for (unsigned int count = minCount; count <= maxCount; count *= 10)
+    {
+        if (doList)
+        {
+            if (count <= listMax)
+                bench.Run(ProtoTimerMgr::SORTED_LIST, count, runTime);
+            else
+                printf("%-7s %8u (skipped, see \"listmax\")\n", "list", count);
+        }
+        if (doWheel)
+            bench.Run(ProtoTimerMgr::TIMING_WHEEL, count, runTime);
+        if (count > (maxCount / 10)) break;
+    }
+    return 0;
+}  // end main()
@@ -49,6 +49,32 @@ class ProtoCap : public ProtoChannel
         virtual bool Recv(char* buffer, unsigned int& numBytes, Direction* direction = NULL) = 0;
         virtual bool Send(const char* buffer, unsigned int& numBytes) = 0;
         
+        // Optional memory-mapped receive ring (e.g., Linux PACKET_RX_RING) support.
+        // This must be called _before_ Open() and returns false if unsupported.
+        // ("retireTimeout" is the max msec a partially filled block is held)
+        virtual bool SetRxRing(unsigned int blockSize, unsigned int frameCount, unsigned int retireTimeout)
+            {return false;}
+        // When a receive ring is used, this iterates through captured frames "in place" 
+        // (without copying), setting "frame" to NULL when no more are ready.  The "frame" 
+        // pointer is only valid until the next RecvFrame() (or Recv()) call.  A listener
+        // should call this until "frame" is NULL for each NOTIFY_INPUT.
+        virtual bool RecvFrame(const char*& frame, unsigned int& numBytes, Direction* direction = NULL)
+        {
+            frame = NULL;
+            numBytes = 0;
+            return false;
+        }
+        // Gets cumulative kernel packet and drop counts, if supported
+        virtual bool GetStatistics(unsigned int& packetCount, unsigned int& dropCount)
+            {return false;}
+        // Optional selection of the interface receive queue for implementations
+        // that bind to a single queue (e.g., AF_XDP).  Must be called _before_ Open().
+        virtual bool SetRxQueue(unsigned int queueId)
+            {return (0 == queueId);}
+        // Sends "count" frames, updating "count" to the number actually sent
+        // (implementations may override this to batch transmission)
+        virtual bool SendBatch(const char* const* frameArray, const unsigned int* numBytesArray, unsigned int& count);
+        
         bool Forward(char* buffer, unsigned int& numBytes);
         
         bool ForwardFrom(char* buffer, unsigned int& numBytes, const ProtoAddress& srcMacAddr);
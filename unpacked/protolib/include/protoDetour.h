@@ -59,7 +59,19 @@ class ProtoDetour : public ProtoChannel
         virtual bool Inject(const char* buffer, unsigned int numBytes) = 0;
         
         virtual bool SetMulticastInterface(const char* interfaceName) {return false;}
-            
+
+        // Optional multi-queue mode where supported (e.g., Linux NFQUEUE).  When
+        // called _before_ Open(), the firewall rules spread packets across "queueCount"
+        // queues (by flow hash) and verdicts may be batched.  This detour services the
+        // first queue and OpenQueueDetour() returns a new, open detour for each other
+        // queue (1 .. queueCount-1), so each may be serviced with its own notifier (e.g.,
+        // a ProtoDispatcher thread).  The caller must delete those detours when done.
+        // On each input notification, call Recv() (and Allow() or Drop()) until it
+        // returns zero bytes, as DefaultEventHandler() does, so that verdicts are
+        // batched across the queued packets (and not issued one at a time).
+        virtual bool SetQueueCount(unsigned int queueCount) {return (queueCount <= 1);}
+        virtual ProtoDetour* OpenQueueDetour(unsigned int queueIndex) {return NULL;}
+
         void SetUserData(const void* userData) 
             {user_data = userData;}
         const void* GetUserData() const
@@ -66,12 +66,12 @@
 #include <sys/time.h>
 
 #elif defined(LINUX)
-// Makefile must pick USE_SELECT or USE_EPOLL or we
-// default to USE_SELECT (TBD)
-#if (!defined(USE_SELECT) && !defined(USE_EPOLL))
-#warning "Neither USE_SELECT or USE_EPOLL defined, setting USE_SELECT"
+// Makefile must pick USE_SELECT, USE_EPOLL or USE_IO_URING 
+// or we default to USE_SELECT (TBD)
+#if (!defined(USE_SELECT) && !defined(USE_EPOLL) && !defined(USE_IO_URING))
+#warning "Neither USE_SELECT, USE_EPOLL or USE_IO_URING defined, setting USE_SELECT"
 #define USE_SELECT 1
-#endif // !defined(USE_SELECT) & !defined(USE_EPOLL)
+#endif // !defined(USE_SELECT) & !defined(USE_EPOLL) & !defined(USE_IO_URING)
 // Makefile must pick either USE_EPOLL or USE_SELECT
 #ifdef USE_EPOLL
 #include <sys/epoll.h>
@@ -79,6 +79,13 @@
 #error "Must define either USE_EPOLL or USE_SELECT, not both!"
 #endif // USE_SELECT
 #endif // USE_EPOLL
+// USE_IO_URING requires Linux 5.11 or later (for IORING_ENTER_EXT_ARG)
+#ifdef USE_IO_URING
+#include <linux/io_uring.h>
+#if defined(USE_SELECT) || defined(USE_EPOLL)
+#error "Must define only one of USE_SELECT, USE_EPOLL, or USE_IO_URING!"
+#endif // USE_SELECT || USE_EPOLL
+#endif // USE_IO_URING
 #ifdef USE_TIMERFD
 #include <sys/timerfd.h>
 #endif // USE_TIMERFD
@@ -478,6 +485,13 @@ class ProtoDispatcher : public ProtoTimerMgr,
                 int GetOutdex() const {return outdex;}
                 void SetOutdex(int theOutdex) {outdex = theOutdex;}
 #endif // WIN32
+#ifdef USE_IO_URING
+                // These track which (INPUT/OUTPUT) requests are actually
+                // outstanding in the io_uring, independent of "flags"
+                bool IsArmed(Flag theFlag) const {return (0 != (armed & theFlag));}
+                void SetArmed(Flag theFlag) {armed |= theFlag;}
+                void UnsetArmed(Flag theFlag) {armed &= ~theFlag;}
+#endif // USE_IO_URING
             protected:
                 Stream(Type theType);
             
@@ -492,6 +506,9 @@ class ProtoDispatcher : public ProtoTimerMgr,
                 int   index;
                 int   outdex;
 #endif // WIN32
+#ifdef USE_IO_URING
+                int   armed;
+#endif // USE_IO_URING
         };  // end class Stream
         
        
@@ -508,7 +525,7 @@ class ProtoDispatcher : public ProtoTimerMgr,
         };  // end class ProtoDispatcher::StreamList
         
         // The "UpdateStreamNotification()" method is implemented with system-specific code
-        // (i.e. for the separate WIN32, USE_SELECT, USE_KQUEUE, and USE_EPOLL cases)
+        // (i.e. for the separate WIN32, USE_SELECT, USE_KQUEUE, USE_EPOLL, and USE_IO_URING cases)
         enum NotificationCommand {DISABLE_ALL, ENABLE_INPUT, DISABLE_INPUT, ENABLE_OUTPUT, DISABLE_OUTPUT};
         bool UpdateStreamNotification(Stream& stream, NotificationCommand cmd);
         
@@ -762,12 +779,12 @@ class ProtoDispatcher : public ProtoTimerMgr,
 #else  // UNIX
         static void* DoThreadStart(void* arg);
         int                     exit_status;
-#if (defined(USE_SELECT) || defined(USE_EPOLL))
+#if (defined(USE_SELECT) || defined(USE_EPOLL) || defined(USE_IO_URING))
         EventStream             break_stream;
 #ifndef USE_EVENTFD
         int                     break_pipe_fd[2]; 
 #endif // !USE_EVENTFD
-#endif // USE_SELECT || USE_EPOLL
+#endif // USE_SELECT || USE_EPOLL || USE_IO_URING
 #if defined(USE_SELECT)
         fd_set                  input_set;        
         fd_set                  output_set;  
@@ -781,6 +798,46 @@ class ProtoDispatcher : public ProtoTimerMgr,
         bool EpollChange(int fd, int events, int op, void* udata);
         struct epoll_event      epoll_event_array[EPOLL_ARRAY_SIZE];
         int                     epoll_fd;
+#elif defined(USE_IO_URING)
+        // Stream readiness is requested with one-shot IORING_OP_POLL_ADD
+        // entries (re-armed as they complete) and the timer_fd and eventfd
+        // are drained with IORING_OP_READ.  Submission queue entries are
+        // accumulated and handed to the kernel with the same io_uring_enter()
+        // call that waits for completions, so each Wait() / Dispatch() 
+        // iteration costs a single system call.
+        enum {URING_QUEUE_SIZE = 1024, URING_ARRAY_SIZE = 64};
+        class UringEvent
+        {
+            public:
+                Stream*     stream;     // NULL if nullified
+                int         events;     // POLLIN, POLLOUT, POLLERR flags
+        };
+        bool UringOpen();
+        void UringClose();
+        bool UringArm(Stream& stream, Stream::Flag theFlag);
+        bool UringCancel(Stream& stream, Stream::Flag theFlag);
+        struct io_uring_sqe* UringGetSqe();
+        int UringEnter(unsigned int minComplete, const struct timespec* timeout);
+        int UringReap();
+        int                     uring_fd;
+        void*                   uring_sq_ring;
+        size_t                  uring_sq_ring_size;
+        void*                   uring_cq_ring;
+        size_t                  uring_cq_ring_size;
+        struct io_uring_sqe*    uring_sqes;
+        unsigned int            uring_sq_entries;
+        unsigned int            uring_sq_mask;
+        unsigned int*           uring_sq_tail;
+        unsigned int*           uring_sq_head;
+        unsigned int*           uring_sq_array;
+        unsigned int            uring_sq_pending;  // entries not yet submitted
+        unsigned int            uring_cq_mask;
+        unsigned int*           uring_cq_tail;
+        unsigned int*           uring_cq_head;
+        struct io_uring_cqe*    uring_cqes;
+        uint64_t                uring_timer_count;  // IORING_OP_READ buffers
+        uint64_t                uring_break_count;
+        UringEvent              uring_event_array[URING_ARRAY_SIZE];
 #else  // UNIX
 #error "undefined async i/o mechanism"  // to make sure we implement something       
 #endif  // !USE_SELECT && !USE_KQUEUE
@@ -285,6 +285,7 @@ class ProtoTimer
         class ProtoTimerMgr*        mgr;                     
         ProtoTimer*                 prev;                    
         ProtoTimer*                 next;                    
+        ProtoTimer**                wheel_slot;  // non-NULL when in a timing wheel slot
 };  // end class ProtoTimer
 
 /** 
@@ -294,17 +295,34 @@ class ProtoTimer
  * The ProtoDispatcher(see below) derives from this to manage ProtoTimers 
  * for an application. (The ProtoSimAgent base class contains a ProtoTimerMgr 
  * to similarly manage timers for a simulation instance). 
+ *
+ * Two timer "engines" are available.  The default SORTED_LIST engine keeps
+ * active timers in time-sorted linked lists (with a one second "pulse" for
+ * long timers).  The TIMING_WHEEL engine hashes timers into a hierarchical 
+ * timing wheel so activation/deactivation cost does not grow with the number
+ * of active timers.  Timers that come due within the current wheel "tick" are
+ * still moved to the sorted short list so timeout precision and ordering are
+ * the same for either engine.
  */
 class ProtoTimerMgr
 {
     friend class ProtoTimer;
     
     public:
+        enum Engine {SORTED_LIST, TIMING_WHEEL};
+            
 		/// Default constructor
-        ProtoTimerMgr();
+        ProtoTimerMgr(Engine theEngine = SORTED_LIST);
 		/// Default destructor
         virtual ~ProtoTimerMgr();
         
+        /**
+        * The timer engine may only be changed when no timers are active
+        */
+        bool SetEngine(Engine theEngine);
+        Engine GetEngine() const
+            {return engine;}
+        
         // ProtoTimer activation/deactivation
         virtual void ActivateTimer(ProtoTimer& theTimer);
         virtual void DeactivateTimer(ProtoTimer& theTimer);
@@ -313,13 +331,12 @@ class ProtoTimerMgr
         * @retval Returns "true" if there are any active timers
         */
         bool IsActive() const
-            {return (NULL != short_head);}
+            {return ((NULL != short_head) || (0 != wheel_count));}
         
         /**
-		* @retval Returns any time remaining for the active short timer or -1
+		* @retval Returns any time remaining for the next timeout or -1
 		*/
-        double GetTimeRemaining() const 
-            {return ((NULL != short_head) ? short_head->GetTimeRemaining() : -1.0);}
+        double GetTimeRemaining() const;
         
         /// Call this when the timer mgr's one-shot system timer fires
         void OnSystemTimeout();
@@ -349,9 +366,24 @@ class ProtoTimerMgr
         void InsertShortTimer(ProtoTimer& theTimer);
         bool InsertShortTimerReverse(ProtoTimer& theTimer);
         void RemoveShortTimer(ProtoTimer& theTimer);
+        void MergeShortTimers(ProtoTimer* timerList);
+        static ProtoTimer* SortTimerList(ProtoTimer* timerList);
         void Update();
         
-        bool GetNextTimeout(ProtoTime& nextTimeout) const
+        // Timing wheel (TIMING_WHEEL engine) methods
+        static UINT32 GetWheelTick(const ProtoTime& theTime)
+            {return (UINT32)(theTime.sec()*WHEEL_TICKS_PER_SEC + theTime.usec()/WHEEL_TICK_USEC);}
+        void InsertWheelTimer(ProtoTimer& theTimer);
+        void ParkWheelTimer(ProtoTimer& theTimer);
+        void LinkWheelTimer(ProtoTimer& theTimer, unsigned int level, unsigned int index);
+        void RemoveWheelTimer(ProtoTimer& theTimer);
+        ProtoTimer* DetachWheelSlot(unsigned int level, unsigned int index);
+        void AdvanceWheel(const ProtoTime& now);
+        void CascadeWheel(const ProtoTime& now);
+        bool GetWheelTimeout(ProtoTime& nextTimeout, const ProtoTime& now) const;
+        int FindWheelSlot(unsigned int level, unsigned int index, bool wrap) const;
+        
+        bool GetNextTimeout(ProtoTime& nextTimeout, const ProtoTime& now) const
         {
             if (NULL != short_head)
             {
@@ -360,7 +392,7 @@ class ProtoTimerMgr
             }
             else
             {
-                return false;
+                return GetWheelTimeout(nextTimeout, now);
             }
         }
         void GetPulseTime(ProtoTime& pulseTime) const
@@ -372,6 +404,23 @@ class ProtoTimerMgr
         
         static const double PRECISION_TIME_THRESHOLD;
         
+        // The wheel has WHEEL_LEVELS levels of WHEEL_SIZE slots with
+        // a 1 msec tick, so it spans 2^32 ticks (about 49 days).  Timers 
+        // further out than WHEEL_FAR_INTERVAL are "parked" in the top level
+        // and re-examined as it cascades.
+        enum 
+        {
+            WHEEL_TICK_USEC = 1000,
+            WHEEL_TICKS_PER_SEC = 1000000 / WHEEL_TICK_USEC,
+            WHEEL_BITS = 8,
+            WHEEL_SIZE = 1 << WHEEL_BITS,
+            WHEEL_MASK = WHEEL_SIZE - 1,
+            WHEEL_LEVELS = 4,
+            WHEEL_WORDS = WHEEL_SIZE / 32
+        };
+        static const double WHEEL_FAR_INTERVAL;
+        static const UINT32 WHEEL_FAR_PARK;
+        
         
         void GetCurrentSystemTime(struct timeval& currentTime)
         {
@@ -395,6 +444,7 @@ class ProtoTimerMgr
         
        
         // Member variables
+        Engine          engine;
         bool            update_pending;       
         bool            timeout_scheduled;                     
         ProtoTime       scheduled_timeout;                                   
@@ -405,6 +455,11 @@ class ProtoTimerMgr
         ProtoTimer*     short_head;                                
         ProtoTimer*     short_tail; 
         ProtoTimer*     invoked_timer;  // timer whose listener is being invoked
+        // TIMING_WHEEL engine state
+        ProtoTimer**    wheel;          // WHEEL_LEVELS x WHEEL_SIZE slot lists
+        UINT32          wheel_bits[WHEEL_LEVELS][WHEEL_WORDS];  // slot occupancy
+        UINT32          wheel_tick;     // next tick to be processed
+        unsigned int    wheel_count;    // number of timers in wheel slots
 };  // end class ProtoTimerMgr
 
 #endif // _PROTO_TIMER
@@ -70,3 +70,30 @@ bool ProtoCap::ForwardFrom(char* buffer, unsigned int& numBytes, const ProtoAddr
     memcpy(buffer+6, srcMacAddr.GetRawHostAddress(), 6);
     return Send(buffer, numBytes);
 }  // end ProtoCap::ForwardFrom()
+
+/**
+ * @brief Sends an array of frames (by default, one at a time via Send())
+ *
+ * @param frameArray
+ * @param numBytesArray
+ * @param count number of frames to send, updated to number actually sent
+ *
+ * @return success or failure indicator 
+ */        
+bool ProtoCap::SendBatch(const char* const* frameArray, const unsigned int* numBytesArray, unsigned int& count)
+{
+    unsigned int sent = 0;
+    bool result = true;
+    while (sent < count)
+    {
+        unsigned int numBytes = numBytesArray[sent];
+        if (!Send(frameArray[sent], numBytes))
+        {
+            result = (0 != sent);
+            break;
+        }
+        sent++;
+    }
+    count = sent;
+    return result;
+}  // end ProtoCap::SendBatch()
@@ -57,6 +57,12 @@ const ProtoDispatcher::Descriptor ProtoDispatcher::INVALID_DESCRIPTOR = INVALID_
 #else
 #include <sys/resource.h>
 #endif // HAVE_SCHED
+#ifdef USE_IO_URING
+#include <sys/mman.h>     // for mmap() of io_uring queues
+#include <sys/syscall.h>  // for io_uring_setup() and io_uring_enter()
+#include <poll.h>         // for POLLIN, POLLOUT, etc
+#include <signal.h>       // for _NSIG
+#endif // USE_IO_URING
 const ProtoDispatcher::Descriptor ProtoDispatcher::INVALID_DESCRIPTOR = -1;
 #endif  // if/else WIN32/UNIX
 
@@ -66,6 +72,9 @@ ProtoDispatcher::Stream::Stream(Type theType)
 #ifdef WIN32
     ,index(-1), outdex(-1)
 #endif // WIN32
+#ifdef USE_IO_URING
+    ,armed(0)
+#endif // USE_IO_URING
 {
 }
 
@@ -139,11 +148,15 @@ ProtoDispatcher::ProtoDispatcher()
       ,kevent_queue(-1)
 #elif defined(USE_EPOLL)
       ,epoll_fd(-1)
+#elif defined(USE_IO_URING)
+      ,uring_fd(-1), uring_sq_ring(NULL), uring_sq_ring_size(0),
+      uring_cq_ring(NULL), uring_cq_ring_size(0), uring_sqes(NULL),
+      uring_sq_pending(0), uring_timer_count(0), uring_break_count(0)
 #else
 #error "undefined async i/o mechanism"  // to make sure we implement something
 #endif  // !WIN32 && !USE_SELECT && !USE_KQUEUE
 {    
-#if !defined(USE_EVENTFD) && (defined(USE_SELECT) || defined(USE_EPOLL))
+#if !defined(USE_EVENTFD) && (defined(USE_SELECT) || defined(USE_EPOLL) || defined(USE_IO_URING))
     break_pipe_fd[0] = break_pipe_fd[1] = INVALID_DESCRIPTOR;
 #endif // UNIX
 }
@@ -195,6 +208,9 @@ void ProtoDispatcher::Destroy()
     stream_count = 0;
     Win32Cleanup();
 #endif // WIN32
+#ifdef USE_IO_URING
+    UringClose();
+#endif // USE_IO_URING
 }  // end ProtoDispatcher::Destroy()
 
 bool ProtoDispatcher::UpdateChannelNotification(ProtoChannel&   theChannel,
@@ -817,6 +833,15 @@ int ProtoDispatcher::Run(bool oneShot)
     }
 #endif    
     timer_stream.SetDescriptor(tfd);
+#ifdef USE_IO_URING
+    if (!UpdateStreamNotification(timer_stream, ENABLE_INPUT))
+    {
+        PLOG(PL_ERROR, "ProtoDispatcher::Run() error: unable to ENABLE_INPUT for timer_fd!\n");
+        close(tfd);
+        timer_stream.SetDescriptor(INVALID_DESCRIPTOR);
+        return -1;  // TBD - is there a more specific exitCode we should use instead???
+    }
+#endif // USE_IO_URING
 #endif // USE_TIMERFD  
 
 #ifdef USE_WAITABLE_TIMER  // WIN32-only
@@ -902,6 +927,11 @@ int ProtoDispatcher::Run(bool oneShot)
         }
     }  while (run);
 #ifdef USE_TIMERFD
+#ifdef USE_IO_URING
+    // Cancel the outstanding timer_fd read (the io_uring holds its own file reference)
+    UpdateStreamNotification(timer_stream, DISABLE_INPUT);
+    UringEnter(0, NULL);
+#endif // USE_IO_URING
     // Note if USE_EPOLL, closing the "timer_fd" automatically deletes the event
     close(timer_stream.GetDescriptor());
     timer_stream.SetDescriptor(INVALID_DESCRIPTOR);
@@ -1472,13 +1502,344 @@ bool ProtoDispatcher::EpollChange(int fd, int events, int op, void* udata)
     return true;
 }  // end ProtoDispatcher::EpollChange()
 
+#elif defined(USE_IO_URING)
+
+// USE_IO_URING implementation of ProtoDispatcher::UpdateStreamNotification()
+// Note that changes here are only queued to the io_uring submission queue.
+// They are handed to the kernel by the io_uring_enter() call in Wait()
+bool ProtoDispatcher::UpdateStreamNotification(Stream& stream, NotificationCommand cmd)
+{
+    switch (cmd)
+    {
+        case ENABLE_INPUT:
+            stream.SetFlag(Stream::INPUT);
+            // (If a canceled request is still outstanding, it is re-armed when it completes)
+            if (!stream.IsArmed(Stream::INPUT) && !UringArm(stream, Stream::INPUT))
+            {
+                PLOG(PL_ERROR, "ProtoDispatcher::UpdateStreamNotification(ENABLE_INPUT) error: UringArm() failed!\n");
+                stream.UnsetFlag(Stream::INPUT);
+                return false;
+            }
+            break;
+                
+        case DISABLE_INPUT:
+            stream.UnsetFlag(Stream::INPUT);
+            if (!UringCancel(stream, Stream::INPUT))
+            {
+                PLOG(PL_ERROR, "ProtoDispatcher::UpdateStreamNotification(DISABLE_INPUT) error: UringCancel() failed!\n");
+                return false;
+            }
+            break;
+            
+        case ENABLE_OUTPUT:
+            stream.SetFlag(Stream::OUTPUT);
+            if (!stream.IsArmed(Stream::OUTPUT) && !UringArm(stream, Stream::OUTPUT))
+            {
+                PLOG(PL_ERROR, "ProtoDispatcher::UpdateStreamNotification(ENABLE_OUTPUT) error: UringArm() failed!\n");
+                stream.UnsetFlag(Stream::OUTPUT);
+                return false;
+            }
+            break;
+            
+        case DISABLE_OUTPUT:
+            stream.UnsetFlag(Stream::OUTPUT);
+            if (!UringCancel(stream, Stream::OUTPUT))
+            {
+                PLOG(PL_ERROR, "ProtoDispatcher::UpdateStreamNotification(DISABLE_OUTPUT) error: UringCancel() failed!\n");
+                return false;
+            }
+            break;
+            
+        case DISABLE_ALL:
+            stream.ClearFlags();
+            if (!UringCancel(stream, Stream::INPUT) || !UringCancel(stream, Stream::OUTPUT))
+            {
+                PLOG(PL_ERROR, "ProtoDispatcher::UpdateStreamNotification(DISABLE_ALL) error: UringCancel() failed!\n");
+                return false;
+            }
+            // TBD - support exceptions ??
+            break;
+    }
+    return true;
+}  // end ProtoDispatcher::UpdateStreamNotification() [USE_IO_URING]
+
+bool ProtoDispatcher::UringOpen()
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, URING_QUEUE_SIZE, &params);
+    if (fd < 0)
+    {
+        PLOG(PL_ERROR, "ProtoDispatcher::UringOpen() io_uring_setup() error: %s\n", GetErrorString());
+        return false;
+    }
+    // We need IORING_ENTER_EXT_ARG to wait with a timeout
+    if (0 == (params.features & IORING_FEAT_EXT_ARG))
+    {
+        PLOG(PL_ERROR, "ProtoDispatcher::UringOpen() error: kernel lacks IORING_FEAT_EXT_ARG support\n");
+        close(fd);
+        return false;
+    }
+    uring_sq_ring_size = params.sq_off.array + params.sq_entries*sizeof(unsigned int);
+    uring_cq_ring_size = params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe);
+    bool singleMap = (0 != (params.features & IORING_FEAT_SINGLE_MMAP));
+    if (singleMap)
+    {
+        if (uring_cq_ring_size > uring_sq_ring_size) 
+            uring_sq_ring_size = uring_cq_ring_size;
+        uring_cq_ring_size = uring_sq_ring_size;
+    }
+    uring_sq_ring = mmap(NULL, uring_sq_ring_size, PROT_READ | PROT_WRITE, 
+                         MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == uring_sq_ring)
+    {
+        PLOG(PL_ERROR, "ProtoDispatcher::UringOpen() mmap(sq_ring) error: %s\n", GetErrorString());
+        uring_sq_ring = NULL;
+        close(fd);
+        return false;
+    }
+    if (singleMap)
+    {
+        uring_cq_ring = uring_sq_ring;
+    }
+    else
+    {
+        uring_cq_ring = mmap(NULL, uring_cq_ring_size, PROT_READ | PROT_WRITE, 
+                             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (MAP_FAILED == uring_cq_ring)
+        {
+            PLOG(PL_ERROR, "ProtoDispatcher::UringOpen() mmap(cq_ring) error: %s\n", GetErrorString());
+            uring_cq_ring = NULL;
+            munmap(uring_sq_ring, uring_sq_ring_size);
+            uring_sq_ring = NULL;
+            close(fd);
+            return false;
+        }
+    }
+    void* sqes = mmap(NULL, params.sq_entries*sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, 
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (MAP_FAILED == sqes)
+    {
+        PLOG(PL_ERROR, "ProtoDispatcher::UringOpen() mmap(sqes) error: %s\n", GetErrorString());
+        if (uring_cq_ring != uring_sq_ring) munmap(uring_cq_ring, uring_cq_ring_size);
+        munmap(uring_sq_ring, uring_sq_ring_size);
+        uring_sq_ring = uring_cq_ring = NULL;
+        close(fd);
+        return false;
+    }
+    uring_sqes = (struct io_uring_sqe*)sqes;
+    char* sqPtr = (char*)uring_sq_ring;
+    uring_sq_entries = params.sq_entries;
+    uring_sq_mask = *((unsigned int*)(sqPtr + params.sq_off.ring_mask));
+    uring_sq_head = (unsigned int*)(sqPtr + params.sq_off.head);
+    uring_sq_tail = (unsigned int*)(sqPtr + params.sq_off.tail);
+    uring_sq_array = (unsigned int*)(sqPtr + params.sq_off.array);
+    uring_sq_pending = 0;
+    char* cqPtr = (char*)uring_cq_ring;
+    uring_cq_mask = *((unsigned int*)(cqPtr + params.cq_off.ring_mask));
+    uring_cq_head = (unsigned int*)(cqPtr + params.cq_off.head);
+    uring_cq_tail = (unsigned int*)(cqPtr + params.cq_off.tail);
+    uring_cqes = (struct io_uring_cqe*)(cqPtr + params.cq_off.cqes);
+    uring_fd = fd;
+    return true;
+}  // end ProtoDispatcher::UringOpen()
+
+void ProtoDispatcher::UringClose()
+{
+    if (-1 == uring_fd) return;
+    munmap(uring_sqes, uring_sq_entries*sizeof(struct io_uring_sqe));
+    if (uring_cq_ring != uring_sq_ring) munmap(uring_cq_ring, uring_cq_ring_size);
+    munmap(uring_sq_ring, uring_sq_ring_size);
+    uring_sqes = NULL;
+    uring_sq_ring = uring_cq_ring = NULL;
+    close(uring_fd);  // this cancels any outstanding requests
+    uring_fd = -1;
+    uring_sq_pending = 0;
+    // Our own timer and break streams outlive the ring
+#ifdef USE_TIMERFD
+    timer_stream.UnsetArmed(Stream::INPUT);
+#endif // USE_TIMERFD
+    break_stream.UnsetArmed(Stream::INPUT);
+}  // end ProtoDispatcher::UringClose()
+
+struct io_uring_sqe* ProtoDispatcher::UringGetSqe()
+{
+    if ((-1 == uring_fd) && !UringOpen())
+    {
+        PLOG(PL_ERROR, "ProtoDispatcher::UringGetSqe() error: UringOpen() failed!\n");
+        return NULL;
+    }
+    if (uring_sq_pending >= uring_sq_entries)
+    {
+        // Submission queue is full, so hand what we have to the kernel
+        if ((UringEnter(0, NULL) < 0) || (uring_sq_pending >= uring_sq_entries))
+        {
+            PLOG(PL_ERROR, "ProtoDispatcher::UringGetSqe() io_uring_enter() error: %s\n", GetErrorString());
+            return NULL;
+        }
+    }
+    // (The kernel only reads the submission queue during io_uring_enter()
+    //  so we can advance the "tail" before the caller fills in the entry)
+    unsigned int tail = *uring_sq_tail;
+    unsigned int index = tail & uring_sq_mask;
+    struct io_uring_sqe* sqe = uring_sqes + index;
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    uring_sq_array[index] = index;
+    __atomic_store_n(uring_sq_tail, tail + 1, __ATOMIC_RELEASE);
+    uring_sq_pending++;
+    return sqe;
+}  // end ProtoDispatcher::UringGetSqe()
+
+// Queues a one-shot request for the given stream direction. The "user_data"
+// is the Stream pointer with the low order bit set for OUTPUT.  One-shot polls
+// (re-armed by UringReap()) are used instead of IORING_POLL_ADD_MULTI since 
+// multishot polls are edge-triggered and our notification semantics are not
+bool ProtoDispatcher::UringArm(Stream& stream, Stream::Flag theFlag)
+{
+    struct io_uring_sqe* sqe = UringGetSqe();
+    if (NULL == sqe) return false;
+    bool output = (Stream::OUTPUT == theFlag);
+    sqe->fd = output ? stream.GetOutputHandle() : stream.GetInputHandle();
+    switch (stream.GetType())
+    {
+        case Stream::TIMER:
+        case Stream::EVENT:
+            // Read the timer_fd expiration count or break eventfd counter 
+            // (or break pipe bytes) directly so no separate read() is needed
+            sqe->opcode = IORING_OP_READ;
+            sqe->addr = (uintptr_t)((Stream::TIMER == stream.GetType()) ? &uring_timer_count : &uring_break_count);
+            sqe->len = sizeof(uint64_t);
+            break;
+        default:
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = output ? POLLOUT : POLLIN;
+            break;
+    }
+    sqe->user_data = (uintptr_t)&stream | (output ? 1 : 0);
+    stream.SetArmed(theFlag);
+    return true;
+}  // end ProtoDispatcher::UringArm()
+
+bool ProtoDispatcher::UringCancel(Stream& stream, Stream::Flag theFlag)
+{
+    // Go through the current "uring_event_array" and trim down or nullify
+    // applicable current pending events for this "stream"
+    // (So we don't get undesired notification dispatches)
+    UringEvent* evp = uring_event_array;
+    for (int i = 0; i < wait_status; i++)
+    {
+        if (evp->stream == &stream)
+        {
+            evp->events &= ((Stream::OUTPUT == theFlag) ? ~POLLOUT : ~POLLIN);
+            if (!stream.HasFlags()) evp->stream = NULL;
+        }
+        evp++;
+    }
+    if (!stream.IsArmed(theFlag)) return true;
+    // Note the request stays "armed" until its (-ECANCELED) completion is reaped
+    struct io_uring_sqe* sqe = UringGetSqe();
+    if (NULL == sqe) return false;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uintptr_t)&stream | ((Stream::OUTPUT == theFlag) ? 1 : 0);
+    sqe->user_data = 0;  // completion is ignored
+    return true;
+}  // end ProtoDispatcher::UringCancel()
+
+// Submits any queued entries and waits for at least "minComplete" completions
+// or the "timeout" (if non-NULL), returning the number of entries submitted
+int ProtoDispatcher::UringEnter(unsigned int minComplete, const struct timespec* timeout)
+{
+    if (-1 == uring_fd) return 0;
+    unsigned int flags = 0;
+    void* argp = NULL;
+    size_t argsz = 0;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    if (NULL != timeout)
+    {
+        ts.tv_sec = timeout->tv_sec;
+        ts.tv_nsec = timeout->tv_nsec;
+        memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = (uintptr_t)&ts;
+        argp = &arg;
+        argsz = sizeof(arg);
+        flags |= IORING_ENTER_EXT_ARG | IORING_ENTER_GETEVENTS;
+    }
+    else if (0 != minComplete)
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+    else if (0 == uring_sq_pending)
+    {
+        return 0;  // nothing to do
+    }
+    int result = (int)syscall(__NR_io_uring_enter, uring_fd, uring_sq_pending, minComplete, flags, argp, argsz);
+    if (result > 0) 
+        uring_sq_pending -= ((unsigned int)result < uring_sq_pending) ? result : uring_sq_pending;
+    return result;
+}  // end ProtoDispatcher::UringEnter()
+
+// Moves ready completions to the "uring_event_array" and re-arms
+// the associated one-shot requests as needed, returning the event count
+int ProtoDispatcher::UringReap()
+{
+    int count = 0;
+    unsigned int head = *uring_cq_head;
+    unsigned int tail = __atomic_load_n(uring_cq_tail, __ATOMIC_ACQUIRE);
+    while ((head != tail) && (count < URING_ARRAY_SIZE))
+    {
+        struct io_uring_cqe* cqe = uring_cqes + (head & uring_cq_mask);
+        head++;
+        if (0 == cqe->user_data) continue;  // IORING_OP_ASYNC_CANCEL completion
+        Stream* stream = (Stream*)(uintptr_t)(cqe->user_data & ~((__u64)1));
+        Stream::Flag flag = (0 != (cqe->user_data & 1)) ? Stream::OUTPUT : Stream::INPUT;
+        int result = cqe->res;
+        stream->UnsetArmed(flag);
+        if (!stream->FlagIsSet(flag)) continue;  // notification was disabled
+        if (-ECANCELED == result)
+        {
+            // Canceled, but then re-enabled before this completion was reaped
+            if (!UringArm(*stream, flag))
+                PLOG(PL_ERROR, "ProtoDispatcher::UringReap() error: UringArm() failed!\n");
+            continue;
+        }
+        int events;
+        if (result < 0)
+        {
+            // Don't re-arm on error to avoid spinning on a bad descriptor
+            PLOG(PL_ERROR, "ProtoDispatcher::UringReap() io_uring request error: %s\n", GetErrorString(-result));
+            if ((Stream::TIMER == stream->GetType()) || (Stream::EVENT == stream->GetType())) continue;
+            events = POLLERR;
+        }
+        else
+        {
+            if (!UringArm(*stream, flag))
+                PLOG(PL_ERROR, "ProtoDispatcher::UringReap() error: UringArm() failed!\n");
+            // (POLLHUP is passed as input or output readiness so the listener sees the hangup)
+            if ((Stream::TIMER == stream->GetType()) || (Stream::EVENT == stream->GetType()))
+                events = POLLIN;
+            else if (0 != (result & (POLLIN | POLLOUT | POLLHUP)))
+                events = (result & POLLERR) | ((Stream::OUTPUT == flag) ? POLLOUT : POLLIN);
+            else
+                events = (result & POLLERR);
+        }
+        uring_event_array[count].stream = stream;
+        uring_event_array[count].events = events;
+        count++;
+    }
+    __atomic_store_n(uring_cq_head, head, __ATOMIC_RELEASE);
+    return count;
+}  // end ProtoDispatcher::UringReap()
+
 #else
 #error "undefined async i/o mechanism"  // to make sure we implement something
 #endif // !USE_SELECT && !USE_KQUEUE
 
 bool ProtoDispatcher::InstallBreak()
 { 
-#if defined(USE_SELECT) || defined(USE_EPOLL)
+#if defined(USE_SELECT) || defined(USE_EPOLL) || defined(USE_IO_URING)
 #ifdef USE_EVENTFD
     // Create eventfd() descriptor
     int efd = eventfd(0, 0);  // TBD - should we set the flag "EFD_NONBLOCK"???
@@ -1497,6 +1858,15 @@ bool ProtoDispatcher::InstallBreak()
         return false;
     }
 #endif // USE_EPOLL    
+#ifdef USE_IO_URING
+    if (!UpdateStreamNotification(break_stream, ENABLE_INPUT))
+    {
+        PLOG(PL_ERROR, "ProtoDispatcher::InstallBreak() error: UpdateStreamNotification() failed!\n");
+        close(efd);
+        break_stream.SetDescriptor(INVALID_DESCRIPTOR);
+        return false;
+    }
+#endif // USE_IO_URING
 #else
     // Create a "self pipe" for thread awakening purposes
     if (0 != pipe(break_pipe_fd))
@@ -1522,6 +1892,17 @@ bool ProtoDispatcher::InstallBreak()
         return false;
     }
 #endif // USE_EPOLL    
+#ifdef USE_IO_URING
+    if (!UpdateStreamNotification(break_stream, ENABLE_INPUT))
+    {
+        PLOG(PL_ERROR, "ProtoDispatcher::InstallBreak() error: UpdateStreamNotification() failed!\n");
+        close(break_pipe_fd[0]);
+        close(break_pipe_fd[1]);
+        break_pipe_fd[0] = break_pipe_fd[1] = INVALID_DESCRIPTOR;
+        break_stream.SetDescriptor(INVALID_DESCRIPTOR);
+        return false;
+    }
+#endif // USE_IO_URING
 #endif // if/else USE_EVENTFD    
 #elif defined(USE_KQUEUE)
     if (!KeventChange(1, EVFILT_USER, EV_ADD | EV_ENABLE | EV_CLEAR, NULL))
@@ -1537,7 +1918,7 @@ bool ProtoDispatcher::InstallBreak()
 
 bool ProtoDispatcher::SetBreak()
 {      
-#if defined(USE_SELECT) || defined(USE_EPOLL)
+#if defined(USE_SELECT) || defined(USE_EPOLL) || defined(USE_IO_URING)
 #ifdef USE_EVENTFD
     uint64_t value = 1;
     if (write(break_stream.GetDescriptor(), &value, sizeof(uint64_t)) < 0)
@@ -1583,7 +1964,7 @@ bool ProtoDispatcher::SetBreak()
 
 void ProtoDispatcher::RemoveBreak()
 {
-#if defined(USE_SELECT) || defined(USE_EPOLL)
+#if defined(USE_SELECT) || defined(USE_EPOLL) || defined(USE_IO_URING)
     if (INVALID_DESCRIPTOR != break_stream.GetDescriptor())
     {
 #ifdef USE_EPOLL
@@ -1592,6 +1973,12 @@ void ProtoDispatcher::RemoveBreak()
             PLOG(PL_ERROR, "ProtoDispatcher::RemoveBreak() error: EpollChange() failed!\n");
         }
 #endif // USE_EPOLL
+#ifdef USE_IO_URING
+        // Cancel the outstanding break_stream read before we close it
+        if (!UpdateStreamNotification(break_stream, DISABLE_INPUT))
+            PLOG(PL_ERROR, "ProtoDispatcher::RemoveBreak() error: UpdateStreamNotification() failed!\n");
+        UringEnter(0, NULL);
+#endif // USE_IO_URING
         // Close down the break_stream pipe or eventfd
         close(break_stream.GetDescriptor());
         break_stream.SetDescriptor(INVALID_DESCRIPTOR);
@@ -1621,9 +2008,9 @@ void ProtoDispatcher::Wait()
     // (TBD) We could put some code here to protect this from
     // being called by the wrong thread?
     
-#if defined(USE_KQUEUE) || defined(HAVE_PSELECT) || defined(USE_TIMERFD)
+#if defined(USE_KQUEUE) || defined(HAVE_PSELECT) || defined(USE_TIMERFD) || defined(USE_IO_URING)
 #define USE_TIMESPEC 1 // so we can use the "struct timespec" created here
-#endif  // USE_KQUEUE || HAVE_PSELECT || USE_TIMERFD    
+#endif  // USE_KQUEUE || HAVE_PSELECT || USE_TIMERFD || USE_IO_URING
     
     
 #ifdef USE_SELECT
@@ -1786,6 +2173,26 @@ void ProtoDispatcher::Wait()
     }
     wait_status = kevent(kevent_queue, NULL, 0, kevent_array, KEVENT_ARRAY_SIZE, timeoutPtr);
     // TBD - should we print a message here on error? (Dispatch() does this for us)
+#elif defined(USE_IO_URING)
+    // If no streams were installed yet, create io_uring early
+    if ((-1 == uring_fd) && !UringOpen())
+    {
+        PLOG(PL_ERROR, "ProtoDispatcher::Wait() error: UringOpen() failed!\n");
+        wait_status = -1;
+        return;
+    }
+    // Don't block if completions were left over from the last reaping
+    unsigned int minComplete = 
+        (*uring_cq_head == __atomic_load_n(uring_cq_tail, __ATOMIC_ACQUIRE)) ? 1 : 0;
+    // This submits our queued requests and waits for completions in one call.
+    // Note if (NULL == timeoutPtr), then the timer_fd has been set up with the proper timeout value
+    if ((UringEnter(minComplete, timeoutPtr) < 0) && 
+        (ETIME != errno) && (EBUSY != errno) && (EAGAIN != errno))
+    {
+        wait_status = -1;  // Dispatch() reports the error
+        return;
+    }
+    wait_status = UringReap();
 #else
 #error "undefined async i/o mechanism"  // to make sure we implement something    
 #endif // !USE_SELECT && !USE_KQUEUE
@@ -2038,6 +2445,111 @@ void ProtoDispatcher::Dispatch()
             OnSystemTimeout();
             break;
     }  // end switch(wait_status) [USE_EPOLL]   
+
+#elif defined(USE_IO_URING)
+
+    switch(wait_status)
+    {
+        case -1:
+            if (EINTR != errno)
+                PLOG(PL_ERROR, "ProtoDispatcher::Dispatch() io_uring_enter() error: %s\n", GetErrorString());
+            break;
+            
+        case 0: 
+            // timeout only
+            OnSystemTimeout(); 
+            break;
+            
+        default:
+            // (Note "wait_status" may change on the fly, here if
+            //  notification results in stream removal)
+            UringEvent* evp = uring_event_array;
+            for (int i = 0; i < wait_status; i++)
+            {
+                if (NULL != evp->stream)
+                {
+                    Stream* stream = evp->stream;
+                    switch (stream->GetType())
+                    {
+                        case Stream::CHANNEL:
+                        {
+                            ProtoChannel& channel = static_cast<ChannelStream*>(stream)->GetChannel();
+                            if (0 != (POLLIN & evp->events))
+                            {
+                                if (stream->IsInput())
+                                    channel.OnNotify(ProtoChannel::NOTIFY_INPUT);
+                            }
+                            if (0 != (POLLOUT & evp->events))
+                            {
+                                if (stream->IsOutput())
+                                    channel.OnNotify(ProtoChannel::NOTIFY_OUTPUT);
+                            }
+                            if (0 != (POLLERR & evp->events))
+                            {
+                                PLOG(PL_ERROR, "ProtoDispatcher::Dispatch() ProtoChannel io_uring poll error\n");
+                                // Throw a notification so error will be detected by app???
+                                if (stream->IsInput())
+                                    channel.OnNotify(ProtoChannel::NOTIFY_INPUT);
+                                else if (stream->IsOutput())
+                                    channel.OnNotify(ProtoChannel::NOTIFY_OUTPUT);
+                            }
+                            break;
+                        }
+                        case Stream::SOCKET:
+                        {
+                            ProtoSocket& socket = static_cast<SocketStream*>(stream)->GetSocket();
+                            if (0 != (POLLIN & evp->events))
+                            {
+                                if (stream->IsInput())
+                                    socket.OnNotify(ProtoSocket::NOTIFY_INPUT);
+                            }
+                            if (0 != (POLLOUT & evp->events))
+                            {
+                                if (stream->IsOutput())
+                                    socket.OnNotify(ProtoSocket::NOTIFY_OUTPUT);
+                            }
+                            if (0 != (POLLERR & evp->events))
+                                socket.OnNotify(ProtoSocket::NOTIFY_ERROR);
+                            break;
+                        }
+                        case Stream::GENERIC:
+                        {
+                            if (0 != (POLLIN & evp->events))
+                            {
+                                if (stream->IsInput())
+                                    static_cast<GenericStream*>(stream)->OnEvent(EVENT_INPUT);
+                            }
+                            if (0 != (POLLOUT & evp->events))
+                            {
+                                if (stream->IsOutput())
+                                    static_cast<GenericStream*>(stream)->OnEvent(EVENT_OUTPUT);
+                            }
+                            if (0 != (POLLERR & evp->events))
+                            {
+                                // Throw an input or output notification so app gets notified?
+                                if (stream->IsInput())
+                                    static_cast<GenericStream*>(stream)->OnEvent(EVENT_INPUT);
+                                else if (stream->IsOutput())
+                                    static_cast<GenericStream*>(stream)->OnEvent(EVENT_OUTPUT);
+                            }
+                            break;
+                        }
+                        case Stream::TIMER:
+                        case Stream::EVENT:
+                            // The timer_fd or break_stream was already read
+                            // by its IORING_OP_READ (timeout dispatched below)
+                            break;
+                    }  // end switch(stream->GetType()) [USE_IO_URING]
+                }
+                else
+                {
+                    // This must be a nullified event so do nothing
+                }
+                evp++;               
+            }  // end for (i = 0..wait_status)
+            OnSystemTimeout();
+            break;
+    }  // end switch(wait_status) [USE_IO_URING]
     
 #elif defined(USE_KQUEUE)
     // Here the "wait_status" is the return value from the kevent() call
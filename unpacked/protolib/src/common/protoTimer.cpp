@@ -9,6 +9,7 @@
 #include "protoDebug.h"
 
 #include <stdio.h>  // for getchar() debug
+#include <string.h>  // for memset()
 
 /**
 * @brief Default constructor
@@ -20,10 +21,11 @@
 * @param mgr(NULL)
 * @param prev(NULL)
 * @param next(NULL)
+* @param wheel_slot(NULL)
 */
 ProtoTimer::ProtoTimer()
  : listener(NULL), interval(1.0), repeat(0), repeat_count(0),
-   mgr(NULL), prev(NULL), next(NULL)
+   mgr(NULL), prev(NULL), next(NULL), wheel_slot(NULL)
 {
 
 }
@@ -126,19 +128,77 @@ double ProtoTimer::GetTimeRemaining() const
  *  contains a ProtoTimerMgr to similarly manage timers for a simulation
  *  instance).
  */
-ProtoTimerMgr::ProtoTimerMgr()
-: update_pending(false), timeout_scheduled(false),
-  long_head(NULL), long_tail(NULL), short_head(NULL), short_tail(NULL), invoked_timer(NULL)
+ProtoTimerMgr::ProtoTimerMgr(Engine theEngine)
+: engine(SORTED_LIST), update_pending(false), timeout_scheduled(false),
+  long_head(NULL), long_tail(NULL), short_head(NULL), short_tail(NULL), invoked_timer(NULL),
+  wheel(NULL), wheel_tick(0), wheel_count(0)
 {
     pulse_timer.SetListener(this, &ProtoTimerMgr::OnPulseTimeout);
     pulse_timer.SetInterval(1.0);
     pulse_timer.SetRepeat(-1);
+    memset(wheel_bits, 0, sizeof(wheel_bits));
+    SetEngine(theEngine);
 }
 
 ProtoTimerMgr::~ProtoTimerMgr()
 {
     // (TBD) Uninstall or halt, deactivate all timers ...   
+    if (NULL != wheel)
+    {
+        delete[] wheel;
+        wheel = NULL;
+    }
 }
+
+bool ProtoTimerMgr::SetEngine(Engine theEngine)
+{
+    if (theEngine == engine) return true;
+    if (IsActive())
+    {
+        PLOG(PL_ERROR, "ProtoTimerMgr::SetEngine() error: timers are active\n");
+        return false;
+    }
+    if (TIMING_WHEEL == theEngine)
+    {
+        if (NULL == wheel)
+        {
+            if (NULL == (wheel = new ProtoTimer*[WHEEL_LEVELS*WHEEL_SIZE]))
+            {
+                PLOG(PL_ERROR, "ProtoTimerMgr::SetEngine() new wheel error: %s\n", GetErrorString());
+                return false;
+            }
+            memset(wheel, 0, WHEEL_LEVELS*WHEEL_SIZE*sizeof(ProtoTimer*));
+        }
+    }
+    else if (NULL != wheel)
+    {
+        delete[] wheel;
+        wheel = NULL;
+    }
+    engine = theEngine;
+    return true;
+}  // end ProtoTimerMgr::SetEngine()
+
+double ProtoTimerMgr::GetTimeRemaining() const
+{
+    if (NULL != short_head)
+    {
+        return short_head->GetTimeRemaining();
+    }
+    else if (0 != wheel_count)
+    {
+        ProtoTime currentTime;
+        const_cast<ProtoTimerMgr*>(this)->GetCurrentProtoTime(currentTime);
+        ProtoTime nextTimeout;
+        GetWheelTimeout(nextTimeout, currentTime);
+        double timeRemaining = ProtoTime::Delta(nextTimeout, currentTime);
+        return ((timeRemaining < 0.0) ? 0.0 : timeRemaining);
+    }
+    else
+    {
+        return -1.0;
+    }
+}  // end ProtoTimerMgr::GetTimeRemaining()
 /**
 * Calls inlined ProtoSystemTime function
 */
@@ -148,6 +208,9 @@ void ProtoTimerMgr::GetSystemTime(struct timeval& currentTime)
 }  // end ProtoTimerMgr::GetSystemTime()
 
 const double ProtoTimerMgr::PRECISION_TIME_THRESHOLD = 8.0;
+// (a little less than 2^31 ticks so wheel tick arithmetic is unambiguous)
+const double ProtoTimerMgr::WHEEL_FAR_INTERVAL = 2.0e+06;
+const UINT32 ProtoTimerMgr::WHEEL_FAR_PARK = ((UINT32)1 << 30);
 
 /**
 *
@@ -158,9 +221,11 @@ void ProtoTimerMgr::OnSystemTimeout()
     timeout_scheduled = false;
     bool updateStatus = update_pending;
     update_pending = true;
-    ProtoTimer* next = short_head;
     ProtoTime now;
     GetCurrentProtoTime(now);
+    // Move any wheel timers due by "now" to the short list
+    if (0 != wheel_count) AdvanceWheel(now);
+    ProtoTimer* next = short_head;
     while (next)
     {
         double delta = ProtoTime::Delta(next->timeout, now);
@@ -235,7 +300,19 @@ void ProtoTimerMgr::ActivateTimer(ProtoTimer& theTimer)
 {
     ASSERT(!theTimer.IsActive());
     double timerInterval = theTimer.GetInterval();
-    if (PRECISION_TIME_THRESHOLD > timerInterval)
+    if (TIMING_WHEEL == engine)
+    {
+        ProtoTime now;
+        GetCurrentProtoTime(now);
+        AdvanceWheel(now);
+        theTimer.timeout = now;
+        theTimer.timeout += timerInterval;
+        if (timerInterval < WHEEL_FAR_INTERVAL)
+            InsertWheelTimer(theTimer);
+        else
+            ParkWheelTimer(theTimer);
+    }
+    else if (PRECISION_TIME_THRESHOLD > timerInterval)
     {       
         GetCurrentProtoTime(theTimer.timeout);
         theTimer.timeout += timerInterval;
@@ -262,7 +339,7 @@ void ProtoTimerMgr::ActivateTimer(ProtoTimer& theTimer)
 void ProtoTimerMgr::ReactivateTimer(ProtoTimer& theTimer, const ProtoTime& now)
 {
     double timerInterval = theTimer.GetInterval();
-    if (PRECISION_TIME_THRESHOLD > timerInterval)
+    if ((TIMING_WHEEL == engine) || (PRECISION_TIME_THRESHOLD > timerInterval))
     {
         //TRACE("incrementing timer timeout %lu:%lu by %lf\n", theTimer.timeout.sec(), theTimer.timeout.usec(), timerInterval);
         theTimer.timeout += timerInterval;
@@ -274,7 +351,12 @@ void ProtoTimerMgr::ReactivateTimer(ProtoTimer& theTimer, const ProtoTime& now)
             PLOG(PL_DEBUG, "ProtoTimerMgr: Warning! real time failure interval:%lf (delta:%lf)\n", 
                            timerInterval, delta);
         }   
-        InsertShortTimer(theTimer);
+        if (TIMING_WHEEL != engine)
+            InsertShortTimer(theTimer);
+        else if (timerInterval < WHEEL_FAR_INTERVAL)
+            InsertWheelTimer(theTimer);
+        else
+            ParkWheelTimer(theTimer);
     }
     else
     {
@@ -304,6 +386,10 @@ void ProtoTimerMgr::DeactivateTimer(ProtoTimer& theTimer)
                 invoked_timer = NULL;
             RemoveShortTimer(theTimer);
         }
+        else if (NULL != theTimer.wheel_slot)
+        {
+            RemoveWheelTimer(theTimer);
+        }
         else
         {
             RemoveLongTimer(theTimer);
@@ -321,7 +407,11 @@ void ProtoTimerMgr::DeactivateTimer(ProtoTimer& theTimer)
 
 void ProtoTimerMgr::Update()
 {
-    if (NULL == short_head)
+    ProtoTime now;
+    if ((NULL == short_head) && (0 != wheel_count))
+        GetCurrentProtoTime(now);
+    ProtoTime nextTimeout;
+    if (!GetNextTimeout(nextTimeout, now))
     {
         // REMOVE existing scheduled system timeout if applicable
         if (timeout_scheduled)
@@ -334,11 +424,11 @@ void ProtoTimerMgr::Update()
     else if (timeout_scheduled)
     {
         // MODIFY existing scheduled system timeout if different
-        if (scheduled_timeout != short_head->timeout)
+        if (scheduled_timeout != nextTimeout)
         {
-            if (UpdateSystemTimer(ProtoTimer::MODIFY, short_head->GetTimeRemaining()))
+            if (UpdateSystemTimer(ProtoTimer::MODIFY, GetTimeRemaining()))
             {
-                scheduled_timeout = short_head->timeout;
+                scheduled_timeout = nextTimeout;
             }
             else  // (TBD) if MODIFY fails, do we still have a system timeout ???
             {
@@ -350,9 +440,9 @@ void ProtoTimerMgr::Update()
     else 
     {
         // INSTALL new scheduled system timeout
-        if (UpdateSystemTimer(ProtoTimer::INSTALL, short_head->GetTimeRemaining()))
+        if (UpdateSystemTimer(ProtoTimer::INSTALL, GetTimeRemaining()))
         {
-                scheduled_timeout = short_head->timeout;
+                scheduled_timeout = nextTimeout;
                 timeout_scheduled = true;
         }  
         else
@@ -548,3 +638,303 @@ void ProtoTimerMgr::RemoveLongTimer(ProtoTimer& theTimer)
         long_tail = theTimer.prev;
     theTimer.mgr = NULL;
 }  // end ProtoTimerMgr::RemoveLongTimer()
+
+/**
+ * Merges a NULL-terminated (via "next") list of timers into the
+ * time-sorted short timer list.  (Used when timing wheel slots come due)
+ * Since these are usually later than the timers already in the short
+ * list, the sorted list is merged in from the tail end.
+ */
+void ProtoTimerMgr::MergeShortTimers(ProtoTimer* timerList)
+{
+    if (NULL == timerList) return;
+    if (NULL == timerList->next)
+    {
+        InsertShortTimer(*timerList);
+        return;
+    }
+    timerList = SortTimerList(timerList);
+    // Link up "prev" pointers to walk the sorted list backwards
+    ProtoTimer* last = timerList;
+    last->prev = NULL;
+    while (NULL != last->next)
+    {
+        last->next->prev = last;
+        last = last->next;
+    }
+    ProtoTimer* pos = short_tail;
+    while (NULL != last)
+    {
+        ProtoTimer& theTimer = *last;
+        last = last->prev;
+        while ((NULL != pos) && (theTimer.timeout < pos->timeout))
+            pos = pos->prev;
+        theTimer.mgr = this;
+        theTimer.is_precise = true;
+        // Insert "theTimer" after "pos" (or at head if NULL)
+        if (NULL != (theTimer.prev = pos))
+        {
+            if (NULL != (theTimer.next = pos->next))
+                theTimer.next->prev = &theTimer;
+            else
+                short_tail = &theTimer;
+            pos->next = &theTimer;
+        }
+        else
+        {
+            if (NULL != (theTimer.next = short_head))
+                short_head->prev = &theTimer;
+            else
+                short_tail = &theTimer;
+            short_head = &theTimer;
+        }
+    }
+}  // end ProtoTimerMgr::MergeShortTimers()
+
+// Merge sort of a NULL-terminated (via "next") timer list by timeout
+ProtoTimer* ProtoTimerMgr::SortTimerList(ProtoTimer* timerList)
+{
+    if ((NULL == timerList) || (NULL == timerList->next)) return timerList;
+    ProtoTimer* slow = timerList;
+    ProtoTimer* fast = timerList->next;
+    while ((NULL != fast) && (NULL != fast->next))
+    {
+        slow = slow->next;
+        fast = fast->next->next;
+    }
+    ProtoTimer* a = slow->next;
+    slow->next = NULL;
+    ProtoTimer* b = SortTimerList(a);
+    a = SortTimerList(timerList);
+    ProtoTimer* head = NULL;
+    ProtoTimer** tail = &head;
+    while ((NULL != a) && (NULL != b))
+    {
+        if (a->timeout <= b->timeout)
+        {
+            *tail = a;
+            a = a->next;
+        }
+        else
+        {
+            *tail = b;
+            b = b->next;
+        }
+        tail = &((*tail)->next);
+    }
+    *tail = (NULL != a) ? a : b;
+    return head;
+}  // end ProtoTimerMgr::SortTimerList()
+
+void ProtoTimerMgr::InsertWheelTimer(ProtoTimer& theTimer)
+{
+    UINT32 tick = GetWheelTick(theTimer.timeout);
+    UINT32 delta = tick - wheel_tick;
+    if ((INT32)delta < 0)
+    {
+        // It's due within a tick that has already been processed
+        theTimer.wheel_slot = NULL;
+        InsertShortTimer(theTimer);
+        return;
+    }
+    unsigned int level = 0;
+    while ((level < (WHEEL_LEVELS - 1)) && 
+           (delta >= ((UINT32)1 << (WHEEL_BITS*(level + 1)))))
+    {
+        level++;
+    }
+    LinkWheelTimer(theTimer, level, (tick >> (WHEEL_BITS*level)) & WHEEL_MASK);
+}  // end ProtoTimerMgr::InsertWheelTimer()
+
+// Timers beyond the wheel's unambiguous span are "parked" in the top
+// level slot that cascades about WHEEL_FAR_PARK ticks from now
+void ProtoTimerMgr::ParkWheelTimer(ProtoTimer& theTimer)
+{
+    unsigned int level = WHEEL_LEVELS - 1;
+    UINT32 tick = wheel_tick + WHEEL_FAR_PARK;
+    LinkWheelTimer(theTimer, level, (tick >> (WHEEL_BITS*level)) & WHEEL_MASK);
+}  // end ProtoTimerMgr::ParkWheelTimer()
+
+void ProtoTimerMgr::LinkWheelTimer(ProtoTimer& theTimer, unsigned int level, unsigned int index)
+{
+    ProtoTimer** slot = wheel + (level*WHEEL_SIZE + index);
+    theTimer.mgr = this;
+    theTimer.is_precise = false;
+    theTimer.wheel_slot = slot;
+    theTimer.prev = NULL;
+    if (NULL != (theTimer.next = *slot))
+        theTimer.next->prev = &theTimer;
+    *slot = &theTimer;
+    wheel_bits[level][index >> 5] |= ((UINT32)1 << (index & 0x1f));
+    wheel_count++;
+}  // end ProtoTimerMgr::LinkWheelTimer()
+
+void ProtoTimerMgr::RemoveWheelTimer(ProtoTimer& theTimer)
+{
+    ProtoTimer** slot = theTimer.wheel_slot;
+    if (NULL != theTimer.prev)
+    {
+        theTimer.prev->next = theTimer.next;
+    }
+    else if (NULL == (*slot = theTimer.next))
+    {
+        // Slot is now empty, so clear its occupancy bit
+        unsigned int offset = (unsigned int)(slot - wheel);
+        unsigned int index = offset & WHEEL_MASK;
+        wheel_bits[offset >> WHEEL_BITS][index >> 5] &= ~((UINT32)1 << (index & 0x1f));
+    }
+    if (NULL != theTimer.next)
+        theTimer.next->prev = theTimer.prev;
+    theTimer.wheel_slot = NULL;
+    theTimer.mgr = NULL;
+    wheel_count--;
+}  // end ProtoTimerMgr::RemoveWheelTimer()
+
+// Empties a wheel slot, returning its timers as a NULL-terminated list
+ProtoTimer* ProtoTimerMgr::DetachWheelSlot(unsigned int level, unsigned int index)
+{
+    ProtoTimer** slot = wheel + (level*WHEEL_SIZE + index);
+    ProtoTimer* timerList = *slot;
+    if (NULL != timerList)
+    {
+        *slot = NULL;
+        wheel_bits[level][index >> 5] &= ~((UINT32)1 << (index & 0x1f));
+        for (ProtoTimer* next = timerList; NULL != next; next = next->next)
+        {
+            next->wheel_slot = NULL;
+            wheel_count--;
+        }
+    }
+    return timerList;
+}  // end ProtoTimerMgr::DetachWheelSlot()
+
+// Returns the first occupied slot index at or after "index" (circularly if "wrap")
+// or -1 if none is found
+int ProtoTimerMgr::FindWheelSlot(unsigned int level, unsigned int index, bool wrap) const
+{
+    const UINT32* bits = wheel_bits[level];
+    unsigned int word = index >> 5;
+    UINT32 mask = bits[word] & (0xffffffff << (index & 0x1f));
+    unsigned int count = wrap ? (WHEEL_WORDS + 1) : (WHEEL_WORDS - word);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (0 != mask)
+        {
+            unsigned int bit = 0;
+            while (0 == (mask & 0x01))
+            {
+                mask >>= 1;
+                bit++;
+            }
+            return (int)((word << 5) + bit);
+        }
+        word = (word + 1) % WHEEL_WORDS;
+        mask = bits[word];
+    }
+    return -1;
+}  // end ProtoTimerMgr::FindWheelSlot()
+
+/**
+ * Processes wheel ticks up through "now", cascading upper levels as 
+ * needed and moving timers from due level 0 slots to the short list.
+ * Runs of empty level 0 slots are skipped.
+ */
+void ProtoTimerMgr::AdvanceWheel(const ProtoTime& now)
+{
+    UINT32 nowTick = GetWheelTick(now);
+    while ((INT32)(nowTick - wheel_tick) >= 0)
+    {
+        if (0 == wheel_count)
+        {
+            // Nothing to process, so just catch up
+            wheel_tick = nowTick + 1;
+            break;
+        }
+        unsigned int index = wheel_tick & WHEEL_MASK;
+        if (0 == index) CascadeWheel(now);
+        MergeShortTimers(DetachWheelSlot(0, index));
+        int nextIndex = (index < WHEEL_MASK) ? FindWheelSlot(0, index + 1, false) : -1;
+        UINT32 skip = (nextIndex < 0) ? (WHEEL_SIZE - index) : (nextIndex - index);
+        if ((nowTick - wheel_tick) < skip)
+            wheel_tick = nowTick + 1;
+        else
+            wheel_tick += skip;
+    }
+}  // end ProtoTimerMgr::AdvanceWheel()
+
+// Called at level 0 wrap points to redistribute upper level slot timers
+void ProtoTimerMgr::CascadeWheel(const ProtoTime& now)
+{
+    for (unsigned int level = 1; level < WHEEL_LEVELS; level++)
+    {
+        unsigned int index = (wheel_tick >> (WHEEL_BITS*level)) & WHEEL_MASK;
+        ProtoTimer* next = DetachWheelSlot(level, index);
+        if ((NULL != next) && ((WHEEL_LEVELS - 1) == level))
+        {
+            // Parked timers may still be too far out for the wheel
+            double lag = (double)(GetWheelTick(now) - wheel_tick) / WHEEL_TICKS_PER_SEC;
+            while (NULL != next)
+            {
+                ProtoTimer& current = *next;
+                next = next->next;
+                if ((ProtoTime::Delta(current.timeout, now) + lag) < WHEEL_FAR_INTERVAL)
+                    InsertWheelTimer(current);
+                else
+                    ParkWheelTimer(current);
+            }
+        }
+        while (NULL != next)
+        {
+            ProtoTimer& current = *next;
+            next = next->next;
+            InsertWheelTimer(current);
+        }
+        if (0 != index) break;
+    }
+}  // end ProtoTimerMgr::CascadeWheel()
+
+/**
+ * Computes the time of the next wheel tick where a slot is
+ * processed or cascaded.  Note cascades may result in an
+ * "early" system timeout that just redistributes timers.
+ */
+bool ProtoTimerMgr::GetWheelTimeout(ProtoTime& nextTimeout, const ProtoTime& now) const
+{
+    if (0 == wheel_count) return false;
+    UINT32 minDelta = 0xffffffff;
+    for (unsigned int level = 0; level < WHEEL_LEVELS; level++)
+    {
+        unsigned int shift = WHEEL_BITS*level;
+        unsigned int index = (wheel_tick >> shift) & WHEEL_MASK;
+        // An upper level's current slot is pending only at its cascade point
+        unsigned int start = 
+            ((0 == level) || (0 == (wheel_tick & (((UINT32)1 << shift) - 1)))) ? 0 : 1;
+        int slot = FindWheelSlot(level, (index + start) & WHEEL_MASK, true);
+        if (slot < 0) continue;
+        UINT32 offset = start + (((unsigned int)slot - index - start) & WHEEL_MASK);
+        UINT32 tick = (0 == level) ? 
+                        (wheel_tick + offset) : 
+                        (((wheel_tick >> shift) + offset) << shift);
+        UINT32 delta = tick - wheel_tick;
+        if (delta < minDelta) minDelta = delta;
+    }
+    INT32 lag = (INT32)(GetWheelTick(now) - wheel_tick);
+    if ((lag >= 0) && (minDelta <= (UINT32)lag))
+    {
+        nextTimeout = now;  // overdue
+        return true;
+    }
+    if (minDelta > 0x7fffffff) minDelta = 0x7fffffff;  // (an early timeout is harmless)
+    UINT32 ticks = minDelta - lag;
+    // Offset from the start of the current tick
+    unsigned long sec = now.sec() + ticks / WHEEL_TICKS_PER_SEC;
+    unsigned long usec = (now.usec() / WHEEL_TICK_USEC) * WHEEL_TICK_USEC;
+    usec += (ticks % WHEEL_TICKS_PER_SEC) * WHEEL_TICK_USEC;
+    if (usec >= 1000000)
+    {
+        sec++;
+        usec -= 1000000;
+    }
+    nextTimeout = ProtoTime(sec, usec);
+    return true;
+}  // end ProtoTimerMgr::GetWheelTimeout()
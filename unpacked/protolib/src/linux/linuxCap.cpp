@@ -5,9 +5,10 @@
 
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/mman.h>    /* for mmap() of PACKET_RX_RING */
 #include <features.h>    /* for the glibc version number */
 #if __GLIBC__ >= 2 && __GLIBC_MINOR__ >= 1
-#include <netpacket/packet.h>
+#include <linux/if_packet.h>  /* (instead of <netpacket/packet.h> for TPACKET_V3) */
 #include <net/ethernet.h>     /* the L2 protocols */
 #else
 #include <asm/types.h>
@@ -18,6 +19,9 @@
 
 /** This implementation of ProtoCap uses the
  *  PF_PACKET socket type available on Linux systems
+ *  Optionally, a TPACKET_V3 memory-mapped receive ring 
+ *  (PACKET_RX_RING) may be used to avoid the per-frame 
+ *  recvfrom() system call and copy
  */
 
 class LinuxCap : public ProtoCap
@@ -31,6 +35,30 @@ class LinuxCap : public ProtoCap
         bool Send(const char* buffer, unsigned int& numBytes);
         bool Recv(char* buffer, unsigned int& numBytes, Direction* direction = NULL);
         
+        bool SetRxRing(unsigned int blockSize, unsigned int frameCount, unsigned int retireTimeout);
+        bool RecvFrame(const char*& frame, unsigned int& numBytes, Direction* direction = NULL);
+        bool GetStatistics(unsigned int& packetCount, unsigned int& dropCount);
+        
+    private:
+        bool OpenRxRing();
+        void CloseRxRing();
+        
+        // Nominal frame size used to compute the ring block count
+        // (TPACKET_V3 frames are variable length, packed into blocks)
+        enum {RX_RING_FRAME_SIZE = 2048};
+        
+        unsigned int    ring_block_size;     // zero if ring not used
+        unsigned int    ring_frame_count;
+        unsigned int    ring_retire_timeout; // msec
+        char*           rx_ring;
+        unsigned int    ring_block_count;
+        unsigned int    ring_block_index;    // current block
+        bool            ring_block_held;     // true when current block is ours
+        unsigned int    ring_frames_left;    // in current block
+        char*           ring_frame;          // next frame in current block
+        unsigned int    stats_packets;       // cumulative PACKET_STATISTICS
+        unsigned int    stats_drops;
+        
 };  // end class LinuxCap
 
 ProtoCap* ProtoCap::Create()
@@ -39,6 +67,9 @@ ProtoCap* ProtoCap::Create()
 }  // end ProtoCap::Create()
 
 LinuxCap::LinuxCap()
+ : ring_block_size(0), ring_frame_count(0), ring_retire_timeout(0), 
+   rx_ring(NULL), ring_block_count(0), ring_block_index(0), ring_block_held(false),
+   ring_frames_left(0), ring_frame(NULL), stats_packets(0), stats_drops(0)
 {
 }
 
@@ -114,6 +145,15 @@ bool LinuxCap::Open(const char* interfaceName)
     memcpy(ifaceAddr.sll_addr, if_addr.GetRawHostAddress(), 6);
     ifaceAddr.sll_halen = if_addr.GetLength();
     
+    // The receive ring (if used) is set up before bind() so no frames are
+    // delivered to the regular socket receive queue 
+    if ((0 != ring_block_size) && !OpenRxRing())
+    {
+        PLOG(PL_ERROR, "LinuxCap::Open() error: unable to set up receive ring\n");
+        Close();
+        return false;
+    }
+    
     // bind() the socket to the specified interface
     if (bind(descriptor, (struct sockaddr*)&ifaceAddr, sizeof(ifaceAddr)) < 0)
     {
@@ -136,13 +176,165 @@ bool LinuxCap::Open(const char* interfaceName)
 void LinuxCap::Close()
 {
     ProtoCap::Close();
+    CloseRxRing();
     if (INVALID_HANDLE != descriptor)
     {
         close(descriptor);
         descriptor = INVALID_HANDLE; 
     }  
+    stats_packets = stats_drops = 0;
 }  // end LinuxCap::Close()
 
+bool LinuxCap::SetRxRing(unsigned int blockSize, unsigned int frameCount, unsigned int retireTimeout)
+{
+    if (IsOpen())
+    {
+        PLOG(PL_ERROR, "LinuxCap::SetRxRing() error: must be called before Open()\n");
+        return false;
+    }
+    // Block size must be a power-of-two multiple of the page size
+    // and hold at least one (nominal) frame
+    unsigned int pageSize = (unsigned int)sysconf(_SC_PAGESIZE);
+    if ((0 != blockSize) && 
+        ((blockSize < pageSize) || (blockSize < RX_RING_FRAME_SIZE) || (0 != (blockSize & (blockSize - 1)))))
+    {
+        PLOG(PL_ERROR, "LinuxCap::SetRxRing() error: invalid block size %u\n", blockSize);
+        return false;
+    }
+    ring_block_size = blockSize;  // zero disables ring usage
+    ring_frame_count = frameCount;
+    ring_retire_timeout = retireTimeout;
+    return true;
+}  // end LinuxCap::SetRxRing()
+
+bool LinuxCap::OpenRxRing()
+{
+    int version = TPACKET_V3;
+    if (setsockopt(descriptor, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxCap::OpenRxRing() setsockopt(PACKET_VERSION) error: %s\n", GetErrorString());
+        return false;
+    }
+    unsigned int framesPerBlock = ring_block_size / RX_RING_FRAME_SIZE;
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = ring_block_size;
+    req.tp_block_nr = (ring_frame_count + framesPerBlock - 1) / framesPerBlock;
+    if (req.tp_block_nr < 2) req.tp_block_nr = 2;  // so one can fill while we read another
+    req.tp_frame_size = RX_RING_FRAME_SIZE;
+    req.tp_frame_nr = req.tp_block_nr * framesPerBlock;
+    req.tp_retire_blk_tov = ring_retire_timeout;
+    req.tp_feature_req_word = 0;
+    if (setsockopt(descriptor, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxCap::OpenRxRing() setsockopt(PACKET_RX_RING) error: %s\n", GetErrorString());
+        return false;
+    }
+    size_t ringSize = (size_t)req.tp_block_size * req.tp_block_nr;
+    void* ring = mmap(NULL, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, descriptor, 0);
+    if (MAP_FAILED == ring)
+    {
+        PLOG(PL_ERROR, "LinuxCap::OpenRxRing() mmap() error: %s\n", GetErrorString());
+        return false;
+    }
+    rx_ring = (char*)ring;
+    ring_block_count = req.tp_block_nr;
+    ring_block_index = 0;
+    ring_block_held = false;
+    ring_frames_left = 0;
+    ring_frame = NULL;
+    return true;
+}  // end LinuxCap::OpenRxRing()
+
+void LinuxCap::CloseRxRing()
+{
+    if (NULL != rx_ring)
+    {
+        munmap(rx_ring, (size_t)ring_block_size * ring_block_count);
+        rx_ring = NULL;
+        ring_block_count = 0;
+        ring_block_held = false;
+        ring_frames_left = 0;
+        ring_frame = NULL;
+    }
+}  // end LinuxCap::CloseRxRing()
+
+bool LinuxCap::RecvFrame(const char*& frame, unsigned int& numBytes, Direction* direction)
+{
+    frame = NULL;
+    numBytes = 0;
+    if (NULL == rx_ring)
+    {
+        PLOG(PL_ERROR, "LinuxCap::RecvFrame() error: receive ring not enabled\n");
+        return false;
+    }
+    for (;;)
+    {
+        char* blockPtr = rx_ring + ring_block_index*ring_block_size;
+        struct tpacket_block_desc* block = (struct tpacket_block_desc*)((void*)blockPtr);
+        if (!ring_block_held)
+        {
+            UINT32 status = __atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE);
+            if (0 == (status & TP_STATUS_USER)) return true;  // no more frames ready
+            if (0 != (status & TP_STATUS_LOSING))
+            {
+                // The ring overflowed, so update (and report) our drop count
+                unsigned int dropsPrev = stats_drops;
+                unsigned int packets, drops;
+                if (GetStatistics(packets, drops) && (drops != dropsPrev))
+                    PLOG(PL_WARN, "LinuxCap::RecvFrame() warning: receive ring dropped %u frames\n", drops - dropsPrev);
+            }
+            ring_block_held = true;
+            ring_frames_left = block->hdr.bh1.num_pkts;
+            ring_frame = blockPtr + block->hdr.bh1.offset_to_first_pkt;
+        }
+        if (0 != ring_frames_left)
+        {
+            struct tpacket3_hdr* hdr = (struct tpacket3_hdr*)((void*)ring_frame);
+            frame = ring_frame + hdr->tp_mac;
+            numBytes = hdr->tp_snaplen;
+            if (NULL != direction)
+            {
+                struct sockaddr_ll* pktAddr = 
+                    (struct sockaddr_ll*)((void*)(ring_frame + TPACKET_ALIGN(sizeof(struct tpacket3_hdr))));
+                if (pktAddr->sll_pkttype == PACKET_OUTGOING)
+                    *direction = OUTBOUND;
+                else 
+                    *direction = INBOUND;
+            }
+            ring_frame += hdr->tp_next_offset;
+            ring_frames_left--;
+            return true;
+        }
+        // We've consumed the current block, so return it to the
+        // kernel and move on to the next one
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        ring_block_held = false;
+        ring_frame = NULL;
+        ring_block_index = (ring_block_index + 1) % ring_block_count;
+    }
+}  // end LinuxCap::RecvFrame()
+
+bool LinuxCap::GetStatistics(unsigned int& packetCount, unsigned int& dropCount)
+{
+    // Note the kernel resets its PACKET_STATISTICS on each read,
+    // so we accumulate them here
+    // (tpacket_stats_v3 is a superset of tpacket_stats)
+    struct tpacket_stats_v3 stats;
+    memset(&stats, 0, sizeof(stats));
+    socklen_t len = (NULL != rx_ring) ? sizeof(struct tpacket_stats_v3) : sizeof(struct tpacket_stats);
+    if (getsockopt(descriptor, SOL_PACKET, PACKET_STATISTICS, &stats, &len) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxCap::GetStatistics() getsockopt(PACKET_STATISTICS) error: %s\n", GetErrorString());
+        return false;
+    }
+    stats_packets += stats.tp_packets;
+    stats_drops += stats.tp_drops;
+    packetCount = stats_packets;
+    dropCount = stats_drops;
+    return true;
+}  // end LinuxCap::GetStatistics()
+
 bool LinuxCap::Send(const char* buffer, unsigned int& numBytes)
 {
     // Make sure packet is a type that is OK for us to send
@@ -185,6 +377,21 @@ bool LinuxCap::Send(const char* buffer, unsigned int& numBytes)
 
 bool LinuxCap::Recv(char* buffer, unsigned int& numBytes, Direction* direction)
 {
+    if (NULL != rx_ring)
+    {
+        // Copy the next ring frame (if any) to the caller's buffer
+        const char* frame;
+        unsigned int frameLen;
+        if (!RecvFrame(frame, frameLen, direction))
+        {
+            numBytes = 0;
+            return false;
+        }
+        if (frameLen > numBytes) frameLen = numBytes;  // truncate
+        if (NULL != frame) memcpy(buffer, frame, frameLen);
+        numBytes = frameLen;
+        return true;
+    }
     struct sockaddr_ll pktAddr;
     socklen_t addrLen = sizeof(pktAddr);
     int result = recvfrom(descriptor, buffer, (size_t)numBytes, 0, 
@@ -10,14 +10,36 @@
 #include <linux/netfilter_ipv4.h>  // for NF_IP_LOCAL_OUT, etc
 #include <linux/netfilter_ipv6.h>  // for NF_IP6_LOCAL_OUT, etc
 #include <linux/netfilter.h>  // for NF_ACCEPT, etc
+#include <linux/netfilter/nf_tables.h>  // for nftables netlink messages
 #include <libnetfilter_queue/libnetfilter_queue.h>
+#include <linux/netlink.h>
 
 #include <fcntl.h>  // for fcntl(), etc
+#include <poll.h>   // for poll()
 #include <linux/if_ether.h>  // for ETH_P_IP
 #include <net/if_arp.h>   // for ARPHRD_ETHER
 
 #include <linux/version.h>  // for LINUX_VERSION_CODE
 
+// (These may be missing from older libnfnetlink headers)
+#ifndef NFNL_SUBSYS_NFTABLES
+#define NFNL_SUBSYS_NFTABLES 10
+#endif // !NFNL_SUBSYS_NFTABLES
+#ifndef NFNL_MSG_BATCH_BEGIN
+#define NFNL_MSG_BATCH_BEGIN NLMSG_MIN_TYPE
+#define NFNL_MSG_BATCH_END (NLMSG_MIN_TYPE + 1)
+#endif // !NFNL_MSG_BATCH_BEGIN
+// (NFT_TABLE_F_OWNER is an enum value, added along with NFT_TABLE_F_MASK in Linux 5.12)
+#ifndef NFT_TABLE_F_MASK
+#define NFT_TABLE_F_OWNER 0x2
+#endif // !NFT_TABLE_F_MASK
+#ifndef SOL_NETLINK
+#define SOL_NETLINK 270
+#endif // !SOL_NETLINK
+#ifndef NETLINK_CAP_ACK
+#define NETLINK_CAP_ACK 10
+#endif // !NETLINK_CAP_ACK
+
 /** NOTES: 
  *
  * 1) This newer implementation of LinuxDetour uses netfilter_queue
@@ -31,6 +53,24 @@
  *    the application-provided "buffer" as we could with the prior 
  *    "ip_queue" implementation. (Yuck! - but, oh well)
  *
+ * 3) When SetQueueCount() is used, the firewall rules use the NFQUEUE
+ *    "--queue-balance" option to spread packets (by flow hash) across
+ *    a range of queues, each serviced by its own LinuxDetour instance
+ *    (see OpenQueueDetour()).  In this mode, verdicts for unmodified,
+ *    allowed packets are batched (nfq_set_verdict_batch()) only while
+ *    more input is queued, the queues are configured to "fail open"
+ *    and pass GSO packets unsegmented, and the netlink receive buffer 
+ *    is enlarged to absorb bursts.
+ *
+ * 4) The firewall rules are installed in a detour-owned nftables table
+ *    using a single netlink batch (i.e., atomically) and removed by
+ *    deleting that table.  When supported (Linux 5.12 or later), the
+ *    table is also bound to our netlink socket so that the kernel
+ *    removes it if the process exits without closing the detour.
+ *    The "iptables" (or "ip6tables") command is used if nftables is
+ *    not available or the "PROTO_NFQ_IPTABLES" environment variable
+ *    is set.
+ *
  */
 
 class LinuxDetour : public ProtoDetour
@@ -58,6 +98,9 @@ class LinuxDetour : public ProtoDetour
         bool Inject(const char* buffer, unsigned int numBytes);
         
         virtual bool SetMulticastInterface(const char* interfaceName);
+        
+        bool SetQueueCount(unsigned int queueCount);
+        ProtoDetour* OpenQueueDetour(unsigned int queueIndex);
                     
     private:
         enum Action
@@ -69,6 +112,10 @@ class LinuxDetour : public ProtoDetour
         // Simple has used to randomize pid into base nfq_num    
         UINT32 JenkinsHash(UINT32 value);  
         
+        bool OpenRawSocket();
+        bool OpenQueue(int addrFamily);
+        bool FlushVerdicts();
+        
         bool SetIPTables(UINT16              nfqNum,
                          Action              action,
                          int                 hookFlags ,
@@ -78,6 +125,49 @@ class LinuxDetour : public ProtoDetour
                          unsigned int        dstFilterMask,
                          int                 dscpValue);
         
+        // nftables netlink rule installation
+        bool SetNfTables(UINT16              nfqNum,
+                         Action              action,
+                         int                 hookFlags ,
+                         const ProtoAddress& srcFilterAddr, 
+                         unsigned int        srcFilterMask,
+                         const ProtoAddress& dstFilterAddr,
+                         unsigned int        dstFilterMask,
+                         int                 dscpValue);
+        bool NftOpen();
+        void NftClose();
+        bool NftInstall(UINT8               family,
+                        bool                tableOwner,
+                        int                 hookFlags,
+                        const ProtoAddress& srcFilterAddr, 
+                        unsigned int        srcFilterMask,
+                        const ProtoAddress& dstFilterAddr,
+                        unsigned int        dstFilterMask,
+                        int                 dscpValue,
+                        int&                error);
+        bool NftDelete(UINT8 family, int& error);
+        bool NftCommit(int& error);
+        void NftBeginMsg(UINT16 type, UINT16 flags, UINT8 family);
+        void NftEndMsg();
+        void NftAddAttr(UINT16 type, const void* data, unsigned int len);
+        void NftAddAttrU32(UINT16 type, UINT32 value)  // (in network byte order)
+        {
+            value = htonl(value);
+            NftAddAttr(type, &value, sizeof(UINT32));
+        }
+        void NftAddAttrU16(UINT16 type, UINT16 value)
+        {
+            value = htons(value);
+            NftAddAttr(type, &value, sizeof(UINT16));
+        }
+        void NftAddAttrString(UINT16 type, const char* text)
+            {NftAddAttr(type, text, strlen(text) + 1);}
+        struct nlattr* NftBeginNest(UINT16 type);
+        void NftEndNest(struct nlattr* nest);
+        void NftAddPayloadMatch(UINT32 offset, UINT32 len, const UINT8* value, const UINT8* mask);
+        void NftAddAddrMatch(const ProtoAddress& addr, unsigned int maskLen, bool source);
+        void NftAddQueue(UINT16 queueNum, UINT16 queueTotal);
+        
         int                     raw_fd;  // for packet injection
         int                     hook_flags;
         ProtoAddress            src_filter_addr;
@@ -87,6 +177,11 @@ class LinuxDetour : public ProtoDetour
         int                     dscp_value;
         
         enum {NFQ_BUFFER_SIZE = 8192};
+        // These are used for the multi-queue mode
+        enum {NFQ_GSO_BUFFER_SIZE = 65536 + 4096};   // for GSO packets plus netlink overhead
+        enum {NFQ_QUEUE_MAXLEN = 4096};              // kernel queue length (default is 1024)
+        enum {NFQ_RCVBUF_SIZE = 8*1024*1024};        // netlink socket receive buffer
+        enum {NFQ_VERDICT_BATCH_MAX = 64};
         
         static int NfqCallback(nfq_q_handle*       nfqQueue, 
                                struct nfgenmsg*    nfqMsg,
@@ -98,18 +193,38 @@ class LinuxDetour : public ProtoDetour
         // process id otherwise
         static bool             nfq_num_init;
         static UINT16           nfq_num_next;  //   
-             
+        static bool             nft_disabled;  // set by "PROTO_NFQ_IPTABLES"
+        
         struct nfq_handle*      nfq_handle;
         struct nfq_q_handle*    nfq_queue;
         UINT16                  nfq_num;  // based on pid
+        unsigned int            nfq_count;  // non-zero for multi-queue mode
+        char*                   nfq_buffer;
+        unsigned int            nfq_buffer_size;
         
         // The NfqCallback() fills these in on a per-packet basis
         UINT32                  nfq_pkt_id;
         char*                   nfq_pkt_data;
         unsigned int            nfq_pkt_len;
+        unsigned int            nfq_pkt_copied;  // number of bytes copied by Recv()
         Direction               nfq_direction;
         ProtoAddress            nfq_src_macaddr;
         unsigned int            nfq_ifindex;
+        
+        // Pending batched NF_ACCEPT verdict state (multi-queue mode)
+        UINT32                  nfq_batch_id;     // highest pending packet id
+        unsigned int            nfq_batch_count;  
+        
+        // nftables netlink state (nft_fd is valid when our rules are in nftables)
+        enum {NFT_BUFFER_SIZE = 8192};
+        int                     nft_fd;
+        UINT32                  nft_seq;
+        char                    nft_table[32];
+        UINT32                  nft_buffer[NFT_BUFFER_SIZE/4];  // (UINT32 for alignment)
+        unsigned int            nft_len;
+        struct nlmsghdr*        nft_msg;    // message being built
+        unsigned int            nft_last;   // offset of last message in batch
+        bool                    nft_overflow;
             
 };  // end class LinuxDetour
     
@@ -120,12 +235,15 @@ ProtoDetour* ProtoDetour::Create()
 
 bool LinuxDetour::nfq_num_init = true;
 UINT16 LinuxDetour::nfq_num_next = 0;
+bool LinuxDetour::nft_disabled = false;
 
 LinuxDetour::LinuxDetour()
  : raw_fd(-1), hook_flags(0), dscp_value(-1), 
-   nfq_handle(NULL), nfq_queue(NULL),
-   nfq_pkt_id(0), nfq_pkt_data(NULL), nfq_pkt_len(0),
-   nfq_direction(UNSPECIFIED), nfq_ifindex(0)
+   nfq_handle(NULL), nfq_queue(NULL), nfq_num(0), nfq_count(0),
+   nfq_buffer(NULL), nfq_buffer_size(0),
+   nfq_pkt_id(0), nfq_pkt_data(NULL), nfq_pkt_len(0), nfq_pkt_copied(0),
+   nfq_direction(UNSPECIFIED), nfq_ifindex(0), nfq_batch_id(0), nfq_batch_count(0),
+   nft_fd(-1), nft_seq(0), nft_len(0), nft_msg(NULL), nft_last(0), nft_overflow(false)
    
 {
     if (nfq_num_init)
@@ -135,8 +253,10 @@ LinuxDetour::LinuxDetour()
             nfq_num_next = (UINT16)atoi(cp);
         else
             nfq_num_next = (UINT16)JenkinsHash(getpid());  // TBD - implement a semaphore for this?
+        nft_disabled = (NULL != getenv("PROTO_NFQ_IPTABLES"));
         nfq_num_init = false;
     }
+    nft_table[0] = '\0';
 }
 
 LinuxDetour::~LinuxDetour()
@@ -217,7 +337,11 @@ bool LinuxDetour::SetIPTables(UINT16              nfqNum,
         // cmd  = "iptables" or "ip6tables"
         // mode = "-I" or "-D"
         // target = "INPUT", "OUTPUT", or "FORWARD"
-        sprintf(rule, "%s %s %s -j NFQUEUE --queue-num %hu ", cmd, mode, target, nfqNum);
+        if (nfq_count > 1)
+            sprintf(rule, "%s %s %s -j NFQUEUE --queue-balance %hu:%u ", 
+                    cmd, mode, target, nfqNum, nfqNum + nfq_count - 1);
+        else
+            sprintf(rule, "%s %s %s -j NFQUEUE --queue-num %hu ", cmd, mode, target, nfqNum);
         if (0 != srcFilterMask)
         {
             strcat(rule, "-s ");
@@ -284,6 +408,424 @@ bool LinuxDetour::SetIPTables(UINT16              nfqNum,
     return true;
 }  // end LinuxDetour::SetIPTables()
 
+bool LinuxDetour::NftOpen()
+{
+    NftClose();
+    if ((nft_fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_NETFILTER)) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxDetour::NftOpen() socket(NETLINK_NETFILTER) error: %s\n", GetErrorString());
+        return false;
+    }
+    struct sockaddr_nl localAddr;
+    memset(&localAddr, 0, sizeof(localAddr));
+    localAddr.nl_family = AF_NETLINK;
+    if (bind(nft_fd, (struct sockaddr*)&localAddr, sizeof(localAddr)) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxDetour::NftOpen() bind() error: %s\n", GetErrorString());
+        NftClose();
+        return false;
+    }
+    // Don't wait forever for a response
+    struct timeval timeout;
+    timeout.tv_sec = 5;
+    timeout.tv_usec = 0;
+    if (setsockopt(nft_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0)
+        PLOG(PL_WARN, "LinuxDetour::NftOpen() setsockopt(SO_RCVTIMEO) warning: %s\n", GetErrorString());
+    // Don't echo the failed request in error acks (NftCommit() sizes 
+    // its receive buffer to allow for that on kernels before 4.3, too)
+    int enable = 1;
+    if (setsockopt(nft_fd, SOL_NETLINK, NETLINK_CAP_ACK, &enable, sizeof(enable)) < 0)
+        PLOG(PL_DEBUG, "LinuxDetour::NftOpen() setsockopt(NETLINK_CAP_ACK) warning: %s\n", GetErrorString());
+    return true;
+}  // end LinuxDetour::NftOpen()
+
+void LinuxDetour::NftClose()
+{
+    // (the kernel deletes an "owned" table when its socket is closed)
+    if (nft_fd >= 0)
+    {
+        close(nft_fd);
+        nft_fd = -1;
+    }
+}  // end LinuxDetour::NftClose()
+
+bool LinuxDetour::SetNfTables(UINT16              nfqNum,
+                              Action              action,
+                              int                 hookFlags ,
+                              const ProtoAddress& srcFilterAddr, 
+                              unsigned int        srcFilterMask,
+                              const ProtoAddress& dstFilterAddr,
+                              unsigned int        dstFilterMask,
+                              int                 dscpValue)
+{
+    UINT8 family;
+    if (srcFilterAddr.GetType() != dstFilterAddr.GetType())
+    {
+        PLOG(PL_ERROR, "LinuxDetour::SetNfTables() error: inconsistent src/dst filter addr families\n");
+        return false;
+    }
+    else if (ProtoAddress::IPv4 == srcFilterAddr.GetType())
+    {
+        family = NFPROTO_IPV4;
+    }
+    else if (ProtoAddress::IPv6 == srcFilterAddr.GetType())
+    {
+        family = NFPROTO_IPV6;
+    }
+    else
+    {
+        PLOG(PL_ERROR, "LinuxDetour::SetNfTables() error: unspecified filter addr family\n");
+        return false;
+    }
+    int error;
+    if (DELETE == action)
+    {
+        // Deleting our table removes all of its chains and rules
+        if (!NftDelete(family, error))
+        {
+            PLOG(PL_ERROR, "LinuxDetour::SetNfTables() error deleting table \"%s\": %s\n", 
+                           nft_table, strerror(error));
+            return false;
+        }
+        return true;
+    }
+    sprintf(nft_table, "protodetour%hu", nfqNum);
+    bool tableOwner = true;
+    for (int attempt = 0; attempt < 3; attempt++)
+    {
+        if (NftInstall(family, tableOwner, hookFlags, 
+                       srcFilterAddr, srcFilterMask,
+                       dstFilterAddr, dstFilterMask,
+                       dscpValue, error))
+        {
+            return true;
+        }
+        if (tableOwner && ((EOPNOTSUPP == error) || (EINVAL == error)))
+        {
+            // Older kernel without NFT_TABLE_F_OWNER support 
+            // (kernels before 5.12 reject unknown table flags with EINVAL)
+            tableOwner = false;
+        }
+        else if (EEXIST == error)
+        {
+            // Remove a stale table left by a prior instance using our queue number
+            PLOG(PL_WARN, "LinuxDetour::SetNfTables() warning: replacing existing table \"%s\"\n", nft_table);
+            if (!NftDelete(family, error)) break;
+        }
+        else
+        {
+            break;
+        }
+    }
+    // (a warning since Open() falls back to iptables)
+    PLOG(PL_WARN, "LinuxDetour::SetNfTables() warning: unable to install table \"%s\": %s\n", 
+                   nft_table, strerror(error));
+    return false;
+}  // end LinuxDetour::SetNfTables()
+
+bool LinuxDetour::NftInstall(UINT8               family,
+                             bool                tableOwner,
+                             int                 hookFlags,
+                             const ProtoAddress& srcFilterAddr, 
+                             unsigned int        srcFilterMask,
+                             const ProtoAddress& dstFilterAddr,
+                             unsigned int        dstFilterMask,
+                             int                 dscpValue,
+                             int&                error)
+{
+    // Build a batch that creates our table, a base chain for each
+    // hook (at the "mangle" priority like our iptables rules) and
+    // the rule that directs matching packets to our NFQUEUE(s)
+    nft_len = 0;
+    nft_overflow = false;
+    NftBeginMsg(NFNL_MSG_BATCH_BEGIN, 0, AF_UNSPEC);
+    NftEndMsg();
+    NftBeginMsg((NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_NEWTABLE, NLM_F_CREATE | NLM_F_EXCL, family);
+    NftAddAttrString(NFTA_TABLE_NAME, nft_table);
+    if (tableOwner) NftAddAttrU32(NFTA_TABLE_FLAGS, NFT_TABLE_F_OWNER);
+    NftEndMsg();
+    while (0 != hookFlags)
+    {
+        const char* chain;
+        UINT32 hook;
+        if (0 != (hookFlags & OUTPUT))
+        {
+            chain = "output";
+            hook = NF_INET_LOCAL_OUT;
+            hookFlags &= ~OUTPUT;
+        }
+        else if (0 != (hookFlags & INPUT))
+        {
+            chain = "prerouting";  // (as with our iptables PREROUTING rule)
+            hook = NF_INET_PRE_ROUTING;
+            hookFlags &= ~INPUT;
+        }
+        else if (0 != (hookFlags & FORWARD))
+        {
+            chain = "forward";
+            hook = NF_INET_FORWARD;
+            hookFlags &= ~FORWARD;
+        }
+        else
+        {
+            break;  // all flags have been processed
+        }
+        NftBeginMsg((NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_NEWCHAIN, NLM_F_CREATE, family);
+        NftAddAttrString(NFTA_CHAIN_TABLE, nft_table);
+        NftAddAttrString(NFTA_CHAIN_NAME, chain);
+        struct nlattr* nest = NftBeginNest(NFTA_CHAIN_HOOK);
+        NftAddAttrU32(NFTA_HOOK_HOOKNUM, hook);
+        NftAddAttrU32(NFTA_HOOK_PRIORITY, (UINT32)NF_IP_PRI_MANGLE);
+        NftEndNest(nest);
+        NftAddAttrU32(NFTA_CHAIN_POLICY, NF_ACCEPT);
+        NftAddAttrString(NFTA_CHAIN_TYPE, "filter");
+        NftEndMsg();
+        
+        NftBeginMsg((NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_NEWRULE, NLM_F_CREATE | NLM_F_APPEND, family);
+        NftAddAttrString(NFTA_RULE_TABLE, nft_table);
+        NftAddAttrString(NFTA_RULE_CHAIN, chain);
+        nest = NftBeginNest(NFTA_RULE_EXPRESSIONS);
+        if (0 != srcFilterMask) NftAddAddrMatch(srcFilterAddr, srcFilterMask, true);
+        if (0 != dstFilterMask) NftAddAddrMatch(dstFilterAddr, dstFilterMask, false);
+        if (dscpValue >= 0)
+        {
+            // DSCP is the upper 6 bits of the IPv4 TOS or IPv6 traffic class
+            if (NFPROTO_IPV4 == family)
+            {
+                UINT8 value = (UINT8)(dscpValue << 2);
+                UINT8 mask = 0xfc;
+                NftAddPayloadMatch(1, 1, &value, &mask);
+            }
+            else
+            {
+                UINT8 value[2] = {(UINT8)((dscpValue >> 2) & 0x0f), (UINT8)((dscpValue << 6) & 0xc0)};
+                UINT8 mask[2] = {0x0f, 0xc0};
+                NftAddPayloadMatch(0, 2, value, mask);
+            }
+        }
+        NftAddQueue(nfq_num, (nfq_count > 1) ? nfq_count : 1);
+        NftEndNest(nest);
+        NftEndMsg();
+    }
+    return NftCommit(error);
+}  // end LinuxDetour::NftInstall()
+
+bool LinuxDetour::NftDelete(UINT8 family, int& error)
+{
+    nft_len = 0;
+    nft_overflow = false;
+    NftBeginMsg(NFNL_MSG_BATCH_BEGIN, 0, AF_UNSPEC);
+    NftEndMsg();
+    NftBeginMsg((NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_DELTABLE, 0, family);
+    NftAddAttrString(NFTA_TABLE_NAME, nft_table);
+    NftEndMsg();
+    return NftCommit(error);
+}  // end LinuxDetour::NftDelete()
+
+// Sends the batch built in "nft_buffer" and checks the response
+bool LinuxDetour::NftCommit(int& error)
+{
+    error = 0;
+    // Request an acknowledgment for the last message, then end the batch
+    struct nlmsghdr* lastMsg = (struct nlmsghdr*)((char*)nft_buffer + nft_last);
+    lastMsg->nlmsg_flags |= NLM_F_ACK;
+    UINT32 ackSeq = lastMsg->nlmsg_seq;
+    UINT32 firstSeq = ((struct nlmsghdr*)nft_buffer)->nlmsg_seq;
+    NftBeginMsg(NFNL_MSG_BATCH_END, 0, AF_UNSPEC);
+    NftEndMsg();
+    if (nft_overflow)
+    {
+        PLOG(PL_ERROR, "LinuxDetour::NftCommit() error: batch buffer overflow\n");
+        error = ENOBUFS;
+        return false;
+    }
+    if (send(nft_fd, nft_buffer, nft_len, 0) < 0)
+    {
+        error = errno;
+        PLOG(PL_ERROR, "LinuxDetour::NftCommit() send() error: %s\n", GetErrorString());
+        return false;
+    }
+    // Any message error aborts the whole batch
+    while (1)
+    {
+        // (room for an error ack that echoes our largest request message)
+        UINT32 buffer[(NFT_BUFFER_SIZE + NLMSG_HDRLEN + sizeof(struct nlmsgerr)) / 4 + 1];
+        int msgLen = recv(nft_fd, buffer, sizeof(buffer), 0);
+        if (msgLen < 0)
+        {
+            if (EINTR == errno) continue;
+            error = errno;
+            PLOG(PL_ERROR, "LinuxDetour::NftCommit() recv() error: %s\n", GetErrorString());
+            return false;
+        }
+        struct nlmsghdr* msg = (struct nlmsghdr*)buffer;
+        for (; 0 != NLMSG_OK(msg, (unsigned int)msgLen); msg = NLMSG_NEXT(msg, msgLen))
+        {
+            if ((NLMSG_ERROR != msg->nlmsg_type) || 
+                (msg->nlmsg_seq < firstSeq) || (msg->nlmsg_seq > ackSeq))
+            {
+                continue;
+            }
+            struct nlmsgerr* errorMsg = (struct nlmsgerr*)NLMSG_DATA(msg);
+            if (0 != errorMsg->error)
+            {
+                error = -errorMsg->error;
+                return false;
+            }
+            else if (ackSeq == msg->nlmsg_seq)
+            {
+                return true;
+            }
+        }
+    }
+}  // end LinuxDetour::NftCommit()
+
+void LinuxDetour::NftBeginMsg(UINT16 type, UINT16 flags, UINT8 family)
+{
+    unsigned int hdrLen = NLMSG_LENGTH(sizeof(struct nfgenmsg));
+    if ((nft_len + hdrLen) > NFT_BUFFER_SIZE)
+    {
+        nft_overflow = true;
+        nft_msg = NULL;
+        return;
+    }
+    nft_msg = (struct nlmsghdr*)((char*)nft_buffer + nft_len);
+    memset(nft_msg, 0, hdrLen);
+    nft_msg->nlmsg_len = hdrLen;
+    nft_msg->nlmsg_type = type;
+    nft_msg->nlmsg_flags = NLM_F_REQUEST | flags;
+    nft_msg->nlmsg_seq = ++nft_seq;
+    struct nfgenmsg* nfMsg = (struct nfgenmsg*)NLMSG_DATA(nft_msg);
+    nfMsg->nfgen_family = family;
+    nfMsg->version = NFNETLINK_V0;
+    nfMsg->res_id = htons(NFNL_SUBSYS_NFTABLES);  // (only needed for batch begin/end)
+}  // end LinuxDetour::NftBeginMsg()
+
+void LinuxDetour::NftEndMsg()
+{
+    if (NULL == nft_msg) return;
+    nft_last = nft_len;
+    nft_len += NLMSG_ALIGN(nft_msg->nlmsg_len);
+    nft_msg = NULL;
+}  // end LinuxDetour::NftEndMsg()
+
+// Add an "attribute" to the netlink msg being built
+void LinuxDetour::NftAddAttr(UINT16 type, const void* data, unsigned int len)
+{
+    if (NULL == nft_msg) return;
+    unsigned int attrLen = NLA_HDRLEN + len;
+    if ((nft_len + NLMSG_ALIGN(nft_msg->nlmsg_len) + NLA_ALIGN(attrLen)) > NFT_BUFFER_SIZE)
+    {
+        nft_overflow = true;
+        return;
+    }
+    struct nlattr* attr = (struct nlattr*)((char*)nft_msg + NLMSG_ALIGN(nft_msg->nlmsg_len));
+    attr->nla_type = type;
+    attr->nla_len = attrLen;
+    if (0 != len) memcpy((char*)attr + NLA_HDRLEN, data, len);
+    memset((char*)attr + attrLen, 0, NLA_ALIGN(attrLen) - attrLen);
+    nft_msg->nlmsg_len = NLMSG_ALIGN(nft_msg->nlmsg_len) + NLA_ALIGN(attrLen);
+}  // end LinuxDetour::NftAddAttr()
+
+struct nlattr* LinuxDetour::NftBeginNest(UINT16 type)
+{
+    if (NULL == nft_msg) return NULL;
+    struct nlattr* nest = (struct nlattr*)((char*)nft_msg + NLMSG_ALIGN(nft_msg->nlmsg_len));
+    NftAddAttr(type | NLA_F_NESTED, NULL, 0);
+    return nft_overflow ? NULL : nest;
+}  // end LinuxDetour::NftBeginNest()
+
+void LinuxDetour::NftEndNest(struct nlattr* nest)
+{
+    if ((NULL == nft_msg) || (NULL == nest)) return;
+    nest->nla_len = (UINT16)(((char*)nft_msg + nft_msg->nlmsg_len) - (char*)nest);
+}  // end LinuxDetour::NftEndNest()
+
+// Adds "payload", "bitwise" (if "mask" is non-NULL) and "cmp" expressions to
+// match "len" bytes at "offset" in the network header to the given "value"
+void LinuxDetour::NftAddPayloadMatch(UINT32 offset, UINT32 len, const UINT8* value, const UINT8* mask)
+{
+    struct nlattr* elem = NftBeginNest(NFTA_LIST_ELEM);
+    NftAddAttrString(NFTA_EXPR_NAME, "payload");
+    struct nlattr* data = NftBeginNest(NFTA_EXPR_DATA);
+    NftAddAttrU32(NFTA_PAYLOAD_DREG, NFT_REG_1);
+    NftAddAttrU32(NFTA_PAYLOAD_BASE, NFT_PAYLOAD_NETWORK_HEADER);
+    NftAddAttrU32(NFTA_PAYLOAD_OFFSET, offset);
+    NftAddAttrU32(NFTA_PAYLOAD_LEN, len);
+    NftEndNest(data);
+    NftEndNest(elem);
+    
+    if (NULL != mask)
+    {
+        UINT8 zero[16];
+        memset(zero, 0, sizeof(zero));
+        elem = NftBeginNest(NFTA_LIST_ELEM);
+        NftAddAttrString(NFTA_EXPR_NAME, "bitwise");
+        data = NftBeginNest(NFTA_EXPR_DATA);
+        NftAddAttrU32(NFTA_BITWISE_SREG, NFT_REG_1);
+        NftAddAttrU32(NFTA_BITWISE_DREG, NFT_REG_1);
+        NftAddAttrU32(NFTA_BITWISE_LEN, len);
+        struct nlattr* nest = NftBeginNest(NFTA_BITWISE_MASK);
+        NftAddAttr(NFTA_DATA_VALUE, mask, len);
+        NftEndNest(nest);
+        nest = NftBeginNest(NFTA_BITWISE_XOR);
+        NftAddAttr(NFTA_DATA_VALUE, zero, len);
+        NftEndNest(nest);
+        NftEndNest(data);
+        NftEndNest(elem);
+    }
+    
+    elem = NftBeginNest(NFTA_LIST_ELEM);
+    NftAddAttrString(NFTA_EXPR_NAME, "cmp");
+    data = NftBeginNest(NFTA_EXPR_DATA);
+    NftAddAttrU32(NFTA_CMP_SREG, NFT_REG_1);
+    NftAddAttrU32(NFTA_CMP_OP, NFT_CMP_EQ);
+    struct nlattr* nest = NftBeginNest(NFTA_CMP_DATA);
+    NftAddAttr(NFTA_DATA_VALUE, value, len);
+    NftEndNest(nest);
+    NftEndNest(data);
+    NftEndNest(elem);
+}  // end LinuxDetour::NftAddPayloadMatch()
+
+void LinuxDetour::NftAddAddrMatch(const ProtoAddress& addr, unsigned int maskLen, bool source)
+{
+    UINT32 offset, len;
+    if (ProtoAddress::IPv4 == addr.GetType())
+    {
+        offset = source ? 12 : 16;
+        len = 4;
+    }
+    else
+    {
+        offset = source ? 8 : 24;
+        len = 16;
+    }
+    if (maskLen > (8*len)) maskLen = 8*len;
+    UINT8 value[16], mask[16];
+    const UINT8* ptr = (const UINT8*)addr.GetRawHostAddress();
+    for (unsigned int i = 0; i < len; i++)
+    {
+        unsigned int bits = (maskLen > 8*i) ? (maskLen - 8*i) : 0;
+        mask[i] = (bits >= 8) ? 0xff : (UINT8)(0xff << (8 - bits));
+        value[i] = ptr[i] & mask[i];
+    }
+    NftAddPayloadMatch(offset, len, value, (maskLen < 8*len) ? mask : NULL);
+}  // end LinuxDetour::NftAddAddrMatch()
+
+void LinuxDetour::NftAddQueue(UINT16 queueNum, UINT16 queueTotal)
+{
+    // (like the NFQUEUE "--queue-balance" option, packets are spread
+    //  across "queueTotal" queues by flow hash)
+    struct nlattr* elem = NftBeginNest(NFTA_LIST_ELEM);
+    NftAddAttrString(NFTA_EXPR_NAME, "queue");
+    struct nlattr* data = NftBeginNest(NFTA_EXPR_DATA);
+    NftAddAttrU16(NFTA_QUEUE_NUM, queueNum);
+    NftAddAttrU16(NFTA_QUEUE_TOTAL, queueTotal);
+    NftAddAttrU16(NFTA_QUEUE_FLAGS, 0);
+    NftEndNest(data);
+    NftEndNest(elem);
+}  // end LinuxDetour::NftAddQueue()
+
 bool LinuxDetour::Open(int                 hookFlags, 
                        const ProtoAddress& srcFilterAddr, 
                        unsigned int        srcFilterMask,
@@ -294,29 +836,9 @@ bool LinuxDetour::Open(int                 hookFlags,
     if (IsOpen()) Close();
     
     // 0) Open raw socket for optional packet injection use
-    //if (0 > (raw_fd = socket(domain, SOCK_RAW, IPPROTO_RAW)))
-    if (0 > (raw_fd = socket(AF_INET, SOCK_RAW, IPPROTO_RAW)))  // or can we IPv6 on an AF_INET/HDRINCL socket?
-    {
-        PLOG(PL_ERROR, "LinuxDetour::Open() socket(IPPROTO_RAW) error: %s\n", 
-                GetErrorString());
-        return false;
-    }
-    //if (AF_INET == domain)
+    if (!OpenRawSocket())
     {
-        // Note: no IP_HDRINCL for IPv6 raw sockets ?
-        int enable = 1;
-        if (setsockopt(raw_fd, IPPROTO_IP, IP_HDRINCL, &enable, sizeof(enable)))
-        {
-            PLOG(PL_ERROR, "LinuxDetour::Open() setsockopt(IP_HDRINCL) error: %s\n",
-                    GetErrorString());
-            Close();
-            return false;
-        }
-    }
-    // Set to non-blocking for our purposes (TBD) Add a SetBlocking() method    
-    if(-1 == fcntl(raw_fd, F_SETFL, fcntl(raw_fd, F_GETFL, 0) | O_NONBLOCK))
-    {
-        PLOG(PL_ERROR, "LinuxDetour::Open() fcntl(F_SETFL(O_NONBLOCK)) error: %s\n", GetErrorString());
+        PLOG(PL_ERROR, "LinuxDetour::Open() error: unable to open raw socket\n");
         Close();
         return false;
     }
@@ -382,6 +904,12 @@ bool LinuxDetour::Open(int                 hookFlags,
     }
     
     nfq_num = nfq_num_next++;    // TBD - is there a better way??
+    if (nfq_count > 1)
+    {
+        // Reserve a contiguous range of queue numbers 
+        if ((nfq_num + nfq_count - 1) > 0xffff) nfq_num = 0;
+        nfq_num_next = nfq_num + nfq_count;
+    }
     
     // Save parameters for firewall rule removal
     hook_flags = hookFlags;
@@ -390,13 +918,29 @@ bool LinuxDetour::Open(int                 hookFlags,
     dst_filter_addr = dstFilterAddr;
     dst_filter_mask = dstFilterMask;
     dscp_value = dscpValue;
-    // Set up iptables (or ip6tables) if non-zero "hookFlags" are provided
+    // Set up nftables (or iptables) if non-zero "hookFlags" are provided
     if (0 != hookFlags)
     {
-        if (!SetIPTables(nfq_num, INSTALL, hookFlags, 
-                         srcFilterAddr, srcFilterMask,
-                         dstFilterAddr, dstFilterMask,
-                         dscpValue))
+        bool installed = false;
+        if (!nft_disabled)
+        {
+            if (NftOpen() && SetNfTables(nfq_num, INSTALL, hookFlags, 
+                                         srcFilterAddr, srcFilterMask,
+                                         dstFilterAddr, dstFilterMask,
+                                         dscpValue))
+            {
+                installed = true;
+            }
+            else
+            {
+                PLOG(PL_INFO, "LinuxDetour::Open() nftables not available, using iptables\n");
+                NftClose();
+            }
+        }
+        if (!installed && !SetIPTables(nfq_num, INSTALL, hookFlags, 
+                                       srcFilterAddr, srcFilterMask,
+                                       dstFilterAddr, dstFilterMask,
+                                       dscpValue))
         {
             PLOG(PL_ERROR, "LinuxDetour::Open() error: couldn't install firewall rules\n");   
             Close();
@@ -404,12 +948,58 @@ bool LinuxDetour::Open(int                 hookFlags,
         }   
     }
     
+    if (!OpenQueue(addrFamily))
+    {
+        PLOG(PL_ERROR, "LinuxDetour::Open() error: unable to open netfilter queue\n");
+        Close();
+        return false;
+    }
+    
+    if (!ProtoDetour::Open())
+    {
+        PLOG(PL_ERROR, "LinuxDetour::Open() ProtoDetour::Open() error\n");
+        Close();
+        return false;   
+    }
+    return true;
+}  // end LinuxDetour::Open()  
+
+bool LinuxDetour::OpenRawSocket()
+{
+    //if (0 > (raw_fd = socket(domain, SOCK_RAW, IPPROTO_RAW)))
+    if (0 > (raw_fd = socket(AF_INET, SOCK_RAW, IPPROTO_RAW)))  // or can we IPv6 on an AF_INET/HDRINCL socket?
+    {
+        PLOG(PL_ERROR, "LinuxDetour::OpenRawSocket() socket(IPPROTO_RAW) error: %s\n", 
+                GetErrorString());
+        return false;
+    }
+    //if (AF_INET == domain)
+    {
+        // Note: no IP_HDRINCL for IPv6 raw sockets ?
+        int enable = 1;
+        if (setsockopt(raw_fd, IPPROTO_IP, IP_HDRINCL, &enable, sizeof(enable)))
+        {
+            PLOG(PL_ERROR, "LinuxDetour::OpenRawSocket() setsockopt(IP_HDRINCL) error: %s\n",
+                    GetErrorString());
+            return false;
+        }
+    }
+    // Set to non-blocking for our purposes (TBD) Add a SetBlocking() method    
+    if(-1 == fcntl(raw_fd, F_SETFL, fcntl(raw_fd, F_GETFL, 0) | O_NONBLOCK))
+    {
+        PLOG(PL_ERROR, "LinuxDetour::OpenRawSocket() fcntl(F_SETFL(O_NONBLOCK)) error: %s\n", GetErrorString());
+        return false;
+    }
+    return true;
+}  // end LinuxDetour::OpenRawSocket()
+
+bool LinuxDetour::OpenQueue(int addrFamily)
+{
     // The first three nfq calls here set up the nfq library
     // Open netfilter_queue handle
     if (NULL == (nfq_handle = nfq_open()))
     {
-        PLOG(PL_ERROR, "LinuxDetour::Open() nfq_open() error: %s\n", GetErrorString());   
-        Close();
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueue() nfq_open() error: %s\n", GetErrorString());   
         return false;
     }
     descriptor = nfq_fd(nfq_handle);
@@ -417,42 +1007,103 @@ bool LinuxDetour::Open(int                 hookFlags,
     // Not sure this step is necessary, but was in example code
     if (nfq_unbind_pf(nfq_handle, addrFamily) < 0)
     {
-        PLOG(PL_ERROR, "LinuxDetour::Open() warning: nfq_unbind_pf() error: %s\n", GetErrorString());   
-        //Close();
-        //return false;
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueue() warning: nfq_unbind_pf() error: %s\n", GetErrorString());   
     }
     // "bind" our nfq handle for the specified address family
     if (nfq_bind_pf(nfq_handle, addrFamily) < 0)
     {
-        PLOG(PL_ERROR, "LinuxDetour::Open() nfq_bind_pf() error: %s\n", GetErrorString());   
-        Close();
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueue() nfq_bind_pf() error: %s\n", GetErrorString());   
         return false;
     }
     
     // Next, set up an NFQ queue 
     if (NULL == (nfq_queue = nfq_create_queue(nfq_handle, nfq_num, NfqCallback, this)))
     {
-        PLOG(PL_ERROR, "LinuxDetour::Open() nfq_create_queue() error: %s\n", GetErrorString());   
-        Close();
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueue() nfq_create_queue() error: %s\n", GetErrorString());   
         return false;
     }
     
-    // Turn on packet copy mode
-    if (nfq_set_mode(nfq_queue, NFQNL_COPY_PACKET, NFQ_BUFFER_SIZE) < 0)
+    // Turn on packet copy mode (whole GSO packets are copied in multi-queue mode)
+    unsigned int copyRange = (0 != nfq_count) ? 0xffff : NFQ_BUFFER_SIZE;
+    if (nfq_set_mode(nfq_queue, NFQNL_COPY_PACKET, copyRange) < 0)
     {
-        PLOG(PL_ERROR, "LinuxDetour::Open() nfq_set_mode() error: %s\n", GetErrorString());   
-        Close();
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueue() nfq_set_mode() error: %s\n", GetErrorString());   
         return false;
     }
     
-    if (!ProtoDetour::Open())
+    nfq_buffer_size = NFQ_BUFFER_SIZE;
+    if (0 != nfq_count)
     {
-        PLOG(PL_ERROR, "LinuxDetour::Open() ProtoDetour::Open() error\n");
-        Close();
-        return false;   
+        nfq_buffer_size = NFQ_GSO_BUFFER_SIZE;
+        if (nfq_set_queue_maxlen(nfq_queue, NFQ_QUEUE_MAXLEN) < 0)
+            PLOG(PL_WARN, "LinuxDetour::OpenQueue() warning: nfq_set_queue_maxlen() error: %s\n", GetErrorString());
+        // Accept (instead of drop) packets when our queue is full and get
+        // GSO packets without segmentation (these flags need Linux 3.6 or later)
+        UINT32 flags = NFQA_CFG_F_FAIL_OPEN | NFQA_CFG_F_GSO;
+        if (nfq_set_queue_flags(nfq_queue, flags, flags) < 0)
+            PLOG(PL_WARN, "LinuxDetour::OpenQueue() warning: nfq_set_queue_flags() error: %s\n", GetErrorString());
+        // Size the netlink receive buffer to absorb bursts
+        unsigned int rcvbuf = nfnl_rcvbufsiz(nfq_nfnlh(nfq_handle), NFQ_RCVBUF_SIZE);
+        if (rcvbuf < NFQ_RCVBUF_SIZE)
+            PLOG(PL_WARN, "LinuxDetour::OpenQueue() warning: netlink receive buffer limited to %u bytes\n", rcvbuf);
+    }
+    if (NULL == (nfq_buffer = new char[nfq_buffer_size]))
+    {
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueue() new nfq_buffer error: %s\n", GetErrorString());
+        return false;
     }
     return true;
-}  // end LinuxDetour::Open()  
+}  // end LinuxDetour::OpenQueue()
+
+bool LinuxDetour::SetQueueCount(unsigned int queueCount)
+{
+    if (IsOpen())
+    {
+        PLOG(PL_ERROR, "LinuxDetour::SetQueueCount() error: must be called before Open()\n");
+        return false;
+    }
+    if (queueCount > 0xffff)
+    {
+        PLOG(PL_ERROR, "LinuxDetour::SetQueueCount() error: invalid queue count\n");
+        return false;
+    }
+    nfq_count = queueCount;  // (one enables the batched verdict mode for a single queue)
+    return true;
+}  // end LinuxDetour::SetQueueCount()
+
+ProtoDetour* LinuxDetour::OpenQueueDetour(unsigned int queueIndex)
+{
+    if (NULL == nfq_queue)
+    {
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueueDetour() error: not open\n");
+        return NULL;
+    }
+    if ((0 == queueIndex) || (queueIndex >= nfq_count))
+    {
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueueDetour() error: invalid queue index %u\n", queueIndex);
+        return NULL;
+    }
+    LinuxDetour* detour = new LinuxDetour();
+    if (NULL == detour)
+    {
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueueDetour() new LinuxDetour error: %s\n", GetErrorString());
+        return NULL;
+    }
+    // Our firewall rules direct packets to this queue, so it
+    // just needs to bind to it (its hook_flags remain zero)
+    detour->nfq_count = nfq_count;
+    detour->nfq_num = nfq_num + queueIndex;
+    detour->src_filter_addr = src_filter_addr;
+    detour->dst_filter_addr = dst_filter_addr;
+    int addrFamily = (ProtoAddress::IPv6 == src_filter_addr.GetType()) ? AF_INET6 : AF_INET;
+    if (!detour->OpenRawSocket() || !detour->OpenQueue(addrFamily) || !detour->ProtoDetour::Open())
+    {
+        PLOG(PL_ERROR, "LinuxDetour::OpenQueueDetour() error: unable to open queue %hu\n", detour->nfq_num);
+        delete detour;
+        return NULL;
+    }
+    return detour;
+}  // end LinuxDetour::OpenQueueDetour()
 
 void LinuxDetour::Close()
 {
@@ -463,11 +1114,17 @@ void LinuxDetour::Close()
     }
     if (0 != hook_flags)
     {
-        SetIPTables(nfq_num, DELETE, hook_flags,
-                    src_filter_addr, src_filter_mask,
-                    dst_filter_addr, dst_filter_mask, dscp_value);
+        if (nft_fd >= 0)
+            SetNfTables(nfq_num, DELETE, hook_flags,
+                        src_filter_addr, src_filter_mask,
+                        dst_filter_addr, dst_filter_mask, dscp_value);
+        else
+            SetIPTables(nfq_num, DELETE, hook_flags,
+                        src_filter_addr, src_filter_mask,
+                        dst_filter_addr, dst_filter_mask, dscp_value);
         hook_flags = 0;   
     }
+    NftClose();
     if (descriptor >= 0)
     {
         ProtoDetour::Close();
@@ -476,6 +1133,7 @@ void LinuxDetour::Close()
     
     if (NULL != nfq_queue)
     {
+        FlushVerdicts();  // else the kernel drops them
         nfq_destroy_queue(nfq_queue);
         nfq_queue = NULL;
     }
@@ -485,6 +1143,13 @@ void LinuxDetour::Close()
         nfq_close(nfq_handle);
         nfq_handle = NULL;
     }
+    if (NULL != nfq_buffer)
+    {
+        delete[] nfq_buffer;
+        nfq_buffer = NULL;
+    }
+    nfq_pkt_data = NULL;
+    nfq_batch_count = 0;
     
 }  // end LinuxDetour::Close()
 
@@ -499,15 +1164,30 @@ bool LinuxDetour::Recv(char*            buffer,
         PLOG(PL_ERROR, "LinuxDetour::Recv() error: existing packet pending allow/drop!\n");
         return false;
     }
-    char nfqBuffer[NFQ_BUFFER_SIZE];
-    int result = recv(descriptor, nfqBuffer, NFQ_BUFFER_SIZE, 0);
+    // With verdicts pending, we check for more input without blocking
+    // and issue the pending verdicts when the input is drained
+    int flags = (0 != nfq_batch_count) ? MSG_DONTWAIT : 0;
+    int result = recv(descriptor, nfq_buffer, nfq_buffer_size, flags);
+    if ((result < 0) && (0 != nfq_batch_count) && ((EAGAIN == errno) || (EWOULDBLOCK == errno)))
+    {
+        FlushVerdicts();
+        if (NULL == GetNotifier())
+            result = recv(descriptor, nfq_buffer, nfq_buffer_size, 0);  // blocking
+        else
+            errno = EAGAIN;
+    }
     if (result < 0)
     {
         numBytes = 0;
         if (NULL != direction) *direction = UNSPECIFIED;
         if (NULL != srcMac) srcMac->Invalidate();
         if (NULL != ifIndex) *ifIndex = 0;
-        if ((EAGAIN != errno) && (EINTR != errno))
+        if (ENOBUFS == errno)
+        {
+            // Netlink receive buffer overflow (packets were dropped)
+            PLOG(PL_WARN, "LinuxDetour::Recv() warning: netlink receive buffer overflow\n");
+        }
+        else if ((EAGAIN != errno) && (EINTR != errno))
         {   
             PLOG(PL_ERROR, "LinuxDetour::Recv() recv() error: %s\n", GetErrorString());
             return false;   
@@ -517,16 +1197,14 @@ bool LinuxDetour::Recv(char*            buffer,
     {
         // This will invoke our "nfq_callback" which sets a pointer to
         // the packet data "nfq_pkt_data" and the "nfq_pkt_len" value
-        nfq_handle_packet(nfq_handle, nfqBuffer, result);
+        nfq_handle_packet(nfq_handle, nfq_buffer, result);
         if (NULL != nfq_pkt_data)
         {
             if (NULL != direction) *direction = nfq_direction;
             if (NULL != srcMac) *srcMac = nfq_src_macaddr;
             if (NULL != ifIndex) *ifIndex = nfq_ifindex;
-            if (numBytes < nfq_pkt_len)
-                memcpy(buffer, nfq_pkt_data, numBytes);
-            else
-                memcpy(buffer, nfq_pkt_data, nfq_pkt_len);
+            nfq_pkt_copied = (numBytes < nfq_pkt_len) ? numBytes : nfq_pkt_len;
+            memcpy(buffer, nfq_pkt_data, nfq_pkt_copied);
             numBytes = nfq_pkt_len;
         }
         else
@@ -618,6 +1296,26 @@ bool LinuxDetour::Allow(const char* buffer, unsigned int numBytes)
         PLOG(PL_ERROR, "LinuxDetour::Allow() error: no pending packet\n");
         return false;
     }
+    if ((0 != nfq_count) && (numBytes == nfq_pkt_len) && 
+        (0 == memcmp(buffer, nfq_pkt_data, nfq_pkt_copied)))
+    {
+        // Unmodified packet, so its NF_ACCEPT verdict is batched.  The batch
+        // is only held while more input is already queued (so that the
+        // notifier, or a caller draining Recv(), comes back for it), else 
+        // the last packets of a burst would wait on further traffic.
+        nfq_batch_id = nfq_pkt_id;
+        nfq_batch_count++;
+        nfq_pkt_data = NULL; 
+        struct pollfd pfd;
+        pfd.fd = descriptor;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if ((nfq_batch_count >= NFQ_VERDICT_BATCH_MAX) || (poll(&pfd, 1, 0) <= 0))
+            return FlushVerdicts();
+        return true;
+    }
+    // Issue pending verdicts first to preserve packet order
+    FlushVerdicts();
     if (0 > nfq_set_verdict(nfq_queue, nfq_pkt_id, NF_ACCEPT, numBytes, (unsigned char*)buffer))
     {
         PLOG(PL_ERROR, "LinuxDetour::Allow() nfq_set_verdict() error: %s\n",
@@ -628,6 +1326,20 @@ bool LinuxDetour::Allow(const char* buffer, unsigned int numBytes)
     return true;
 }  // end LinuxDetour::Allow()
 
+bool LinuxDetour::FlushVerdicts()
+{
+    if (0 == nfq_batch_count) return true;
+    // This accepts all pending packets with ids up to "nfq_batch_id"
+    nfq_batch_count = 0;
+    if (0 > nfq_set_verdict_batch(nfq_queue, nfq_batch_id, NF_ACCEPT))
+    {
+        PLOG(PL_ERROR, "LinuxDetour::FlushVerdicts() nfq_set_verdict_batch() error: %s\n",
+                        GetErrorString());
+        return false;
+    }
+    return true;
+}  // end LinuxDetour::FlushVerdicts()
+
 bool LinuxDetour::Drop()
 {
     if (NULL == nfq_queue)
@@ -0,0 +1,742 @@
+#include "protoCap.h"
+#include "protoDebug.h"
+#include "protoSocket.h"
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/if_xdp.h>
+#include <linux/if_link.h>  /* for XDP_FLAGS_* */
+#include <linux/bpf.h>
+#include <net/ethernet.h>
+#include <stddef.h>  /* for offsetof() */
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif // !AF_XDP
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif // !SOL_XDP
+
+/** This implementation of ProtoCap uses the Linux AF_XDP
+ *  socket type (Linux 5.9 or later).  A small XDP program
+ *  is attached to the interface to redirect frames arriving
+ *  on the selected receive queue (see SetRxQueue()) to our
+ *  socket, bypassing the kernel network stack.  Note this
+ *  means that, unlike LinuxCap, captured frames are _not_
+ *  also delivered to the host and only INBOUND frames are
+ *  captured.  The XDP program is detached when closed.
+ *
+ *  Frames are received into (and sent from) a "UMEM" area
+ *  shared with the kernel using the fill, completion, RX
+ *  and TX descriptor rings.  The driver zero-copy mode is
+ *  used if supported, else the kernel copy mode is used.
+ *  RecvFrame() gives direct access to received frames and
+ *  Send() (thus Forward()) of a frame just received via
+ *  RecvFrame() queues it for transmission without copying.
+ *  Other frames are copied into a free UMEM frame.
+ *
+ *  SetRxRing() may be used before Open() to set the UMEM
+ *  frame size ("blockSize") and count ("frameCount")
+ */
+
+class LinuxXdpCap : public ProtoCap
+{
+    public:
+        LinuxXdpCap();
+        ~LinuxXdpCap();
+
+        bool Open(const char* interfaceName = NULL);
+        void Close();
+        bool Send(const char* buffer, unsigned int& numBytes);
+        bool SendBatch(const char* const* frameArray, const unsigned int* numBytesArray, unsigned int& count);
+        bool Recv(char* buffer, unsigned int& numBytes, Direction* direction = NULL);
+
+        bool SetRxRing(unsigned int blockSize, unsigned int frameCount, unsigned int retireTimeout);
+        bool SetRxQueue(unsigned int queueId);
+        bool RecvFrame(const char*& frame, unsigned int& numBytes, Direction* direction = NULL);
+        bool GetStatistics(unsigned int& packetCount, unsigned int& dropCount);
+
+        bool IsZeroCopy() const
+            {return zero_copy;}
+
+    private:
+        // Descriptor ring as mapped from the kernel
+        class Ring
+        {
+            public:
+                Ring();
+                bool Map(int fd, off_t offset, const struct xdp_ring_offset& off,
+                         unsigned int ringSize, size_t descSize);
+                void Unmap();
+
+                __u32 GetProducer() const
+                    {return __atomic_load_n(producer, __ATOMIC_ACQUIRE);}
+                __u32 GetConsumer() const
+                    {return __atomic_load_n(consumer, __ATOMIC_ACQUIRE);}
+                void SetProducer(__u32 value)
+                    {__atomic_store_n(producer, value, __ATOMIC_RELEASE);}
+                void SetConsumer(__u32 value)
+                    {__atomic_store_n(consumer, value, __ATOMIC_RELEASE);}
+                bool NeedWakeup() const
+                    {return (0 != (__atomic_load_n(flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP));}
+
+                __u64& Addr(__u32 index)
+                    {return ((__u64*)desc)[index & mask];}
+                struct xdp_desc& Desc(__u32 index)
+                    {return ((struct xdp_desc*)desc)[index & mask];}
+
+                unsigned int GetSize() const
+                    {return mask + 1;}
+
+            private:
+                void*       map;
+                size_t      map_len;
+                __u32*      producer;
+                __u32*      consumer;
+                __u32*      flags;
+                void*       desc;
+                __u32       mask;
+        };  // end class LinuxXdpCap::Ring
+
+        bool LoadProgram(int ifIndex);
+        void UnloadProgram();
+        void ReleaseRxBatch();
+        void RefillRing();
+        void ReapCompletions();
+        void KickTx();
+
+        char* GetFrame(__u64 addr) const
+            {return (umem_area + addr);}
+        __u64 GetFrameBase(__u64 addr) const
+            {return (addr & ~((__u64)frame_size - 1));}
+        void PushFrame(__u64 addr)
+            {free_frames[free_count++] = GetFrameBase(addr);}
+
+        enum {DEFAULT_FRAME_SIZE = 2048};
+        enum {DEFAULT_FRAME_COUNT = 4096};
+        enum {RX_BATCH_MAX = 64};
+
+        unsigned int    frame_size;
+        unsigned int    frame_count;
+        unsigned int    queue_id;
+        bool            zero_copy;
+        bool            need_wakeup;
+        char*           umem_area;
+        __u64*          free_frames;  // stack of unused UMEM frame addresses
+        unsigned int    free_count;
+        Ring            fill_ring;
+        Ring            comp_ring;
+        Ring            rx_ring;
+        Ring            tx_ring;
+        __u32           fill_prod;    // local (cached) ring indices
+        __u32           comp_cons;
+        __u32           rx_cons;
+        __u32           tx_prod;
+        unsigned int    tx_outstanding;
+        // Current batch of received frames (consumed via RecvFrame())
+        struct xdp_desc rx_batch[RX_BATCH_MAX];
+        bool            rx_lent[RX_BATCH_MAX];  // "true" if frame was handed to TX
+        unsigned int    rx_batch_count;
+        unsigned int    rx_batch_index;
+        // XDP program state
+        int             map_fd;
+        int             prog_fd;
+        int             link_fd;
+        unsigned int    stats_packets;
+
+};  // end class LinuxXdpCap
+
+ProtoCap* ProtoCap::Create()
+{
+    return static_cast<ProtoCap*>(new LinuxXdpCap());
+}  // end ProtoCap::Create()
+
+static int BpfCall(int cmd, union bpf_attr& attr)
+{
+    return (int)syscall(__NR_bpf, cmd, &attr, sizeof(attr));
+}  // end BpfCall()
+
+LinuxXdpCap::Ring::Ring()
+ : map(MAP_FAILED), map_len(0), producer(NULL), consumer(NULL),
+   flags(NULL), desc(NULL), mask(0)
+{
+}
+
+bool LinuxXdpCap::Ring::Map(int fd, off_t offset, const struct xdp_ring_offset& off,
+                            unsigned int ringSize, size_t descSize)
+{
+    map_len = off.desc + ringSize*descSize;
+    map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    if (MAP_FAILED == map)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Ring::Map() mmap() error: %s\n", GetErrorString());
+        return false;
+    }
+    producer = (__u32*)((char*)map + off.producer);
+    consumer = (__u32*)((char*)map + off.consumer);
+    flags = (__u32*)((char*)map + off.flags);
+    desc = (char*)map + off.desc;
+    mask = ringSize - 1;
+    return true;
+}  // end LinuxXdpCap::Ring::Map()
+
+void LinuxXdpCap::Ring::Unmap()
+{
+    if (MAP_FAILED != map)
+    {
+        munmap(map, map_len);
+        map = MAP_FAILED;
+        producer = consumer = flags = NULL;
+        desc = NULL;
+    }
+}  // end LinuxXdpCap::Ring::Unmap()
+
+LinuxXdpCap::LinuxXdpCap()
+ : frame_size(DEFAULT_FRAME_SIZE), frame_count(DEFAULT_FRAME_COUNT), queue_id(0),
+   zero_copy(false), need_wakeup(false), umem_area(NULL), free_frames(NULL), free_count(0),
+   fill_prod(0), comp_cons(0), rx_cons(0), tx_prod(0), tx_outstanding(0),
+   rx_batch_count(0), rx_batch_index(0), map_fd(-1), prog_fd(-1), link_fd(-1),
+   stats_packets(0)
+{
+}
+
+LinuxXdpCap::~LinuxXdpCap()
+{
+    Close();
+}
+
+bool LinuxXdpCap::SetRxRing(unsigned int blockSize, unsigned int frameCount, unsigned int /*retireTimeout*/)
+{
+    if (IsOpen())
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::SetRxRing() error: must be called before Open()\n");
+        return false;
+    }
+    // UMEM frames must be a power of two from 2048 up to the page size
+    // and the frame count a power of two (half are used for receive)
+    if (0 == blockSize) blockSize = DEFAULT_FRAME_SIZE;
+    if (0 == frameCount) frameCount = DEFAULT_FRAME_COUNT;
+    unsigned int pageSize = (unsigned int)sysconf(_SC_PAGESIZE);
+    if ((blockSize < 2048) || (blockSize > pageSize) || (0 != (blockSize & (blockSize - 1))))
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::SetRxRing() error: invalid frame size %u\n", blockSize);
+        return false;
+    }
+    if ((frameCount < 2*RX_BATCH_MAX) || (0 != (frameCount & (frameCount - 1))))
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::SetRxRing() error: invalid frame count %u\n", frameCount);
+        return false;
+    }
+    frame_size = blockSize;
+    frame_count = frameCount;
+    return true;
+}  // end LinuxXdpCap::SetRxRing()
+
+bool LinuxXdpCap::SetRxQueue(unsigned int queueId)
+{
+    if (IsOpen())
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::SetRxQueue() error: must be called before Open()\n");
+        return false;
+    }
+    queue_id = queueId;
+    return true;
+}  // end LinuxXdpCap::SetRxQueue()
+
+bool LinuxXdpCap::Open(const char* interfaceName)
+{
+    char buffer[256];
+    if (NULL == interfaceName)
+    {
+        // Try to determine a "default" interface
+        ProtoAddress localAddress;
+        if (!localAddress.ResolveLocalAddress())
+        {
+            PLOG(PL_ERROR, "LinuxXdpCap::Open() error: couldn't auto determine local interface\n");
+            return false;
+        }
+        if (!ProtoSocket::GetInterfaceName(localAddress, buffer, 256))
+        {
+            PLOG(PL_ERROR, "LinuxXdpCap::Open() error: couldn't determine local interface name\n");
+            return false;
+        }
+        interfaceName = buffer;
+    }
+    int ifIndex = ProtoSocket::GetInterfaceIndex(interfaceName);
+    if (0 == ifIndex)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() error getting interface index\n");
+        return false;
+    }
+    if (!ProtoSocket::GetInterfaceAddress(interfaceName, ProtoAddress::ETH, if_addr))
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() error getting interface MAC address\n");
+        return false;
+    }
+
+    if ((descriptor = socket(AF_XDP, SOCK_RAW, 0)) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() socket(AF_XDP) error: %s\n", GetErrorString());
+        return false;
+    }
+
+    // Allocate and register our UMEM area
+    size_t umemSize = (size_t)frame_size * frame_count;
+    void* umem = mmap(NULL, umemSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (MAP_FAILED == umem)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() mmap(umem) error: %s\n", GetErrorString());
+        Close();
+        return false;
+    }
+    umem_area = (char*)umem;
+    struct xdp_umem_reg umemReg;
+    memset(&umemReg, 0, sizeof(umemReg));
+    umemReg.addr = (__u64)(unsigned long)umem_area;
+    umemReg.len = umemSize;
+    umemReg.chunk_size = frame_size;
+    umemReg.headroom = 0;
+    if (setsockopt(descriptor, SOL_XDP, XDP_UMEM_REG, &umemReg, sizeof(umemReg)) < 0)
+    {
+        // (note UMEM is charged to RLIMIT_MEMLOCK without CAP_IPC_LOCK)
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() setsockopt(XDP_UMEM_REG) error: %s\n", GetErrorString());
+        Close();
+        return false;
+    }
+
+    // Set the ring sizes (half the frames for receive, half for transmit)
+    unsigned int ringSize = frame_count / 2;
+    if ((setsockopt(descriptor, SOL_XDP, XDP_UMEM_FILL_RING, &ringSize, sizeof(ringSize)) < 0) ||
+        (setsockopt(descriptor, SOL_XDP, XDP_UMEM_COMPLETION_RING, &ringSize, sizeof(ringSize)) < 0) ||
+        (setsockopt(descriptor, SOL_XDP, XDP_RX_RING, &ringSize, sizeof(ringSize)) < 0) ||
+        (setsockopt(descriptor, SOL_XDP, XDP_TX_RING, &ringSize, sizeof(ringSize)) < 0))
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() setsockopt(ring size) error: %s\n", GetErrorString());
+        Close();
+        return false;
+    }
+    struct xdp_mmap_offsets off;
+    socklen_t optLen = sizeof(off);
+    if (getsockopt(descriptor, SOL_XDP, XDP_MMAP_OFFSETS, &off, &optLen) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() getsockopt(XDP_MMAP_OFFSETS) error: %s\n", GetErrorString());
+        Close();
+        return false;
+    }
+    if (!fill_ring.Map(descriptor, XDP_UMEM_PGOFF_FILL_RING, off.fr, ringSize, sizeof(__u64)) ||
+        !comp_ring.Map(descriptor, XDP_UMEM_PGOFF_COMPLETION_RING, off.cr, ringSize, sizeof(__u64)) ||
+        !rx_ring.Map(descriptor, XDP_PGOFF_RX_RING, off.rx, ringSize, sizeof(struct xdp_desc)) ||
+        !tx_ring.Map(descriptor, XDP_PGOFF_TX_RING, off.tx, ringSize, sizeof(struct xdp_desc)))
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() error: unable to map rings\n");
+        Close();
+        return false;
+    }
+    fill_prod = fill_ring.GetProducer();
+    comp_cons = comp_ring.GetConsumer();
+    rx_cons = rx_ring.GetConsumer();
+    tx_prod = tx_ring.GetProducer();
+
+    // Initially, all frames are free and the fill ring is loaded with as many as it holds
+    if (NULL == (free_frames = new __u64[frame_count]))
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() new free_frames error: %s\n", GetErrorString());
+        Close();
+        return false;
+    }
+    free_count = 0;
+    for (unsigned int i = frame_count; i > 0; i--)
+        PushFrame((__u64)(i - 1) * frame_size);
+    RefillRing();
+
+    // bind() to the interface queue, trying zero-copy mode first
+    struct sockaddr_xdp xdpAddr;
+    memset(&xdpAddr, 0, sizeof(xdpAddr));
+    xdpAddr.sxdp_family = AF_XDP;
+    xdpAddr.sxdp_ifindex = ifIndex;
+    xdpAddr.sxdp_queue_id = queue_id;
+    xdpAddr.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+    if (bind(descriptor, (struct sockaddr*)&xdpAddr, sizeof(xdpAddr)) < 0)
+    {
+        PLOG(PL_DEBUG, "LinuxXdpCap::Open() zero-copy bind() error: %s (using copy mode)\n", GetErrorString());
+        xdpAddr.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+        if (bind(descriptor, (struct sockaddr*)&xdpAddr, sizeof(xdpAddr)) < 0)
+        {
+            PLOG(PL_ERROR, "LinuxXdpCap::Open() bind() error: %s\n", GetErrorString());
+            Close();
+            return false;
+        }
+        zero_copy = false;
+    }
+    else
+    {
+        zero_copy = true;
+    }
+    need_wakeup = true;
+
+    if (!LoadProgram(ifIndex))
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() error: unable to attach XDP program\n");
+        Close();
+        return false;
+    }
+
+    // Explicitly call ProtoCap::Open so that ProtoChannel stuff is properly set up
+    if (!ProtoCap::Open(interfaceName))
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::Open() ProtoCap::Open() error\n");
+        Close();
+        return false;
+    }
+    if_index = ifIndex;
+    PLOG(PL_INFO, "LinuxXdpCap::Open() interface %s queue %u opened in %s mode\n",
+         interfaceName, queue_id, zero_copy ? "zero-copy" : "copy");
+    return true;
+}  // end LinuxXdpCap::Open()
+
+void LinuxXdpCap::Close()
+{
+    ProtoCap::Close();
+    UnloadProgram();
+    if (INVALID_HANDLE != descriptor)
+    {
+        close(descriptor);
+        descriptor = INVALID_HANDLE;
+    }
+    fill_ring.Unmap();
+    comp_ring.Unmap();
+    rx_ring.Unmap();
+    tx_ring.Unmap();
+    if (NULL != umem_area)
+    {
+        munmap(umem_area, (size_t)frame_size * frame_count);
+        umem_area = NULL;
+    }
+    if (NULL != free_frames)
+    {
+        delete[] free_frames;
+        free_frames = NULL;
+    }
+    free_count = 0;
+    tx_outstanding = 0;
+    rx_batch_count = rx_batch_index = 0;
+    zero_copy = need_wakeup = false;
+    stats_packets = 0;
+}  // end LinuxXdpCap::Close()
+
+// Loads and attaches an XDP program equivalent to:
+//
+//    return bpf_redirect_map(&xsks_map, ctx->rx_queue_index, XDP_PASS);
+//
+// so frames on queues without a socket still go to the network stack.
+bool LinuxXdpCap::LoadProgram(int ifIndex)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = BPF_MAP_TYPE_XSKMAP;
+    attr.key_size = sizeof(__u32);
+    attr.value_size = sizeof(__u32);
+    attr.max_entries = queue_id + 1;
+    if ((map_fd = BpfCall(BPF_MAP_CREATE, attr)) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::LoadProgram() bpf(BPF_MAP_CREATE) error: %s\n", GetErrorString());
+        return false;
+    }
+    __u32 key = queue_id;
+    __u32 value = descriptor;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = map_fd;
+    attr.key = (__u64)(unsigned long)&key;
+    attr.value = (__u64)(unsigned long)&value;
+    attr.flags = BPF_ANY;
+    if (BpfCall(BPF_MAP_UPDATE_ELEM, attr) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::LoadProgram() bpf(BPF_MAP_UPDATE_ELEM) error: %s\n", GetErrorString());
+        return false;
+    }
+
+    struct bpf_insn prog[6];
+    memset(prog, 0, sizeof(prog));
+    // r2 = ctx->rx_queue_index
+    prog[0].code = BPF_LDX | BPF_MEM | BPF_W;
+    prog[0].dst_reg = BPF_REG_2;
+    prog[0].src_reg = BPF_REG_1;
+    prog[0].off = offsetof(struct xdp_md, rx_queue_index);
+    // r1 = xsks_map (64-bit immediate load spans two instructions)
+    prog[1].code = BPF_LD | BPF_DW | BPF_IMM;
+    prog[1].dst_reg = BPF_REG_1;
+    prog[1].src_reg = BPF_PSEUDO_MAP_FD;
+    prog[1].imm = map_fd;
+    // r3 = XDP_PASS
+    prog[3].code = BPF_ALU64 | BPF_MOV | BPF_K;
+    prog[3].dst_reg = BPF_REG_3;
+    prog[3].imm = XDP_PASS;
+    // r0 = bpf_redirect_map(r1, r2, r3)
+    prog[4].code = BPF_JMP | BPF_CALL;
+    prog[4].imm = BPF_FUNC_redirect_map;
+    // return r0
+    prog[5].code = BPF_JMP | BPF_EXIT;
+
+    static const char license[] = "BSD";
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = (__u64)(unsigned long)prog;
+    attr.insn_cnt = sizeof(prog) / sizeof(struct bpf_insn);
+    attr.license = (__u64)(unsigned long)license;
+    if ((prog_fd = BpfCall(BPF_PROG_LOAD, attr)) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::LoadProgram() bpf(BPF_PROG_LOAD) error: %s\n", GetErrorString());
+        return false;
+    }
+
+    // Attach via a BPF link (so it is detached when we close) trying
+    // native (driver) mode first, then generic (skb) mode
+    memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = prog_fd;
+    attr.link_create.target_ifindex = ifIndex;
+    attr.link_create.attach_type = BPF_XDP;
+    attr.link_create.flags = XDP_FLAGS_DRV_MODE;
+    if ((link_fd = BpfCall(BPF_LINK_CREATE, attr)) < 0)
+    {
+        PLOG(PL_DEBUG, "LinuxXdpCap::LoadProgram() native XDP attach error: %s (using generic mode)\n", GetErrorString());
+        attr.link_create.flags = XDP_FLAGS_SKB_MODE;
+        if ((link_fd = BpfCall(BPF_LINK_CREATE, attr)) < 0)
+        {
+            PLOG(PL_ERROR, "LinuxXdpCap::LoadProgram() bpf(BPF_LINK_CREATE) error: %s\n", GetErrorString());
+            return false;
+        }
+    }
+    return true;
+}  // end LinuxXdpCap::LoadProgram()
+
+void LinuxXdpCap::UnloadProgram()
+{
+    if (link_fd >= 0)
+    {
+        close(link_fd);
+        link_fd = -1;
+    }
+    if (prog_fd >= 0)
+    {
+        close(prog_fd);
+        prog_fd = -1;
+    }
+    if (map_fd >= 0)
+    {
+        close(map_fd);
+        map_fd = -1;
+    }
+}  // end LinuxXdpCap::UnloadProgram()
+
+// Moves free frames to the fill ring for the kernel to receive into
+void LinuxXdpCap::RefillRing()
+{
+    __u32 space = fill_ring.GetSize() - (fill_prod - fill_ring.GetConsumer());
+    if (space > free_count) space = free_count;
+    if (0 == space) return;
+    for (__u32 i = 0; i < space; i++)
+        fill_ring.Addr(fill_prod++) = free_frames[--free_count];
+    fill_ring.SetProducer(fill_prod);
+}  // end LinuxXdpCap::RefillRing()
+
+// Frees frames whose transmission has completed
+void LinuxXdpCap::ReapCompletions()
+{
+    if (0 == tx_outstanding) return;
+    __u32 prod = comp_ring.GetProducer();
+    if (prod == comp_cons) return;
+    while (comp_cons != prod)
+    {
+        PushFrame(comp_ring.Addr(comp_cons++));
+        tx_outstanding--;
+    }
+    comp_ring.SetConsumer(comp_cons);
+}  // end LinuxXdpCap::ReapCompletions()
+
+// Frees the frames of the current receive batch (except those handed to TX)
+void LinuxXdpCap::ReleaseRxBatch()
+{
+    for (unsigned int i = 0; i < rx_batch_count; i++)
+    {
+        if (!rx_lent[i]) PushFrame(rx_batch[i].addr);
+    }
+    rx_batch_count = rx_batch_index = 0;
+}  // end LinuxXdpCap::ReleaseRxBatch()
+
+void LinuxXdpCap::KickTx()
+{
+    // In copy mode, or when the driver asks, a sendto() is needed to start transmission
+    if (zero_copy && need_wakeup && !tx_ring.NeedWakeup()) return;
+    if (sendto(descriptor, NULL, 0, MSG_DONTWAIT, NULL, 0) < 0)
+    {
+        switch (errno)
+        {
+            case EAGAIN:
+            case EBUSY:
+            case ENOBUFS:
+            case EINTR:
+                break;  // transmission will proceed on a later kick
+            default:
+                PLOG(PL_WARN, "LinuxXdpCap::KickTx() sendto() error: %s\n", GetErrorString());
+                break;
+        }
+    }
+}  // end LinuxXdpCap::KickTx()
+
+bool LinuxXdpCap::RecvFrame(const char*& frame, unsigned int& numBytes, Direction* direction)
+{
+    frame = NULL;
+    numBytes = 0;
+    if (NULL == umem_area)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::RecvFrame() error: not open\n");
+        return false;
+    }
+    if (rx_batch_index == rx_batch_count)
+    {
+        // Recycle frames of the previous batch and get the next batch
+        ReleaseRxBatch();
+        ReapCompletions();
+        RefillRing();
+        __u32 avail = rx_ring.GetProducer() - rx_cons;
+        if (0 == avail)
+        {
+            // Wake up the driver if it is waiting for fill ring frames
+            if (need_wakeup && fill_ring.NeedWakeup())
+                recvfrom(descriptor, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+            return true;
+        }
+        if (avail > RX_BATCH_MAX) avail = RX_BATCH_MAX;
+        for (__u32 i = 0; i < avail; i++)
+        {
+            rx_batch[i] = rx_ring.Desc(rx_cons++);
+            rx_lent[i] = false;
+        }
+        // The descriptors are copied, so the RX ring entries can be released
+        rx_ring.SetConsumer(rx_cons);
+        rx_batch_count = avail;
+        stats_packets += avail;
+    }
+    const struct xdp_desc& desc = rx_batch[rx_batch_index++];
+    frame = GetFrame(desc.addr);
+    numBytes = desc.len;
+    if (NULL != direction) *direction = INBOUND;
+    return true;
+}  // end LinuxXdpCap::RecvFrame()
+
+bool LinuxXdpCap::Recv(char* buffer, unsigned int& numBytes, Direction* direction)
+{
+    // Copy the next received frame (if any) to the caller's buffer
+    const char* frame;
+    unsigned int frameLen;
+    if (!RecvFrame(frame, frameLen, direction))
+    {
+        numBytes = 0;
+        return false;
+    }
+    if (frameLen > numBytes) frameLen = numBytes;  // truncate
+    if (NULL != frame) memcpy(buffer, frame, frameLen);
+    numBytes = frameLen;
+    return true;
+}  // end LinuxXdpCap::Recv()
+
+bool LinuxXdpCap::Send(const char* buffer, unsigned int& numBytes)
+{
+    unsigned int count = 1;
+    if (!SendBatch(&buffer, &numBytes, count) || (0 == count))
+    {
+        numBytes = 0;
+        return false;
+    }
+    return true;
+}  // end LinuxXdpCap::Send()
+
+bool LinuxXdpCap::SendBatch(const char* const* frameArray, const unsigned int* numBytesArray, unsigned int& count)
+{
+    if (NULL == umem_area)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::SendBatch() error: not open\n");
+        count = 0;
+        return false;
+    }
+    ReapCompletions();
+    __u32 space = tx_ring.GetSize() - (tx_prod - tx_ring.GetConsumer());
+    unsigned int sent = 0;
+    while ((sent < count) && (sent < space))
+    {
+        const char* frame = frameArray[sent];
+        unsigned int numBytes = numBytesArray[sent];
+        if (numBytes > frame_size)
+        {
+            PLOG(PL_WARN, "LinuxXdpCap::SendBatch() error: frame length %u exceeds UMEM frame size\n", numBytes);
+            break;
+        }
+        __u64 addr = 0;
+        bool lent = false;
+        if ((frame >= umem_area) && (frame < (umem_area + (size_t)frame_size*frame_count)))
+        {
+            // If it's a frame from the current receive batch, hand it
+            // directly to the TX ring instead of recycling it.
+            __u64 frameAddr = (__u64)(frame - umem_area);
+            __u64 frameBase = GetFrameBase(frameAddr);
+            for (unsigned int i = 0; i < rx_batch_count; i++)
+            {
+                if (!rx_lent[i] && (GetFrameBase(rx_batch[i].addr) == frameBase) &&
+                    ((frameAddr + numBytes) <= (frameBase + frame_size)))
+                {
+                    rx_lent[i] = lent = true;
+                    addr = frameAddr;
+                    break;
+                }
+            }
+        }
+        if (!lent)
+        {
+            // Copy into a free frame
+            if (0 == free_count)
+            {
+                PLOG(PL_DEBUG, "LinuxXdpCap::SendBatch() no free UMEM frames\n");
+                break;
+            }
+            addr = free_frames[--free_count];
+            memcpy(GetFrame(addr), frame, numBytes);
+        }
+        struct xdp_desc& desc = tx_ring.Desc(tx_prod++);
+        desc.addr = addr;
+        desc.len = numBytes;
+        desc.options = 0;
+        sent++;
+    }
+    if (0 != sent)
+    {
+        tx_ring.SetProducer(tx_prod);
+        tx_outstanding += sent;
+        KickTx();
+    }
+    else if (0 != count)
+    {
+        // TX ring full or no free frames, so kick to make progress
+        KickTx();
+    }
+    bool result = (0 != sent) || (0 == count);
+    count = sent;
+    return result;
+}  // end LinuxXdpCap::SendBatch()
+
+bool LinuxXdpCap::GetStatistics(unsigned int& packetCount, unsigned int& dropCount)
+{
+    // (XDP_STATISTICS counts are cumulative)
+    struct xdp_statistics stats;
+    memset(&stats, 0, sizeof(stats));
+    socklen_t len = sizeof(stats);
+    if (getsockopt(descriptor, SOL_XDP, XDP_STATISTICS, &stats, &len) < 0)
+    {
+        PLOG(PL_ERROR, "LinuxXdpCap::GetStatistics() getsockopt(XDP_STATISTICS) error: %s\n", GetErrorString());
+        return false;
+    }
+    packetCount = stats_packets;
+    dropCount = (unsigned int)(stats.rx_dropped + stats.rx_ring_full);
+    return true;
+}  // end LinuxXdpCap::GetStatistics()
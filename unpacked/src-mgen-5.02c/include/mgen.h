@@ -5,6 +5,12 @@
 #include "mgenFlow.h"
 #include "mgenGlobals.h"
 #include "mgenMsg.h"
+#include "mgenLogWriter.h"
+#include "mgenRecvStats.h"
+#include "mgenHash.h"
+#include "mgenLogMerger.h"
+
+class MgenWorker;
 
 class MgenController
 {
@@ -71,6 +77,10 @@ class DrecGroupList
         bool Activate(Mgen& mgen);
         bool IsActive() {return (NULL != flow_transport);}
         UINT16 GetPort() {return port;}
+        bool Matches(const ProtoAddress& groupAddr,
+                     const ProtoAddress& sourceAddr,
+                     const char*         interfaceName,
+                     UINT16              thePort);
         
       private:
         MgenTransport*          flow_transport;
@@ -90,9 +100,18 @@ class DrecGroupList
     
     void Append(DrecMgenTransport* item);
     void Remove(DrecMgenTransport* item);
+    static unsigned int MakeKey(char*               key,
+                                const ProtoAddress& groupAddr,
+                                const ProtoAddress& sourceAddr,
+                                const char*         interfaceName,
+                                UINT16              thePort);
+    
+    class GroupIndex : public MgenHashIndexTemplate<DrecMgenTransport> {};
     
     DrecMgenTransport* head;  
     DrecMgenTransport* tail;
+    GroupIndex         group_index;    // (group, source, interface, port)
+    unsigned int       wildcard_count; // items with no group (match any)
 };  // end class DrecGroupList
 
 /**
@@ -105,6 +124,9 @@ class Mgen
 {
   public:
     enum {SCRIPT_LINE_MAX = 8192};  // maximum script line length
+    enum {TX_BATCH_MAX = 64};       // maximum messages sent per flow timeout
+    enum {ZERO_COPY_MIN_DEFAULT = 16384};  // default ZEROCOPY message size threshold
+    enum {WORKER_MAX = 64};         // maximum WORKERS threads
     
     Mgen(ProtoTimerMgr&         timerMgr, 
          ProtoSocket::Notifier& socketNotifier);
@@ -143,7 +165,15 @@ class Mgen
       TXCHECKSUM,// include checksums in transmitted MGEN messages
       RXCHECKSUM,// force checksum validation at receiver _always_
       QUEUE,     // Turn off tx_timer when pending queue exceeds this limit
-      REUSE      // Toggle socket reuse on and off
+      REUSE,     // Toggle socket reuse on and off
+      TIMESTAMP, // Log kernel packet timestamps {on|hw|off}
+      TXBATCH,   // Max messages a late flow sends per timeout (burst catch-up)
+      ASYNCLOG,  // Write the log from a separate thread {on|drop|off}[,<kbytes>]
+      STATS,     // Per-flow receive statistics {<interval>|report|off}[,<statsFile>]
+      RXLOG,     // Log RECV events {on|off}
+      WORKERS,   // Shard flows across <count> sender threads
+      PACE,      // Precision flow pacing {off|spin|txtime|etf}[,<leadUsec>]
+      ZEROCOPY   // Zero copy (MSG_ZEROCOPY) send of large TCP messages {on|off}[,<minBytes>]
     };
     static Command GetCommandFromString(const char* string);
     enum CmdType {CMD_INVALID, CMD_ARG, CMD_NOARG};
@@ -169,6 +199,33 @@ class Mgen
     bool GetLogFlush() {return log_flush;}
     bool GetLogTx() {return log_tx;}
     bool GetReuse() {return reuse;}
+    bool GetTimestamp() {return timestamp;}
+    bool GetTimestampHw() {return timestamp_hw;}
+    unsigned int GetTxBatch() {return tx_batch;}
+    MgenPacer::Mode GetPaceMode() {return pace_mode;}
+    double GetPaceLead() {return pace_lead;}
+    // TCP messages at least this large are sent zero copy (0 = off)
+    unsigned int GetZeroCopyMin() {return zero_copy_min;}
+    bool GetLogRx() {return log_rx;}
+    // Returns NULL unless receive statistics are enabled
+    MgenRecvStats* GetRecvStats() {return (stats_enable ? &recv_stats : NULL);}
+    // Writes a receive statistics report to "path" if given,
+    // otherwise to the STATS output file (or text log, or stderr)
+    bool ReportStats(const char* path = NULL);
+    // Returns NULL unless asynchronous logging is active
+    MgenLogWriter* GetLogWriter() {return (log_writer.IsOpen() ? &log_writer : NULL);}
+    // START/STOP events (and the binary log header) are not logged
+    // when "logSession" is false (e.g. by MgenWorker instances)
+    void SetLogSession(bool logSession) {log_session = logSession;}
+    unsigned int GetWorkerCount() const {return worker_count;}
+    // MgenLogWriter::Option flags for the current log settings
+    int GetLogOptions()
+    {
+        return ((log_binary ? MgenLogWriter::BINARY : 0) |
+                (local_time ? MgenLogWriter::LOCAL_TIME : 0) |
+                (log_data ? MgenLogWriter::LOG_DATA : 0) |
+                (log_gps_data ? MgenLogWriter::LOG_GPS_DATA : 0));
+    }
     typedef int (*LogFunction)(FILE*, const char*, ...);
 #ifndef _WIN32_WCE
     static LogFunction Log;
@@ -179,15 +236,24 @@ class Mgen
 #endif  // if/else _WIN32_WCE
     
     bool ParseScript(const char* path);
+    // Loads a script precompiled by MgenBinaryScript::Compile()
+    // (ParseScript() detects these)
+    bool ParseBinaryScript(const char* path);
 #if OPNET  // JPH 11/16/2005
     bool ParseScript(List*);
 #endif  // OPNET
     bool ParseEvent(const char* lineBuffer, unsigned int lineCount);
+    // Adds a parsed event to its flow (or worker), taking ownership
+    // of "theEvent" (deleted on failure)
+    bool InsertMgenEvent(MgenEvent* theEvent, unsigned int lineCount);
     
     double GetCurrentOffset() const;
     bool GetOffsetPending() {return offset_pending;}
     
     void InsertDrecEvent(DrecEvent* event);
+    // Sorts (and validates) events loaded out of time order before
+    // start (done by Start(), so scripts load in O(N log N) time)
+    bool SortEvents();
 
     void SetDefaultSocketType(ProtoAddress::Type addrType) 
     {addr_type = addrType;}
@@ -264,6 +330,12 @@ class Mgen
                                      const char* theInterface);
 
     MgenTransport* FindMgenTransportBySocket(const ProtoSocket& socket);
+    static bool TransportMatches(MgenTransport*      transport,
+                                 Protocol            theProtocol,
+                                 UINT16              srcPort,
+                                 const ProtoAddress& dstAddress,
+                                 bool                closedOnly,
+                                 const char*         theInterface);
 
     MgenTransport* FindTransportByInterface(const char*           interfaceName,
                                             UINT16        thePort = 0,
@@ -392,6 +464,7 @@ class Mgen
     
     bool OnStartTimeout(ProtoTimer& theTimer);
     bool OnDrecEventTimeout(ProtoTimer& theTimer);
+    bool OnStatsTimeout(ProtoTimer& theTimer);
     void ProcessDrecEvent(const DrecEvent& event);
 
     // Common state
@@ -453,6 +526,7 @@ class Mgen
     ProtoTimer         drec_event_timer;
     MgenEventList      drec_event_list;
     DrecEvent*         next_drec_event;      // for iterating drec_event_list
+    bool               drec_unsorted;        // (see SortEvents())
     DrecGroupList      drec_group_list;
     ProtoAddress::Type addr_type;
     
@@ -472,6 +546,34 @@ class Mgen
     bool               log_open;
     bool               log_empty;
     bool               reuse;
+    bool               timestamp;     // enable kernel (SO_TIMESTAMPING) packet timestamps
+    bool               timestamp_hw;  // use NIC hardware timestamps
+    unsigned int       tx_batch;      // max messages per flow tx timeout (1 = no batching)
+    MgenPacer::Mode    pace_mode;     // flow pacing mode
+    double             pace_lead;     // paced flow timers fire this far ahead (seconds)
+    unsigned int       zero_copy_min; // min TCP message size sent zero copy (0 = off)
+    
+    void StartLogWriter();
+    MgenLogWriter      log_writer;
+    unsigned int       async_log_size;  // ring buffer bytes (0 = synchronous logging)
+    bool               async_log_drop;  // drop SEND/RECV records when ring is full
+    
+    bool               log_rx;          // log RECV events
+    bool               stats_enable;
+    MgenRecvStats      recv_stats;
+    ProtoTimer         stats_timer;     // periodic stats reports
+    FILE*              stats_file;      // stats report output (NULL = log file)
+    
+    // Multi-threaded ("WORKERS") mode: MGEN flows are sharded across
+    // the MgenWorker threads by flow id and their logs are merged
+    bool SetWorkerCount(unsigned int count);
+    void CopySettings(Mgen& worker) const;
+    static bool IsWorkerCommand(Command cmd);
+    void StartLogMerger();
+    MgenWorker**       worker_list;
+    unsigned int       worker_count;
+    MgenLogMerger      log_merger;
+    bool               log_session;     // log START/STOP events
     
 }; // end class Mgen 
 
@@ -3,6 +3,7 @@
 
 #include "mgenGlobals.h"
 #include "mgen.h"
+#include "mgenLogConverter.h"
 #include "mgenVersion.h"
 #include "protokit.h"
 
@@ -60,6 +61,10 @@ class MgenApp : public ProtoApp
         bool              have_ports;
         bool              convert;
         char              convert_path[PATH_MAX];
+        MgenLogConverter  log_converter;
+        bool              compile;
+        char              compile_path[PATH_MAX];   // text script
+        char              compile_bin_path[PATH_MAX];
         char              ifinfo_name[64];
         UINT32            ifinfo_tx_count;
         UINT32            ifinfo_rx_count;
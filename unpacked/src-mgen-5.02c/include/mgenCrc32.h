@@ -0,0 +1,52 @@
+#ifndef _MGEN_CRC32
+#define _MGEN_CRC32
+
+#include <protoDefs.h>  // for UINT8, UINT32
+
+/**
+ * @class MgenCrc32
+ *
+ * @brief CRC32 (reflected polynomial 0x04C11DB7) engine used for MGEN
+ * message checksums.  Update() advances a "raw" CRC32 register (i.e.,
+ * without the initial and final XOR values applied) and is dispatched at
+ * run time to the fastest engine the CPU supports.  All engines give the
+ * same results as the byte-wise MgenMsg::CRC32_TABLE computation.
+ */
+class MgenCrc32
+{
+  public:
+    enum Engine
+    {
+      TABLE,   // byte-at-a-time table lookup (reference)
+      SLICE8,  // portable slicing-by-8
+      PCLMUL,  // x86 carry-less multiply (PCLMULQDQ) folding
+      ARMV8    // ARMv8 CRC32 instructions
+    };
+
+    static UINT32 Update(UINT32 crc, const UINT8* buffer, UINT32 bufferLen)
+        {return update_func(crc, buffer, bufferLen);}
+
+    static Engine GetEngine() {return engine;}
+    // Returns false if "theEngine" is not supported on this system
+    static bool SetEngine(Engine theEngine);
+    static bool IsSupported(Engine theEngine);
+    static const char* GetEngineName(Engine theEngine);
+
+  private:
+    typedef UINT32 (*UpdateFunc)(UINT32 crc, const UINT8* buffer, UINT32 bufferLen);
+
+    static UINT32 UpdateTable(UINT32 crc, const UINT8* buffer, UINT32 bufferLen);
+    static UINT32 UpdateSlice8(UINT32 crc, const UINT8* buffer, UINT32 bufferLen);
+    static UINT32 UpdatePclmul(UINT32 crc, const UINT8* buffer, UINT32 bufferLen);
+    static UINT32 UpdateArmv8(UINT32 crc, const UINT8* buffer, UINT32 bufferLen);
+    // Selects the best engine on first use
+    static UINT32 UpdateInit(UINT32 crc, const UINT8* buffer, UINT32 bufferLen);
+    static void Init();  // builds the tables
+
+    static UpdateFunc   update_func;
+    static Engine       engine;
+    static UINT32       slice_table[8][256];
+
+};  // end class MgenCrc32
+
+#endif // _MGEN_CRC32
@@ -143,6 +143,10 @@ class MgenEvent : public MgenBaseEvent
 	~MgenEvent();
     
     bool InitFromString(const char* string);
+    // Packs/unpacks the event (time, type, flow id and the options
+    // set) for a binary script (see MgenBinaryScript)
+    bool Pack(MgenScriptRecord& record) const;
+    bool Unpack(MgenScriptRecord& record);
     
     unsigned int GetFlowId() const {return flow_id;}
 	void SetFlowId(unsigned int flowId) {flow_id = flowId;};
@@ -213,6 +217,11 @@ class MgenEventList
     ~MgenEventList();
     void Destroy();
     void Insert(MgenBaseEvent* theEvent);
+    // Appends "theEvent" regardless of its time (see Sort())
+    void Append(MgenBaseEvent* theEvent);
+    // Stable O(N log N) merge sort into time order, so a list of appended
+    // events ends up in the order Insert() would have given
+    bool Sort();
     void Remove(MgenBaseEvent* theEvent);
     // This places "theEvent" _before_ "nextEvent" in the list.
     // (If "nextEvent" is NULL, "theEvent" goes to the end of the list)
@@ -223,6 +232,11 @@ class MgenEventList
     const MgenBaseEvent* Tail() const {return tail;}
     
   private:
+    struct SortItem
+    {
+        double          time;
+        MgenBaseEvent*  event;
+    };
     MgenBaseEvent* head; 
     MgenBaseEvent* tail; 
 }; // end class MgenEventList 
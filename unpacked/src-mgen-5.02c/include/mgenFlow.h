@@ -3,6 +3,7 @@
 
 #include "mgenEvent.h"
 #include "mgenTransport.h"
+#include "mgenPacer.h"
 #include "gpsPub.h"
 #include "protokit.h"
 #include <stdio.h>  // for FILE
@@ -57,6 +58,8 @@ class MgenFlow
 	void SetMessageLimit(int messageLimit) {message_limit = messageLimit;}
 	bool UnlimitedRate() {return pattern.UnlimitedRate();}
     bool InsertEvent(MgenEvent* event, bool mgenStarted, double currentTime);
+    // Sorts and validates events inserted out of order before the flow started
+    bool SortEvents();
     bool ValidateEvent(const MgenEvent* event);
     bool Start(double offsetTime);
     bool Update(const MgenEvent* event);
@@ -78,7 +81,7 @@ class MgenFlow
 	void RestartTimer();
 	ProtoTimer& GetTxTimer() {return tx_timer;}
 	int QueueLimit() {return queue_limit;}
-	bool SendMessage();
+	bool SendMessage(const ProtoTime* launchTime = NULL);
 	MgenTransport* GetFlowTransport() {return flow_transport;}
     void SetFlowTransport(MgenTransport* theTransport) {flow_transport = theTransport;}
 	bool OffPending() {return off_pending;}
@@ -90,9 +93,17 @@ class MgenFlow
     MgenFlow* GetPendingPrev() {return pending_prev;}
     void AppendPendingPrev(MgenFlow* theFlow) {pending_prev = theFlow;}
     double GetPktInterval() {return pattern.GetPktInterval();}
+    // Realized schedule error stats of PACE'd messages
+    MgenPacer& AccessPacer() {return pacer;}
+    // Writes (and resets) the flow's PACE report, if it has one
+    void ReportPace();
 
   private:
 	bool GetNextInterval();
+    bool ScheduleNextInterval(double nextInterval);
+    void BuildMessage(MgenMsg& theMsg);
+    bool SendMessageBatch();
+    bool SendMessagePaced();
     bool OnEventTimeout(ProtoTimer& theTimer);	
 	bool                    off_pending;
     MgenTransport*          old_transport;
@@ -109,15 +120,20 @@ class MgenFlow
     UINT32                  flow_label;                  
     
     ProtoTimer              tx_timer;  
+    MgenMsgTemplate         msg_template;   // pre-packed message (rebuilt on ON/MOD)
 
     
     MgenTransport*          flow_transport;               
     UINT32                  seq_num;                     
 	int                     pending_messages;
     double                  last_interval;               
+    ProtoTime               tx_sched;       // scheduled time of next batched (or paced) message
+    double                  tx_sched_delay; // tx_timer interval set by SendMessageBatch()/SendMessagePaced()
+    MgenPacer               pacer;
     
     MgenEventList           event_list;                  
     MgenEvent*              next_event;                  
+    bool                    events_unsorted;  // (see SortEvents())
     ProtoTimer              event_timer;                 
     bool                    started;                     
     bool                    socket_error;
@@ -154,6 +170,7 @@ class MgenFlowList
     MgenFlow* FindFlowById(unsigned int flowId);
     bool IsEmpty() {return (NULL == head);}
     
+    bool SortEvents();
     bool Start(double offsetTime);
     
     double GetCurrentOffset() const;
@@ -161,8 +178,10 @@ class MgenFlowList
     void SetDefaultLabel(UINT32 label);
 	MgenFlow* Head() {return head;}
   private:
+    class FlowIndex : public MgenHashIndexTemplate<MgenFlow> {};
     MgenFlow* head; 
     MgenFlow* tail;  
+    FlowIndex flow_index;  // (flow id)
 }; // end class MgenFlowList 
 
 #endif  // _MGEN_FLOW
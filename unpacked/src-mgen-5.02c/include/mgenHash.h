@@ -0,0 +1,106 @@
+#ifndef _MGEN_HASH
+#define _MGEN_HASH
+
+#include "protokit.h"
+#include <string.h>  // for memcmp()
+
+/**
+ * @class MgenHashIndex
+ *
+ * @brief Chained hash table used to index items (transports, flows,
+ * group joins) that are otherwise kept on linked lists, so lookups do
+ * not have to scan the list.  Keys are short byte strings built by the
+ * owner of the index.  An item may be indexed more than once, and
+ * several items may share a key, in which case they are found most
+ * recently inserted first.  The table doubles in size as it fills.
+ */
+class MgenHashIndex
+{
+  public:
+    MgenHashIndex();
+    ~MgenHashIndex();
+
+    enum {KEY_MAX = 64};  // maximum key length (bytes)
+
+    bool Insert(const char* key, unsigned int keyLen, void* item);
+    // Removes the entry for "item" with the given key
+    bool Remove(const char* key, unsigned int keyLen, const void* item);
+    // Returns the most recently inserted item with the given key
+    void* Find(const char* key, unsigned int keyLen) const;
+    void Destroy();
+
+    unsigned int GetCount() const {return count;}
+
+  private:
+    class Entry
+    {
+      public:
+        char            key[KEY_MAX];
+        unsigned int    key_len;
+        UINT32          hash;
+        void*           item;
+        Entry*          next;
+    };
+
+  public:
+    // Iterates over the items with a given key
+    class Iterator
+    {
+      public:
+        Iterator(const MgenHashIndex& index, const char* key, unsigned int keyLen);
+        void* GetNextItem();
+
+      private:
+        const char*     key;
+        unsigned int    key_len;
+        UINT32          hash;
+        Entry*          next;
+    };  // end class MgenHashIndex::Iterator
+
+    friend class Iterator;
+
+  private:
+    static UINT32 Hash(const char* key, unsigned int keyLen);
+    static bool KeyIsEqual(const Entry* entry, const char* key, unsigned int keyLen, UINT32 hash)
+    {
+        return ((hash == entry->hash) && (keyLen == entry->key_len) &&
+                (0 == memcmp(key, entry->key, keyLen)));
+    }
+    bool Resize(unsigned int newSize);
+
+    enum {DEFAULT_SIZE = 64};  // (must be a power of two)
+
+    Entry**         table;
+    unsigned int    table_size;
+    unsigned int    count;
+
+};  // end class MgenHashIndex
+
+/**
+ * @class MgenHashIndexTemplate
+ *
+ * @brief Type-safe wrapper of MgenHashIndex for items of class ITEM
+ */
+template <class ITEM>
+class MgenHashIndexTemplate : public MgenHashIndex
+{
+  public:
+    bool Insert(const char* key, unsigned int keyLen, ITEM& item)
+        {return MgenHashIndex::Insert(key, keyLen, (void*)&item);}
+    bool Remove(const char* key, unsigned int keyLen, const ITEM& item)
+        {return MgenHashIndex::Remove(key, keyLen, (const void*)&item);}
+    ITEM* Find(const char* key, unsigned int keyLen) const
+        {return static_cast<ITEM*>(MgenHashIndex::Find(key, keyLen));}
+
+    class Iterator : public MgenHashIndex::Iterator
+    {
+      public:
+        Iterator(const MgenHashIndexTemplate& index, const char* key, unsigned int keyLen)
+         : MgenHashIndex::Iterator(index, key, keyLen) {}
+        ITEM* GetNextItem()
+            {return static_cast<ITEM*>(MgenHashIndex::Iterator::GetNextItem());}
+    };  // end class MgenHashIndexTemplate::Iterator
+
+};  // end class MgenHashIndexTemplate
+
+#endif // _MGEN_HASH
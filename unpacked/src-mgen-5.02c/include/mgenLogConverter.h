@@ -0,0 +1,120 @@
+#ifndef _MGEN_LOG_CONVERTER
+#define _MGEN_LOG_CONVERTER
+
+#include "mgenMsg.h"
+#include <stdio.h>
+
+// Chunks are formatted in parallel into open_memstream() buffers
+#if defined(LINUX) || defined(MACOSX)
+#define MGEN_PARALLEL_CONVERT
+#include <pthread.h>
+#endif // LINUX || MACOSX
+
+class Mgen;
+
+/**
+ * @class MgenLogConverter
+ *
+ * @brief Converts MGEN binary log files to the text log format.  The
+ * log file is memory-mapped and a first pass over the record headers
+ * splits it into chunks of whole records.  Worker threads format the
+ * chunks in parallel and the output is written in chunk order, so it
+ * is the same as converting the records one by one.  Conversion may
+ * optionally be limited to selected flows and/or event types.
+ */
+class MgenLogConverter
+{
+  public:
+    MgenLogConverter();
+    ~MgenLogConverter();
+
+    // Limits output to records of the listed flows (e.g. "1,3,10-20").
+    // Records without a flow id (START, LISTEN, etc) are then skipped.
+    bool SetFlowFilter(const char* flowList);
+    // Limits output to the listed event types (e.g. "RECV,SEND")
+    bool SetEventFilter(const char* eventList);
+    // Number of formatting threads (0 = one per CPU)
+    void SetThreadCount(unsigned int count) {thread_count = count;}
+
+    // Converts using the log file and settings of "mgen"
+    bool Convert(const char* path, Mgen& mgen);
+    bool Convert(const char*  path,
+                 FILE*        outFile,
+                 bool         localTime,
+                 bool         logData,
+                 bool         logGpsData,
+                 bool         flush);
+
+    // Formats one binary log record (the "recordLength" bytes after
+    // its 4 byte header) to "outFile".  Returns false for an invalid record.
+    static bool ConvertRecord(FILE*         outFile,
+                              LogEventType  eventType,
+                              Protocol      theProtocol,
+                              char*         buffer,
+                              UINT16        recordLength,
+                              bool          localTime,
+                              bool          logData,
+                              bool          logGpsData);
+
+    enum {BINARY_RECORD_MAX = 1024};  // maximum record size
+
+  private:
+    struct Chunk
+    {
+        size_t  start;      // file offset of first record header
+        size_t  end;        // file offset after last record
+        char*   text;       // formatted output
+        size_t  text_len;
+        bool    done;
+        bool    error;
+    };
+
+    struct FlowRange
+    {
+        UINT32  first;
+        UINT32  last;
+    };
+
+    bool RecordSelected(LogEventType        eventType,
+                        Protocol            theProtocol,
+                        const char*         buffer,
+                        UINT16              recordLength) const;
+    bool FlowSelected(UINT32 flowId) const;
+    // Converts the records of "chunk", returning false on error
+    bool ConvertChunk(FILE* outFile, const Chunk& chunk);
+    bool MapFile(const char* path);
+    void UnmapFile();
+    bool Index();
+
+    FlowRange*      flow_list;
+    unsigned int    flow_count;
+    UINT32          event_mask;     // bit per LogEventType (0 = all)
+    unsigned int    thread_count;
+
+    const char*     file_data;
+    size_t          file_size;
+    Chunk*          chunk_list;
+    unsigned int    chunk_count;
+    bool            index_error;    // invalid/truncated record after last chunk
+
+    bool            local_time;
+    bool            log_data;
+    bool            log_gps_data;
+
+#ifdef MGEN_PARALLEL_CONVERT
+    static void* DoThreadStart(void* arg);
+    void RunWorker();
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    unsigned int    next_chunk;     // next chunk for a worker to format
+    unsigned int    write_chunk;    // next chunk to be written
+    unsigned int    chunk_window;   // max chunks formatted ahead of writing
+    bool            abort;
+#endif // MGEN_PARALLEL_CONVERT
+#ifndef UNIX
+    char*           file_buffer;    // (file is read into memory)
+#endif // !UNIX
+
+};  // end class MgenLogConverter
+
+#endif // _MGEN_LOG_CONVERTER
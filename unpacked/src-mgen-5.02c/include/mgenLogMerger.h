@@ -0,0 +1,117 @@
+#ifndef _MGEN_LOG_MERGER
+#define _MGEN_LOG_MERGER
+
+#include "protokit.h"
+#include <stdio.h>
+
+// The merge thread needs pthreads and stdio "cookie" streams
+// (fopencookie() or funopen()) for each log source
+#if defined(LINUX) || defined(MACOSX)
+#define MGEN_LOG_MERGE
+#include <pthread.h>
+#endif // LINUX || MACOSX
+
+/**
+ * @class MgenLogMerger
+ *
+ * @brief Merges the log output of several Mgen instances (e.g. the
+ * worker threads of a multi-threaded MGEN) into one log file.  Each
+ * source writes to its own stream, which splits the output into log
+ * entries (text lines or binary log records) and queues them with
+ * their event time.  A merge thread writes the queued entries in time
+ * order.  An entry is held back until every open source has an entry
+ * queued, or until it has waited HOLDBACK_USEC, so that entries from
+ * sources logging at different rates are still interleaved in order.
+ */
+class MgenLogMerger
+{
+  public:
+    MgenLogMerger();
+    ~MgenLogMerger();
+
+    enum {HOLDBACK_USEC = 100000};
+
+    static bool IsSupported();
+
+    // Starts the merge thread for "logFile" and returns the stream that
+    // the primary source (the main Mgen) should log to (NULL on failure).
+    // Closing that stream writes all pending entries and then closes
+    // "logFile" (unless it is stdout or stderr).  Any other source
+    // streams still open are detached and their output is discarded.
+    FILE* Open(FILE* logFile, bool binary, bool flush);
+    // Returns the stream for an additional log source (NULL on failure)
+    FILE* OpenSource();
+    bool IsOpen() const {return (NULL != log_stream);}
+    FILE* GetFile() const {return log_file;}
+    void Close();
+    // "flush" makes the merge thread flush the log file after each batch
+    void SetFlush(bool flush) {log_flush = flush;}
+
+  private:
+    // Entries are an Entry header followed by "len" bytes of log output
+    struct Entry
+    {
+        double          time;       // event time (-1.0 = none)
+        double          arrival;    // time queued
+        unsigned int    len;
+        Entry*          next;
+    };
+
+    class Source
+    {
+      public:
+        Source(MgenLogMerger& theMerger, bool isPrimary);
+        ~Source();
+
+        MgenLogMerger&  merger;
+        FILE*           stream;
+        bool            primary;
+        bool            attached;   // (protected by merger "mutex")
+        bool            closed;     // (protected by merger "mutex")
+        bool            header;     // binary log header still expected
+        double          last_time;  // (protected by merger "mutex")
+        Entry*          head;       // (protected by merger "mutex")
+        Entry*          tail;
+        Source*         next;
+        // Output not yet split into entries (producer side only)
+        char*           partial;
+        unsigned int    partial_len;
+        unsigned int    partial_max;
+    };
+
+    FILE* OpenStream(Source* source);
+    // Splits buffered source output into entries (producer side)
+    Entry* Split(Source& source, bool final);
+    Entry* NewEntry(const char* data, unsigned int len, double theTime);
+    static double ParseTextTime(const char* text, unsigned int len);
+    static double GetTime();
+    // Queues entries, ordering text times across midnight (caller locks)
+    void Enqueue(Source& source, Entry* entryList);
+    void Run();
+
+    FILE*               log_file;       // the real log file
+    FILE*               log_stream;     // primary source stream
+    bool                log_binary;
+    volatile bool       log_flush;
+    Source*             source_list;    // (protected by "mutex")
+    double              ref_time;       // (protected by "mutex")
+
+#ifdef MGEN_LOG_MERGE
+    static void* DoThreadStart(void* arg);
+#ifdef LINUX
+    static ssize_t StreamWrite(void* cookie, const char* buffer, size_t size);
+    static int StreamClose(void* cookie);
+#else
+    static int StreamWrite(void* cookie, const char* buffer, int size);
+    static int StreamClose(void* cookie);
+#endif // if/else LINUX
+    pthread_t           thread_id;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      cond;
+    bool                merger_idle;    // (protected by "mutex")
+    bool                stopping;       // (protected by "mutex")
+#endif // MGEN_LOG_MERGE
+
+};  // end class MgenLogMerger
+
+#endif // _MGEN_LOG_MERGER
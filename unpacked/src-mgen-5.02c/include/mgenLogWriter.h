@@ -0,0 +1,189 @@
+#ifndef _MGEN_LOG_WRITER
+#define _MGEN_LOG_WRITER
+
+#include "mgenMsg.h"
+#include <stdio.h>
+
+// The writer thread needs pthreads and a stdio "cookie" stream
+// (fopencookie() or funopen()) to capture other log output
+#if defined(LINUX) || defined(MACOSX)
+#define MGEN_ASYNC_LOG
+#include <pthread.h>
+#endif // LINUX || MACOSX
+
+/**
+ * @class MgenLogWriter
+ *
+ * @brief Moves MGEN log file output off the dispatcher thread.  SEND
+ * and RECV events are captured as compact records (the message fields
+ * plus the bytes a binary log record needs) in a lock-free, single
+ * producer/single consumer ring buffer.  A writer thread rebuilds each
+ * message and writes it with the usual MgenMsg log methods in batches,
+ * so the log content is unchanged.  All other log output is written to
+ * the stream returned by Open() and passes through the ring as text, in
+ * order with the event records.
+ */
+class MgenLogWriter
+{
+  public:
+    MgenLogWriter();
+    ~MgenLogWriter();
+
+    enum
+    {
+        BUFFER_SIZE_MIN     = 65536,
+        BUFFER_SIZE_DEFAULT = 4194304
+    };
+
+    // Log option flags (as in the Mgen log settings)
+    enum Option
+    {
+        BINARY       = 0x01,
+        LOCAL_TIME   = 0x02,
+        LOG_DATA     = 0x04,
+        LOG_GPS_DATA = 0x08
+    };
+
+    static bool IsSupported();
+
+    // Starts the writer thread for "logFile" and returns the stream that
+    // log output should be written to (NULL on failure).  Closing that
+    // stream writes all pending records and then closes "logFile" (unless
+    // it is stdout or stderr).  When the ring is full, SEND/RECV records
+    // are dropped if "dropOnFull" is set, otherwise the caller waits for
+    // room (text output is never dropped).
+    FILE* Open(FILE* logFile, unsigned int bufferSize, bool dropOnFull, bool flush);
+    bool IsOpen() const {return (NULL != log_stream);}
+    FILE* GetFile() const {return log_file;}
+    void Close();
+    // Writes pending records and stops the writer thread, but leaves the
+    // log file open and returns it so logging may continue synchronously
+    FILE* Detach();
+    // Waits until all pending records are written and the log file flushed
+    void Sync();
+    // "flush" makes the writer thread flush the log file after each batch
+    void SetFlush(bool flush) {log_flush = flush;}
+
+    // These return false if the record was dropped
+    bool LogSendEvent(MgenMsg&              theMsg,
+                      int                   options,
+                      const char*           msgBuffer,
+                      const struct timeval& theTime,
+                      const struct timeval* txStamp);
+    bool LogRecvEvent(MgenMsg&              theMsg,
+                      int                   options,
+                      const char*           msgBuffer,
+                      const struct timeval& theTime,
+                      const struct timeval* rxStamp);
+
+    // Backpressure/drop accounting
+    unsigned long GetRecordCount() const {return record_count;}
+    unsigned long GetWaitCount() const {return wait_count;}
+    unsigned long GetDropCount() const {return drop_count;}
+
+  private:
+    enum RecordType
+    {
+        PAD,    // fills ring space up to the wrap point
+        TEXT,
+        SEND,
+        RECV
+    };
+
+    struct Address
+    {
+        UINT8   type;   // ProtoAddress::Type
+        UINT8   len;
+        UINT16  port;
+        char    addr[16];
+    };
+
+    // Ring records are a Record header followed by "payload_len" bytes of
+    // payload and "buffer_len" bytes of message buffer (or text) content
+    struct Record
+    {
+        UINT16          type;
+        UINT16          options;
+        UINT32          length;         // total record length (multiple of 8)
+        UINT32          buffer_len;
+        UINT16          payload_len;
+        UINT16          msg_len;
+        UINT16          packet_header_len;
+        UINT8           flags;
+        UINT8           protocol;
+        UINT8           gps_status;
+        UINT8           has_stamp;
+        UINT32          flow_id;
+        UINT32          seq_num;
+        UINT32          mgen_msg_len;
+        INT32           altitude;
+        double          latitude;
+        double          longitude;
+        struct timeval  event_time;
+        struct timeval  tx_time;
+        struct timeval  stamp;
+        Address         src_addr;
+        Address         dst_addr;
+        Address         host_addr;
+    };
+
+    enum {TEXT_MAX = 4096};  // max text bytes per TEXT record
+
+    static UINT32 RecordLength(UINT32 dataLen)
+        {return ((sizeof(Record) + dataLen + 7) & ~((UINT32)7));}
+    static void SaveAddress(Address& a, const ProtoAddress& theAddr);
+    static void RestoreAddress(const Address& a, ProtoAddress& theAddr);
+
+    bool LogEvent(RecordType            type,
+                  MgenMsg&              theMsg,
+                  int                   options,
+                  const char*           msgBuffer,
+                  UINT16                bufferLen,
+                  const struct timeval& theTime,
+                  const struct timeval* stampTime);
+
+    // Producer side
+    Record* Reserve(UINT32 length, bool canDrop);
+    void Commit(Record* record);
+    void WakeWriter(bool force);
+
+    // Writer thread
+    void WriteRecord(Record* record);
+    void Run();
+
+    FILE*               log_file;       // the real log file
+    FILE*               log_stream;     // what Mgen writes other output to
+    bool                detach;         // leave "log_file" open on close
+    bool                drop_on_full;
+    volatile bool       log_flush;
+
+    char*               ring;
+    UINT32              ring_mask;
+    UINT32              ring_head;      // written by producer only
+    UINT32              ring_tail;      // written by writer thread only
+
+    unsigned long       record_count;
+    unsigned long       wait_count;
+    unsigned long       drop_count;
+
+#ifdef MGEN_ASYNC_LOG
+    static void* DoThreadStart(void* arg);
+#ifdef LINUX
+    static ssize_t StreamWrite(void* cookie, const char* buffer, size_t size);
+    static int StreamClose(void* cookie);
+#else
+    static int StreamWrite(void* cookie, const char* buffer, int size);
+    static int StreamClose(void* cookie);
+#endif // if/else LINUX
+    pthread_t           thread_id;
+    pthread_mutex_t     mutex;
+    pthread_cond_t      cond;
+    bool                writer_idle;    // writer is waiting on "cond"
+    bool                stopping;       // (protected by "mutex")
+    UINT32              sync_request;   // (protected by "mutex")
+    UINT32              sync_done;      // (protected by "mutex")
+#endif // MGEN_ASYNC_LOG
+
+};  // end class MgenLogWriter
+
+#endif // _MGEN_LOG_WRITER
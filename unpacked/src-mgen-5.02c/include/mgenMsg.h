@@ -37,11 +37,13 @@
 #include "mgenGlobals.h"
 #include "mgenPayload.h"
 #include <stdio.h>  // for FILE*
+#include <time.h>   // for struct tm
 
 
 // (TBD) rework MgenMsg class into more optimized form
 class Mgen;
 class DrecEvent;
+class MgenMsgTemplate;
 /**
  * @class MgenMsg
  *
@@ -54,6 +56,8 @@ class DrecEvent;
 class MgenMsg
 {
     friend class MgenTcpTransport; // for msg_len & mgen_msg_len
+    friend class MgenMsgTemplate;  // for packed fields & CRC32_TABLE
+    friend class MgenLogWriter;    // to capture and rebuild logged messages
 
   public:
     
@@ -148,7 +152,14 @@ class MgenMsg
     void SetChecksumError() {msg_error = ERROR_CHECKSUM;};
 	bool ComputeCRC() {return compute_crc;}
 	void ComputeCRC(bool theFlag) {compute_crc = theFlag;}
-    // For these, "msgBuffer" is a packed message buffer
+    // When a (valid, matching) template is set, Pack() copies it and
+    // patches only the seq_num, tx_time and checksum fields
+    void SetTemplate(const MgenMsgTemplate* theTemplate) {msg_template = theTemplate;}
+    // For these, "msgBuffer" is a packed message buffer.  The optional
+    // "rxStamp" and "txStamp" are kernel packet timestamps that are
+    // added to text log records as "rxStamp>" and "txStamp>" fields.
+    // (These are also called by the MgenLogWriter thread so they must
+    //  not use static buffers, e.g. from gmtime() or GetHostString())
     bool LogRecvEvent(FILE*                 logFile, 
                       bool                  logBinary,
                       bool                  local_time,
@@ -156,13 +167,15 @@ class MgenMsg
 		      bool                  log_gps_data,
                       char*                 msgBuffer,
                       bool                  flush,
-                      const struct timeval& theTime);
+                      const struct timeval& theTime,
+                      const struct timeval* rxStamp = NULL);
 	bool LogSendEvent(FILE*                 logFile, 
                       bool                  logBinary, 
                       bool                  local_time,
                       char*                 msgBuffer,
                       bool                  flush,
-                      const struct timeval& theTime);
+                      const struct timeval& theTime,
+                      const struct timeval* txStamp = NULL);
     bool LogTcpConnectionEvent(FILE*        logFile, 
                                bool                  logBinary,
                                bool                  local_time,
@@ -181,7 +194,12 @@ class MgenMsg
                       const DrecEvent *event, 
                       UINT16 portNumber,
                       Mgen& mgen);
+    // (see MgenLogConverter for more conversion options)
     bool ConvertBinaryLog(const char* path,Mgen& mgen);
+    // Thread-safe localtime()/gmtime() for log output
+    static struct tm* GetTimeStruct(const time_t*   timeSec,
+                                    bool            local_time,
+                                    struct tm*      timeStruct);
     
     static void ComputeCRC32(UINT32& checksum,
                              const UINT8* buffer, 
@@ -194,6 +212,10 @@ class MgenMsg
 	unsigned int    mgen_msg_len;
     
   private:
+    static void LogStamp(FILE*                 logFile,
+                         const char*           name,
+                         bool                  local_time,
+                         const struct timeval& theTime);
     
     static UINT32 ComputeCRC32(const UINT8* buffer, 
                                UINT32               buflen);
@@ -221,8 +243,63 @@ class MgenMsg
     Protocol        protocol;
     Error           msg_error;
 	bool            compute_crc;
+    const MgenMsgTemplate* msg_template;
     
     enum {FLAGS_OFFSET = 3};
 };  // end class MgenMsg    
 
+/**
+ * @class MgenMsgTemplate
+ *
+ * @brief A pre-packed MGEN message for flows whose messages differ only 
+ * in seq_num and tx_time (and so checksum).  The CRC32 state of the 
+ * constant fields is precomputed so the checksum update cost does not 
+ * depend on the message size.
+ */
+class MgenMsgTemplate
+{
+  public:
+    MgenMsgTemplate();
+    ~MgenMsgTemplate();
+    
+    // Packs "theMsg" (with LAST_BUFFER semantics) as the template.  This
+    // returns false (and the template is not used) for messages that 
+    // can't be patched in place, e.g. too short to hold a checksum.
+    bool Init(MgenMsg& theMsg, bool includeChecksum);
+    // Marks the template for rebuilding (e.g. after flow ON/MOD events)
+    void Invalidate() 
+    {
+        stale = true;
+        valid = false;
+    }
+    bool IsStale() const {return stale;}
+    bool IsValid() const {return valid;}
+    
+    bool Matches(const MgenMsg& theMsg, UINT16 bufferLen, bool includeChecksum) const;
+    // Copies the template into "buffer" with the seq_num and tx_time of
+    // "theMsg", setting "txChecksum" as MgenMsg::Pack() would
+    UINT16 Pack(MgenMsg& theMsg, char* buffer, UINT32& txChecksum) const;
+    
+  private:
+    enum 
+    {
+        SEQ_OFFSET   = 8,   // seq_num, tx_time(sec) and tx_time(usec)
+        PATCH_LEN    = 12,  // are the only fields patched per message
+        PATCH_END    = SEQ_OFFSET + PATCH_LEN
+    };
+    static UINT32 ApplyCRC32Shift(const UINT32* shift, UINT32 crc);
+    
+    char*           msg_buffer;
+    UINT16          msg_len;
+    UINT8           msg_flags;
+    UINT16          packet_header_len;
+    ProtoAddress    host_addr;
+    bool            checksum;
+    bool            stale;
+    bool            valid;
+    UINT32          crc_prefix;     // CRC32 register after bytes before SEQ_OFFSET
+    UINT32          crc_suffix;     // CRC32 (from zero) of bytes from PATCH_END to checksum
+    UINT32          crc_shift[32];  // CRC32 register advance over that many zero bytes
+};  // end class MgenMsgTemplate
+
 #endif // _MGEN_MESSAGE
@@ -0,0 +1,61 @@
+#ifndef _MGEN_PACER
+#define _MGEN_PACER
+
+#include "protokit.h"
+#include <stdio.h>
+
+/**
+ * @class MgenPacer
+ *
+ * @brief Precision pacing state for an MGEN flow ("PACE" command).
+ * Paced flows keep an absolute transmit schedule and their tx_timer
+ * fires a "lead" time ahead of each scheduled message.  In SPIN mode
+ * the flow then busy-waits until the scheduled time before sending, so
+ * timer wakeup overshoot does not show in the departure times.  In
+ * TXTIME (or ETF) mode the message is handed to the kernel early with
+ * its scheduled time as an SO_TXTIME launch time.  The pacer records
+ * the realized schedule error of each message: the send time (SPIN)
+ * or kernel transmit timestamp (TXTIME) minus its scheduled time.
+ */
+class MgenPacer
+{
+  public:
+    MgenPacer();
+    ~MgenPacer();
+
+    enum Mode {OFF, SPIN, TXTIME, ETF};
+    enum {SPIN_LEAD_DEFAULT = 200};      // usec
+    enum {TXTIME_LEAD_DEFAULT = 1000};   // usec
+    enum {HISTOGRAM_BUCKETS = 32};       // bucket "i" counts |errors| < 2^i usec
+
+    static Mode GetModeFromString(const char* string);
+    static const char* GetStringFromMode(Mode mode);
+
+    // Busy-waits until the system time reaches "schedTime"
+    static void SpinUntil(const ProtoTime& schedTime);
+
+    void SetMode(Mode mode) {pace_mode = mode;}
+    Mode GetMode() const {return pace_mode;}
+    // Records a message's realized schedule error (seconds)
+    void Update(double error);
+    // Counts a message whose timer fired after its scheduled time
+    void CountLate() {late_count++;}
+    bool IsEmpty() const {return ((0 == error_count) && (0 == late_count));}
+
+    // Writes a "PACE" report line for flow "flowId"
+    void Report(FILE* outFile, UINT32 flowId, bool localTime);
+    void Reset();
+
+  private:
+    Mode            pace_mode;
+    unsigned long   error_count;
+    unsigned long   late_count;
+    double          error_min;   // (seconds)
+    double          error_max;
+    double          error_sum;
+    double          error_sum_sq;
+    UINT32          error_hist[HISTOGRAM_BUCKETS];
+
+};  // end class MgenPacer
+
+#endif // _MGEN_PACER
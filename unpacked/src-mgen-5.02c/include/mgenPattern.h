@@ -9,6 +9,8 @@
 #endif //_HAVE_PCAP
 #include "protoDefs.h" // to get proper struct timeval def
 #include "mgenGlobals.h" // can't forward declare enum's
+
+class MgenScriptRecord;
 /**
  * @class StringMapper
  * @brief Helper class to build tables to map strings to values
@@ -39,6 +41,10 @@ class MgenPattern
         static Type GetTypeFromString(const char* string);
 
         bool InitFromString(MgenPattern::Type theType, const char* string,Protocol protocol);
+        // Packs/unpacks the pattern parameters for a binary script
+        // (Pack() returns false for CLONE patterns, which aren't packed)
+        bool Pack(MgenScriptRecord& record) const;
+        bool Unpack(MgenScriptRecord& record);
                 
         double GetPktInterval();        
         double GetIntervalAve() {return interval_ave;}
@@ -0,0 +1,97 @@
+#ifndef _MGEN_RECV_STATS
+#define _MGEN_RECV_STATS
+
+#include "protokit.h"
+#include "mgenMsg.h"
+#include <stdio.h>
+
+/**
+ * @class MgenRecvStats
+ *
+ * @brief Keeps per-flow receive statistics as MGEN messages arrive so
+ * that loss, latency, jitter and rate are available without per-packet
+ * logging and post-processing (e.g. by TRPR).  Flows are identified by
+ * flow id, protocol, source and destination address.  For each flow, it
+ * counts messages and bytes, tracks sequence number gaps (loss), late
+ * (out-of-order or duplicate) messages and duplicates (within the last
+ * SEQ_WINDOW sequence numbers, so they don't hide loss), and keeps latency
+ * and inter-arrival time histograms with power-of-two microsecond buckets.
+ */
+class MgenRecvStats
+{
+  public:
+    MgenRecvStats();
+    ~MgenRecvStats();
+
+    enum {HISTOGRAM_BUCKETS = 32};  // bucket "i" counts values < 2^i usec
+
+    // Updates the message's flow stats ("rxTime" is its receive time)
+    void Update(MgenMsg& theMsg, const struct timeval& rxTime);
+
+    // Writes a "STATS" report line per flow.  The "rate" field is the
+    // receive rate since the previous report that had "markInterval" set.
+    void Report(FILE* outFile, bool localTime, bool markInterval = true);
+
+    // Removes all flows
+    void Reset();
+
+    unsigned int GetFlowCount() const {return flow_count;}
+
+  private:
+    class Flow : public ProtoTree::Item
+    {
+      public:
+        // Key: flowId, protocol, srcAddr/port, dstAddr/port (with the
+        // addresses zero-padded to IPv6 size so all keys are the same size)
+        enum {KEY_SIZE = 4 + 1 + 2*(1 + 16 + 2)};
+        // Duplicates are detected for seq numbers within this many of max_seq
+        enum {SEQ_WINDOW = 1024};
+        Flow(const char* theKey);
+
+        const char* GetKey() const {return key;}
+        unsigned int GetKeysize() const {return (KEY_SIZE << 3);}
+
+        static void MakeKey(char* key, MgenMsg& theMsg);
+
+        // Returns true if "seq" was already received (and marks it received)
+        bool MarkSeq(UINT32 seq);
+
+        char            key[KEY_SIZE];
+        UINT32          flow_id;
+        Protocol        protocol;
+        ProtoAddress    src_addr;
+        ProtoAddress    dst_addr;
+
+        unsigned long   rx_count;
+        double          rx_bytes;
+        UINT32          first_seq;
+        UINT32          max_seq;
+        unsigned long   late_count;      // messages with seq <= max_seq
+        unsigned long   dup_count;       // duplicate messages (included in rx_count)
+        UINT32          seq_mask[SEQ_WINDOW / 32];  // received seqs (bit seq % SEQ_WINDOW)
+        struct timeval  first_rx;
+        struct timeval  last_rx;
+        double          latency_min;     // (seconds)
+        double          latency_max;
+        double          latency_sum;
+        double          last_transit;
+        double          jitter;          // RFC 3550 interarrival jitter
+        UINT32          latency_hist[HISTOGRAM_BUCKETS];
+        UINT32          iat_hist[HISTOGRAM_BUCKETS];
+        // State at previous report (for the interval rate)
+        double          report_bytes;
+        struct timeval  report_time;
+    };  // end class MgenRecvStats::Flow
+
+    class FlowTree : public ProtoTreeTemplate<Flow> {};
+
+    static unsigned int GetBucket(double seconds);
+    static void LogHistogram(FILE* outFile, const char* name, const UINT32* hist);
+
+    FlowTree        flow_tree;
+    unsigned int    flow_count;
+    Flow*           last_flow;       // (most recently updated flow)
+
+};  // end class MgenRecvStats
+
+#endif // _MGEN_RECV_STATS
@@ -0,0 +1,120 @@
+#ifndef _MGEN_SCRIPT
+#define _MGEN_SCRIPT
+
+#include "protokit.h"
+#include <stdio.h>
+
+/**
+ * @class MgenScriptRecord
+ *
+ * @brief Packs (or unpacks) the fields of a binary script record
+ * body in network byte order.  Any overflow of the buffer is sticky,
+ * so a series of fields can be packed or unpacked before checking
+ * IsOk() once.
+ */
+class MgenScriptRecord
+{
+  public:
+    // For packing into "buffer"
+    MgenScriptRecord(char* buffer, unsigned int bufferLen);
+    // For unpacking from "buffer"
+    MgenScriptRecord(const char* buffer, unsigned int bufferLen);
+
+    bool IsOk() const {return ok;}
+    unsigned int GetLength() const {return index;}
+    unsigned int GetRemaining() const {return (ok ? (buffer_len - index) : 0);}
+
+    bool PutUINT8(UINT8 value);
+    bool PutUINT16(UINT16 value);
+    bool PutUINT32(UINT32 value);
+    bool PutDouble(double value);
+    bool PutData(const char* data, unsigned int len);
+
+    bool GetUINT8(UINT8& value);
+    bool GetUINT16(UINT16& value);
+    bool GetUINT32(UINT32& value);
+    bool GetDouble(double& value);
+    // Points "data" into the record buffer (no copy)
+    bool GetData(const char*& data, unsigned int len);
+
+  private:
+    bool Reserve(unsigned int len)
+    {
+        if (ok && ((buffer_len - index) < len)) ok = false;
+        return ok;
+    }
+
+    char*           put_buffer;
+    const char*     get_buffer;
+    unsigned int    buffer_len;
+    unsigned int    index;
+    bool            ok;
+
+};  // end class MgenScriptRecord
+
+/**
+ * @class MgenBinaryScript
+ *
+ * @brief A precompiled ("binary") MGEN script.  Compile() parses a
+ * text script offline into a file of records in the original script
+ * order.  MGEN events are stored as packed MgenEvent fields, so loading
+ * them skips the text parsing, while global commands, DREC events and
+ * MGEN events that can't be packed (CLONE patterns) are stored as
+ * script lines and parsed as usual.  The file starts with a text
+ * header line (terminated with a NULL character) like the binary log:
+ *
+ *     "mgen version=<version> type=binary_script\n"
+ *
+ * and each record is:
+ *
+ *     <recordType(8)><reserved(8)><recordLength(16)><lineCount(32)><body>
+ *
+ * where "recordLength" is the length of the body and "lineCount" is
+ * the script line number the record came from (for error messages).
+ */
+class MgenBinaryScript
+{
+  public:
+    MgenBinaryScript();
+    ~MgenBinaryScript();
+
+    enum RecordType {INVALID_RECORD = 0, SCRIPT_LINE = 1, MGEN_EVENT = 2};
+    enum {RECORD_HEADER_LEN = 8};
+
+    // Checks the file header, so ParseScript() can load either format
+    static bool IsBinaryScript(const char* path);
+    // Compiles the text script at "scriptPath" to "binPath"
+    static bool Compile(const char* scriptPath, const char* binPath);
+
+    // Maps the script file into memory and checks its header
+    bool Open(const char* path);
+    void Close();
+    // Gets the next record ("data" points into the mapped file and
+    // SCRIPT_LINE text is NULL terminated).  Returns false at the end
+    // of the script or on a truncated record (see IsError())
+    bool GetNextRecord(RecordType&    type,
+                       unsigned int&  lineCount,
+                       const char*&   data,
+                       unsigned int&  len);
+    bool IsError() const {return read_error;}
+
+  private:
+    static const char* const FILE_TYPE;
+    static bool WriteRecord(FILE*          file,
+                            RecordType     type,
+                            unsigned int   lineCount,
+                            const char*    data,
+                            unsigned int   len);
+    static bool CheckHeader(const char* buffer, unsigned int len);
+
+    const char*     file_data;
+    size_t          file_size;
+    size_t          read_offset;
+    bool            read_error;
+#ifndef UNIX
+    char*           file_buffer;    // (file is read into memory)
+#endif // !UNIX
+
+};  // end class MgenBinaryScript
+
+#endif // _MGEN_SCRIPT
@@ -0,0 +1,129 @@
+#ifndef _MGEN_SHM_RING
+#define _MGEN_SHM_RING
+
+#include "protokit.h"
+
+// The ring needs memfd_create(), eventfd() and descriptor passing
+// over Unix-domain sockets
+#ifdef LINUX
+#define MGEN_SHM_RING
+#endif // LINUX
+
+/**
+ * @class MgenShmRing
+ *
+ * @brief A single producer/single consumer ring of length-prefixed
+ * messages in shared memory, used by the "sink" and "source" options
+ * ("SHM:<socketPath>") to exchange MGEN messages with another
+ * application without a pipe write or read per message.
+ *
+ * MGEN creates the ring (a memfd) and two eventfds and passes them to
+ * the application listening on the Unix-domain stream socket
+ * <socketPath>, which takes them with Accept().  Either side may be the
+ * producer ("sink": MGEN writes, "source": MGEN reads).  The eventfds
+ * are only written when the other side is waiting (for data or for
+ * space), so a busy consumer takes many messages per wakeup and a
+ * message costs no system call at all.
+ *
+ * Messages are an 8 byte header (the message length) followed by the
+ * message, padded to a multiple of 8 bytes.  A message never wraps: the
+ * space up to the end of the ring is skipped with a PAD header instead.
+ */
+class MgenShmRing
+{
+  public:
+    MgenShmRing();
+    ~MgenShmRing();
+
+    enum
+    {
+        SIZE_MIN     = 65536,
+        SIZE_DEFAULT = 4194304
+    };
+
+    static bool IsSupported();
+
+    // (MGEN side) Creates a ring of "size" bytes (rounded up to a power
+    // of 2) and passes it to the application listening on the socket
+    // "path".  The connection is kept until Close() so the application
+    // sees end-of-file when MGEN is done.
+    bool Connect(const char* path, unsigned int size, bool producer);
+    // (application side) Takes the ring passed on connected socket "sock"
+    bool Accept(int sock);
+    void Close();
+    bool IsOpen() const {return (NULL != header);}
+    bool IsProducer() const {return producer;}
+
+    // The descriptor that becomes readable when this side should try
+    // again: data for the consumer, space for the producer.
+    int GetEventDescriptor() const {return producer ? space_fd : data_fd;}
+    // Resets the event descriptor after it was readable
+    void ClearEvent();
+    // Waits until the event descriptor is readable (for blocking use)
+    bool Wait(int timeoutMsec = -1);
+
+    // Producer: Reserve() returns space for a message of "len" bytes or
+    // NULL when the ring is full (the event descriptor then signals
+    // space), and Commit() publishes the reserved message.
+    char* Reserve(unsigned int len);
+    void Commit(unsigned int len);
+    // Producer: makes the event descriptor readable once there is space
+    // (right away unless the last Reserve() found the ring full), for
+    // callers that want "ready to write" notification
+    void RequestSpaceEvent();
+
+    // Consumer: Peek() returns the next message (in place) or NULL when
+    // the ring is empty (the event descriptor then signals data), and
+    // Consume() releases it.
+    const char* Peek(unsigned int& len);
+    void Consume();
+
+  private:
+    enum {MAGIC = 0x4d47524e, VERSION = 1};  // "MGRN"
+    enum {PAD = 0xffffffff};
+
+    // The shared ring header.  The indices are free-running byte counts
+    // and each side's fields are on their own cache line.
+    struct Header
+    {
+        UINT32  magic;
+        UINT32  version;
+        UINT32  size;               // ring data bytes (power of 2)
+        UINT32  reserved;
+        char    pad0[48];
+        UINT32  head;               // written by the producer
+        UINT32  producer_waiting;
+        char    pad1[56];
+        UINT32  tail;               // written by the consumer
+        UINT32  consumer_waiting;
+        char    pad2[56];
+    };
+
+    // (passed with the descriptors by Connect())
+    struct Hello
+    {
+        UINT32  magic;
+        UINT32  version;
+        UINT32  mgen_producer;
+        UINT32  size;
+    };
+
+    static UINT32 RecordLength(UINT32 len)
+        {return ((8 + len + 7) & ~((UINT32)7));}
+    bool Map(int memFd, size_t mapSize, bool init);
+    static void Signal(int fd);
+
+    Header*         header;
+    char*           ring;
+    UINT32          ring_mask;
+    size_t          map_size;
+    bool            producer;
+    UINT32          reserve_pad;    // pad before the reserved message
+    UINT32          peek_length;    // record length of the peeked message
+    int             data_fd;        // signaled when data is available
+    int             space_fd;       // signaled when space is available
+    int             socket_fd;      // connection to the application
+
+};  // end class MgenShmRing
+
+#endif // _MGEN_SHM_RING
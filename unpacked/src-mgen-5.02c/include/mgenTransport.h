@@ -5,6 +5,8 @@
 #include "mgenGlobals.h"
 #include "mgenMsg.h"
 #include "mgenEvent.h"
+#include "mgenHash.h"
+#include "mgenShmRing.h"
 
 class MgenController;
 class MgenFlowList;
@@ -17,10 +19,16 @@ class MgenTransport;
  * @brief Maintains list of transport items (e.g. sockets, pipes) 
  * for transmission, reception,
  * and multicast group join/leave. 
+ * The transports are also hash indexed by protocol and source port,
+ * by protocol and destination address, and by socket so that
+ * Mgen can find them without scanning the list.  Each transport
+ * has an "order" value that increases along the list so that
+ * lookups can still return the first match in list order.
 */
 class MgenTransportList
 {
     friend class Mgen;
+    friend class MgenTransport;
 
   public:
     
@@ -43,8 +51,22 @@ class MgenTransportList
     void Append(MgenTransport* transport);
 
   private:
+    // The transport must be unindexed before its srcPort or
+    // dstAddress is changed, and indexed again afterwards
+    void Index(MgenTransport* transport);
+    void Unindex(MgenTransport* transport);
+    static unsigned int MakePortKey(char* key, Protocol theProtocol, UINT16 srcPort);
+    static unsigned int MakeDstKey(char* key, Protocol theProtocol, const ProtoAddress& dstAddr);
+
+    class TransportIndex : public MgenHashIndexTemplate<MgenTransport> {};
+
     MgenTransport*          head;                  
     MgenTransport*          tail;    
+    TransportIndex          port_index;     // (protocol, srcPort)
+    TransportIndex          dst_index;      // (protocol, dstAddress) if valid
+    TransportIndex          socket_index;   // (socket pointer)
+    long                    head_order;
+    long                    tail_order;
 };  // end class MgenTransportList
 
 /**
@@ -68,6 +90,7 @@ class MgenTransport
     // of these now...
     virtual bool IsSocketTransport() {return false;}
     virtual bool OwnsSocket(const ProtoSocket& theSocket) {return false;}
+    virtual const ProtoSocket* GetSocket() const {return NULL;}
     virtual UINT16 GetSocketPort() {return 0;}
     // TBD add client state to udp sockets?
     virtual bool IsClient() {return true;} 
@@ -101,6 +124,21 @@ class MgenTransport
     virtual MessageStatus SendMessage(MgenMsg& theMsg,
                              const ProtoAddress& dst_addr,
                              char* txBuffer) = 0;
+    // Sends the "count" messages of "msgArray" in order, setting "count"
+    // to the number actually sent.  Transports may override this to
+    // hand the whole batch to the socket in one call.
+    virtual MessageStatus SendMessageBatch(MgenMsg*            msgArray,
+                                           unsigned int&       count,
+                                           const ProtoAddress& dst_addr);
+    // As SendMessage(), but the message is to leave at "launchTime".
+    // Transports without kernel launch time (SO_TXTIME) support, see
+    // TxTimeEnabled(), just send it now.
+    virtual MessageStatus SendMessageAt(MgenMsg&            theMsg,
+                                        const ProtoAddress& dst_addr,
+                                        char*               txBuffer,
+                                        const ProtoTime&    launchTime)
+        {return SendMessage(theMsg, dst_addr, txBuffer);}
+    virtual bool TxTimeEnabled() {return false;}
     virtual bool StartOutputNotification() {return true;}
     virtual void StopOutputNotification() {;}
     virtual bool StartInputNotification() {return true;}
@@ -114,9 +152,12 @@ class MgenTransport
     void PrintList(); // ljt
     bool SendPendingMessage();
     void RemoveFromPendingList();
-    void LogEvent(LogEventType theEvent,MgenMsg* theMsg,const struct timeval& theTime,char* buffer = NULL);
+    // ("stampTime" is an optional kernel rx/tx timestamp for RECV/SEND events)
+    void LogEvent(LogEventType theEvent,MgenMsg* theMsg,const struct timeval& theTime,char* buffer = NULL,
+                  const struct timeval* stampTime = NULL);
     Protocol GetProtocol() {return protocol;}
-    void SetDstAddr(const ProtoAddress& theAddress) {dstAddress = theAddress;}
+    void SetDstAddr(const ProtoAddress& theAddress);
+    void SetSrcPort(UINT16 thePort);
 
     void AppendFlow(MgenFlow* const theFlow);
     void RemoveFlow(MgenFlow* const theFlow);
@@ -154,6 +195,8 @@ class MgenTransport
   private: 
     MgenTransport*  prev;  
     MgenTransport*  next;  
+    MgenTransportList* list;     // list this is on (for reindexing)
+    long            list_order;  // position on list
   protected:	      
     UINT16  srcPort;
     UINT16  dstPort;
@@ -196,6 +239,7 @@ class MgenSocketTransport : public MgenTransport
     }
     bool IsSocketTransport() {return true;}
     UINT16 GetSocketPort() {return socket.GetPort();}
+    const ProtoSocket* GetSocket() const {return &socket;}
     bool OwnsSocket(const ProtoSocket& theSocket) 
     {
         if (&socket == &theSocket)
@@ -273,6 +317,9 @@ class MgenUdpTransport : public MgenSocketTransport
 		    const ProtoAddress& sourceAddress,
                     const char* interfaceName = NULL);
     MessageStatus SendMessage(MgenMsg& theMsg,const ProtoAddress& dst_addr,char* txBuffer);
+    MessageStatus SendMessageBatch(MgenMsg* msgArray, unsigned int& count, const ProtoAddress& dst_addr);
+    MessageStatus SendMessageAt(MgenMsg& theMsg,const ProtoAddress& dst_addr,char* txBuffer,const ProtoTime& launchTime);
+    bool TxTimeEnabled() {return socket.TxTimeEnabled();}
     bool Listen(UINT16 port,ProtoAddress::Type addrType, bool bindOnOpen);
     
     unsigned int GroupCount() {return group_count;}
@@ -299,6 +346,23 @@ class MgenUdpTransport : public MgenSocketTransport
   private:	  
     unsigned int    group_count;	  
     bool            connect;
+    char*           batch_buffer;       // packed messages for SendMessageBatch()
+    unsigned int    batch_buffer_size;
+    
+    // Kernel transmit timestamps are matched to the launch times of
+    // messages sent by SendMessageAt() for their flows' PACE stats
+    void OnTxTimestamp(UINT32 txId, const ProtoTime& txTime);
+    enum {PACE_PENDING_MAX = 256};
+    struct PacePending
+    {
+        UINT32      tx_id;
+        UINT32      flow_id;
+        ProtoTime   launch_time;
+    };
+    bool            tx_stamps;          // kernel transmit timestamps enabled
+    PacePending     pace_pending[PACE_PENDING_MAX];  // (a ring)
+    unsigned int    pace_pending_head;
+    unsigned int    pace_pending_count;
 }; // end class MgenUdpTransport
 
 /**
@@ -341,13 +405,11 @@ class MgenTcpTransport : public MgenSocketTransport
     void OnRecvMsg(unsigned int numBytes,unsigned int bufferIndex,const char* buffer);
     MessageStatus SendMessage(MgenMsg& theMsg,const ProtoAddress& dst_addr,char* txBuffer);
     bool GetNextTxBuffer(unsigned int numBytes);
-    void SetupNextTxBuffer();
     UINT16 GetNextTxFragment();
     UINT16 GetNextTxFragmentSize();
     unsigned int GetRxNumBytes(unsigned int bufferIndex);
     void CopyMsgBuffer(unsigned int numBytes,unsigned int bufferIndex,const char* buffer);
     void CalcRxChecksum(const char* buffer,unsigned int bufferIndex,unsigned int numBytes);
-    void CalcTxChecksum(); 
     bool IsTransmitting() 
     {
 	    if (tx_msg.GetMsgLen()) 
@@ -368,6 +430,10 @@ class MgenTcpTransport : public MgenSocketTransport
     bool IsClient() {return is_client;};
     void IsClient(bool isClient) {is_client = isClient;};
   private:
+    void SetupTxVector();
+    bool SendTxVector(unsigned int& numBytes);
+    void EnableZeroCopy();
+
     bool                    is_client;
     MgenMsg                 tx_msg;
     char                    tx_msg_buffer[TX_BUFFER_SIZE];
@@ -377,6 +443,17 @@ class MgenTcpTransport : public MgenSocketTransport
     UINT16                  tx_fragment_pending;
     UINT32                  tx_checksum;
     struct timeval          tx_time; // send time of first tcp fragment
+
+    // A fragment is sent as a vector of pieces (see SetupTxVector())
+    enum {TX_VECTOR_MAX = (MAX_FRAG_SIZE / TX_BUFFER_SIZE) + 3};
+    const char*             tx_vector_buffer[TX_VECTOR_MAX];
+    unsigned int            tx_vector_len[TX_VECTOR_MAX];
+    unsigned int            tx_vector_count;
+    unsigned int            tx_vector_index;   // next piece to send
+    unsigned int            tx_vector_offset;  // bytes of it already sent
+    int                     tx_vector_zero_copy; // piece sent zero copy (or -1)
+    char                    tx_checksum_buffer[4];
+    bool                    tx_zero_copy;          // MSG_ZEROCOPY enabled (see ZEROCOPY)
 	
     MgenMsg                 rx_msg;
     char                    rx_msg_buffer[TX_BUFFER_SIZE];
@@ -453,9 +530,18 @@ class MgenAppSinkTransport : public MgenSinkTransport, public ProtoChannel
 
     // MgenSinkTransport implementation
     bool IsOpen() {return ProtoChannel::IsOpen();}
-    void Close() {ProtoChannel::Close();}
-    bool StartOutputNotification() {return ProtoChannel::StartOutputNotification();}
-    void StopOutputNotification() {ProtoChannel::StopOutputNotification();}
+    void Close();
+    // (a shared memory ring sink always watches its "space" event)
+    bool StartOutputNotification() 
+    {
+        if (!shm_ring.IsOpen()) return ProtoChannel::StartOutputNotification();
+        shm_ring.RequestSpaceEvent();
+        return true;
+    }
+    void StopOutputNotification() 
+    {
+        if (!shm_ring.IsOpen()) ProtoChannel::StopOutputNotification();
+    }
     bool StartInputNotification() {return ProtoChannel::StartInputNotification();}
     void StopInputNotification() {ProtoChannel::StopInputNotification();}
     bool HasListener() {return ProtoChannel::HasListener();};
@@ -472,6 +558,14 @@ class MgenAppSinkTransport : public MgenSinkTransport, public ProtoChannel
     void SetSink(class ProtoMessageSink* theSink) {;}
 
  private:
+    // "SHM:<socketPath>[,<kbytes>]" paths use a shared memory ring
+    bool IsShmPath() const;
+    bool OpenShmRing(bool producer);
+    void OnShmRingEvent();
+
+    MgenShmRing                     shm_ring;
+    enum {SHM_BURST_MAX = 256};
+    int                             shm_burst;  // sends left in a ring event (or -1)
 
 #ifdef WIN32
     ProtoDispatcher::Descriptor     descriptor;
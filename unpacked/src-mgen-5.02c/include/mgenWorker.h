@@ -0,0 +1,82 @@
+#ifndef _MGEN_WORKER
+#define _MGEN_WORKER
+
+#include "mgen.h"
+
+/**
+ * @class MgenWorker
+ *
+ * @brief One thread of a multi-threaded MGEN ("WORKERS" command).  A
+ * worker is an Mgen instance with its own ProtoDispatcher thread, so
+ * the flows it is given are scheduled and sent with their own timers,
+ * transports and sockets, independently of the other workers.  Script
+ * lines, global commands and log streams are passed to the worker
+ * through a message queue that the worker thread is prompted to
+ * process, so its Mgen is only ever touched by its own thread once it
+ * has started.
+ */
+class MgenWorker
+{
+  public:
+    MgenWorker(unsigned int index);
+    ~MgenWorker();
+
+    unsigned int GetIndex() const {return worker_index;}
+    bool IsRunning() const {return running;}
+
+    // Starts the worker thread and then its Mgen
+    bool Start();
+    // Stops the worker Mgen (closing its flows and log stream) and thread
+    void Stop();
+
+    // These pass script lines, global commands and log streams to the
+    // worker's Mgen.  Before Start() they are processed immediately (so
+    // errors are returned).  After that they are queued for the worker
+    // thread (and errors are only reported by it).
+    bool PostEvent(const char* lineBuffer, unsigned int lineCount);
+    // The worker's Mgen takes ownership of "theEvent" (already parsed)
+    bool PostMgenEvent(MgenEvent* theEvent, unsigned int lineCount);
+    bool PostCommand(Mgen::Command cmd, const char* arg, bool override);
+    // The worker's Mgen takes ownership of "logStream" (may be NULL)
+    bool PostLogFile(FILE* logStream);
+
+    // Direct access is only safe before Start() (e.g. to copy settings)
+    Mgen& AccessMgen() {return mgen;}
+
+  private:
+    class Message
+    {
+      public:
+        enum Type {EVENT, MGEN_EVENT, COMMAND, LOG_FILE, START};
+        Message(Type theType, const char* theText);
+        ~Message();
+
+        Type            type;
+        char*           text;        // script line or command argument
+        unsigned int    line_count;
+        Mgen::Command   cmd;
+        bool            override;
+        FILE*           log_stream;
+        MgenEvent*      mgen_event;
+        Message*        next;
+    };
+
+    bool Post(Message* msg);
+    bool Process(Message& msg);
+    void ProcessQueue();
+    static void DoPrompt(const void* clientData);
+
+    // (the dispatcher is constructed first as "mgen" uses it)
+    ProtoDispatcher         dispatcher;
+    Mgen                    mgen;
+    unsigned int            worker_index;
+    bool                    running;
+
+    ProtoDispatcher::Mutex  queue_mutex;
+    Message*                queue_head;    // (protected by "queue_mutex")
+    Message*                queue_tail;
+    bool                    prompt_pending;
+
+};  // end class MgenWorker
+
+#endif // _MGEN_WORKER
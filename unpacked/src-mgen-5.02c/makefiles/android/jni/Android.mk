@@ -18,6 +18,16 @@ LOCAL_SRC_FILES := \
 	../../../src/common/mgenEvent.cpp \
 	../../../src/common/mgenFlow.cpp \
 	../../../src/common/mgenMsg.cpp \
+	../../../src/common/mgenCrc32.cpp \
+	../../../src/common/mgenLogWriter.cpp \
+	../../../src/common/mgenLogConverter.cpp \
+	../../../src/common/mgenRecvStats.cpp \
+	../../../src/common/mgenHash.cpp \
+	../../../src/common/mgenLogMerger.cpp \
+	../../../src/common/mgenWorker.cpp \
+	../../../src/common/mgenPacer.cpp \
+	../../../src/common/mgenScript.cpp \
+	../../../src/common/mgenShmRing.cpp \
 	../../../src/common/mgenTransport.cpp \
 	../../../src/common/mgenPattern.cpp \
 	../../../src/common/mgenPayload.cpp \
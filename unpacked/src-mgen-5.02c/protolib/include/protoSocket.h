@@ -2,6 +2,7 @@
 #define _PROTO_SOCKET
 
 #include "protoAddress.h"
+#include "protoTime.h"
 
 #include "protoDebug.h"  // temp
 
@@ -171,8 +172,27 @@ class ProtoSocket
 		bool SendTo(const char* buffer, unsigned int &buflen, const ProtoAddress& dstAddr);
 		bool RecvFrom(char* buffer, unsigned int& numBytes, ProtoAddress& srcAddr);
         bool RecvFrom(char* buffer, unsigned int& numBytes, ProtoAddress& srcAddr, ProtoAddress& dstAddr); 
+        // This variant also gets the receive time (kernel timestamp if enabled and available)
+        bool RecvFrom(char* buffer, unsigned int& numBytes, ProtoAddress& srcAddr, ProtoTime& rxTime); 
 		bool Send(const char* buffer, unsigned int& numBytes);
 		bool Recv(char* buffer, unsigned int& numBytes);
+        // Batched datagram I/O (uses recvmmsg()/sendmmsg() on Linux, else loops)
+        // On input, "count" is the number of array entries and "numBytesArray" holds
+        // the buffer sizes (RecvBatch) or datagram lengths (SendBatch).  On return,
+        // "count" is the number of datagrams received or sent (zero if would block)
+        // and "numBytesArray" holds their lengths.  The optional "dstAddrArray" and
+        // "rxTimeArray" get each received datagram's destination address and receive
+        // time.  For SendBatch(), a NULL "dstAddrArray" is used for connected sockets.
+        bool RecvBatch(char* const*     bufferArray, 
+                       unsigned int*    numBytesArray, 
+                       ProtoAddress*    srcAddrArray, 
+                       unsigned int&    count,
+                       ProtoAddress*    dstAddrArray = NULL,
+                       ProtoTime*       rxTimeArray = NULL);
+        bool SendBatch(const char* const*   bufferArray, 
+                       unsigned int*        numBytesArray,
+                       const ProtoAddress*  dstAddrArray,
+                       unsigned int&        count);
 #if !defined(WIN32) && !defined(SIMULATE)        
 		// This was for debugging?? Remove??
         bool Read(char* buffer, unsigned int &numBytes)
@@ -214,6 +234,56 @@ class ProtoSocket
 		unsigned int GetRxBufferSize();
         
         void EnableRecvDstAddr();
+        void EnableRecvTimestamp();
+        // Kernel packet timestamping (Linux SO_TIMESTAMPING) for datagram sockets.  The
+        // socket must be open.  Receive timestamps are then provided by RecvFrom() (w/ rxTime)
+        // and RecvBatch().  If "txStamps" is set, the time each datagram is passed to the
+        // device (or sent by the NIC for "hardware" stamps, which also requires the interface 
+        // be configured for it, e.g. via SIOCSHWTSTAMP) is queued for RecvTxTimestamp().
+        bool EnableTimestamping(bool txStamps, bool hardware = false);
+        // Gets the next queued transmit timestamp (returns false if none is ready).  The
+        // "txId" is the count of datagrams sent before the one stamped (see GetTxStampId()).
+        // Note queued transmit timestamps make the socket "readable" until they are read.
+        bool RecvTxTimestamp(UINT32& txId, ProtoTime& txTime);
+        // Returns the "txId" that the _next_ datagram sent will have
+        UINT32 GetTxStampId() const
+            {return tx_stamp_id;}
+        // Per-packet launch times (Linux SO_TXTIME) for datagram sockets.  The socket
+        // must be open.  Datagrams sent with SendAt() are then held by the "fq" or "etf"
+        // queuing discipline until their launch time, which is on the "tai" (CLOCK_TAI, as
+        // "etf" usually expects) or else the monotonic clock ("fq" requires it).  Other 
+        // queuing disciplines ignore the launch time and send immediately.
+        bool EnableTxTime(bool tai = false);
+        bool TxTimeEnabled() const
+            {return tx_time;}
+        // As SendTo(), but with a launch time given as system (gettimeofday()) time
+        bool SendAt(const char*         buffer, 
+                    unsigned int&       buflen, 
+                    const ProtoAddress& dstAddr,
+                    const ProtoTime&    launchTime);
+        // Gathered Send() of "count" buffers on a connected socket (one sendmsg() call
+        // on Unix, else a loop over Send()).  On return, "numBytes" is the total number
+        // of bytes sent (zero if would block).  With "zeroCopy" (and EnableZeroCopy()),
+        // the kernel sends from the buffers in place (Linux MSG_ZEROCOPY), so they must
+        // not change until the send is complete (see GetZeroCopyPending()).
+        bool SendVector(const char* const*  bufferArray,
+                        const unsigned int* numBytesArray,
+                        unsigned int        count,
+                        unsigned int&       numBytes,
+                        bool                zeroCopy = false);
+        // Allows zero copy SendVector() on a (TCP) stream socket.  The socket must be open.
+        bool EnableZeroCopy();
+        bool ZeroCopyEnabled() const
+            {return zero_copy;}
+        // Zero copy completions are queued on the socket's error queue and are
+        // read as that is signaled (or by RecvZeroCopyCompletions()) without any
+        // event to the listener.  ZeroCopyCopied() is set if the kernel copied the
+        // data anyway (e.g. for loopback), in which case zero copy only adds overhead.
+        bool RecvZeroCopyCompletions();
+        UINT32 GetZeroCopyPending() const
+            {return (zero_copy_id - zero_copy_done);}
+        bool ZeroCopyCopied() const
+            {return zero_copy_copied;}
 
 		// Helper methods
 #ifdef HAVE_IPV6
@@ -430,6 +500,15 @@ class ProtoSocket
         UINT8                   tos;           // IPv4 TOS or IPv6 traffic class
         bool                    ecn_capable;
         bool                    ip_recvdstaddr;  // set "true" if RecvFrom() w/ destAddr is invoked
+        bool                    recv_timestamp;  // set "true" if RecvBatch() w/ rxTime is invoked
+        bool                    tx_timestamp;    // set "true" if EnableTimestamping() w/ txStamps
+        UINT32                  tx_stamp_id;     // counts datagrams sent when "tx_timestamp" is set
+        bool                    tx_time;         // set "true" if EnableTxTime() succeeded
+        int                     tx_time_clock;   // clock id of SendAt() launch times
+        bool                    zero_copy;       // set "true" if EnableZeroCopy() succeeded
+        UINT32                  zero_copy_id;    // counts zero copy sends
+        UINT32                  zero_copy_done;  // counts completed zero copy sends
+        bool                    zero_copy_copied;
 #ifdef HAVE_IPV6
         UINT32                  flow_label;    // IPv6 flow label      
 #endif // HAVE_IPV6
@@ -21,6 +21,11 @@
 #include <ifaddrs.h>
 #include <errno.h>
 #include <fcntl.h>
+#ifdef LINUX
+#include <linux/net_tstamp.h>  // for SOF_TIMESTAMPING_* flags
+#include <linux/errqueue.h>    // for struct scm_timestamping, struct sock_extended_err
+#include <time.h>              // for clock_gettime() (SO_TXTIME launch times)
+#endif // LINUX
 
 #ifndef SIOCGIFHWADDR
 #if defined(SOLARIS) || defined(IRIX)
@@ -88,6 +93,8 @@ ProtoSocket::IPv6SupportStatus ProtoSocket::ipv6_support_status = IPV6_UNKNOWN;
 ProtoSocket::ProtoSocket(ProtoSocket::Protocol theProtocol)
     : domain(IPv4), protocol(theProtocol), raw_protocol(RAW), state(CLOSED), 
       handle(INVALID_HANDLE), port(-1), tos(0), ecn_capable(false), ip_recvdstaddr(false),
+      recv_timestamp(false), tx_timestamp(false), tx_stamp_id(0),
+      tx_time(false), tx_time_clock(0), zero_copy(false), zero_copy_id(0), zero_copy_done(0), zero_copy_copied(false),
 #ifdef HAVE_IPV6
       flow_label(0),
 #endif // HAVE_IPV6
@@ -516,6 +523,10 @@ bool ProtoSocket::Open(UINT16               thePort,
     closing = false;
 #endif //WIN32
     ip_recvdstaddr = false;  // make sure this is reset
+    recv_timestamp = false;
+    tx_timestamp = false;
+    tx_time = false;
+    zero_copy = false;
     return true;
 }  // end ProtoSocket::Open()
 
@@ -677,6 +688,16 @@ void ProtoSocket::OnNotify(ProtoSocket::Flag theFlag)
     }
     else if (NOTIFY_ERROR == theFlag)
     {
+#ifndef WIN32
+        // Queued zero copy completions signal an error, too
+        if (zero_copy && RecvZeroCopyCompletions())
+        {
+            int err = 0;
+            socklen_t errsize = sizeof(err);
+            if ((0 == getsockopt(handle, SOL_SOCKET, SO_ERROR, (char*)&err, &errsize)) && (0 == err))
+                return;
+        }
+#endif // !WIN32
 		TRACE("ProtoSocket NOTIFY_ERROR notification\n");
         switch(state)
     	{
@@ -1268,6 +1289,7 @@ bool ProtoSocket::Accept(ProtoSocket* newSocket)
     }  // end if/else (this == &theSocket)
     theSocket.handle = theHandle;  // the socket gets the new handle/descriptor from accept()
     theSocket.state = CONNECTED;
+    theSocket.zero_copy = false;  // (SO_ZEROCOPY is per descriptor)
     theSocket.UpdateNotification();
     return true;
 }  // end ProtoSocket::Accept()
@@ -1361,6 +1383,7 @@ bool ProtoSocket::Send(const char*         buffer,
         else
         {
             numBytes = result;
+            if (tx_timestamp) tx_stamp_id++;
             return true;
         }
 #endif // if/else WIN32/UNIX
@@ -1559,6 +1582,7 @@ bool ProtoSocket::SendTo(const char*         buffer,
         else
         {   
             //ASSERT(result == buflen);
+            if (tx_timestamp) tx_stamp_id++;
             return true;
         }
 #endif // if/else WIN32/UNIX
@@ -1678,6 +1702,71 @@ void ProtoSocket::EnableRecvDstAddr()
 #endif // WIN32
 }  // end ProtoSocket::EnableRecvDstAddr()
 
+#ifndef WIN32
+// Helper function to get destination address and/or receive timestamp
+// from recvmsg() control data (either pointer may be NULL)
+static void GetRecvMsgInfo(struct msghdr& msg, ProtoAddress* destAddr, ProtoTime* rxTime)
+{
+    if (NULL != rxTime) rxTime->Zeroize();
+    for (struct cmsghdr* cmptr = CMSG_FIRSTHDR(&msg); cmptr != NULL; cmptr = CMSG_NXTHDR(&msg, cmptr)) 
+    {
+        if (cmptr->cmsg_level == IPPROTO_IP)
+        {
+            if (NULL == destAddr) continue;
+#ifdef IP_RECVDSTADDR
+            if ((cmptr->cmsg_level == IPPROTO_IP) && (cmptr->cmsg_type == IP_RECVDSTADDR))
+            {
+                destAddr->SetRawHostAddress(ProtoAddress::IPv4, (char*)CMSG_DATA(cmptr), 4);
+            }
+#else
+            if (cmptr->cmsg_type == IP_PKTINFO)
+            {
+                struct in_pktinfo* pktInfo = (struct in_pktinfo*)((void*)CMSG_DATA(cmptr));
+                destAddr->SetRawHostAddress(ProtoAddress::IPv4, (char*)(&pktInfo->ipi_addr), 4);
+            }
+#endif // if/else IP_RECVDSTADDR
+        }
+#ifdef HAVE_IPV6
+        if (cmptr->cmsg_level == IPPROTO_IPV6)   
+        {             
+            if (NULL == destAddr) continue;
+#ifdef IPV6_RECVDSTADDR
+            if (cmptr->cmsg_type == IPV6_RECVDSTADDR)
+            {
+                destAddr->SetRawHostAddress(ProtoAddress::IPv6, (char*)CMSG_DATA(cmptr), 16);
+            }
+#else
+            if (cmptr->cmsg_type == IPV6_PKTINFO)
+            {
+                struct in6_pktinfo* pktInfo = (struct in6_pktinfo*)((void*)CMSG_DATA(cmptr));
+                destAddr->SetRawHostAddress(ProtoAddress::IPv6, (char*)(&pktInfo->ipi6_addr), 16);
+            }
+#endif // if/else IPV6_RECVDSTADDR
+        }
+#endif // HAVE_IPV6   
+#ifdef SO_TIMESTAMP
+        if ((cmptr->cmsg_level == SOL_SOCKET) && (cmptr->cmsg_type == SCM_TIMESTAMP) && (NULL != rxTime))
+            memcpy(&rxTime->AccessTimeVal(), CMSG_DATA(cmptr), sizeof(struct timeval));
+#endif // SO_TIMESTAMP
+#ifdef SO_TIMESTAMPING
+        if ((cmptr->cmsg_level == SOL_SOCKET) && (cmptr->cmsg_type == SCM_TIMESTAMPING) && (NULL != rxTime))
+        {
+            // Use the raw hardware timestamp if one was provided, else the software one
+            struct scm_timestamping stamps;
+            memcpy(&stamps, CMSG_DATA(cmptr), sizeof(stamps));
+            const struct timespec& ts = ((0 != stamps.ts[2].tv_sec) || (0 != stamps.ts[2].tv_nsec)) ?
+                                            stamps.ts[2] : stamps.ts[0];
+            if ((0 != ts.tv_sec) || (0 != ts.tv_nsec))
+            {
+                rxTime->AccessTimeVal().tv_sec = ts.tv_sec;
+                rxTime->AccessTimeVal().tv_usec = ts.tv_nsec / 1000;
+            }
+        }
+#endif // SO_TIMESTAMPING
+    } 
+}  // end GetRecvMsgInfo()
+#endif // !WIN32
+
 #ifndef WIN32
 // Variant RecvFrom() that uses recvmsg() to get destAddr information
 bool ProtoSocket::RecvFrom(char*            buffer, 
@@ -1754,41 +1843,7 @@ bool ProtoSocket::RecvFrom(char*            buffer,
             return false;
         }
         // Get destAddr info
-        for (struct cmsghdr* cmptr = CMSG_FIRSTHDR(&msg); cmptr != NULL; cmptr = CMSG_NXTHDR(&msg, cmptr)) 
-        {
-            if (cmptr->cmsg_level == IPPROTO_IP)
-            {
-#ifdef IP_RECVDSTADDR
-                if ((cmptr->cmsg_level == IPPROTO_IP) && (cmptr->cmsg_type == IP_RECVDSTADDR))
-                {
-                    destAddr.SetRawHostAddress(ProtoAddress::IPv4, (char*)CMSG_DATA(cmptr), 4);
-                }
-#else
-                if (cmptr->cmsg_type == IP_PKTINFO)
-                {
-                    struct in_pktinfo* pktInfo = (struct in_pktinfo*)((void*)CMSG_DATA(cmptr));
-                    destAddr.SetRawHostAddress(ProtoAddress::IPv4, (char*)(&pktInfo->ipi_addr), 4);
-                }
-#endif // if/else IP_RECVDSTADDR
-            }
-#ifdef HAVE_IPV6
-            if (cmptr->cmsg_level == IPPROTO_IPV6)   
-            {             
-#ifdef IPV6_RECVDSTADDR
-                if (cmptr->cmsg_type == IPV6_RECVDSTADDR)
-                {
-                    destAddr.SetRawHostAddress(ProtoAddress::IPv6, (char*)CMSG_DATA(cmptr), 16);
-                }
-#else
-                if (cmptr->cmsg_type == IPV6_PKTINFO)
-                {
-                    struct in6_pktinfo* pktInfo = (struct in6_pktinfo*)((void*)CMSG_DATA(cmptr));
-                    destAddr.SetRawHostAddress(ProtoAddress::IPv6, (char*)(&pktInfo->ipi6_addr), 16);
-                }
-#endif // if/else IPV6_RECVDSTADDR
-            }
-#endif // HAVE_IPV6    
-        } 
+        GetRecvMsgInfo(msg, &destAddr, NULL);
         return true;
     }
 }  // end ProtoSocket::RecvFrom(w/ destAddr)
@@ -1901,6 +1956,670 @@ bool ProtoSocket::RecvFrom(char*            buffer,
 
 #endif // if/else !WIN32
 
+#ifndef WIN32
+// Variant RecvFrom() that uses recvmsg() to get the (kernel) receive time
+bool ProtoSocket::RecvFrom(char*            buffer, 
+                           unsigned int&    numBytes, 
+                           ProtoAddress&    sourceAddr,
+                           ProtoTime&       rxTime)
+{
+    if (!IsBound())
+    {
+        PLOG(PL_ERROR, "ProtoSocket::RecvFrom() error: socket not bound\n");
+        numBytes = 0;    
+    }
+    if (!recv_timestamp) EnableRecvTimestamp();  // should enable ahead of time to make sure you don't miss any
+    
+#ifdef HAVE_IPV6    
+    struct sockaddr_storage sockAddr;
+#else
+    struct sockaddr sockAddr;
+#endif  // if/else HAVE_IPV6
+    char cdata[128];
+    struct msghdr msg;
+    struct iovec iov[1];
+    iov[0].iov_base = buffer;
+    iov[0].iov_len = numBytes;
+    msg.msg_name = &sockAddr;
+    msg.msg_namelen = sizeof(sockAddr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cdata;
+    msg.msg_controllen = sizeof(cdata);
+    msg.msg_flags = 0;
+    int result = recvmsg(handle, &msg, 0);
+    if (result < 0)
+    {
+        numBytes = 0;
+        switch (errno)
+        {
+            case EINTR:
+            case EAGAIN:
+                return true;            
+            default:
+                PLOG(PL_ERROR, "ProtoSocket::RecvFrom() recvmsg() error: %s\n", GetErrorString());
+                break;
+        }
+        return false;
+    }
+    numBytes = result;
+    sourceAddr.SetSockAddr(*((struct sockaddr*)&sockAddr));
+    if (!sourceAddr.IsValid())
+    {
+        PLOG(PL_ERROR, "ProtoSocket::RecvFrom() Unsupported address type!\n");
+        return false;
+    }
+    GetRecvMsgInfo(msg, NULL, &rxTime);
+    if (rxTime.IsZero()) rxTime.GetCurrentTime();  // no kernel timestamp
+    return true;
+}  // end ProtoSocket::RecvFrom(w/ rxTime)
+#else
+// WIN32 implementation (no kernel timestamps, so we use the current time)
+bool ProtoSocket::RecvFrom(char*            buffer, 
+                           unsigned int&    numBytes, 
+                           ProtoAddress&    sourceAddr,
+                           ProtoTime&       rxTime)
+{
+    bool result = RecvFrom(buffer, numBytes, sourceAddr);
+    rxTime.GetCurrentTime();
+    return result;
+}  // end ProtoSocket::RecvFrom(w/ rxTime) [WIN32]
+#endif // if/else !WIN32
+
+void ProtoSocket::EnableRecvTimestamp()
+{
+    if (!recv_timestamp)
+    {
+#ifdef SO_TIMESTAMP
+        int enable = 1;
+        if (setsockopt(handle, SOL_SOCKET, SO_TIMESTAMP, (char*)&enable, sizeof(enable)) < 0)
+            PLOG(PL_WARN, "ProtoSocket::EnableRecvTimestamp() setsockopt(SO_TIMESTAMP) error: %s\n", GetErrorString());
+#endif // SO_TIMESTAMP
+        recv_timestamp = true;
+    }
+}  // end ProtoSocket::EnableRecvTimestamp()
+
+bool ProtoSocket::EnableTimestamping(bool txStamps, bool hardware)
+{
+#ifdef SO_TIMESTAMPING
+    if (!IsOpen())
+    {
+        PLOG(PL_ERROR, "ProtoSocket::EnableTimestamping() error: socket not open\n");
+        return false;
+    }
+    if (TCP == protocol)
+    {
+        // (TCP transmit timestamps are keyed by byte offset, not datagram)
+        PLOG(PL_ERROR, "ProtoSocket::EnableTimestamping() error: not supported for TCP sockets\n");
+        return false;
+    }
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (hardware) flags |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (txStamps)
+    {
+        // OPT_ID tags each stamp with a datagram counter and OPT_TSONLY
+        // keeps the kernel from looping the packet content back to us
+        flags |= hardware ? SOF_TIMESTAMPING_TX_HARDWARE : SOF_TIMESTAMPING_TX_SOFTWARE;
+        flags |= SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    }
+    if (setsockopt(handle, SOL_SOCKET, SO_TIMESTAMPING, (char*)&flags, sizeof(flags)) < 0)
+    {
+        PLOG(PL_ERROR, "ProtoSocket::EnableTimestamping() setsockopt(SO_TIMESTAMPING) error: %s\n", GetErrorString());
+        return false;
+    }
+    recv_timestamp = true;
+    tx_timestamp = txStamps;
+    tx_stamp_id = 0;  // the kernel resets its counter, too
+    return true;
+#else
+    PLOG(PL_ERROR, "ProtoSocket::EnableTimestamping() error: not supported on this platform\n");
+    return false;
+#endif // if/else SO_TIMESTAMPING
+}  // end ProtoSocket::EnableTimestamping()
+
+bool ProtoSocket::RecvTxTimestamp(UINT32& txId, ProtoTime& txTime)
+{
+#ifdef SO_TIMESTAMPING
+    if (!tx_timestamp) return false;
+    while (1)
+    {
+        char cdata[256];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = cdata;
+        msg.msg_controllen = sizeof(cdata);
+        if (recvmsg(handle, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if ((EAGAIN != errno) && (EINTR != errno))
+                PLOG(PL_ERROR, "ProtoSocket::RecvTxTimestamp() recvmsg() error: %s\n", GetErrorString());
+            return false;
+        }
+        bool haveId = false;
+        txTime.Zeroize();
+        for (struct cmsghdr* cmptr = CMSG_FIRSTHDR(&msg); cmptr != NULL; cmptr = CMSG_NXTHDR(&msg, cmptr)) 
+        {
+            if ((SOL_SOCKET == cmptr->cmsg_level) && (SCM_TIMESTAMPING == cmptr->cmsg_type))
+            {
+                struct scm_timestamping stamps;
+                memcpy(&stamps, CMSG_DATA(cmptr), sizeof(stamps));
+                const struct timespec& ts = ((0 != stamps.ts[2].tv_sec) || (0 != stamps.ts[2].tv_nsec)) ?
+                                                stamps.ts[2] : stamps.ts[0];
+                txTime.AccessTimeVal().tv_sec = ts.tv_sec;
+                txTime.AccessTimeVal().tv_usec = ts.tv_nsec / 1000;
+            }
+            else if (((IPPROTO_IP == cmptr->cmsg_level) && (IP_RECVERR == cmptr->cmsg_type)) ||
+                     ((IPPROTO_IPV6 == cmptr->cmsg_level) && (IPV6_RECVERR == cmptr->cmsg_type)))
+            {
+                struct sock_extended_err err;
+                memcpy(&err, CMSG_DATA(cmptr), sizeof(err));
+                if ((ENOMSG == err.ee_errno) && (SO_EE_ORIGIN_TIMESTAMPING == err.ee_origin))
+                {
+                    txId = err.ee_data;
+                    haveId = true;
+                }
+                else
+                {
+                    // Some other error queue entry (e.g. ICMP port unreachable) that reading
+                    // the error queue here consumes, so at least make note of it.
+                    PLOG(PL_DEBUG, "ProtoSocket::RecvTxTimestamp() non-timestamp error queue entry "
+                                   "(origin:%u errno:%u type:%u code:%u): %s\n",
+                                   (unsigned int)err.ee_origin, (unsigned int)err.ee_errno,
+                                   (unsigned int)err.ee_type, (unsigned int)err.ee_code,
+                                   strerror(err.ee_errno));
+                }
+            }
+        }
+        if (haveId && !txTime.IsZero()) return true;
+        // else it was some other error queue message, so try the next
+    }
+#else
+    return false;
+#endif // if/else SO_TIMESTAMPING
+}  // end ProtoSocket::RecvTxTimestamp()
+
+bool ProtoSocket::EnableTxTime(bool tai)
+{
+#if defined(SO_TXTIME) && defined(SCM_TXTIME)
+    if (!IsOpen())
+    {
+        PLOG(PL_ERROR, "ProtoSocket::EnableTxTime() error: socket not open\n");
+        return false;
+    }
+    if (TCP == protocol)
+    {
+        PLOG(PL_ERROR, "ProtoSocket::EnableTxTime() error: not supported for TCP sockets\n");
+        return false;
+    }
+#ifdef CLOCK_TAI
+    int clockId = tai ? CLOCK_TAI : CLOCK_MONOTONIC;
+#else
+    if (tai)
+    {
+        PLOG(PL_ERROR, "ProtoSocket::EnableTxTime() error: CLOCK_TAI not supported\n");
+        return false;
+    }
+    int clockId = CLOCK_MONOTONIC;
+#endif // if/else CLOCK_TAI
+    struct sock_txtime txTime;
+    txTime.clockid = clockId;
+    txTime.flags = 0;  // (no SOF_TXTIME_REPORT_ERRORS, as nothing reads them)
+    if (setsockopt(handle, SOL_SOCKET, SO_TXTIME, (char*)&txTime, sizeof(txTime)) < 0)
+    {
+        PLOG(PL_ERROR, "ProtoSocket::EnableTxTime() setsockopt(SO_TXTIME) error: %s\n", GetErrorString());
+        return false;
+    }
+    tx_time = true;
+    tx_time_clock = clockId;
+    return true;
+#else
+    PLOG(PL_ERROR, "ProtoSocket::EnableTxTime() error: not supported on this platform\n");
+    return false;
+#endif // if/else SO_TXTIME && SCM_TXTIME
+}  // end ProtoSocket::EnableTxTime()
+
+bool ProtoSocket::SendAt(const char*         buffer, 
+                         unsigned int&       buflen, 
+                         const ProtoAddress& dstAddr,
+                         const ProtoTime&    launchTime)
+{
+#if defined(SO_TXTIME) && defined(SCM_TXTIME)
+    if (!tx_time) return SendTo(buffer, buflen, dstAddr);
+    // Convert the launch time to the SO_TXTIME clock, using how far
+    // ahead of the current system time it is
+    struct timespec sysNow, clockNow;
+    clock_gettime(CLOCK_REALTIME, &sysNow);
+    clock_gettime(tx_time_clock, &clockNow);
+    const struct timeval& launch = launchTime.GetTimeVal();
+    int64_t delta = ((int64_t)launch.tv_sec - (int64_t)sysNow.tv_sec) * 1000000000 +
+                    ((int64_t)launch.tv_usec * 1000 - (int64_t)sysNow.tv_nsec);
+    uint64_t txTime = (uint64_t)clockNow.tv_sec * 1000000000 + (uint64_t)clockNow.tv_nsec;
+    if (delta > 0) txTime += (uint64_t)delta;
+    
+    struct iovec iov;
+    iov.iov_base = (void*)buffer;
+    iov.iov_len = buflen;
+    char cdata[CMSG_SPACE(sizeof(uint64_t))];
+    memset(cdata, 0, sizeof(cdata));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    if (!IsConnected())
+    {
+        msg.msg_name = (void*)&dstAddr.GetSockAddr();
+#ifdef HAVE_IPV6
+        if (flow_label && (ProtoAddress::IPv6 == dstAddr.GetType()))
+            ((struct sockaddr_in6*)(&dstAddr.GetSockAddrStorage()))->sin6_flowinfo = flow_label;
+        if (ProtoAddress::IPv6 == dstAddr.GetType())
+            msg.msg_namelen = sizeof(struct sockaddr_in6);
+        else
+#endif //HAVE_IPV6
+            msg.msg_namelen = sizeof(struct sockaddr_in);
+    }
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cdata;
+    msg.msg_controllen = sizeof(cdata);
+    struct cmsghdr* cmptr = CMSG_FIRSTHDR(&msg);
+    cmptr->cmsg_level = SOL_SOCKET;
+    cmptr->cmsg_type = SCM_TXTIME;
+    cmptr->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+    memcpy(CMSG_DATA(cmptr), &txTime, sizeof(uint64_t));
+    
+    ssize_t result = sendmsg(handle, &msg, 0);
+    if (result < 0)
+    {
+        buflen = 0;
+        switch (errno)
+        {
+            case EINTR:
+            case EAGAIN:
+                return true;
+            case ENOBUFS:
+                PLOG(PL_DEBUG, "ProtoSocket::SendAt() sendmsg() error: %s\n", GetErrorString());
+                return false;
+            default:
+                break;
+        }
+        PLOG(PL_ERROR, "ProtoSocket::SendAt() sendmsg() error: %s\n", GetErrorString());
+        return false;
+    }
+    if (tx_timestamp) tx_stamp_id++;
+    return true;
+#else
+    return SendTo(buffer, buflen, dstAddr);
+#endif // if/else SO_TXTIME && SCM_TXTIME
+}  // end ProtoSocket::SendAt()
+
+bool ProtoSocket::SendVector(const char* const*  bufferArray,
+                             const unsigned int* numBytesArray,
+                             unsigned int        count,
+                             unsigned int&       numBytes,
+                             bool                zeroCopy)
+{
+    numBytes = 0;
+    if (!IsConnected())
+    {
+        PLOG(PL_ERROR, "ProtoSocket::SendVector() error unconnected socket\n");
+        return false;   
+    }
+#if defined(WIN32) || defined(SIMULATE)
+    // Loop over Send() until done or the socket would block
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned int len = numBytesArray[i];
+        if (!Send(bufferArray[i], len)) 
+            return (0 != numBytes);  // (the error recurs on the next call)
+        numBytes += len;
+        if (len < numBytesArray[i]) break;
+    }
+    return true;
+#else
+    // Max buffers per sendmsg() call (the rest is left for the next call)
+    const unsigned int IOV_BATCH_MAX = 16;
+    struct iovec iov[IOV_BATCH_MAX];
+    if (count > IOV_BATCH_MAX) count = IOV_BATCH_MAX;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        iov[i].iov_base = (void*)bufferArray[i];
+        iov[i].iov_len = numBytesArray[i];
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    int flags = 0;
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    if (zeroCopy && zero_copy) flags |= MSG_ZEROCOPY;
+#endif // SO_ZEROCOPY && MSG_ZEROCOPY
+    ssize_t result = sendmsg(handle, &msg, flags);
+    if ((result < 0) && (ENOBUFS == errno) && (0 != flags))
+    {
+        // The socket's zero copy (optmem) limit was hit, so copy this time
+        flags = 0;
+        result = sendmsg(handle, &msg, flags);
+    }
+    if (result < 0)
+    {
+        switch (errno)
+        {
+            case EINTR:
+            case EAGAIN:
+                return true;
+            case ENETRESET:
+            case ECONNABORTED:
+            case ECONNRESET:
+            case ESHUTDOWN:
+            case ENOTCONN:
+                OnNotify(NOTIFY_ERROR);
+                break;
+            case ENOBUFS:
+                PLOG(PL_DEBUG, "ProtoSocket::SendVector() sendmsg() error: %s\n", GetErrorString());
+                return false;
+            default:
+                PLOG(PL_ERROR, "ProtoSocket::SendVector() sendmsg() error: %s\n", GetErrorString());
+                break;
+        }
+        return false;
+    }
+    numBytes = (unsigned int)result;
+    if ((0 != flags) && (0 != result)) zero_copy_id++;
+    return true;
+#endif // if/else WIN32 || SIMULATE
+}  // end ProtoSocket::SendVector()
+
+bool ProtoSocket::EnableZeroCopy()
+{
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    if (!IsOpen())
+    {
+        PLOG(PL_ERROR, "ProtoSocket::EnableZeroCopy() error: socket not open\n");
+        return false;
+    }
+    int enable = 1;
+    if (setsockopt(handle, SOL_SOCKET, SO_ZEROCOPY, (char*)&enable, sizeof(enable)) < 0)
+    {
+        PLOG(PL_ERROR, "ProtoSocket::EnableZeroCopy() setsockopt(SO_ZEROCOPY) error: %s\n", GetErrorString());
+        return false;
+    }
+    zero_copy = true;
+    zero_copy_id = zero_copy_done = 0;  // (the kernel counts from zero, too)
+    zero_copy_copied = false;
+    return true;
+#else
+    PLOG(PL_ERROR, "ProtoSocket::EnableZeroCopy() error: not supported on this platform\n");
+    return false;
+#endif // if/else SO_ZEROCOPY && MSG_ZEROCOPY
+}  // end ProtoSocket::EnableZeroCopy()
+
+bool ProtoSocket::RecvZeroCopyCompletions()
+{
+#if defined(SO_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+    if (!zero_copy) return false;
+    bool result = false;
+    while (1)
+    {
+        char cdata[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = cdata;
+        msg.msg_controllen = sizeof(cdata);
+        if (recvmsg(handle, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if ((EAGAIN != errno) && (EINTR != errno))
+                PLOG(PL_ERROR, "ProtoSocket::RecvZeroCopyCompletions() recvmsg() error: %s\n", GetErrorString());
+            return result;
+        }
+        for (struct cmsghdr* cmptr = CMSG_FIRSTHDR(&msg); cmptr != NULL; cmptr = CMSG_NXTHDR(&msg, cmptr)) 
+        {
+            if (((IPPROTO_IP == cmptr->cmsg_level) && (IP_RECVERR == cmptr->cmsg_type)) ||
+                ((IPPROTO_IPV6 == cmptr->cmsg_level) && (IPV6_RECVERR == cmptr->cmsg_type)))
+            {
+                struct sock_extended_err err;
+                memcpy(&err, CMSG_DATA(cmptr), sizeof(err));
+                if ((0 == err.ee_errno) && (SO_EE_ORIGIN_ZEROCOPY == err.ee_origin))
+                {
+                    // Sends "ee_info" through "ee_data" are complete
+                    zero_copy_done += err.ee_data - err.ee_info + 1;
+                    if (0 != (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED))
+                        zero_copy_copied = true;
+                    result = true;
+                }
+            }
+        }
+    }
+#else
+    return false;
+#endif // if/else SO_ZEROCOPY && SO_EE_ORIGIN_ZEROCOPY
+}  // end ProtoSocket::RecvZeroCopyCompletions()
+
+#if defined(LINUX) && !defined(ANDROID)
+#define HAVE_MMSG 1  // recvmmsg() and sendmmsg() are available
+#endif // LINUX && !ANDROID
+
+#ifdef HAVE_MMSG
+// Max number of datagrams per recvmmsg() or sendmmsg() call
+// (larger batches are broken into multiple calls)
+static const unsigned int MMSG_BATCH_MAX = 64;
+static const unsigned int MMSG_CDATA_SIZE = 128;
+#endif // HAVE_MMSG
+
+bool ProtoSocket::RecvBatch(char* const*    bufferArray,
+                            unsigned int*   numBytesArray,
+                            ProtoAddress*   srcAddrArray,
+                            unsigned int&   count,
+                            ProtoAddress*   dstAddrArray,
+                            ProtoTime*      rxTimeArray)
+{
+    if (!IsBound())
+    {
+        PLOG(PL_ERROR, "ProtoSocket::RecvBatch() error: socket not bound\n");
+        count = 0;
+        return false;
+    }
+    // (should enable these ahead of time to make sure you don't miss any)
+    if ((NULL != dstAddrArray) && !ip_recvdstaddr) EnableRecvDstAddr();  
+    if ((NULL != rxTimeArray) && !recv_timestamp) EnableRecvTimestamp();
+#ifdef HAVE_MMSG
+    bool getInfo = ((NULL != dstAddrArray) || (NULL != rxTimeArray));
+    struct mmsghdr msgs[MMSG_BATCH_MAX];
+    struct iovec iovs[MMSG_BATCH_MAX];
+    struct sockaddr_storage addrs[MMSG_BATCH_MAX];
+    char cdata[MMSG_BATCH_MAX][MMSG_CDATA_SIZE];
+    unsigned int total = 0;
+    while (total < count)
+    {
+        unsigned int batchSize = count - total;
+        if (batchSize > MMSG_BATCH_MAX) batchSize = MMSG_BATCH_MAX;
+        for (unsigned int i = 0; i < batchSize; i++)
+        {
+            iovs[i].iov_base = bufferArray[total + i];
+            iovs[i].iov_len = numBytesArray[total + i];
+            struct msghdr& msg = msgs[i].msg_hdr;
+            msg.msg_name = &addrs[i];
+            msg.msg_namelen = sizeof(struct sockaddr_storage);
+            msg.msg_iov = &iovs[i];
+            msg.msg_iovlen = 1;
+            msg.msg_control = getInfo ? cdata[i] : NULL;
+            msg.msg_controllen = getInfo ? MMSG_CDATA_SIZE : 0;
+            msg.msg_flags = 0;
+            msgs[i].msg_len = 0;
+        }
+        // (MSG_WAITFORONE / MSG_DONTWAIT so a blocking socket only waits for the first datagram)
+        int result = recvmmsg(handle, msgs, batchSize, (0 == total) ? MSG_WAITFORONE : MSG_DONTWAIT, NULL);
+        if (result < 0)
+        {
+            if ((EINTR == errno) || (EAGAIN == errno) || (0 != total)) break;
+            PLOG(PL_ERROR, "ProtoSocket::RecvBatch() recvmmsg() error: %s\n", GetErrorString());
+            count = 0;
+            return false;
+        }
+        for (int i = 0; i < result; i++)
+        {
+            unsigned int index = total + i;
+            numBytesArray[index] = msgs[i].msg_len;
+            srcAddrArray[index].SetSockAddr(*((struct sockaddr*)&addrs[i]));
+            if (NULL != dstAddrArray) dstAddrArray[index].Invalidate();
+            if (getInfo)
+            {
+                GetRecvMsgInfo(msgs[i].msg_hdr, (NULL != dstAddrArray) ? (dstAddrArray + index) : NULL,
+                                                (NULL != rxTimeArray) ? (rxTimeArray + index) : NULL);
+                if ((NULL != rxTimeArray) && rxTimeArray[index].IsZero())
+                    rxTimeArray[index].GetCurrentTime();
+            }
+        }
+        total += result;
+        if ((unsigned int)result < batchSize) break;  // socket was drained
+    }
+    count = total;
+    return true;
+#else
+    // Loop over RecvFrom() until the socket is drained or arrays are full
+    unsigned int total = 0;
+    while (total < count)
+    {
+        unsigned int numBytes = numBytesArray[total];
+        bool result = (NULL != dstAddrArray) ?
+                        RecvFrom(bufferArray[total], numBytes, srcAddrArray[total], dstAddrArray[total]) :
+                        RecvFrom(bufferArray[total], numBytes, srcAddrArray[total]);
+        if (!result)
+        {
+            if (0 != total) break;
+            PLOG(PL_ERROR, "ProtoSocket::RecvBatch() error: RecvFrom() failed\n");
+            count = 0;
+            return false;
+        }
+        if (0 == numBytes) break;  // nothing more to read
+        numBytesArray[total] = numBytes;
+        // No kernel timestamp available here, so we use the current time
+        if (NULL != rxTimeArray) rxTimeArray[total].GetCurrentTime();
+        total++;
+        if (NULL == notifier) break;  // blocking socket, so don't wait for more
+    }
+    count = total;
+    return true;
+#endif // if/else HAVE_MMSG
+}  // end ProtoSocket::RecvBatch()
+
+bool ProtoSocket::SendBatch(const char* const*  bufferArray,
+                            unsigned int*       numBytesArray,
+                            const ProtoAddress* dstAddrArray,
+                            unsigned int&       count)
+{
+    if (0 == count) return true;
+    if (!IsOpen())
+    {
+        if ((NULL == dstAddrArray) || !Open(0, dstAddrArray[0].GetType()))
+        {
+            PLOG(PL_ERROR, "ProtoSocket::SendBatch() error: socket not open\n");
+            count = 0;
+            return false;
+        }
+    }
+#ifdef HAVE_MMSG
+    if ((TCP != protocol) && ((NULL != dstAddrArray) || IsConnected()))
+    {
+        struct mmsghdr msgs[MMSG_BATCH_MAX];
+        struct iovec iovs[MMSG_BATCH_MAX];
+        unsigned int total = 0;
+        while (total < count)
+        {
+            unsigned int batchSize = count - total;
+            if (batchSize > MMSG_BATCH_MAX) batchSize = MMSG_BATCH_MAX;
+            for (unsigned int i = 0; i < batchSize; i++)
+            {
+                unsigned int index = total + i;
+                iovs[i].iov_base = (void*)bufferArray[index];
+                iovs[i].iov_len = numBytesArray[index];
+                struct msghdr& msg = msgs[i].msg_hdr;
+                if (IsConnected() || (NULL == dstAddrArray))
+                {
+                    msg.msg_name = NULL;
+                    msg.msg_namelen = 0;
+                }
+                else
+                {
+                    const ProtoAddress& dstAddr = dstAddrArray[index];
+#ifdef HAVE_IPV6
+                    if (ProtoAddress::IPv6 == dstAddr.GetType())
+                    {
+                        if (0 != flow_label)
+                            ((struct sockaddr_in6*)(&dstAddr.GetSockAddrStorage()))->sin6_flowinfo = flow_label;
+                        msg.msg_namelen = sizeof(struct sockaddr_in6);
+                    }
+                    else
+#endif //HAVE_IPV6
+                    {
+                        msg.msg_namelen = sizeof(struct sockaddr_in);
+                    }
+                    msg.msg_name = (void*)&dstAddr.GetSockAddr();
+                }
+                msg.msg_iov = &iovs[i];
+                msg.msg_iovlen = 1;
+                msg.msg_control = NULL;
+                msg.msg_controllen = 0;
+                msg.msg_flags = 0;
+                msgs[i].msg_len = 0;
+            }
+            int result = sendmmsg(handle, msgs, batchSize, 0);
+            if (result < 0)
+            {
+                for (unsigned int i = total; i < count; i++)
+                    numBytesArray[i] = 0;
+                count = total;
+                switch (errno)
+                {
+                    case EINTR:
+                    case EAGAIN:
+                        return true;
+                    case ENOBUFS:
+                        PLOG(PL_DEBUG, "ProtoSocket::SendBatch() sendmmsg() error: %s\n", GetErrorString());
+                        return (0 != total);
+                    default:
+                        break;
+                }
+                PLOG(PL_ERROR, "ProtoSocket::SendBatch() sendmmsg() error: %s\n", GetErrorString());
+                return (0 != total);
+            }
+            for (int i = 0; i < result; i++)
+                numBytesArray[total + i] = msgs[i].msg_len;
+            total += result;
+            if (tx_timestamp) tx_stamp_id += result;
+            if ((unsigned int)result < batchSize)
+            {
+                // Socket send buffer is full (or the next datagram has an error
+                // that will be reported by the next call)
+                for (unsigned int i = total; i < count; i++)
+                    numBytesArray[i] = 0;
+                break;
+            }
+        }
+        count = total;
+        return true;
+    }
+#endif // HAVE_MMSG
+    // Loop over SendTo() (or Send()) until done or the socket would block
+    unsigned int total = 0;
+    while (total < count)
+    {
+        unsigned int numBytes = numBytesArray[total];
+        bool result = (NULL != dstAddrArray) ?
+                        SendTo(bufferArray[total], numBytes, dstAddrArray[total]) :
+                        Send(bufferArray[total], numBytes);
+        if (!result)
+        {
+            for (unsigned int i = total; i < count; i++)
+                numBytesArray[i] = 0;
+            count = total;
+            return (0 != total);
+        }
+        if (0 == numBytes) break;  // would block
+        numBytesArray[total++] = numBytes;
+    }
+    for (unsigned int i = total; i < count; i++)
+        numBytesArray[i] = 0;
+    count = total;
+    return true;
+}  // end ProtoSocket::SendBatch()
+
 #ifdef HAVE_IPV6
 #ifndef IPV6_ADD_MEMBERSHIP
 #define IPV6_ADD_MEMBERSHIP IPV6_JOIN_GROUP
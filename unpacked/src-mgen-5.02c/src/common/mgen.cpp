@@ -4,6 +4,8 @@
 #include "mgenMsg.h"
 #include "mgenVersion.h"
 #include "mgenEvent.h"
+#include "mgenWorker.h"
+#include "mgenScript.h"
 
 #include <string.h>
 #include <stdio.h>   
@@ -66,11 +68,16 @@ Mgen::Mgen(ProtoTimerMgr&         timerMgr,
   sink_non_blocking(true),
   log_data(true), log_gps_data(true),
   checksum_enable(false), 
+  drec_unsorted(false),
   addr_type(ProtoAddress::IPv4), 
   get_position(NULL), get_position_data(NULL),
   log_file(NULL), log_binary(false), local_time(false), log_flush(false), 
   log_file_lock(false), log_tx(false), log_open(false), log_empty(true),
-  reuse(true)
+  reuse(true), timestamp(false), timestamp_hw(false), tx_batch(1),
+  pace_mode(MgenPacer::OFF), pace_lead(0.0), zero_copy_min(0),
+  async_log_size(0), async_log_drop(false),
+  log_rx(true), stats_enable(false), stats_file(NULL),
+  worker_list(NULL), worker_count(0), log_session(true)
 
 {
     start_timer.SetListener(this, &Mgen::OnStartTimeout);
@@ -80,6 +87,10 @@ Mgen::Mgen(ProtoTimerMgr&         timerMgr,
     drec_event_timer.SetListener(this, &Mgen::OnDrecEventTimeout);
     drec_event_timer.SetInterval(0.0);
     drec_event_timer.SetRepeat(-1);
+    
+    stats_timer.SetListener(this, &Mgen::OnStatsTimeout);
+    stats_timer.SetInterval(0.0);
+    stats_timer.SetRepeat(-1);
 
     default_interface[0] = '\0';
     sink_path[0] = '\0';
@@ -90,6 +101,7 @@ Mgen::Mgen(ProtoTimerMgr&         timerMgr,
 Mgen::~Mgen()
 {
     Stop();
+    SetWorkerCount(0);
     if (save_path) delete save_path;
 }
 
@@ -111,7 +123,8 @@ bool Mgen::Start()
     if (start_sec < 0.0)
     {
         // Start immediately
-        if (log_file)
+        if (!SortEvents()) return false;
+        if (log_file && log_session)
         {
             // Log START event
             if (log_binary)
@@ -178,12 +191,17 @@ bool Mgen::Start()
         flow_list.Start(offset);
         
         // Pre-process drec events occurring prior to "offset" time
+        // (with workers, events at the start time are processed now too,
+        // so receive sockets are open before the worker flows begin)
+        double drecOffset = ((0 != worker_count) && (offset < 0.0)) ? 0.0 : offset;
         DrecEvent* nextEvent = (DrecEvent*)drec_event_list.Head();
         offset_pending = true;
         while (nextEvent)
         {
-            if (nextEvent->GetTime() <= offset)
+            if (nextEvent->GetTime() <= drecOffset)
             {
+                // (only events prior to "offset" are processed silently)
+                offset_pending = (nextEvent->GetTime() <= offset);
                 ProcessDrecEvent(*nextEvent);
             }
             else
@@ -200,6 +218,16 @@ bool Mgen::Start()
 
         // Activate any group joins deferred during "offset" processing.
         drec_group_list.JoinDeferredGroups(*this);
+        
+        // Start the worker threads' flows
+        for (unsigned int i = 0; i < worker_count; i++)
+        {
+            // (picks up settings made other than by command, e.g. by MgenApp)
+            if (!worker_list[i]->IsRunning())
+                CopySettings(worker_list[i]->AccessMgen());
+            if (!worker_list[i]->Start())
+                DMSG(0, "Mgen::Start() error: worker %u not started\n", i);
+        }
     }
     else  // Schedule absolute start time
     {
@@ -324,6 +352,43 @@ bool Mgen::LeaveGroup(MgenTransport* mgenTransport,
     }
 }  // end Mgen::LeaveGroup()
 
+bool Mgen::TransportMatches(MgenTransport*      next,
+                            Protocol            theProtocol,
+                            UINT16              srcPort,
+                            const ProtoAddress& dstAddress,
+                            bool                closedOnly,
+                            const char*         interfaceName)
+{
+    // Same protocol and srcPort?
+    if (
+        (next->GetProtocol() == theProtocol) 
+        &&
+        (srcPort == 0 || next->srcPort == srcPort) 
+        &&
+        ((NULL == interfaceName ) ||
+         (NULL != interfaceName && NULL != next->GetInterface() && !strcmp(interfaceName,next->GetInterface())))
+        &&
+        // ignore events && unconnected udp sockets
+        // have invalid addrs and should match
+        (((!dstAddress.IsValid() && !next->dstAddress.IsValid()) && theProtocol == UDP)
+         ||
+         // For tcp ignore events we want to close the
+         // listening socket too which won't have a dst address
+         (theProtocol == TCP && !dstAddress.IsValid())
+         || 
+         (dstAddress.IsValid() && next->dstAddress.IsEqual(dstAddress)))
+        
+        // We should only have one sink
+        || 
+        (next->GetProtocol() == SINK && theProtocol == SINK)
+        )
+    {
+        if (!closedOnly) { return true; }
+        if (!next->IsOpen())  { return true;}
+    }
+    return false;
+}  // end Mgen::TransportMatches()
+
 /**
  * This finds us a mgenTransport with matching attributes  
  * If a valid mgenTransport ptr is passed, we get the next 
@@ -336,45 +401,49 @@ MgenTransport* Mgen::FindMgenTransport(Protocol theProtocol,
                                        MgenTransport* mgenTransport,
                                        const char* interfaceName)
 { 
-    MgenTransport* next;
-    if (!mgenTransport) {next = transport_list.head;}
-    else {next = mgenTransport->next;}
-    
-    while (next)
+    if ((SINK == theProtocol) || ((0 == srcPort) && !dstAddress.IsValid()))
     {
-        // Same protocol and srcPort?
-      if (
-          (next->GetProtocol() == theProtocol) 
-          &&
-          (srcPort == 0 || next->srcPort == srcPort) 
-          &&
-          ((NULL == interfaceName ) ||
-           (NULL != interfaceName && NULL != next->GetInterface() && !strcmp(interfaceName,next->GetInterface())))
-          &&
-          // ignore events && unconnected udp sockets
-          // have invalid addrs and should match
-          (((!dstAddress.IsValid() && !next->dstAddress.IsValid()) && theProtocol == UDP)
-           ||
-           // For tcp ignore events we want to close the
-           // listening socket too which won't have a dst address
-           (theProtocol == TCP && !dstAddress.IsValid())
-           || 
-           (dstAddress.IsValid() && next->dstAddress.IsEqual(dstAddress)))
-          
-          // We should only have one sink
-          || 
-          (next->GetProtocol() == SINK && theProtocol == SINK)
-          )
+        // Wildcard search, so scan the list
+        MgenTransport* next;
+        if (!mgenTransport) {next = transport_list.head;}
+        else {next = mgenTransport->next;}
+        while (next)
         {
-	  if (!closedOnly) { return next; }
-	  if (!next->IsOpen())  { return next;}
-
-
+            if (TransportMatches(next, theProtocol, srcPort, dstAddress, closedOnly, interfaceName))
+              return next;
+            next = next->next;   
         }
-        next = next->next;   
+        return (MgenTransport*)NULL;
     }
-
-    return (MgenTransport*)NULL;
+    
+    // Any match is in the srcPort (or dstAddress) index bucket, 
+    // and we want the one that comes first in the list after "mgenTransport"
+    char key[MgenHashIndex::KEY_MAX];
+    unsigned int keyLen;
+    const MgenTransportList::TransportIndex* index;
+    if (0 != srcPort)
+    {
+        keyLen = MgenTransportList::MakePortKey(key, theProtocol, srcPort);
+        index = &transport_list.port_index;
+    }
+    else
+    {
+        keyLen = MgenTransportList::MakeDstKey(key, theProtocol, dstAddress);
+        index = &transport_list.dst_index;
+    }
+    MgenTransport* match = NULL;
+    MgenTransportList::TransportIndex::Iterator iterator(*index, key, keyLen);
+    MgenTransport* next;
+    while (NULL != (next = iterator.GetNextItem()))
+    {
+        if ((NULL != mgenTransport) && (next->list_order <= mgenTransport->list_order))
+          continue;
+        if ((NULL != match) && (next->list_order >= match->list_order))
+          continue;
+        if (TransportMatches(next, theProtocol, srcPort, dstAddress, closedOnly, interfaceName))
+          match = next;
+    }
+    return match;
     
 }  // end MgenTransport::FindMgenTransport()
 
@@ -389,6 +458,23 @@ MgenTransport* Mgen::FindTransportByInterface(const char*           interfaceNam
 {
 
     MgenTransport* nextTransport = transport_list.head;
+    if (0 != thePort)
+    {
+        // Only the first UDP transport on the list with this
+        // port and address type can match, so find it by index
+        char key[MgenHashIndex::KEY_MAX];
+        unsigned int keyLen = MgenTransportList::MakePortKey(key, UDP, thePort);
+        MgenTransportList::TransportIndex::Iterator iterator(transport_list.port_index, key, keyLen);
+        MgenTransport* first = NULL;
+        MgenTransport* next;
+        while (NULL != (next = iterator.GetNextItem()))
+        {
+            if ((next->GetAddressType() == addrType) && 
+                ((NULL == first) || (next->list_order < first->list_order)))
+              first = next;
+        }
+        nextTransport = first;
+    }
     while (nextTransport)
     {
         if (nextTransport->GetAddressType() != addrType)
@@ -463,13 +549,10 @@ MgenTransport* Mgen::FindTransportByInterface(const char*           interfaceNam
 
 MgenTransport* Mgen::FindMgenTransportBySocket(const ProtoSocket& socket)
 {
-    MgenTransport* next = transport_list.head;
-    while (next)
-    {
-        if (next->OwnsSocket(socket)) 
-          return next;
-        next = next->next;   
-    }
+    const ProtoSocket* socketPtr = &socket;
+    MgenTransport* next = transport_list.socket_index.Find((const char*)&socketPtr, sizeof(socketPtr));
+    if ((NULL != next) && next->OwnsSocket(socket))
+      return next;
     return (MgenTransport*)NULL;
 }  // end Mgen::FindMgenTransportBySocket()
 
@@ -551,9 +634,32 @@ MgenTransport* Mgen::GetMgenTransport(Protocol theProtocol,
 
 void Mgen::Stop()
 {
+    // Stop the workers first so their final output is merged into the log
+    for (unsigned int i = 0; i < worker_count; i++)
+        worker_list[i]->Stop();
+    if (stats_enable)
+    {
+        // Final receive statistics report
+        if (started) ReportStats();
+        if (stats_timer.IsActive()) stats_timer.Deactivate();
+        if (NULL != stats_file)
+        {
+            fclose(stats_file);
+            stats_file = NULL;
+        }
+        recv_stats.Reset();
+        stats_enable = false;
+    }
     if (started)
     {
-        if (NULL != log_file) 
+        // PACE reports for flows still running
+        MgenFlow* flow = flow_list.Head();
+        while (NULL != flow)
+        {
+            flow->ReportPace();
+            flow = flow->Next();
+        }
+        if ((NULL != log_file) && log_session)
         {
             // Log STOP event
             struct timeval currentTime;
@@ -627,7 +733,14 @@ void Mgen::Stop()
     if (NULL != log_file)
     {
         fflush(log_file);
-        if ((log_file != stdout) && (stderr != log_file))
+        // (an MgenLogWriter wrapping stdout or stderr is just synced)
+        FILE* logFile = log_file;
+        if (log_writer.IsOpen())
+        {
+            log_writer.Sync();
+            logFile = log_writer.GetFile();
+        }
+        if ((logFile != stdout) && (stderr != logFile))
         {
             fclose(log_file);
             log_file = NULL;   
@@ -639,6 +752,7 @@ void Mgen::Stop()
     flow_list.Destroy();
     if (drec_event_timer.IsActive()) drec_event_timer.Deactivate();
     drec_event_list.Destroy();
+    drec_unsorted = false;
     drec_group_list.Destroy(*this);
     transport_list.Destroy();
 }  // end Mgen::Stop()
@@ -673,6 +787,39 @@ bool Mgen::OnDrecEventTimeout(ProtoTimer& /*theTimer*/)
     }
 }  // end Mgen::OnDrecEventTimeout()
 
+bool Mgen::OnStatsTimeout(ProtoTimer& /*theTimer*/)
+{
+    ReportStats();
+    return true;
+}  // end Mgen::OnStatsTimeout()
+
+bool Mgen::ReportStats(const char* path)
+{
+    if (!stats_enable) return false;
+    if (NULL != path)
+    {
+        FILE* filePtr = fopen(path, "w");
+        if (NULL == filePtr)
+        {
+            DMSG(0, "Mgen::ReportStats() fopen() error: %s\n", GetErrorString());
+            return false;
+        }
+        // (queries to a file don't restart the periodic report "rate" interval)
+        recv_stats.Report(filePtr, local_time, false);
+        fclose(filePtr);
+    }
+    else if (NULL != stats_file)
+    {
+        recv_stats.Report(stats_file, local_time);
+    }
+    else
+    {
+        // (text reports would corrupt a binary log)
+        recv_stats.Report(((NULL != log_file) && !log_binary) ? log_file : stderr, local_time);
+    }
+    return true;
+}  // end Mgen::ReportStats()
+
 /**
  * Process JOIN, LEAVE, IGNORE, LISTEN events
  */
@@ -945,6 +1092,8 @@ void Mgen::SetLogFile(FILE* filePtr)
 {
     CloseLog();
     log_file = filePtr;
+    StartLogMerger();
+    StartLogWriter();
 #ifdef _WIN32_WCE
     if ((stdout == log_file) || (stderr == log_file))
         Log = Mgen::LogToDebug;
@@ -964,6 +1113,175 @@ void Mgen::CloseLog()
     }
 }  // end Mgen::CloseLog()
 
+// Wraps the current log file with the MgenLogWriter when ASYNCLOG is set
+void Mgen::StartLogWriter()
+{
+    if ((0 == async_log_size) || (NULL == log_file) || log_writer.IsOpen())
+        return;
+    FILE* logStream = log_writer.Open(log_file, async_log_size, async_log_drop, log_flush);
+    if (NULL != logStream)
+        log_file = logStream;
+    else
+        DMSG(0, "Mgen::StartLogWriter() warning: asynchronous log writer not started\n");
+}  // end Mgen::StartLogWriter()
+
+// Merges the worker logs into the current log file when there are workers
+void Mgen::StartLogMerger()
+{
+    if (0 == worker_count) return;
+    if ((NULL != log_file) && !log_merger.IsOpen())
+    {
+        // The merger must go beneath any asynchronous log writer (as in
+        // SetLogFile()), since only one thread may write to the writer's ring
+        bool restartWriter = log_writer.IsOpen();
+        if (restartWriter) log_file = log_writer.Detach();
+        FILE* logStream = log_merger.Open(log_file, log_binary, log_flush);
+        if (NULL != logStream)
+            log_file = logStream;
+        else
+            DMSG(0, "Mgen::StartLogMerger() warning: worker output will not be logged\n");
+        if (restartWriter) StartLogWriter();
+    }
+    // Each worker logs to its own merger source stream (or not at all)
+    for (unsigned int i = 0; i < worker_count; i++)
+        worker_list[i]->PostLogFile((NULL != log_file) ? log_merger.OpenSource() : NULL);
+}  // end Mgen::StartLogMerger()
+
+/**
+ * Creates "count" MgenWorker threads (replacing any existing ones), 
+ * each configured with the current global settings.  Subsequent
+ * MGEN events are passed to worker "flowId % count".
+ */
+bool Mgen::SetWorkerCount(unsigned int count)
+{
+    if (count == worker_count) return true;
+    if (started || !flow_list.IsEmpty())
+    {
+        DMSG(0, "Mgen::SetWorkerCount() Error: WORKERS must precede START and MGEN events\n");
+        return false;
+    }
+    if ((0 != count) && !MgenLogMerger::IsSupported())
+    {
+        DMSG(0, "Mgen::SetWorkerCount() Error: WORKERS not supported on this system\n");
+        return false;
+    }
+    for (unsigned int i = 0; i < worker_count; i++)
+        delete worker_list[i];
+    delete[] worker_list;
+    worker_list = NULL;
+    worker_count = 0;
+    if (0 == count) return true;
+    if (NULL == (worker_list = new MgenWorker*[count]))
+    {
+        DMSG(0, "Mgen::SetWorkerCount() new worker list error: %s\n", GetErrorString());
+        return false;
+    }
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (NULL == (worker_list[i] = new MgenWorker(i)))
+        {
+            DMSG(0, "Mgen::SetWorkerCount() new worker error: %s\n", GetErrorString());
+            for (unsigned int j = 0; j < i; j++)
+                delete worker_list[j];
+            delete[] worker_list;
+            worker_list = NULL;
+            worker_count = 0;
+            return false;
+        }
+        worker_count++;
+        CopySettings(worker_list[i]->AccessMgen());
+    }
+    StartLogMerger();
+    return true;
+}  // end Mgen::SetWorkerCount()
+
+// Copies the settings that affect MGEN flows and their logging
+void Mgen::CopySettings(Mgen& worker) const
+{
+    worker.controller = controller;
+    worker.offset = offset;
+    worker.offset_lock = offset_lock;
+    worker.checksum_force = checksum_force;
+    worker.default_flow_label = default_flow_label;
+    worker.default_label_lock = default_label_lock;
+    worker.default_tx_buffer = default_tx_buffer;
+    worker.default_rx_buffer = default_rx_buffer;
+    worker.default_broadcast = default_broadcast;
+    worker.default_tos = default_tos;
+    worker.default_multicast_ttl = default_multicast_ttl;
+    worker.default_unicast_ttl = default_unicast_ttl;
+    worker.default_df = default_df;
+    strncpy(worker.default_interface, default_interface, 16);
+    worker.default_queue_limit = default_queue_limit;
+    worker.default_broadcast_lock = default_broadcast_lock;
+    worker.default_tos_lock = default_tos_lock;
+    worker.default_multicast_ttl_lock = default_multicast_ttl_lock;
+    worker.default_unicast_ttl_lock = default_unicast_ttl_lock;
+    worker.default_df_lock = default_df_lock;
+    worker.default_tx_buffer_lock = default_tx_buffer_lock;
+    worker.default_rx_buffer_lock = default_rx_buffer_lock;
+    worker.default_interface_lock = default_interface_lock;
+    worker.default_queue_limit_lock = default_queue_limit_lock;
+    strncpy(worker.sink_path, sink_path, PATH_MAX);
+    strncpy(worker.source_path, source_path, PATH_MAX);
+    worker.sink_non_blocking = sink_non_blocking;
+    worker.log_data = log_data;
+    worker.log_gps_data = log_gps_data;
+    worker.host_addr = host_addr;
+    worker.checksum_enable = checksum_enable;
+    worker.addr_type = addr_type;
+    worker.get_position = get_position;
+    worker.get_position_data = get_position_data;
+#ifdef HAVE_GPS
+    worker.payload_handle = payload_handle;
+#endif // HAVE_GPS
+    worker.log_binary = log_binary;
+    worker.local_time = local_time;
+    worker.log_flush = log_flush;
+    worker.log_tx = log_tx;
+    worker.reuse = reuse;
+    worker.timestamp = timestamp;
+    worker.timestamp_hw = timestamp_hw;
+    worker.tx_batch = tx_batch;
+    worker.pace_mode = pace_mode;
+    worker.pace_lead = pace_lead;
+    worker.zero_copy_min = zero_copy_min;
+}  // end Mgen::CopySettings()
+
+// Global commands passed on to the workers (those affecting flows and their logging)
+bool Mgen::IsWorkerCommand(Command cmd)
+{
+    switch (cmd)
+    {
+        case OFFSET:
+        case TXLOG:
+        case LOCALTIME:
+        case BINARY:
+        case FLUSH:
+        case LABEL:
+        case TXBUFFER:
+        case RXBUFFER:
+        case BROADCAST:
+        case TOS:
+        case TTL:
+        case UNICAST_TTL:
+        case DF:
+        case INTERFACE:
+        case CHECKSUM:
+        case TXCHECKSUM:
+        case RXCHECKSUM:
+        case QUEUE:
+        case REUSE:
+        case TIMESTAMP:
+        case TXBATCH:
+        case PACE:
+        case ZEROCOPY:
+            return true;
+        default:
+            return false;
+    }
+}  // end Mgen::IsWorkerCommand()
+
 /**
  * Query flow_list and drec_event_list for an idea
  * of the current (or greatest) estimate of 
@@ -986,6 +1304,10 @@ double Mgen::GetCurrentOffset() const
  */
 bool Mgen::ParseScript(const char* path)
 {
+    // Precompiled scripts (see MgenBinaryScript) are loaded directly
+    if (MgenBinaryScript::IsBinaryScript(path))
+        return ParseBinaryScript(path);
+    
     // Open script file
     FILE* scriptFile = fopen(path, "r");
     if (!scriptFile)
@@ -1028,6 +1350,59 @@ bool Mgen::ParseScript(const char* path)
     return true;
 }  // end Mgen::ParseScript()
 
+bool Mgen::ParseBinaryScript(const char* path)
+{
+    MgenBinaryScript script;
+    if (!script.Open(path)) return false;
+    MgenBinaryScript::RecordType type;
+    unsigned int lineCount, len;
+    const char* data;
+    while (script.GetNextRecord(type, lineCount, data, len))
+    {
+        switch (type)
+        {
+            case MgenBinaryScript::SCRIPT_LINE:
+                if (!ParseEvent(data, lineCount))
+                {
+                    DMSG(0, "Mgen::ParseBinaryScript() Error: invalid mgen script line: %lu\n", 
+                            lineCount);
+                    return false;
+                }
+                break;
+            case MgenBinaryScript::MGEN_EVENT:
+            {
+                MgenEvent* theEvent = new MgenEvent();
+                if (!theEvent)
+                {
+                    DMSG(0, "Mgen::ParseBinaryScript() mgen event allocation error: %s\n",
+                         GetErrorString());
+                    return false; 
+                }
+                MgenScriptRecord record(data, len);
+                if (!theEvent->Unpack(record))
+                {
+                    DMSG(0, "Mgen::ParseBinaryScript() Error: invalid event record for line: %lu\n",
+                         lineCount);
+                    delete theEvent;
+                    return false;
+                }
+                if (!InsertMgenEvent(theEvent, lineCount)) return false;
+                break;
+            }
+            default:
+                DMSG(0, "Mgen::ParseBinaryScript() Error: invalid record type for line: %lu\n",
+                     lineCount);
+                return false;
+        }
+    }
+    if (script.IsError())
+    {
+        DMSG(0, "Mgen::ParseBinaryScript() Error: truncated binary script\n");
+        return false;
+    }
+    return true;
+}  // end Mgen::ParseBinaryScript()
+
 bool Mgen::ParseEvent(const char* lineBuffer, unsigned int lineCount)
 {
     const char *ptr = lineBuffer;
@@ -1105,29 +1480,11 @@ bool Mgen::ParseEvent(const char* lineBuffer, unsigned int lineCount)
                   return false;
               }
               
-              // 2) Find the flow
-              MgenFlow* theFlow = flow_list.FindFlowById(flowId);
-              if (!theFlow)
-              {
-                  if (!(theFlow = new MgenFlow(flowId, 
-                                               timer_mgr, 
-                                               controller,
-                                               *this,
-                                               default_queue_limit,
-                                               default_flow_label)))
-                  {
-                      DMSG(0, "Mgen::ParseEvent() Error: MgenFlow memory allocation error: %s\n",
-                           GetErrorString());   
-                      return false;
-                  }
-                  theFlow->SetPositionCallback(get_position, get_position_data);
-#ifdef HAVE_GPS
-                  theFlow->SetPayloadHandle(payload_handle);
-#endif // HAVE_GPS
-                  flow_list.Append(theFlow);
-              }
+              // Flows are sharded across any worker threads by flow id
+              if (0 != worker_count)
+                  return worker_list[flowId % worker_count]->PostEvent(lineBuffer, lineCount);
               
-              // 3) Create event object
+              // 2) Create event object
               MgenEvent* theEvent = new MgenEvent();
               if (!theEvent)
               {
@@ -1141,24 +1498,8 @@ bool Mgen::ParseEvent(const char* lineBuffer, unsigned int lineCount)
                   delete theEvent;
                   return false; 
               }
-              // Update host_addr port now that we know it
-              if (host_addr.IsValid() && theEvent->GetSrcPort() != 0)
-              { 
-                  host_addr.SetPort(theEvent->GetSrcPort());
-                  //   theFlow->SetHostAddress(host_addr);
-              }
-              // Update flow specific queue limit if specified
-              if (theEvent->GetQueueLimit())
-                theFlow->SetQueueLimit(theEvent->GetQueueLimit());
-              bool reallyStarted = (started && !start_timer.IsActive());
-              double currentTime =  reallyStarted ? GetCurrentOffset() : 0.0;
-              if (currentTime < 0.0) currentTime = 0.0;
-              if (!theFlow->InsertEvent(theEvent, reallyStarted, currentTime))
-              {
-                  DMSG(0, "Mgen::ParseEvent() Error: invalid mgen script line: %lu\n", lineCount);
-                  delete theEvent;
-                  return false;
-              }
+              // 3) Add it to its flow
+              if (!InsertMgenEvent(theEvent, lineCount)) return false;
           }  // End MGEN event processing
           else if (DrecEvent::INVALID_TYPE != DrecEvent::GetTypeFromString(fieldBuffer))
           {
@@ -1210,6 +1551,56 @@ bool Mgen::ParseEvent(const char* lineBuffer, unsigned int lineCount)
     return true;
 }  // end Mgen::ParseEvent()
 
+bool Mgen::InsertMgenEvent(MgenEvent* theEvent, unsigned int lineCount)
+{
+    unsigned long flowId = theEvent->GetFlowId();
+    // Flows are sharded across any worker threads by flow id
+    if (0 != worker_count)
+        return worker_list[flowId % worker_count]->PostMgenEvent(theEvent, lineCount);
+    
+    // Find the flow
+    MgenFlow* theFlow = flow_list.FindFlowById(flowId);
+    if (!theFlow)
+    {
+        if (!(theFlow = new MgenFlow(flowId, 
+                                     timer_mgr, 
+                                     controller,
+                                     *this,
+                                     default_queue_limit,
+                                     default_flow_label)))
+        {
+            DMSG(0, "Mgen::InsertMgenEvent() Error: MgenFlow memory allocation error: %s\n",
+                 GetErrorString());   
+            delete theEvent;
+            return false;
+        }
+        theFlow->SetPositionCallback(get_position, get_position_data);
+#ifdef HAVE_GPS
+        theFlow->SetPayloadHandle(payload_handle);
+#endif // HAVE_GPS
+        flow_list.Append(theFlow);
+    }
+    // Update host_addr port now that we know it
+    if (host_addr.IsValid() && theEvent->GetSrcPort() != 0)
+    { 
+        host_addr.SetPort(theEvent->GetSrcPort());
+        //   theFlow->SetHostAddress(host_addr);
+    }
+    // Update flow specific queue limit if specified
+    if (theEvent->GetQueueLimit())
+      theFlow->SetQueueLimit(theEvent->GetQueueLimit());
+    bool reallyStarted = (started && !start_timer.IsActive());
+    double currentTime =  reallyStarted ? GetCurrentOffset() : 0.0;
+    if (currentTime < 0.0) currentTime = 0.0;
+    if (!theFlow->InsertEvent(theEvent, reallyStarted, currentTime))
+    {
+        DMSG(0, "Mgen::InsertMgenEvent() Error: invalid mgen script line: %lu\n", lineCount);
+        delete theEvent;
+        return false;
+    }
+    return true;
+}  // end Mgen::InsertMgenEvent()
+
 void Mgen::InsertDrecEvent(DrecEvent* theEvent)
 {
     double eventTime = theEvent->GetTime();
@@ -1250,10 +1641,23 @@ void Mgen::InsertDrecEvent(DrecEvent* theEvent)
     {
         eventTime = eventTime > 0.0 ?  eventTime : 0.0;
         theEvent->SetTime(eventTime);
-        drec_event_list.Insert(theEvent);
+        const MgenBaseEvent* lastEvent = drec_event_list.Tail();
+        if (lastEvent && (eventTime < lastEvent->GetTime()))
+            drec_unsorted = true;
+        drec_event_list.Append(theEvent);
     }
 }  // end Mgen::InsertDrecEvent()
 
+bool Mgen::SortEvents()
+{
+    if (drec_unsorted)
+    {
+        if (!drec_event_list.Sort()) return false;
+        drec_unsorted = false;
+    }
+    return flow_list.SortEvents();
+}  // end Mgen::SortEvents()
+
 // Global command processing
 const StringMapper Mgen::COMMAND_LIST[] =
 {
@@ -1285,6 +1689,14 @@ const StringMapper Mgen::COMMAND_LIST[] =
     {"-RXCHECKSUM", RXCHECKSUM},
     {"+QUEUE",      QUEUE},
     {"+REUSE",      REUSE},
+    {"+TIMESTAMP",  TIMESTAMP},
+    {"+TXBATCH",    TXBATCH},
+    {"+ASYNCLOG",   ASYNCLOG},
+    {"+STATS",      STATS},
+    {"+RXLOG",      RXLOG},
+    {"+WORKERS",    WORKERS},
+    {"+PACE",       PACE},
+    {"+ZEROCOPY",   ZEROCOPY},
     {"+OFF",        INVALID_COMMAND},  // to deconflict "offset" from "off" event
     {NULL,          INVALID_COMMAND}   
 };
@@ -1699,6 +2111,44 @@ bool Mgen::OnCommand(Mgen::Command cmd, const char* arg, bool override)
       }
       break;
       
+    case TIMESTAMP:
+      if (!arg)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: missing argument to TIMESTAMP\n");
+          return false;   
+      }
+      {
+          // convert to upper case for case-insensitivity
+          char temp[4];
+          unsigned int len = strlen(arg);
+          len = len < 3 ? len : 3;
+          unsigned int i;
+          for (i = 0 ; i < len; i++)
+            temp[i] = toupper(arg[i]);
+          temp[i] = '\0';
+          if (!strncmp("ON", temp, len))
+          {
+              timestamp = true;
+              timestamp_hw = false;
+          }
+          else if (!strncmp("HW", temp, len))
+          {
+              timestamp = true;
+              timestamp_hw = true;
+          }
+          else if (!strncmp("OFF", temp, len))
+          {
+              timestamp = false;
+              timestamp_hw = false;
+          }
+          else
+          {
+              DMSG(0, "Mgen::OnCommand() Error: wrong argument to TIMESTAMP: %s\n", arg);
+              return false;   
+          }
+      }
+      break;
+      
     case LOCALTIME:
 	  local_time = true;
 	  break;
@@ -1714,6 +2164,8 @@ bool Mgen::OnCommand(Mgen::Command cmd, const char* arg, bool override)
       
     case FLUSH:
       log_flush = true;
+      log_writer.SetFlush(true);
+      log_merger.SetFlush(true);
       break;
       
     case TXCHECKSUM:
@@ -1738,11 +2190,277 @@ bool Mgen::OnCommand(Mgen::Command cmd, const char* arg, bool override)
       }
       SetDefaultQueueLimit(tmpQueueLimit,override);
       break;            
+
+    case TXBATCH:
+      {
+          int tmpBatch;
+          if (!arg || (1 != sscanf(arg, "%d", &tmpBatch)) || (tmpBatch < 1))
+          {
+              DMSG(0, "Mgen::OnCommand() Error: invalid TXBATCH count\n");
+              return false;
+          }
+          tx_batch = (tmpBatch > TX_BATCH_MAX) ? TX_BATCH_MAX : tmpBatch;
+      }
+      break;
+
+    case ASYNCLOG:
+      if (!arg)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: missing argument to ASYNCLOG\n");
+          return false;   
+      }
+      {
+          // convert to upper case for case-insensitivity
+          char temp[5];
+          unsigned int len = strcspn(arg, ",");
+          len = len < 4 ? len : 4;
+          unsigned int i;
+          for (i = 0 ; i < len; i++)
+            temp[i] = toupper(arg[i]);
+          temp[i] = '\0';
+          unsigned int bufferSize = MgenLogWriter::BUFFER_SIZE_DEFAULT;
+          bool dropOnFull = false;
+          if (0 == len)
+          {
+              DMSG(0, "Mgen::OnCommand() Error: invalid ASYNCLOG option\n");
+              return false;
+          }
+          else if (!strncmp("OFF", temp, len))
+          {
+              bufferSize = 0;
+          }
+          else if (!strncmp("DROP", temp, len))
+          {
+              dropOnFull = true;
+          }
+          else if (strncmp("ON", temp, len))
+          {
+              DMSG(0, "Mgen::OnCommand() Error: invalid ASYNCLOG option\n");
+              return false;
+          }
+          const char* sizePtr = strchr(arg, ',');
+          if (NULL != sizePtr)
+          {
+              unsigned int kbytes;
+              if ((1 != sscanf(sizePtr + 1, "%u", &kbytes)) || (0 == kbytes) || (kbytes > 1048576))
+              {
+                  DMSG(0, "Mgen::OnCommand() Error: invalid ASYNCLOG buffer size\n");
+                  return false;
+              }
+              if (0 != bufferSize) bufferSize = 1024 * kbytes;
+          }
+          if ((0 != bufferSize) && !MgenLogWriter::IsSupported())
+          {
+              DMSG(0, "Mgen::OnCommand() Error: ASYNCLOG not supported on this system\n");
+              return false;
+          }
+          // Any current log writer is restarted with the new settings
+          if (log_writer.IsOpen())
+              log_file = log_writer.Detach();
+          async_log_size = bufferSize;
+          async_log_drop = dropOnFull;
+          StartLogWriter();
+      }
+      break;
+
+    case STATS:
+      if (!arg)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: missing argument to STATS\n");
+          return false;   
+      }
+      {
+          // convert to upper case for case-insensitivity
+          char temp[7];
+          unsigned int len = strcspn(arg, ",");
+          const char* path = (',' == arg[len]) ? (arg + len + 1) : NULL;
+          if ((NULL != path) && ('\0' == *path)) path = NULL;
+          len = len < 6 ? len : 6;
+          unsigned int i;
+          for (i = 0 ; i < len; i++)
+            temp[i] = toupper(arg[i]);
+          temp[i] = '\0';
+          if (0 == len)
+          {
+              DMSG(0, "Mgen::OnCommand() Error: invalid STATS option\n");
+              return false;
+          }
+          else if (!strncmp("OFF", temp, len))
+          {
+              if (stats_timer.IsActive()) stats_timer.Deactivate();
+              if (NULL != stats_file)
+              {
+                  fclose(stats_file);
+                  stats_file = NULL;
+              }
+              recv_stats.Reset();
+              stats_enable = false;
+          }
+          else if (!strncmp("REPORT", temp, len))
+          {
+              // Immediate report (e.g. a query via the control pipe)
+              if (!stats_enable)
+              {
+                  DMSG(0, "Mgen::OnCommand() Error: STATS not enabled\n");
+                  return false;
+              }
+              if (!ReportStats(path)) return false;
+          }
+          else
+          {
+              double interval;
+              if ((1 != sscanf(arg, "%lf", &interval)) || (interval < 0.0))
+              {
+                  DMSG(0, "Mgen::OnCommand() Error: invalid STATS interval\n");
+                  return false;
+              }
+              if (NULL != path)
+              {
+                  FILE* filePtr = fopen(path, "w");
+                  if (NULL == filePtr)
+                  {
+                      DMSG(0, "Mgen::OnCommand() Error: STATS fopen() error: %s\n", GetErrorString());
+                      return false;
+                  }
+                  if (NULL != stats_file) fclose(stats_file);
+                  stats_file = filePtr;
+              }
+              stats_enable = true;
+              if (stats_timer.IsActive()) stats_timer.Deactivate();
+              if (interval > 0.0)
+              {
+                  stats_timer.SetInterval(interval);
+                  timer_mgr.ActivateTimer(stats_timer);
+              }
+          }
+      }
+      break;
+
+    case RXLOG:
+      if (!arg)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: missing argument to RXLOG\n");
+          return false;   
+      }
+      {
+          // convert to upper case for case-insensitivity
+          char temp[4];
+          unsigned int len = strlen(arg);
+          len = len < 3 ? len : 3;
+          unsigned int i;
+          for (i = 0 ; i < len; i++)
+            temp[i] = toupper(arg[i]);
+          temp[i] = '\0';
+          if ((0 != len) && !strncmp("ON", temp, len))
+              log_rx = true;
+          else if ((0 != len) && !strncmp("OFF", temp, len))
+              log_rx = false;
+          else
+          {
+              DMSG(0, "Mgen::OnCommand() Error: wrong argument to RXLOG: %s\n", arg);
+              return false;   
+          }
+      }
+      break;
+ 
+    case WORKERS:
+      {
+          unsigned int count;
+          if (!arg || (1 != sscanf(arg, "%u", &count)) || (count > WORKER_MAX))
+          {
+              DMSG(0, "Mgen::OnCommand() Error: invalid WORKERS count\n");
+              return false;
+          }
+          if (!SetWorkerCount(count)) return false;
+      }
+      break;
+ 
+    case PACE:
+      if (!arg)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: missing argument to PACE\n");
+          return false;   
+      }
+      {
+          char modeName[8];
+          unsigned int len = strcspn(arg, ",");
+          len = len < 7 ? len : 7;
+          strncpy(modeName, arg, len);
+          modeName[len] = '\0';
+          MgenPacer::Mode mode = MgenPacer::GetModeFromString(modeName);
+          if ((MgenPacer::Mode)-1 == mode)
+          {
+              DMSG(0, "Mgen::OnCommand() Error: invalid PACE mode\n");
+              return false;
+          }
+          double lead = (double)MgenPacer::TXTIME_LEAD_DEFAULT;
+          if (MgenPacer::SPIN == mode) lead = (double)MgenPacer::SPIN_LEAD_DEFAULT;
+          const char* leadPtr = strchr(arg, ',');
+          if (NULL != leadPtr)
+          {
+              if ((1 != sscanf(leadPtr + 1, "%lf", &lead)) || (lead < 0.0) || (lead > 1.0e+06))
+              {
+                  DMSG(0, "Mgen::OnCommand() Error: invalid PACE lead time\n");
+                  return false;
+              }
+          }
+          pace_mode = mode;
+          pace_lead = (MgenPacer::OFF == mode) ? 0.0 : (1.0e-06 * lead);
+      }
+      break;
+
+    case ZEROCOPY:
+      if (!arg)
+      {
+          DMSG(0, "Mgen::OnCommand() Error: missing argument to ZEROCOPY\n");
+          return false;   
+      }
+      {
+          // convert to upper case for case-insensitivity
+          char temp[4];
+          unsigned int len = strcspn(arg, ",");
+          len = len < 3 ? len : 3;
+          unsigned int i;
+          for (i = 0 ; i < len; i++)
+            temp[i] = toupper(arg[i]);
+          temp[i] = '\0';
+          unsigned int minBytes = ZERO_COPY_MIN_DEFAULT;
+          if (0 == len)
+          {
+              DMSG(0, "Mgen::OnCommand() Error: invalid ZEROCOPY option\n");
+              return false;
+          }
+          else if (!strncmp("OFF", temp, len))
+          {
+              minBytes = 0;
+          }
+          else if (strncmp("ON", temp, len))
+          {
+              DMSG(0, "Mgen::OnCommand() Error: invalid ZEROCOPY option\n");
+              return false;
+          }
+          const char* sizePtr = strchr(arg, ',');
+          if ((NULL != sizePtr) && (0 != minBytes))
+          {
+              if ((1 != sscanf(sizePtr + 1, "%u", &minBytes)) || (0 == minBytes))
+              {
+                  DMSG(0, "Mgen::OnCommand() Error: invalid ZEROCOPY message size\n");
+                  return false;
+              }
+          }
+          zero_copy_min = minBytes;
+      }
+      break;
  
     case INVALID_COMMAND:
       DMSG(0, "Mgen::OnCommand() Error: invalid command\n");
       return false;   
     }  // end switch(cmd)
+    if ((0 != worker_count) && IsWorkerCommand(cmd))
+    {
+        for (unsigned int i = 0; i < worker_count; i++)
+            worker_list[i]->PostCommand(cmd, arg, override);
+    }
     return true; 
 }  // end Mgen::OnCommand()
 
@@ -1751,7 +2469,7 @@ bool Mgen::OnCommand(Mgen::Command cmd, const char* arg, bool override)
 // DrecGroupList implementation
 
 DrecGroupList::DrecGroupList()
- : head(NULL), tail(NULL)
+ : head(NULL), tail(NULL), wildcard_count(0)
 {
     
 }
@@ -1776,6 +2494,8 @@ void DrecGroupList::Destroy(Mgen& mgen)
         delete current;
     }
     head = tail = (DrecMgenTransport*)NULL;
+    group_index.Destroy();
+    wildcard_count = 0;
 }  // end DrecGroupList::Destroy()
 
 bool DrecGroupList::JoinGroup(Mgen&                 mgen,
@@ -1862,27 +2582,64 @@ DrecGroupList::DrecMgenTransport* DrecGroupList::FindMgenTransportByGroup(
     const char*           interfaceName,
     UINT16        thePort)
 {
+    if (0 == wildcard_count)
+    {
+        // Only an item with the same key can match
+        char key[MgenHashIndex::KEY_MAX];
+        unsigned int keyLen = MakeKey(key, groupAddr, sourceAddr, interfaceName, thePort);
+        GroupIndex::Iterator iterator(group_index, key, keyLen);
+        DrecMgenTransport* match = NULL;
+        DrecMgenTransport* next;
+        while (NULL != (next = iterator.GetNextItem()))
+        {
+            // (items are found most recently appended first)
+            if (next->Matches(groupAddr, sourceAddr, interfaceName, thePort))
+                match = next;
+        }
+        return match;
+    }
     DrecMgenTransport* next = head;
     while (next)
     {
-        const char* nextInterface = next->GetInterface();
-        bool interfaceIsEqual =  (NULL == interfaceName) ? 
-                (NULL == nextInterface) : 
-                ((NULL != nextInterface) && 
-                 !strcmp(nextInterface, interfaceName));
-        bool groupIsEqual = next->group_addr.IsValid() ?
-            next->group_addr.HostIsEqual(groupAddr) : true;
-
-        bool sourceIsEqual = !next->source_addr.IsValid() ?
-                             !sourceAddr.IsValid() :
-                             sourceAddr.IsValid() && next->source_addr.HostIsEqual(sourceAddr);        bool portIsEqual = thePort == next->GetPort();
-        if (interfaceIsEqual && groupIsEqual && sourceIsEqual && portIsEqual) 
+        if (next->Matches(groupAddr, sourceAddr, interfaceName, thePort)) 
             return next;
         next = next->next;
     }
     return (DrecMgenTransport*)NULL;
 }  // end DrecGroupList::FindMgenTransportByGroup()
 
+unsigned int DrecGroupList::MakeKey(char*               key,
+                                    const ProtoAddress& groupAddr,
+                                    const ProtoAddress& sourceAddr,
+                                    const char*         interfaceName,
+                                    UINT16              thePort)
+{
+    unsigned int keyLen = 0;
+    const ProtoAddress* addrList[2] = {&groupAddr, &sourceAddr};
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        const ProtoAddress& addr = *addrList[i];
+        key[keyLen++] = (char)addr.GetType();
+        if (addr.IsValid())
+        {
+            unsigned int addrLen = addr.GetLength();
+            if (addrLen > 16) addrLen = 16;
+            memcpy(key + keyLen, addr.GetRawHostAddress(), addrLen);
+            keyLen += addrLen;
+        }
+    }
+    memcpy(key + keyLen, &thePort, sizeof(UINT16));
+    keyLen += sizeof(UINT16);
+    if (NULL != interfaceName)
+    {
+        // (interface names are kept to 16 characters)
+        unsigned int nameLen = 0;
+        while ((nameLen < 16) && ('\0' != interfaceName[nameLen]))
+            key[keyLen++] = interfaceName[nameLen++];
+    }
+    return keyLen;
+}  // end DrecGroupList::MakeKey()
+
 void DrecGroupList::Append(DrecMgenTransport* transport)
 {
     transport->next = NULL;
@@ -1891,10 +2648,32 @@ void DrecGroupList::Append(DrecMgenTransport* transport)
     else
         head = transport;
     tail = transport;
+    if (transport->group_addr.IsValid())
+    {
+        char key[MgenHashIndex::KEY_MAX];
+        unsigned int keyLen = MakeKey(key, transport->group_addr, transport->source_addr,
+                                      transport->GetInterface(), transport->GetPort());
+        group_index.Insert(key, keyLen, *transport);
+    }
+    else
+    {
+        wildcard_count++;
+    }
 }  // end DrecGroupList::Append()
 
 void DrecGroupList::Remove(DrecMgenTransport* transport)
 {
+    if (transport->group_addr.IsValid())
+    {
+        char key[MgenHashIndex::KEY_MAX];
+        unsigned int keyLen = MakeKey(key, transport->group_addr, transport->source_addr,
+                                      transport->GetInterface(), transport->GetPort());
+        group_index.Remove(key, keyLen, *transport);
+    }
+    else
+    {
+        wildcard_count--;
+    }
     if (transport->prev)
         transport->prev->next = transport->next;
     else
@@ -1933,6 +2712,25 @@ bool DrecGroupList::DrecMgenTransport::Activate(Mgen& mgen)
     return IsActive();
 }
 
+bool DrecGroupList::DrecMgenTransport::Matches(const ProtoAddress& groupAddr,
+                                               const ProtoAddress& sourceAddr,
+                                               const char*         interfaceName,
+                                               UINT16              thePort)
+{
+    const char* nextInterface = GetInterface();
+    bool interfaceIsEqual =  (NULL == interfaceName) ? 
+            (NULL == nextInterface) : 
+            ((NULL != nextInterface) && 
+             !strcmp(nextInterface, interfaceName));
+    bool groupIsEqual = group_addr.IsValid() ?
+        group_addr.HostIsEqual(groupAddr) : true;
+    bool sourceIsEqual = !source_addr.IsValid() ?
+                         !sourceAddr.IsValid() :
+                         sourceAddr.IsValid() && source_addr.HostIsEqual(sourceAddr);
+    bool portIsEqual = thePort == GetPort();
+    return (interfaceIsEqual && groupIsEqual && sourceIsEqual && portIsEqual);
+}  // end DrecGroupList::DrecMgenTransport::Matches()
+
 
 ////////////////////////////////////////////////////////////////
 // Mgen::FastReader implementation
@@ -3,6 +3,7 @@
 #include "mgenMsg.h"
 #include "mgenVersion.h"
 #include "mgenApp.h"
+#include "mgenScript.h"
 #include "protokit.h"
 
 #include <string.h>
@@ -23,7 +24,7 @@ MgenApp::MgenApp()
 #ifdef HAVE_GPS
      gps_handle(NULL), payload_handle(NULL),
 #endif // HAVE_GPS
-     have_ports(false), convert(false), 
+     have_ports(false), convert(false), compile(false),
      ifinfo_tx_count(0), ifinfo_rx_count(0)
 {
     control_pipe.SetNotifier(&GetSocketNotifier());
@@ -55,8 +56,14 @@ void MgenApp::Usage()
             "     [txcheck][rxcheck][check]\n"
             "     [queue <queueSize>][broadcast {on|off}]\n"
             "     [convert <binaryLog>][debug <debugLevel>]\n"
+            "     [convflows <flowList>][convevents <eventList>][convthreads <count>]\n"
             "     [gpskey <gpsSharedMemoryLocation>]\n"
-            "     [boost] [reuse {on|off}]\n");
+            "     [boost] [reuse {on|off}][timestamp {on|hw|off}]\n"
+            "     [txbatch <count>][asynclog {on|drop|off}[,<kbytes>]]\n"
+            "     [stats {<interval>|report|off}[,<statsFile>]][rxlog {on|off}]\n"
+            "     [workers <count>][pace {off|spin|txtime|etf}[,<leadUsec>]]\n"
+            "     [zerocopy {on|off}[,<minBytes>]]\n"
+            "     [compile <scriptFile>,<binaryScript>]\n");
 }  // end MgenApp::Usage()
 
 
@@ -66,6 +73,10 @@ const char* const MgenApp::CMD_LIST[] =
     "-ipv6",       // open IPv6 sockets by default
     "-ipv4",       // open IPv4 sockets by default
     "+convert",    // convert binary logfile to text-based logfile
+    "+convflows",  // limit conversion to listed flows
+    "+convevents", // limit conversion to listed event types
+    "+convthreads",// number of conversion threads (0 = one per CPU)
+    "+compile",    // precompile a script to a binary script
     "+sink",       // set Mgen::sink to stream sink
     "-block",      // set Mgen::sink to blocking I/O
     "+source",     // specify an MGEN stream source
@@ -292,6 +303,47 @@ bool MgenApp::OnCommand(const char* cmd, const char* val)
         convert = true;             // set flag to do the conversion
         strcpy(convert_path, val);  // save path of file to convert
     }
+    else if (!strncmp("convflows", lowerCmd, len))
+    {
+        if (!log_converter.SetFlowFilter(val))
+        {
+            DMSG(0, "MgenApp::ProcessCommand(convflows) error: invalid flow list\n");
+            return false;
+        }
+    }
+    else if (!strncmp("convevents", lowerCmd, len))
+    {
+        if (!log_converter.SetEventFilter(val))
+        {
+            DMSG(0, "MgenApp::ProcessCommand(convevents) error: invalid event list\n");
+            return false;
+        }
+    }
+    else if (!strncmp("convthreads", lowerCmd, len))
+    {
+        int threadCount;
+        if ((1 != sscanf(val, "%d", &threadCount)) || (threadCount < 0))
+        {
+            DMSG(0, "MgenApp::ProcessCommand(convthreads) error: invalid thread count\n");
+            return false;
+        }
+        log_converter.SetThreadCount(threadCount);
+    }
+    else if (!strncmp("compile", lowerCmd, len))
+    {
+        // form "<scriptFile>,<binaryScript>"
+        size_t pathLen = strcspn(val, ",");
+        if ((',' != val[pathLen]) || (0 == pathLen) || ('\0' == val[pathLen+1]) ||
+            (pathLen >= PATH_MAX) || (strlen(val+pathLen+1) >= PATH_MAX))
+        {
+            DMSG(0, "MgenApp::ProcessCommand(compile) error: expected <scriptFile>,<binaryScript>\n");
+            return false;
+        }
+        strncpy(compile_path, val, pathLen);
+        compile_path[pathLen] = '\0';
+        strcpy(compile_bin_path, val+pathLen+1);
+        compile = true;
+    }
     else if (!strncmp("sink", lowerCmd, len))
     {
         mgen.SetSinkPath(val);
@@ -494,10 +546,18 @@ bool MgenApp::OnStartup(int argc, const char*const* argv)
     if (convert)
     {
         fprintf(stderr, "mgen: beginning binary to text log conversion ...\n");
-        MgenMsg theMsg;
-        theMsg.ConvertBinaryLog(convert_path,mgen);
+        log_converter.Convert(convert_path, mgen);
         fprintf(stderr, "mgen: conversion complete (exiting).\n");
     }
+    else if (compile)
+    {
+        fprintf(stderr, "mgen: compiling script \"%s\" ...\n", compile_path);
+        if (MgenBinaryScript::Compile(compile_path, compile_bin_path))
+            fprintf(stderr, "mgen: binary script \"%s\" complete (exiting).\n", compile_bin_path);
+        else
+            fprintf(stderr, "mgen: script compilation failed (exiting).\n");
+        return false;
+    }
     else
     {
         if (mgen.DelayedStart())
@@ -24,7 +24,8 @@ MgenAppSinkTransport::MgenAppSinkTransport(Mgen& theMgen,
                                            Protocol theProtocol,
                                            UINT16        thePort,
                                            const ProtoAddress&   theDstAddress)
-  : MgenSinkTransport(theMgen,theProtocol,thePort,theDstAddress)
+  : MgenSinkTransport(theMgen,theProtocol,thePort,theDstAddress),
+    shm_burst(-1)
 {
 
     ProtoDispatcher* theDispatcher = static_cast<ProtoDispatcher*>(&theMgen.GetSocketNotifier());
@@ -34,7 +35,8 @@ MgenAppSinkTransport::MgenAppSinkTransport(Mgen& theMgen,
 
 MgenAppSinkTransport::MgenAppSinkTransport(Mgen& theMgen,
                                      Protocol theProtocol)
-  : MgenSinkTransport(theMgen,theProtocol)
+  : MgenSinkTransport(theMgen,theProtocol),
+    shm_burst(-1)
 {
 
     ProtoDispatcher* theDispatcher = static_cast<ProtoDispatcher*>(&theMgen.GetSocketNotifier());
@@ -46,13 +48,103 @@ MgenAppSinkTransport::~MgenAppSinkTransport()
 {
 
 }
+
+void MgenAppSinkTransport::Close()
+{
+    ProtoChannel::Close();
+    if (shm_ring.IsOpen())
+    {
+        shm_ring.Close();  // (closes the event descriptor, too)
+#ifndef WIN32
+        descriptor = ProtoDispatcher::INVALID_DESCRIPTOR;
+#endif // !WIN32
+    }
+}  // end MgenAppSinkTransport::Close()
+
+bool MgenAppSinkTransport::IsShmPath() const
+{
+    const char* prefix = "SHM:";
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        if (toupper(path[i]) != prefix[i]) return false;
+    }
+    return true;
+}  // end MgenAppSinkTransport::IsShmPath()
+
+/**
+ * Connects a shared memory ring for a "SHM:<socketPath>[,<kbytes>]"
+ * sink (producer) or source path.  The ring's event descriptor
+ * stands in for the channel descriptor.
+ */
+bool MgenAppSinkTransport::OpenShmRing(bool producer)
+{
+    char sockPath[PATH_MAX];
+    strncpy(sockPath, path + 4, PATH_MAX - 1);
+    sockPath[PATH_MAX - 1] = '\0';
+    unsigned int ringSize = MgenShmRing::SIZE_DEFAULT;
+    char* ptr = strchr(sockPath, ',');
+    if (NULL != ptr)
+    {
+        *ptr++ = '\0';
+        unsigned int kbytes;
+        if ((1 != sscanf(ptr, "%u", &kbytes)) || (0 == kbytes) || (kbytes > 1048576))
+        {
+            DMSG(0, "MgenAppSinkTransport::OpenShmRing() error: invalid ring size \"%s\"\n", ptr);
+            return false;
+        }
+        ringSize = kbytes * 1024;
+    }
+    if (!shm_ring.Connect(sockPath, ringSize, producer))
+    {
+        DMSG(0, "MgenAppSinkTransport::OpenShmRing() error connecting ring to \"%s\"\n", sockPath);
+        return false;
+    }
+#ifndef WIN32
+    descriptor = shm_ring.GetEventDescriptor();
+#endif // !WIN32
+    return true;
+}  // end MgenAppSinkTransport::OpenShmRing()
+
+void MgenAppSinkTransport::OnShmRingEvent()
+{
+    shm_ring.ClearEvent();
+    if (shm_ring.IsProducer())
+    {
+        // Ring space is available again.  The sends are limited to a
+        // burst so an unlimited rate flow can't hold the dispatcher
+        // while the consumer keeps up (a flow that hits the limit
+        // re-signals the event with StartOutputNotification())
+        shm_burst = SHM_BURST_MAX;
+        SendPendingMessage();
+        shm_burst = -1;
+        return;
+    }
+    ProtoAddress srcAddr; 
+    srcAddr.Reset(mgen.GetDefaultSocketType());
+    srcAddr.SetPort(srcPort);
+    const char* buffer;
+    unsigned int len;
+    // (the ring only signals again once Peek() has found it empty)
+    while (NULL != (buffer = shm_ring.Peek(len)))
+    {
+        if ((len < MIN_SIZE) || (len > MAX_SIZE))
+            DMSG(0, "MgenAppSinkTransport::OnShmRingEvent() invalid MGEN message length received: %u\n", len);
+        else
+            HandleMgenMessage(buffer,len,srcAddr);
+        shm_ring.Consume();
+    }
+}  // end MgenAppSinkTransport::OnShmRingEvent()
+
 void MgenAppSinkTransport::OnEvent(ProtoChannel& theChannel,ProtoChannel::Notification theNotification)
 {  
     switch (theNotification)
     {
     case ProtoChannel::NOTIFY_INPUT:
       {
-          OnInputReady();
+          if (shm_ring.IsOpen())
+            OnShmRingEvent();
+          else
+            OnInputReady();
           
           break;
       }
@@ -82,6 +174,14 @@ bool MgenAppSinkTransport::Open(ProtoAddress::Type addrType, bool bindOnOpen)
   Close();
   StopInputNotification(); // the channel open method starts input notification
 
+  if (IsShmPath())
+  {
+      if (!OpenShmRing(true)) return false;
+      msg_length = msg_index = 0;
+      // (input notification here is for the ring "space" event)
+      return ProtoChannel::Open();
+  }
+
 #ifdef WIN32
 #ifdef _WIN32_WCE
     DMSG(0, "MgenAppSinkTransport::Open() \"sink\" option not support under WinCE\n");
@@ -165,6 +265,33 @@ MessageStatus MgenAppSinkTransport::SendMessage(MgenMsg& theMsg,const ProtoAddre
     unsigned int len = 0;
     theMsg.SetFlag(MgenMsg::LAST_BUFFER);
 
+    if (shm_ring.IsOpen())
+    {
+        if (0 == shm_burst) return MSG_SEND_BLOCKED;
+        if (shm_burst > 0) shm_burst--;
+        // Pack the message directly into the ring
+        unsigned int msgLen = theMsg.GetMsgLen();
+        char* slot = shm_ring.Reserve(msgLen);
+        while (NULL == slot)
+        {
+            if (sink_non_blocking) return MSG_SEND_BLOCKED;
+            if (!shm_ring.Wait()) return MSG_SEND_FAILED;
+            slot = shm_ring.Reserve(msgLen);
+        }
+        len = theMsg.Pack(slot,msgLen,mgen.GetChecksumEnable(),txChecksum);
+        if (len == 0)
+          return MSG_SEND_FAILED;
+        if (mgen.GetChecksumEnable() && theMsg.FlagIsSet(MgenMsg::CHECKSUM))
+          theMsg.WriteChecksum(txChecksum,(unsigned char*)slot,(UINT32)len);
+        shm_ring.Commit(len);
+        // (the slot is ours to read until the next Reserve())
+        struct timeval currentTime;
+        ProtoSystemTime(currentTime);
+        LogEvent(SEND_EVENT,&theMsg,currentTime,slot);
+        messages_sent++;
+        return MSG_SEND_OK;
+    }
+
     len = theMsg.Pack(txBuffer,theMsg.GetMsgLen(),mgen.GetChecksumEnable(),txChecksum);
     
     if (len == 0)
@@ -315,6 +442,13 @@ bool MgenAppSinkTransport::Open()
 
   Close();
 
+  if (IsShmPath())
+  {
+      if (!OpenShmRing(false)) return false;
+      msg_length = msg_index = 0;
+      return ProtoChannel::Open();
+  }
+
 #ifdef WIN32
 #ifdef _WIN32_WCE
     DMSG(0, "MgenAppSinkTransport::Open() \"source\" option not supported under WinCE\n");
@@ -0,0 +1,279 @@
+#include "mgenCrc32.h"
+
+#include <string.h>  // for memcpy()
+#include <stdint.h>  // for uint64_t
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_CRC32_PCLMUL
+#include <cpuid.h>
+#include <immintrin.h>
+#endif // __GNUC__ && x86
+
+#if defined(__GNUC__) && defined(__aarch64__) && !defined(__AARCH64EB__) && defined(LINUX)
+#define HAVE_CRC32_ARMV8
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif // !HWCAP_CRC32
+#endif // __GNUC__ && __aarch64__ && LINUX
+
+MgenCrc32::UpdateFunc MgenCrc32::update_func = MgenCrc32::UpdateInit;
+MgenCrc32::Engine MgenCrc32::engine = MgenCrc32::TABLE;
+UINT32 MgenCrc32::slice_table[8][256];
+
+// Makes sure engine selection is done before any threads are started
+static class MgenCrc32Init
+{
+  public:
+    MgenCrc32Init() {MgenCrc32::Update(0, NULL, 0);}
+} mgen_crc32_init;
+
+UINT32 MgenCrc32::UpdateInit(UINT32 crc, const UINT8* buffer, UINT32 bufferLen)
+{
+    if (!SetEngine(ARMV8) && !SetEngine(PCLMUL))
+        SetEngine(SLICE8);
+    return update_func(crc, buffer, bufferLen);
+}  // end MgenCrc32::UpdateInit()
+
+void MgenCrc32::Init()
+{
+    if (0 != slice_table[0][1]) return;  // already built
+    // Table for the reflected 0x04C11DB7 polynomial (0xEDB88320),
+    // extended by a byte per table for slicing-by-8
+    for (UINT32 i = 0; i < 256; i++)
+    {
+        UINT32 crc = i;
+        for (int j = 0; j < 8; j++)
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+        slice_table[0][i] = crc;
+    }
+    for (UINT32 i = 0; i < 256; i++)
+    {
+        for (int k = 1; k < 8; k++)
+        {
+            UINT32 crc = slice_table[k-1][i];
+            slice_table[k][i] = slice_table[0][crc & 0xFF] ^ (crc >> 8);
+        }
+    }
+}  // end MgenCrc32::Init()
+
+bool MgenCrc32::IsSupported(Engine theEngine)
+{
+    switch (theEngine)
+    {
+        case TABLE:
+        case SLICE8:
+            return true;
+        case PCLMUL:
+        {
+#ifdef HAVE_CRC32_PCLMUL
+            // PCLMULQDQ (ECX bit 1) and SSE4.1 (ECX bit 19)
+            unsigned int eax, ebx, ecx, edx;
+            if (0 == __get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+            return ((0 != (ecx & (1 << 1))) && (0 != (ecx & (1 << 19))));
+#else
+            return false;
+#endif // if/else HAVE_CRC32_PCLMUL
+        }
+        case ARMV8:
+#ifdef HAVE_CRC32_ARMV8
+            return (0 != (getauxval(AT_HWCAP) & HWCAP_CRC32));
+#else
+            return false;
+#endif // if/else HAVE_CRC32_ARMV8
+    }
+    return false;
+}  // end MgenCrc32::IsSupported()
+
+bool MgenCrc32::SetEngine(Engine theEngine)
+{
+    if (!IsSupported(theEngine)) return false;
+    Init();
+    switch (theEngine)
+    {
+        case TABLE:
+            update_func = UpdateTable;
+            break;
+        case SLICE8:
+            update_func = UpdateSlice8;
+            break;
+        case PCLMUL:
+            update_func = UpdatePclmul;
+            break;
+        case ARMV8:
+            update_func = UpdateArmv8;
+            break;
+    }
+    engine = theEngine;
+    return true;
+}  // end MgenCrc32::SetEngine()
+
+const char* MgenCrc32::GetEngineName(Engine theEngine)
+{
+    switch (theEngine)
+    {
+        case TABLE:
+            return "table";
+        case SLICE8:
+            return "slice8";
+        case PCLMUL:
+            return "pclmul";
+        case ARMV8:
+            return "armv8";
+    }
+    return "unknown";
+}  // end MgenCrc32::GetEngineName()
+
+UINT32 MgenCrc32::UpdateTable(UINT32 crc, const UINT8* buffer, UINT32 bufferLen)
+{
+    for (UINT32 i = 0; i < bufferLen; i++)
+        crc = slice_table[0][(crc ^ *buffer++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}  // end MgenCrc32::UpdateTable()
+
+UINT32 MgenCrc32::UpdateSlice8(UINT32 crc, const UINT8* buffer, UINT32 bufferLen)
+{
+    // (words are assembled byte-wise so this is independent of endian)
+    while (bufferLen >= 8)
+    {
+        UINT32 one = crc ^ ((UINT32)buffer[0] | ((UINT32)buffer[1] << 8) |
+                            ((UINT32)buffer[2] << 16) | ((UINT32)buffer[3] << 24));
+        UINT32 two = ((UINT32)buffer[4] | ((UINT32)buffer[5] << 8) |
+                      ((UINT32)buffer[6] << 16) | ((UINT32)buffer[7] << 24));
+        crc = slice_table[7][one & 0xFF] ^ slice_table[6][(one >> 8) & 0xFF] ^
+              slice_table[5][(one >> 16) & 0xFF] ^ slice_table[4][one >> 24] ^
+              slice_table[3][two & 0xFF] ^ slice_table[2][(two >> 8) & 0xFF] ^
+              slice_table[1][(two >> 16) & 0xFF] ^ slice_table[0][two >> 24];
+        buffer += 8;
+        bufferLen -= 8;
+    }
+    return UpdateTable(crc, buffer, bufferLen);
+}  // end MgenCrc32::UpdateSlice8()
+
+#ifdef HAVE_CRC32_PCLMUL
+// Folds 64 bytes at a time with carry-less multiplies and then Barrett reduces
+// to 32 bits, per Gopal et al, "Fast CRC Computation for Generic Polynomials
+// Using PCLMULQDQ Instruction" (Intel, 2009).  The constants are the bit-reflected
+// x^n mod P(x) values given there for the CRC32 polynomial.  "bufferLen" must be
+// at least 64 and a multiple of 16.
+__attribute__((target("pclmul,sse4.1")))
+static UINT32 Crc32FoldPclmul(UINT32 crc, const UINT8* buffer, UINT32 bufferLen)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000LL, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(buffer + 0x00));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(buffer + 0x10));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(buffer + 0x20));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(buffer + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    buffer += 64;
+    bufferLen -= 64;
+
+    // Fold four 128-bit lanes in parallel
+    while (bufferLen >= 64)
+    {
+        __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(buffer + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(buffer + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(buffer + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(buffer + 0x30)));
+        buffer += 64;
+        bufferLen -= 64;
+    }
+
+    // Fold the lanes into one
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // Fold any remaining 16 byte blocks
+    while (bufferLen >= 16)
+    {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)buffer)), x5);
+        buffer += 16;
+        bufferLen -= 16;
+    }
+
+    // Fold 128 bits to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduce to 32 bits
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (UINT32)_mm_extract_epi32(x1, 1);
+}  // end Crc32FoldPclmul()
+#endif // HAVE_CRC32_PCLMUL
+
+UINT32 MgenCrc32::UpdatePclmul(UINT32 crc, const UINT8* buffer, UINT32 bufferLen)
+{
+#ifdef HAVE_CRC32_PCLMUL
+    if (bufferLen >= 64)
+    {
+        UINT32 foldLen = bufferLen & ~((UINT32)0x0F);
+        crc = Crc32FoldPclmul(crc, buffer, foldLen);
+        buffer += foldLen;
+        bufferLen -= foldLen;
+    }
+#endif // HAVE_CRC32_PCLMUL
+    return UpdateSlice8(crc, buffer, bufferLen);
+}  // end MgenCrc32::UpdatePclmul()
+
+#ifdef HAVE_CRC32_ARMV8
+__attribute__((target("+crc")))
+static UINT32 Crc32Armv8(UINT32 crc, const UINT8* buffer, UINT32 bufferLen)
+{
+    while ((0 != bufferLen) && (0 != ((unsigned long)buffer & 0x07)))
+    {
+        crc = __crc32b(crc, *buffer++);
+        bufferLen--;
+    }
+    while (bufferLen >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, buffer, 8);
+        crc = __crc32d(crc, word);
+        buffer += 8;
+        bufferLen -= 8;
+    }
+    while (0 != bufferLen--)
+        crc = __crc32b(crc, *buffer++);
+    return crc;
+}  // end Crc32Armv8()
+#endif // HAVE_CRC32_ARMV8
+
+UINT32 MgenCrc32::UpdateArmv8(UINT32 crc, const UINT8* buffer, UINT32 bufferLen)
+{
+#ifdef HAVE_CRC32_ARMV8
+    return Crc32Armv8(crc, buffer, bufferLen);
+#else
+    return UpdateSlice8(crc, buffer, bufferLen);
+#endif // if/else HAVE_CRC32_ARMV8
+}  // end MgenCrc32::UpdateArmv8()
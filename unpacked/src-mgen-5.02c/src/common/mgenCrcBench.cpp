@@ -0,0 +1,162 @@
+/*
+ * This program checks that each MGEN checksum (CRC32) engine supported on
+ * this system gives the same results as the byte-wise table engine and
+ * then compares their throughput across a range of message sizes.
+ *
+ * Usage: mgenCrcBench [size <bytes>] [run <sec>]
+ *
+ * (The default sizes are 64, 256, 576, 1500, 4096 and 8192 bytes, the
+ *  MGEN MAX_SIZE.  Each engine/size combination is run for "run" seconds.)
+ */
+
+#include "mgenCrc32.h"
+#include "protoTime.h"
+
+#include <stdio.h>
+#include <stdlib.h>  // for rand(), atoi(), atof()
+#include <string.h>
+
+static const MgenCrc32::Engine ENGINE_LIST[] =
+{
+    MgenCrc32::TABLE,
+    MgenCrc32::SLICE8,
+    MgenCrc32::PCLMUL,
+    MgenCrc32::ARMV8
+};
+static const unsigned int ENGINE_COUNT = sizeof(ENGINE_LIST) / sizeof(MgenCrc32::Engine);
+
+static const unsigned int BUFFER_MAX = 8192;
+
+// Compares the engine's results for all lengths (up to 1024 bytes plus
+// some larger ones) and buffer alignments against the table engine
+static bool Verify(MgenCrc32::Engine engine, const UINT8* buffer)
+{
+    for (unsigned int len = 0; len <= BUFFER_MAX; len = (len < 1024) ? (len + 1) : (len + 509))
+    {
+        for (unsigned int offset = 0; offset < 8; offset++)
+        {
+            if ((len + offset) > BUFFER_MAX) break;
+            UINT32 init = (UINT32)rand() ^ ((UINT32)rand() << 16);
+            MgenCrc32::SetEngine(MgenCrc32::TABLE);
+            UINT32 expected = MgenCrc32::Update(init, buffer + offset, len);
+            MgenCrc32::SetEngine(engine);
+            UINT32 result = MgenCrc32::Update(init, buffer + offset, len);
+            if (result != expected)
+            {
+                fprintf(stderr, "mgenCrcBench: %s engine error (len %u offset %u): 0x%08x != 0x%08x\n",
+                        MgenCrc32::GetEngineName(engine), len, offset, result, expected);
+                return false;
+            }
+        }
+    }
+    return true;
+}  // end Verify()
+
+static double Run(MgenCrc32::Engine engine, const UINT8* buffer, unsigned int size, double runTime)
+{
+    MgenCrc32::SetEngine(engine);
+    ProtoTime start, now;
+    start.GetCurrentTime();
+    double elapsed = 0.0;
+    unsigned long count = 0;
+    UINT32 crc = 0xFFFFFFFF;
+    do
+    {
+        for (unsigned int i = 0; i < 1000; i++)
+            crc = MgenCrc32::Update(crc, buffer, size);
+        count += 1000;
+        now.GetCurrentTime();
+        elapsed = ProtoTime::Delta(now, start);
+    } while (elapsed < runTime);
+    if (0x5A5A5A5A == crc) fprintf(stderr, " ");  // (so the loop isn't optimized away)
+    return (((double)count * (double)size) / elapsed) / 1.0e+06;  // MByte/sec
+}  // end Run()
+
+void Usage()
+{
+    fprintf(stderr, "Usage: mgenCrcBench [size <bytes>][run <sec>]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int sizeList[] = {64, 256, 576, 1500, 4096, 8192};
+    unsigned int sizeCount = sizeof(sizeList) / sizeof(unsigned int);
+    double runTime = 0.5;
+
+    int i = 1;
+    while (i < argc)
+    {
+        if ((i + 1) >= argc)
+        {
+            Usage();
+            return -1;
+        }
+        const char* cmd = argv[i++];
+        const char* val = argv[i++];
+        if (!strcmp(cmd, "size"))
+        {
+            int size = atoi(val);
+            if ((size <= 0) || (size > (int)BUFFER_MAX))
+            {
+                fprintf(stderr, "mgenCrcBench: invalid size (1 - %u bytes)\n", BUFFER_MAX);
+                return -1;
+            }
+            sizeList[0] = size;
+            sizeCount = 1;
+        }
+        else if (!strcmp(cmd, "run"))
+        {
+            runTime = atof(val);
+        }
+        else
+        {
+            Usage();
+            return -1;
+        }
+    }
+
+    UINT8* buffer = new UINT8[BUFFER_MAX];
+    srand(1);
+    for (unsigned int j = 0; j < BUFFER_MAX; j++)
+        buffer[j] = (UINT8)rand();
+
+    MgenCrc32::Engine defaultEngine = MgenCrc32::GetEngine();
+    // Standard CRC32 check value for the reference engine
+    MgenCrc32::SetEngine(MgenCrc32::TABLE);
+    if (0xCBF43926 != (MgenCrc32::Update(0xFFFFFFFF, (const UINT8*)"123456789", 9) ^ 0xFFFFFFFF))
+    {
+        fprintf(stderr, "mgenCrcBench: table engine check value error\n");
+        delete[] buffer;
+        return -1;
+    }
+    printf("default engine: %s\n", MgenCrc32::GetEngineName(defaultEngine));
+    printf("(throughput in MByte/sec)\n");
+    printf("%-8s", "size");
+    for (unsigned int e = 0; e < ENGINE_COUNT; e++)
+    {
+        if (!MgenCrc32::IsSupported(ENGINE_LIST[e])) continue;
+        if (!Verify(ENGINE_LIST[e], buffer))
+        {
+            delete[] buffer;
+            return -1;
+        }
+        printf(" %10s", MgenCrc32::GetEngineName(ENGINE_LIST[e]));
+    }
+    printf("\n");
+    fflush(stdout);
+
+    for (unsigned int s = 0; s < sizeCount; s++)
+    {
+        printf("%-8u", sizeList[s]);
+        for (unsigned int e = 0; e < ENGINE_COUNT; e++)
+        {
+            if (!MgenCrc32::IsSupported(ENGINE_LIST[e])) continue;
+            printf(" %10.1f", Run(ENGINE_LIST[e], buffer, sizeList[s], runTime));
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+    MgenCrc32::SetEngine(defaultEngine);
+    delete[] buffer;
+    return 0;
+}  // end main()
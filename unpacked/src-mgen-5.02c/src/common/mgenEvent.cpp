@@ -1,6 +1,7 @@
 #include "mgenGlobals.h" // can't forward declare enum's
 #include "mgenEvent.h"
 #include "mgen.h"  // for Mgen::SCRIPT_LINE_MAX
+#include "mgenScript.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -714,6 +715,169 @@ bool MgenEvent::InitFromString(const char* string)
     return true;
 }  // end MgenEvent::InitFromString()
 
+bool MgenEvent::Pack(MgenScriptRecord& record) const
+{
+    record.PutDouble(event_time);
+    record.PutUINT32(flow_id);
+    record.PutUINT8((UINT8)event_type);
+    record.PutUINT32(option_mask);
+    // Only the options set are packed (in option flag order)
+    if (0 != (PROTOCOL & option_mask))
+        record.PutUINT8((UINT8)protocol);
+    if (0 != (DST & option_mask))
+    {
+        UINT8 addrLen = dst_addr.GetLength();
+        record.PutUINT8((UINT8)dst_addr.GetType());
+        record.PutUINT8(addrLen);
+        record.PutData(dst_addr.GetRawHostAddress(), addrLen);
+        record.PutUINT16(dst_addr.GetPort());
+    }
+    if (0 != (SRC & option_mask))
+        record.PutUINT16(src_port);
+    if ((0 != (PATTERN & option_mask)) && !pattern.Pack(record))
+        return false;
+    if (0 != (TOS & option_mask))
+        record.PutUINT32((UINT32)tos);
+    if (0 != (INTERFACE & option_mask))
+    {
+        UINT8 nameLen = (UINT8)strlen(interface_name);
+        record.PutUINT8(nameLen);
+        record.PutData(interface_name, nameLen);
+    }
+    if (0 != (TTL & option_mask))
+        record.PutUINT8(ttl);
+    if (0 != (SEQUENCE & option_mask))
+        record.PutUINT32(sequence);
+    if (0 != (LABEL & option_mask))
+        record.PutUINT32(flow_label);
+    if (0 != (TXBUFFER & option_mask))
+        record.PutUINT32(tx_buffer_size);
+    if (0 != (DATA & option_mask))
+    {
+        UINT16 dataLen = (NULL != payload) ? (UINT16)strlen(payload) : 0;
+        record.PutUINT16(dataLen);
+        record.PutData(payload, dataLen);
+    }
+    if (0 != (QUEUE & option_mask))
+        record.PutUINT32((UINT32)queue);
+    if (0 != (COUNT & option_mask))
+        record.PutUINT32((UINT32)count);
+    if (0 != (BROADCAST & option_mask))
+        record.PutUINT8(broadcast ? 1 : 0);
+    if (0 != (DF & option_mask))
+        record.PutUINT8((UINT8)df);
+    return record.IsOk();
+}  // end MgenEvent::Pack()
+
+bool MgenEvent::Unpack(MgenScriptRecord& record)
+{
+    UINT8 temp8;
+    UINT32 temp32;
+    record.GetDouble(event_time);
+    record.GetUINT32(flow_id);
+    record.GetUINT8(temp8);
+    event_type = (Type)temp8;
+    if (!record.GetUINT32(option_mask)) return false;
+    if ((ON != event_type) && (MOD != event_type) && (OFF != event_type))
+    {
+        DMSG(0, "MgenEvent::Unpack() Error: invalid <eventType>\n");
+        return false;
+    }
+    if (0 != (PROTOCOL & option_mask))
+    {
+        record.GetUINT8(temp8);
+        protocol = (Protocol)temp8;
+    }
+    if (0 != (DST & option_mask))
+    {
+        UINT8 addrType, addrLen;
+        UINT16 dstPort;
+        const char* addrPtr;
+        record.GetUINT8(addrType);
+        record.GetUINT8(addrLen);
+        record.GetData(addrPtr, addrLen);
+        if (!record.GetUINT16(dstPort) ||
+            !dst_addr.SetRawHostAddress((ProtoAddress::Type)addrType, addrPtr, addrLen))
+        {
+            DMSG(0, "MgenEvent::Unpack() Error: invalid <dstAddr>\n");
+            return false;
+        }
+        dst_addr.SetPort(dstPort);
+    }
+    if (0 != (SRC & option_mask))
+        record.GetUINT16(src_port);
+    if ((0 != (PATTERN & option_mask)) && !pattern.Unpack(record))
+        return false;
+    if (0 != (TOS & option_mask))
+    {
+        record.GetUINT32(temp32);
+        tos = (int)temp32;
+    }
+    if (0 != (INTERFACE & option_mask))
+    {
+        const char* namePtr;
+        record.GetUINT8(temp8);
+        if (temp8 > 15) return false;
+        if (record.GetData(namePtr, temp8))
+        {
+            memcpy(interface_name, namePtr, temp8);
+            interface_name[temp8] = '\0';
+        }
+    }
+    if (0 != (TTL & option_mask))
+        record.GetUINT8(ttl);
+    if (0 != (SEQUENCE & option_mask))
+        record.GetUINT32(sequence);
+    if (0 != (LABEL & option_mask))
+        record.GetUINT32(flow_label);
+    if (0 != (TXBUFFER & option_mask))
+    {
+        record.GetUINT32(temp32);
+        tx_buffer_size = temp32;
+    }
+    if (0 != (DATA & option_mask))
+    {
+        UINT16 dataLen;
+        const char* dataPtr;
+        record.GetUINT16(dataLen);
+        if (record.GetData(dataPtr, dataLen))
+        {
+            if (payload != NULL) delete [] payload;
+            payload = new char[dataLen + 1];
+            memcpy(payload, dataPtr, dataLen);
+            payload[dataLen] = '\0';
+        }
+    }
+    if (0 != (QUEUE & option_mask))
+    {
+        record.GetUINT32(temp32);
+        queue = (int)temp32;
+    }
+    if (0 != (COUNT & option_mask))
+    {
+        record.GetUINT32(temp32);
+        count = (int)temp32;
+    }
+    if (0 != (BROADCAST & option_mask))
+    {
+        record.GetUINT8(temp8);
+        broadcast = (0 != temp8);
+    }
+    if (0 != (DF & option_mask))
+    {
+        record.GetUINT8(temp8);
+        df = (FragmentationStatus)temp8;
+    }
+    if (0 != (CONNECT & option_mask))
+        connect = true;
+    if (!record.IsOk())
+    {
+        DMSG(0, "MgenEvent::Unpack() Error: truncated event record\n");
+        return false;
+    }
+    return true;
+}  // end MgenEvent::Unpack()
+
 
 DrecEvent::DrecEvent()
  : MgenBaseEvent(DREC), event_type(INVALID_TYPE), protocol(INVALID_PROTOCOL),
@@ -1143,43 +1307,114 @@ void MgenEventList::Destroy()
 }  // end MgenEventList::Destroy()
 
 /**
- * time-ordered insertion of event
+ * time-ordered insertion of event (after any events with the same time)
  */
 void  MgenEventList::Insert(MgenBaseEvent* theEvent)
 {
-    MgenBaseEvent* next = head;
+    // Search from the tail since scripts are mostly in time order
+    MgenBaseEvent* prev = tail;
     double eventTime = theEvent->GetTime();
-    while(next)
+    while (prev && (eventTime < prev->GetTime()))
+        prev = prev->prev;
+    if ((theEvent->prev = prev))
     {
-        if (eventTime < next->GetTime())
-        {
-            theEvent->next = next;
-            if ((theEvent->prev = next->prev))
-                theEvent->prev->next = theEvent;
-            else
-                head = theEvent;
-            next->prev = theEvent;
-            return;
-        }
+        if ((theEvent->next = prev->next))
+            theEvent->next->prev = theEvent;
         else
-        {
-            next = next->next;
-        }
-    }
-    // Fell to end of list
-    if ((theEvent->prev = tail))
-    {
-        tail->next = theEvent;
+            tail = theEvent;
+        prev->next = theEvent;
     }
     else
     {
+        if ((theEvent->next = head))
+            head->prev = theEvent;
+        else
+            tail = theEvent;
         head = theEvent;
-        theEvent->prev = NULL;
     }
-    tail = theEvent;
-    theEvent->next = NULL;
 }  // end MgenEventList::Insert()
 
+void MgenEventList::Append(MgenBaseEvent* theEvent)
+{
+    theEvent->next = NULL;
+    if ((theEvent->prev = tail))
+        tail->next = theEvent;
+    else
+        head = theEvent;
+    tail = theEvent;
+}  // end MgenEventList::Append()
+
+/**
+ * Bottom-up merge sort of the list.  The event times are copied to an
+ * array (with their events) and sorted there, since merging via the
+ * "next" links of events scattered in memory is cache-bound for large
+ * lists.  The list is then relinked in the sorted order.
+ */
+bool MgenEventList::Sort()
+{
+    if (NULL == head) return true;
+    unsigned int count = 0;
+    MgenBaseEvent* next;
+    bool sorted = true;
+    for (next = head; NULL != next; next = next->next)
+    {
+        if ((NULL != next->next) && (next->next->event_time < next->event_time))
+            sorted = false;
+        count++;
+    }
+    if (sorted) return true;
+    SortItem* list = new SortItem[2*count];
+    if (NULL == list)
+    {
+        DMSG(0, "MgenEventList::Sort() new SortItem[] error: %s\n", GetErrorString());
+        return false;
+    }
+    SortItem* src = list;
+    SortItem* dst = list + count;
+    unsigned int i = 0;
+    for (next = head; NULL != next; next = next->next)
+    {
+        src[i].time = next->event_time;
+        src[i].event = next;
+        i++;
+    }
+    for (unsigned int runSize = 1; runSize < count; runSize *= 2)
+    {
+        for (unsigned int start = 0; start < count; start += 2*runSize)
+        {
+            unsigned int a = start;
+            unsigned int aEnd = (start + runSize < count) ? (start + runSize) : count;
+            unsigned int b = aEnd;
+            unsigned int bEnd = (aEnd + runSize < count) ? (aEnd + runSize) : count;
+            unsigned int k = start;
+            // Merge, taking from "a" on ties so the sort is stable
+            while ((a < aEnd) && (b < bEnd))
+                dst[k++] = (src[b].time < src[a].time) ? src[b++] : src[a++];
+            while (a < aEnd) dst[k++] = src[a++];
+            while (b < bEnd) dst[k++] = src[b++];
+        }
+        SortItem* temp = src;
+        src = dst;
+        dst = temp;
+    }
+    // Relink the list in sorted order
+    MgenBaseEvent* prev = NULL;
+    for (i = 0; i < count; i++)
+    {
+        next = src[i].event;
+        next->prev = prev;
+        if (NULL != prev)
+            prev->next = next;
+        else
+            head = next;
+        prev = next;
+    }
+    prev->next = NULL;
+    tail = prev;
+    delete[] list;
+    return true;
+}  // end MgenEventList::Sort()
+
 /**
  * This places "theEvent" _before_ "nextEvent" in the list.
  * (If "nextEvent" is NULL, "theEvent" goes to the end of the list)
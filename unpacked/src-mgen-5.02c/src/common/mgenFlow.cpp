@@ -18,8 +18,8 @@ MgenFlow::MgenFlow(unsigned int         flowId,
     message_limit(-1), 
     flow_id(flowId), payload(0), flow_label(defaultV6Label),      
     flow_transport(NULL), seq_num(0), 
-    pending_messages(0),
-    next_event(NULL), 
+    pending_messages(0), tx_sched_delay(-1.0),
+    next_event(NULL), events_unsorted(false),
     started(false), socket_error(false),timer_mgr(timerMgr),
     controller(theController),
     mgen(theMgen),
@@ -99,10 +99,17 @@ bool MgenFlow::InsertEvent(MgenEvent* theEvent, bool mgenStarted, double current
     }
     else
     {
+        // Events loaded in time order are validated now, while the
+        // others are just appended until SortEvents() is called
         eventTime = eventTime > 0.0 ? eventTime : 0.0;
         theEvent->SetTime(eventTime);
-        event_list.Insert(theEvent);
-        if (!ValidateEvent(theEvent))
+        const MgenBaseEvent* lastEvent = event_list.Tail();
+        event_list.Append(theEvent);
+        if (events_unsorted || (lastEvent && (eventTime < lastEvent->GetTime())))
+        {
+            events_unsorted = true;
+        }
+        else if (!ValidateEvent(theEvent))
         {
             event_list.Remove(theEvent);
             return false;
@@ -111,6 +118,28 @@ bool MgenFlow::InsertEvent(MgenEvent* theEvent, bool mgenStarted, double current
     return true;
 }  // end MgenFlow::InsertEvent()
 
+/**
+ * Sorts events that were not loaded in time order and validates them
+ */
+bool MgenFlow::SortEvents()
+{
+    if (!events_unsorted) return true;
+    if (!event_list.Sort()) return false;
+    events_unsorted = false;
+    const MgenEvent* next = (const MgenEvent*)event_list.Head();
+    while (next)
+    {
+        if (!ValidateEvent(next))
+        {
+            DMSG(0, "MgenFlow::SortEvents() Error: flow %lu invalid event sequence at time %f\n",
+                 (unsigned long)flow_id, next->GetTime());
+            return false;
+        }
+        next = (const MgenEvent*)next->Next();
+    }
+    return true;
+}  // end MgenFlow::SortEvents()
+
 /**
  *  Validate the event by it's position in the list with respect to its neighbor types   
  */
@@ -480,6 +509,8 @@ bool MgenFlow::DoModEvent(const MgenEvent* event)
 bool MgenFlow::DoGenericEvent(const MgenEvent* event)
 {
     // ON/MOD flow options	
+    // (any of which may change the packed message)
+    msg_template.Invalidate();
 
     if (event->OptionIsSet(MgenEvent::PATTERN))
       pattern = event->GetPattern();
@@ -636,7 +667,11 @@ bool MgenFlow::Update(const MgenEvent* event)
 
 bool MgenFlow::GetNextInterval()
 {
-  double nextInterval = GetPktInterval();
+  return ScheduleNextInterval(GetPktInterval());
+} // end MgenFlow::GetNextInterval()
+
+bool MgenFlow::ScheduleNextInterval(double nextInterval)
+{
   if (nextInterval > 0.0) // normal scheduled transmission event
     {
         tx_timer.SetInterval(nextInterval);
@@ -690,7 +725,7 @@ bool MgenFlow::GetNextInterval()
       return false;
     }
 
-} // end MgenFlow::GetNextInterval()
+} // end MgenFlow::ScheduleNextInterval()
 
 //  Stop Flow is called when a flow has been stopped due to
 //  an OFF_EVENT or when COUNT has been exceeded.
@@ -699,6 +734,8 @@ void MgenFlow::StopFlow()
   pending_messages = message_limit = 0;
   if (flow_transport) flow_transport->SetMessagesSent(0);
   off_pending = false;
+  tx_sched.Zeroize();
+  ReportPace();
 
   // Inform rapr so it can reuse the flowid
   if (controller)
@@ -773,28 +810,8 @@ void MgenFlow::RestartTimer()
     
 } // end MgenFlow::RestartTimer()
 
-bool MgenFlow::SendMessage()
+void MgenFlow::BuildMessage(MgenMsg& theMsg)
 {
-    // If we have an off event for flows with unlimited
-    // pkt rate, stop the flow immediately.  We have 
-    // already disabled the transmission timer.
-    if (OffPending() && pattern.UnlimitedRate())
-    {
-        StopFlow();
-        return false;
-    }
-
-    if (!flow_transport || (message_limit > 0 && flow_transport->GetMessagesSent() >= message_limit))
-    {
-        // Deactivate timer but wait for an OFF_EVENT to actually 
-        // stop flow, unless we have an unlimited rate - in that
-        // case we've turned off the transmission timer.
-        if (tx_timer.IsActive()) tx_timer.Deactivate();
-        if (pattern.UnlimitedRate()) StopFlow();
-        return false;  
-    }
-
-    MgenMsg theMsg;
     theMsg.SetProtocol(protocol);
     unsigned int len = pattern.GetPktSize();
     theMsg.SetMgenMsgLen(len);
@@ -904,13 +921,58 @@ bool MgenFlow::SendMessage()
         flow_transport->SetFlowLabel(flow_label);
     }
 #endif //HAVE_IPV6
+
+    // Unless GPS info is included, messages differ only in their seq_num
+    // and tx_time so datagrams are packed from the flow's template
+    bool useTemplate = (TCP != protocol);
+#ifdef HAVE_GPS
+    if ((NULL != get_position) || (NULL != payload_handle)) useTemplate = false;
+#endif // HAVE_GPS
+#ifdef ANDROID
+    useTemplate = false;
+#endif // ANDROID
+    if (useTemplate)
+    {
+        if (msg_template.IsStale()) 
+            msg_template.Init(theMsg, mgen.GetChecksumEnable());
+        theMsg.SetTemplate(&msg_template);
+    }
+} // end MgenFlow::BuildMessage()
+
+// A "launchTime" is passed to the transport with the message (see PACE)
+bool MgenFlow::SendMessage(const ProtoTime* launchTime)
+{
+    // If we have an off event for flows with unlimited
+    // pkt rate, stop the flow immediately.  We have 
+    // already disabled the transmission timer.
+    if (OffPending() && pattern.UnlimitedRate())
+    {
+        StopFlow();
+        return false;
+    }
+
+    if (!flow_transport || (message_limit > 0 && flow_transport->GetMessagesSent() >= message_limit))
+    {
+        // Deactivate timer but wait for an OFF_EVENT to actually 
+        // stop flow, unless we have an unlimited rate - in that
+        // case we've turned off the transmission timer.
+        if (tx_timer.IsActive()) tx_timer.Deactivate();
+        if (pattern.UnlimitedRate()) StopFlow();
+        return false;  
+    }
+
+    MgenMsg theMsg;
+    BuildMessage(theMsg);
+
     // Send message, checking for error
     // (log only on success)
     char txBuffer[MAX_SIZE];
     MessageStatus result;
     // txbuffer only used by udp and sink transports
     if (flow_transport != NULL)
-      result = flow_transport->SendMessage(theMsg,dst_addr,txBuffer);
+      result = (NULL != launchTime) ?
+                    flow_transport->SendMessageAt(theMsg,dst_addr,txBuffer,*launchTime) :
+                    flow_transport->SendMessage(theMsg,dst_addr,txBuffer);
     else
       result = MSG_SEND_FAILED;
 
@@ -980,6 +1042,151 @@ bool MgenFlow::SendMessage()
     
 } // MgenFlow::SendMessage
 
+// Sends the message due now plus any following ones whose scheduled
+// times have already passed (up to the TXBATCH limit) in a single
+// transport call, so a high rate flow whose timer fires late catches
+// up instead of falling behind its pattern rate.  The tx_timer is then
+// re-armed for the scheduled time of the next message.
+bool MgenFlow::SendMessageBatch()
+{
+    ProtoTime currentTime;
+    currentTime.GetCurrentTime();
+    // (Re)start the schedule on the first batched timeout, if the timer
+    // interval was changed elsewhere (e.g., by a MOD event) or if we're
+    // so late (more than 100 msec) that catching up would only cause a burst
+    if (tx_sched.IsZero() || 
+        (tx_timer.GetInterval() != tx_sched_delay) ||
+        (ProtoTime::Delta(currentTime, tx_sched) > 0.100))
+    {
+        tx_sched = currentTime;
+    }
+    
+    unsigned int maxCount = mgen.GetTxBatch();
+    if (message_limit > 0)
+    {
+        unsigned int remaining = message_limit - flow_transport->GetMessagesSent();
+        if (remaining < maxCount) maxCount = remaining;
+    }
+
+    // Build each due message before advancing the pattern, since
+    // the pattern sets the next message size (e.g., CLONE patterns)
+    MgenMsg msgArray[Mgen::TX_BATCH_MAX];
+    unsigned int count = 0;
+    double nextInterval;
+    while (true)
+    {
+        BuildMessage(msgArray[count++]);
+        nextInterval = GetPktInterval();
+        if (nextInterval <= 0.0) break;
+        tx_sched += nextInterval;
+        if ((count >= maxCount) || (ProtoTime::Delta(tx_sched, currentTime) > 0.0))
+            break;
+    }
+
+    unsigned int sent = count;
+    flow_transport->SendMessageBatch(msgArray, sent, dst_addr);
+    if (sent < count)
+    {
+        // Unsent messages are dropped as for SendMessage() without a
+        // QUEUE limit, so their sequence numbers are reused
+        PLOG(PL_DEBUG, "MgenFlow::SendMessageBatch() flow>%d sent %u of %u messages.\n", flow_id, sent, count);
+#ifndef _RAPR_JOURNAL
+        seq_num -= (count - sent);
+#else
+        for (unsigned int i = sent; i < count; i++)
+            MgenSequencer::GetPrevSequence(flow_id);
+#endif
+    }
+
+    // The transport may have been shut down by a send failure
+    if (NULL == flow_transport) return false;
+    
+    if (nextInterval <= 0.0)  // pattern rate is now zero or unlimited
+    {
+        tx_sched.Zeroize();
+        return ScheduleNextInterval(nextInterval);
+    }
+    
+    currentTime.GetCurrentTime();
+    double delay = ProtoTime::Delta(tx_sched, currentTime);
+    if (delay < 0.0) delay = 0.0;
+    if (tx_timer.IsActive()) tx_timer.Deactivate();
+    tx_timer.SetInterval(delay);
+    timer_mgr.ActivateTimer(tx_timer);
+    tx_sched_delay = tx_timer.GetInterval();  // (may be rounded up)
+    last_interval = tx_sched_delay;
+    return true;
+}  // end MgenFlow::SendMessageBatch()
+
+// Sends the message scheduled for now with precise timing (see Mgen
+// PACE).  The tx_timer fires "lead" time ahead of the scheduled time and
+// the message is then either held until then with a busy-wait (SPIN) or
+// handed to the kernel with the scheduled time as its SO_TXTIME launch
+// time (TXTIME/ETF, if the transport socket supports it).  As for
+// SendMessageBatch(), the schedule is absolute so timer error does not
+// accumulate.
+bool MgenFlow::SendMessagePaced()
+{
+    ProtoTime currentTime;
+    currentTime.GetCurrentTime();
+    // (Re)start the schedule as for SendMessageBatch()
+    if (tx_sched.IsZero() || 
+        (tx_timer.GetInterval() != tx_sched_delay) ||
+        (ProtoTime::Delta(currentTime, tx_sched) > 0.100))
+    {
+        tx_sched = currentTime;
+    }
+    else if (currentTime > tx_sched)
+    {
+        pacer.CountLate();  // the timer fired after the scheduled time
+    }
+
+    bool txTime = (MgenPacer::SPIN != mgen.GetPaceMode()) && flow_transport->TxTimeEnabled();
+    pacer.SetMode(txTime ? mgen.GetPaceMode() : MgenPacer::SPIN);
+    if (txTime)
+    {
+        // (the error is measured by the transport from the tx timestamp)
+        SendMessage(&tx_sched);
+    }
+    else
+    {
+        MgenPacer::SpinUntil(tx_sched);
+        currentTime.GetCurrentTime();
+        if (SendMessage())
+            pacer.Update(ProtoTime::Delta(currentTime, tx_sched));
+    }
+
+    // The transport may have been shut down by a send failure
+    if (NULL == flow_transport) return false;
+
+    double nextInterval = GetPktInterval();
+    if (nextInterval <= 0.0)  // pattern rate is now zero or unlimited
+    {
+        tx_sched.Zeroize();
+        return ScheduleNextInterval(nextInterval);
+    }
+    tx_sched += nextInterval;
+    currentTime.GetCurrentTime();
+    double delay = ProtoTime::Delta(tx_sched, currentTime) - mgen.GetPaceLead();
+    if (delay < 0.0) delay = 0.0;
+    if (tx_timer.IsActive()) tx_timer.Deactivate();
+    tx_timer.SetInterval(delay);
+    timer_mgr.ActivateTimer(tx_timer);
+    tx_sched_delay = tx_timer.GetInterval();  // (may be rounded up)
+    last_interval = tx_sched_delay;
+    return true;
+}  // end MgenFlow::SendMessagePaced()
+
+void MgenFlow::ReportPace()
+{
+    if (pacer.IsEmpty()) return;
+    // (text reports would corrupt a binary log)
+    FILE* logFile = mgen.GetLogFile();
+    if ((NULL == logFile) || mgen.GetLogBinary()) logFile = stderr;
+    pacer.Report(logFile, flow_id, mgen.GetLocalTime());
+    pacer.Reset();
+}  // end MgenFlow::ReportPace()
+
 bool MgenFlow::OnTxTimeout(ProtoTimer& /*theTimer*/)
 {
   if (!flow_transport || (message_limit > 0 && flow_transport->GetMessagesSent() >= message_limit))
@@ -1121,6 +1328,21 @@ bool MgenFlow::OnTxTimeout(ProtoTimer& /*theTimer*/)
         if (tx_timer.IsActive()) tx_timer.Deactivate();
         return false;
     }
+    
+    // Rate-limited UDP flows without a pending queue may be paced
+    // precisely (see Mgen PACE) ...
+    if ((MgenPacer::OFF != mgen.GetPaceMode()) && (UDP == protocol) && (0 == queue_limit) &&
+        !pattern.UnlimitedRate() && !socket_error)
+    {
+        return SendMessagePaced();
+    }
+    // ... or send several overdue messages per timeout (see Mgen TXBATCH)
+    if ((mgen.GetTxBatch() > 1) && (UDP == protocol) && (0 == queue_limit) &&
+        !pattern.UnlimitedRate() && !socket_error)
+    {
+        return SendMessageBatch();
+    }
+    
     SendMessage();
 
     // If we have an unlimited rate, turn off the transmission
@@ -1249,6 +1471,7 @@ void MgenFlowList::Destroy()
         delete current;   
     }
     head = tail = (MgenFlow*)NULL;
+    flow_index.Destroy();
 }  // end MgenFlowList::Destroy()
 
 void MgenFlowList::Append(MgenFlow* theFlow)
@@ -1259,6 +1482,8 @@ void MgenFlowList::Append(MgenFlow* theFlow)
   else
     head = theFlow;
   tail = theFlow;
+  UINT32 flowId = theFlow->flow_id;
+  flow_index.Insert((const char*)&flowId, sizeof(UINT32), *theFlow);
 }  // end MgenFlowList::Append()
 
 
@@ -1277,15 +1502,19 @@ void MgenFlowList::SetDefaultLabel(UINT32 label)
 
 MgenFlow* MgenFlowList::FindFlowById(unsigned int flowId)
 {
-    MgenFlow* prev = tail;
-    while (prev)
-    { 
-        if (flowId == prev->flow_id) return prev;
-        prev = prev->prev;
-    }
-    return (MgenFlow*)NULL;
+    // (the index finds the most recently appended flow with this id)
+    UINT32 id = flowId;
+    return flow_index.Find((const char*)&id, sizeof(UINT32));
 }  // end MgenFlowList::FindFlowById()
 
+bool MgenFlowList::SortEvents()
+{
+    bool result = true;
+    for (MgenFlow* next = head; NULL != next; next = next->next)
+        result &= next->SortEvents();
+    return result;
+}  // end MgenFlowList::SortEvents()
+
 bool MgenFlowList::Start(double offsetTime)
 {
     bool result = false;
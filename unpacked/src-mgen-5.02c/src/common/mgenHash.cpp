@@ -0,0 +1,143 @@
+#include "mgenHash.h"
+
+#include <string.h>
+
+MgenHashIndex::MgenHashIndex()
+ : table(NULL), table_size(0), count(0)
+{
+}
+
+MgenHashIndex::~MgenHashIndex()
+{
+    Destroy();
+}
+
+void MgenHashIndex::Destroy()
+{
+    for (unsigned int i = 0; i < table_size; i++)
+    {
+        Entry* next = table[i];
+        while (next)
+        {
+            Entry* current = next;
+            next = next->next;
+            delete current;
+        }
+    }
+    delete[] table;
+    table = NULL;
+    table_size = 0;
+    count = 0;
+}  // end MgenHashIndex::Destroy()
+
+// FNV-1a hash
+UINT32 MgenHashIndex::Hash(const char* key, unsigned int keyLen)
+{
+    UINT32 hash = 2166136261UL;
+    for (unsigned int i = 0; i < keyLen; i++)
+    {
+        hash ^= (UINT8)key[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}  // end MgenHashIndex::Hash()
+
+bool MgenHashIndex::Resize(unsigned int newSize)
+{
+    Entry** newTable = new Entry*[newSize];
+    if (NULL == newTable)
+    {
+        DMSG(0, "MgenHashIndex::Resize() new table error: %s\n", GetErrorString());
+        return false;
+    }
+    memset(newTable, 0, newSize * sizeof(Entry*));
+    for (unsigned int i = 0; i < table_size; i++)
+    {
+        Entry* next = table[i];
+        while (next)
+        {
+            Entry* entry = next;
+            next = next->next;
+            unsigned int index = entry->hash & (newSize - 1);
+            entry->next = newTable[index];
+            newTable[index] = entry;
+        }
+    }
+    delete[] table;
+    table = newTable;
+    table_size = newSize;
+    return true;
+}  // end MgenHashIndex::Resize()
+
+bool MgenHashIndex::Insert(const char* key, unsigned int keyLen, void* item)
+{
+    if (keyLen > KEY_MAX)
+    {
+        DMSG(0, "MgenHashIndex::Insert() error: key too long\n");
+        return false;
+    }
+    if (count >= table_size)
+    {
+        if (!Resize((0 != table_size) ? (table_size << 1) : (unsigned int)DEFAULT_SIZE))
+            return false;
+    }
+    Entry* entry = new Entry;
+    if (NULL == entry)
+    {
+        DMSG(0, "MgenHashIndex::Insert() new entry error: %s\n", GetErrorString());
+        return false;
+    }
+    memcpy(entry->key, key, keyLen);
+    entry->key_len = keyLen;
+    entry->hash = Hash(key, keyLen);
+    entry->item = item;
+    unsigned int index = entry->hash & (table_size - 1);
+    entry->next = table[index];
+    table[index] = entry;
+    count++;
+    return true;
+}  // end MgenHashIndex::Insert()
+
+bool MgenHashIndex::Remove(const char* key, unsigned int keyLen, const void* item)
+{
+    if (0 == table_size) return false;
+    UINT32 hash = Hash(key, keyLen);
+    Entry** prev = &table[hash & (table_size - 1)];
+    while (NULL != *prev)
+    {
+        Entry* entry = *prev;
+        if ((item == entry->item) && KeyIsEqual(entry, key, keyLen, hash))
+        {
+            *prev = entry->next;
+            delete entry;
+            count--;
+            return true;
+        }
+        prev = &entry->next;
+    }
+    return false;
+}  // end MgenHashIndex::Remove()
+
+void* MgenHashIndex::Find(const char* key, unsigned int keyLen) const
+{
+    Iterator iterator(*this, key, keyLen);
+    return iterator.GetNextItem();
+}  // end MgenHashIndex::Find()
+
+MgenHashIndex::Iterator::Iterator(const MgenHashIndex& index, const char* theKey, unsigned int keyLen)
+ : key(theKey), key_len(keyLen), hash(Hash(theKey, keyLen)),
+   next((0 != index.table_size) ? index.table[hash & (index.table_size - 1)] : NULL)
+{
+}
+
+void* MgenHashIndex::Iterator::GetNextItem()
+{
+    while (NULL != next)
+    {
+        Entry* entry = next;
+        next = next->next;
+        if (KeyIsEqual(entry, key, key_len, hash))
+            return entry->item;
+    }
+    return NULL;
+}  // end MgenHashIndex::Iterator::GetNextItem()
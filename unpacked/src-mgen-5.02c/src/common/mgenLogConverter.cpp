@@ -0,0 +1,936 @@
+#include "mgenLogConverter.h"
+#include "mgen.h"
+
+#include <string.h>
+#include <ctype.h>   // for toupper()
+#include <stdlib.h>  // for strtoul(), free()
+#ifdef UNIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // UNIX
+
+// Approximate input size per chunk (chunks hold whole records)
+static const size_t CHUNK_SIZE = 1024 * 1024;
+
+// (indexed by LogEventType)
+static const char* const EVENT_NAME_LIST[] =
+{
+    "INVALID", "RECV", "RERR", "SEND", "LISTEN", "IGNORE", "JOIN", "LEAVE",
+    "START", "STOP", "ON", "ACCEPT", "DISCONNECT", "CONNECT", "OFF", "SHUTDOWN",
+    NULL
+};
+
+MgenLogConverter::MgenLogConverter()
+ : flow_list(NULL), flow_count(0), event_mask(0), thread_count(0),
+   file_data(NULL), file_size(0), chunk_list(NULL), chunk_count(0),
+   index_error(false), local_time(false), log_data(true), log_gps_data(true)
+{
+#ifdef MGEN_PARALLEL_CONVERT
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+    next_chunk = write_chunk = chunk_window = 0;
+    abort = false;
+#endif // MGEN_PARALLEL_CONVERT
+#ifndef UNIX
+    file_buffer = NULL;
+#endif // !UNIX
+}
+
+MgenLogConverter::~MgenLogConverter()
+{
+    UnmapFile();
+    if (NULL != flow_list) delete[] flow_list;
+#ifdef MGEN_PARALLEL_CONVERT
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+#endif // MGEN_PARALLEL_CONVERT
+}
+
+bool MgenLogConverter::SetFlowFilter(const char* flowList)
+{
+    // Count list items to size the range list
+    unsigned int count = 1;
+    for (const char* ptr = flowList; '\0' != *ptr; ptr++)
+        if (',' == *ptr) count++;
+    FlowRange* rangeList = new FlowRange[count];
+    count = 0;
+    const char* ptr = flowList;
+    while ('\0' != *ptr)
+    {
+        char* end;
+        unsigned long first = strtoul(ptr, &end, 10);
+        unsigned long last = first;
+        if (end == ptr)
+        {
+            DMSG(0, "MgenLogConverter::SetFlowFilter() error: invalid flow list \"%s\"\n", flowList);
+            delete[] rangeList;
+            return false;
+        }
+        if ('-' == *end)
+        {
+            ptr = end + 1;
+            last = strtoul(ptr, &end, 10);
+            if ((end == ptr) || (last < first))
+            {
+                DMSG(0, "MgenLogConverter::SetFlowFilter() error: invalid flow range in \"%s\"\n", flowList);
+                delete[] rangeList;
+                return false;
+            }
+        }
+        if (('\0' != *end) && (',' != *end))
+        {
+            DMSG(0, "MgenLogConverter::SetFlowFilter() error: invalid flow list \"%s\"\n", flowList);
+            delete[] rangeList;
+            return false;
+        }
+        rangeList[count].first = (UINT32)first;
+        rangeList[count].last = (UINT32)last;
+        count++;
+        ptr = (',' == *end) ? (end + 1) : end;
+    }
+    if (NULL != flow_list) delete[] flow_list;
+    flow_list = rangeList;
+    flow_count = count;
+    return true;
+}  // end MgenLogConverter::SetFlowFilter()
+
+bool MgenLogConverter::SetEventFilter(const char* eventList)
+{
+    UINT32 mask = 0;
+    const char* ptr = eventList;
+    while ('\0' != *ptr)
+    {
+        // convert to upper case for case-insensitivity
+        char name[16];
+        unsigned int len = 0;
+        while (('\0' != *ptr) && (',' != *ptr))
+        {
+            if (len < 15) name[len++] = toupper(*ptr);
+            ptr++;
+        }
+        name[len] = '\0';
+        if (',' == *ptr) ptr++;
+        unsigned int i;
+        for (i = RECV_EVENT; NULL != EVENT_NAME_LIST[i]; i++)
+        {
+            if (!strcmp(name, EVENT_NAME_LIST[i]))
+                break;
+        }
+        if (NULL == EVENT_NAME_LIST[i])
+        {
+            DMSG(0, "MgenLogConverter::SetEventFilter() error: invalid event type \"%s\"\n", name);
+            return false;
+        }
+        mask |= (0x01 << i);
+    }
+    event_mask = mask;
+    return true;
+}  // end MgenLogConverter::SetEventFilter()
+
+bool MgenLogConverter::FlowSelected(UINT32 flowId) const
+{
+    for (unsigned int i = 0; i < flow_count; i++)
+    {
+        if ((flowId >= flow_list[i].first) && (flowId <= flow_list[i].last))
+            return true;
+    }
+    return false;
+}  // end MgenLogConverter::FlowSelected()
+
+bool MgenLogConverter::RecordSelected(LogEventType        eventType,
+                                      Protocol            theProtocol,
+                                      const char*         buffer,
+                                      UINT16              recordLength) const
+{
+    unsigned int typeIndex = (UINT8)eventType;
+    if ((0 != event_mask) && ((typeIndex > SHUTDOWN_EVENT) || (0 == (event_mask & (0x01 << typeIndex)))))
+        return false;
+    if (0 == flow_count) return true;
+    // Find the record's flow id (see ConvertRecord() for the record formats)
+    unsigned int index;
+    switch (eventType)
+    {
+    case RECV_EVENT:
+      // eventTime, srcPort, srcAddrType, srcAddrLen, srcAddr, then message
+      if (recordLength < 12) return false;
+      index = 12 + (UINT8)buffer[11] + 4;
+      break;
+    case SEND_EVENT:
+      // [mgen_msg_len (TCP)], then message
+      index = ((TCP == theProtocol) ? 4 : 0) + 4;
+      break;
+    case ON_EVENT:
+    case CONNECT_EVENT:
+    case DISCONNECT_EVENT:
+    case OFF_EVENT:
+    case SHUTDOWN_EVENT:
+      // eventTime, port, addrType, addrLen, addr, dstPort, then flow_id
+      // (a zero flow_id is logged for the server side of a connection)
+      if (recordLength < 12) return false;
+      index = 12 + (UINT8)buffer[11] + 2;
+      break;
+    default:
+      return false;
+    }
+    if ((index + 4) > recordLength) return false;
+    UINT32 temp32;
+    memcpy(&temp32, buffer + index, sizeof(INT32));
+    UINT32 flowId = ntohl(temp32);
+    if ((0 == flowId) && (RECV_EVENT != eventType) && (SEND_EVENT != eventType))
+        return false;
+    return FlowSelected(flowId);
+}  // end MgenLogConverter::RecordSelected()
+
+bool MgenLogConverter::MapFile(const char* path)
+{
+    UnmapFile();
+#ifdef UNIX
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        DMSG(0, "Mgen::ConvertFile() fopen() Error: %s\n", GetErrorString());
+        return false;
+    }
+    struct stat buf;
+    if (0 != fstat(fd, &buf))
+    {
+        DMSG(0, "MgenLogConverter::MapFile() fstat() error: %s\n", GetErrorString());
+        close(fd);
+        return false;
+    }
+    file_size = buf.st_size;
+    if (0 != file_size)
+    {
+        void* addr = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == addr)
+        {
+            DMSG(0, "MgenLogConverter::MapFile() mmap() error: %s\n", GetErrorString());
+            close(fd);
+            file_size = 0;
+            return false;
+        }
+#ifdef MADV_SEQUENTIAL
+        madvise(addr, file_size, MADV_SEQUENTIAL);
+#endif // MADV_SEQUENTIAL
+        file_data = (const char*)addr;
+    }
+    close(fd);  // (the mapping stays valid)
+#else
+    // Other systems read the file into memory
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        DMSG(0, "Mgen::ConvertFile() fopen() Error: %s\n", GetErrorString());
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (0 != file_size)
+    {
+        file_buffer = new char[file_size];
+        if ((NULL == file_buffer) || (fread(file_buffer, 1, file_size, file) < file_size))
+        {
+            DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
+            if (NULL != file_buffer) delete[] file_buffer;
+            file_buffer = NULL;
+            file_size = 0;
+            fclose(file);
+            return false;
+        }
+        file_data = file_buffer;
+    }
+    fclose(file);
+#endif // if/else UNIX
+    return true;
+}  // end MgenLogConverter::MapFile()
+
+void MgenLogConverter::UnmapFile()
+{
+    if (NULL != file_data)
+    {
+#ifdef UNIX
+        munmap((void*)file_data, file_size);
+#else
+        delete[] file_buffer;
+        file_buffer = NULL;
+#endif // if/else UNIX
+        file_data = NULL;
+    }
+    file_size = 0;
+    if (NULL != chunk_list)
+    {
+        for (unsigned int i = 0; i < chunk_count; i++)
+            if (NULL != chunk_list[i].text) free(chunk_list[i].text);
+        delete[] chunk_list;
+        chunk_list = NULL;
+    }
+    chunk_count = 0;
+}  // end MgenLogConverter::UnmapFile()
+
+// Checks the log header line, then walks the record headers to
+// split the records into chunks
+bool MgenLogConverter::Index()
+{
+    // Read ASCII binary log header line
+    // The first four characters should be "mgen"
+    if (file_size < 4)
+    {
+        DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
+        return false;
+    }
+    if (strncmp("mgen", file_data, 4) != 0)
+    {
+        DMSG(0, "Mgen::ConvertBinaryLog() error: invalid mgen log file\n");
+        return false;
+    }
+    // Remainder of header line, including terminating NULL
+    char buffer[BINARY_RECORD_MAX];
+    size_t index = 3;
+    do
+    {
+        index++;
+        if ((index >= file_size) || (index >= BINARY_RECORD_MAX))
+        {
+            DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
+            return false;
+        }
+    } while ('\0' != file_data[index]);
+    memcpy(buffer, file_data, index + 1);
+    size_t offset = index + 1;
+
+    // Confirm log file "version" and "type"
+    char* ptr = strstr(buffer, "version=");
+    if (ptr)
+    {
+        // Just look at major version number for moment
+        int version;
+        if (1 == sscanf(ptr, "version=%d", &version))
+        {
+            if (version != 4 && version != 5)
+            {
+                DMSG(0, "Mgen::ConvertBinaryLog() invalid log file version\n");
+                return false;
+            }
+        }
+        else
+        {
+            DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"version\" value\n");
+            return false;
+        }
+    }
+    else
+    {
+        DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"version\" label\n");
+        return false;
+    }
+    ptr = strstr(ptr, "type=");
+    if (ptr)
+    {
+        char fileType[128];
+        if (1 == sscanf(ptr, "type=%127s", fileType))
+        {
+            if (strcmp(fileType, "binary_log"))
+            {
+                DMSG(0, "Mgen::ConvertBinaryLog() invalid log file type\n");
+                return false;
+            }
+        }
+        else
+        {
+            DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"type\" value\n");
+            return false;
+        }
+    }
+    else
+    {
+        DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"type\" label\n");
+        return false;
+    }
+
+    unsigned int chunkMax = (unsigned int)(file_size / CHUNK_SIZE) + 1;
+    chunk_list = new Chunk[chunkMax];
+    chunk_count = 0;
+    index_error = false;
+    size_t chunkStart = offset;
+    while ((offset + 4) <= file_size)  // (a partial record header at the end is ignored)
+    {
+        UINT16 recordLength;
+        memcpy(&recordLength, file_data + offset + 2, sizeof(INT16));
+        recordLength = ntohs(recordLength);
+        if (recordLength > BINARY_RECORD_MAX)
+        {
+            DMSG(0, "Mgen::ConvertBinaryLog() record len:%hu exceeds maximum length\n", recordLength);
+            index_error = true;
+            break;
+        }
+        if ((offset + 4 + recordLength) > file_size)
+        {
+            DMSG(0, "Mgen::ConvertBinaryLog() fread() error: truncated record\n");
+            index_error = true;
+            break;
+        }
+        offset += 4 + recordLength;
+        if (((offset - chunkStart) >= CHUNK_SIZE) && (chunk_count < (chunkMax - 1)))
+        {
+            Chunk& chunk = chunk_list[chunk_count++];
+            memset(&chunk, 0, sizeof(Chunk));
+            chunk.start = chunkStart;
+            chunk.end = chunkStart = offset;
+        }
+    }
+    if (offset > chunkStart)
+    {
+        Chunk& chunk = chunk_list[chunk_count++];
+        memset(&chunk, 0, sizeof(Chunk));
+        chunk.start = chunkStart;
+        chunk.end = offset;
+    }
+    return true;
+}  // end MgenLogConverter::Index()
+
+bool MgenLogConverter::ConvertChunk(FILE* outFile, const Chunk& chunk)
+{
+    char buffer[BINARY_RECORD_MAX];
+    size_t offset = chunk.start;
+    while (offset < chunk.end)
+    {
+        const char* header = file_data + offset;
+        LogEventType eventType = (LogEventType)header[0];
+        Protocol theProtocol = (Protocol)header[1];
+        UINT16 recordLength;
+        memcpy(&recordLength, header+2, sizeof(INT16));
+        recordLength = ntohs(recordLength);
+        offset += 4 + recordLength;
+        if (!RecordSelected(eventType, theProtocol, header + 4, recordLength))
+            continue;
+        // (the record is copied since ConvertRecord() may parse beyond it)
+        memcpy(buffer, header + 4, recordLength);
+        if (!ConvertRecord(outFile, eventType, theProtocol, buffer, recordLength,
+                           local_time, log_data, log_gps_data))
+            return false;
+    }
+    return true;
+}  // end MgenLogConverter::ConvertChunk()
+
+bool MgenLogConverter::Convert(const char* path, Mgen& mgen)
+{
+    if (NULL == mgen.GetLogFile()) return false;
+    return Convert(path, mgen.GetLogFile(), mgen.GetLocalTime(),
+                   mgen.GetLogData(), mgen.GetLogGpsData(), mgen.GetLogFlush());
+}  // end MgenLogConverter::Convert()
+
+bool MgenLogConverter::Convert(const char*  path,
+                               FILE*        outFile,
+                               bool         localTime,
+                               bool         logData,
+                               bool         logGpsData,
+                               bool         flush)
+{
+    if (NULL == outFile) return false;
+    local_time = localTime;
+    log_data = logData;
+    log_gps_data = logGpsData;
+    if (!MapFile(path)) return false;
+    if (!Index())
+    {
+        UnmapFile();
+        return false;
+    }
+
+    bool result = true;
+    unsigned int threadCount = thread_count;
+#ifdef MGEN_PARALLEL_CONVERT
+    if (0 == threadCount)
+    {
+        long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = (cpuCount > 0) ? (unsigned int)cpuCount : 1;
+    }
+    if (threadCount > chunk_count) threadCount = chunk_count;
+    pthread_t* threadList = NULL;
+    if (threadCount > 1)
+    {
+        next_chunk = write_chunk = 0;
+        chunk_window = 2 * threadCount;
+        abort = false;
+        threadList = new pthread_t[threadCount];
+        unsigned int started = 0;
+        while (started < threadCount)
+        {
+            if (0 != pthread_create(threadList + started, NULL, DoThreadStart, this))
+            {
+                DMSG(0, "MgenLogConverter::Convert() pthread_create() error: %s\n", GetErrorString());
+                break;
+            }
+            started++;
+        }
+        threadCount = started;
+        if (0 == threadCount)
+        {
+            delete[] threadList;
+            threadList = NULL;
+        }
+    }
+    if (NULL != threadList)
+    {
+        // Write the chunks in order as they are formatted
+        for (unsigned int i = 0; i < chunk_count; i++)
+        {
+            Chunk& chunk = chunk_list[i];
+            pthread_mutex_lock(&mutex);
+            while (!chunk.done)
+                pthread_cond_wait(&cond, &mutex);
+            pthread_mutex_unlock(&mutex);
+            if ((0 != chunk.text_len) && (fwrite(chunk.text, 1, chunk.text_len, outFile) < chunk.text_len))
+            {
+                DMSG(0, "MgenLogConverter::Convert() fwrite() error: %s\n", GetErrorString());
+                chunk.error = true;
+            }
+            if (flush) fflush(outFile);
+            free(chunk.text);
+            chunk.text = NULL;
+            pthread_mutex_lock(&mutex);
+            write_chunk = i + 1;
+            if (chunk.error) abort = true;
+            pthread_cond_broadcast(&cond);
+            pthread_mutex_unlock(&mutex);
+            if (chunk.error)
+            {
+                result = false;
+                break;
+            }
+        }
+        for (unsigned int i = 0; i < threadCount; i++)
+            pthread_join(threadList[i], NULL);
+        delete[] threadList;
+    }
+    else
+#endif // MGEN_PARALLEL_CONVERT
+    {
+        for (unsigned int i = 0; i < chunk_count; i++)
+        {
+            if (!ConvertChunk(outFile, chunk_list[i]))
+            {
+                result = false;
+                break;
+            }
+            if (flush) fflush(outFile);
+        }
+    }
+    if (index_error) result = false;
+    UnmapFile();
+    return result;
+}  // end MgenLogConverter::Convert()
+
+#ifdef MGEN_PARALLEL_CONVERT
+void* MgenLogConverter::DoThreadStart(void* arg)
+{
+    ((MgenLogConverter*)arg)->RunWorker();
+    return NULL;
+}  // end MgenLogConverter::DoThreadStart()
+
+void MgenLogConverter::RunWorker()
+{
+    while (true)
+    {
+        // Take the next chunk, staying within "chunk_window" of the writer
+        pthread_mutex_lock(&mutex);
+        while (!abort && (next_chunk < chunk_count) &&
+               (next_chunk >= (write_chunk + chunk_window)))
+            pthread_cond_wait(&cond, &mutex);
+        if (abort || (next_chunk >= chunk_count))
+        {
+            pthread_mutex_unlock(&mutex);
+            break;
+        }
+        Chunk& chunk = chunk_list[next_chunk++];
+        pthread_mutex_unlock(&mutex);
+
+        bool error = false;
+        FILE* memFile = open_memstream(&chunk.text, &chunk.text_len);
+        if (NULL != memFile)
+        {
+            error = !ConvertChunk(memFile, chunk);
+            fclose(memFile);
+        }
+        else
+        {
+            DMSG(0, "MgenLogConverter::RunWorker() open_memstream() error: %s\n", GetErrorString());
+            chunk.text = NULL;
+            chunk.text_len = 0;
+            error = true;
+        }
+        pthread_mutex_lock(&mutex);
+        chunk.done = true;
+        chunk.error = error;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+}  // end MgenLogConverter::RunWorker()
+#endif // MGEN_PARALLEL_CONVERT
+
+bool MgenLogConverter::ConvertRecord(FILE*         log_file,
+                                     LogEventType  eventType,
+                                     Protocol      theProtocol,
+                                     char*         buffer,
+                                     UINT16        recordLength,
+                                     bool          local_time,
+                                     bool          log_data,
+                                     bool          log_gps_data)
+{
+    const char* eventName;
+    char hostString[64];
+    unsigned int index = 0;
+    switch (eventType)
+    {
+    case RECV_EVENT:
+      {
+          // get "eventTime"
+          struct timeval eventTime;
+          UINT32 temp32;
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_sec = ntohl(temp32);
+          index += sizeof(INT32);
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_usec = ntohl(temp32);
+          index += sizeof(INT32);
+          // get "srcPort"
+          UINT16 temp16;
+          memcpy(&temp16, buffer+index, sizeof(INT16));
+          UINT16 srcPort = ntohs(temp16);
+          index += sizeof(INT16);
+          // get "srcAddrType"
+          ProtoAddress::Type addrType;
+          switch (buffer[index++])
+          {
+          case MgenMsg::IPv4:
+            addrType = ProtoAddress::IPv4;
+            break;
+          case MgenMsg::IPv6:
+            addrType = ProtoAddress::IPv6;
+            break;
+          default:
+            DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type:%d\n",
+                 buffer[index-1]);
+            return false;
+          }
+          // get "srcAddrLen"
+          unsigned int addrLen = (unsigned int)buffer[index++];
+          ProtoAddress srcAddr;
+          // get "srcAddr"
+          srcAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
+          index += addrLen;
+          srcAddr.SetPort(srcPort);
+
+          // The remainder of the record corresponds to the message content
+          MgenMsg msg;
+          msg.SetProtocol(theProtocol);
+          msg.SetSrcAddr(srcAddr);
+          msg.SetTxTime(eventTime);
+          msg.Unpack(buffer+index, recordLength - index, false, log_data);
+          msg.LogRecvEvent(log_file, false, local_time, log_data, log_gps_data, NULL, false, eventTime);
+          break;
+      }
+    case SEND_EVENT:
+      {
+          MgenMsg msg;
+          // get tcp mgen_msg_len
+          if (theProtocol == TCP)
+          {
+              UINT32 temp32;
+              memcpy(&temp32,buffer+index,sizeof(INT32));
+              msg.SetMgenMsgLen(ntohl(temp32));
+              index += sizeof(UINT32);
+          }
+          msg.SetProtocol(theProtocol);
+          msg.Unpack(buffer+index, recordLength, false, log_data);
+          msg.LogSendEvent(log_file, false, local_time, NULL, false, msg.GetTxTime());
+          break;
+      }
+    case LISTEN_EVENT:
+    case IGNORE_EVENT:
+      {
+          eventName = (LISTEN_EVENT == eventType) ? "LISTEN" : "IGNORE";
+          // get "eventTime"
+          struct timeval eventTime;
+          UINT32 temp32;
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_sec = ntohl(temp32);
+          index += sizeof(INT32);
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_usec = ntohl(temp32);
+          index += sizeof(INT32);
+          // get "protocol"
+          const char* protoName =
+            MgenBaseEvent::GetStringFromProtocol((Protocol)buffer[index++]);
+          // skip "reserved" field
+          index++;
+          // get "portNumber"
+          UINT16 temp16;
+          memcpy(&temp16, buffer+index, sizeof(INT16));
+          UINT16 portNumber = ntohs(temp16);
+          // Output text log format
+          time_t timeSec = eventTime.tv_sec;
+          struct tm timeStruct;
+          struct tm* timePtr = MgenMsg::GetTimeStruct(&timeSec, local_time, &timeStruct);
+          Mgen::Log(log_file, "%02d:%02d:%02d.%06lu %s proto>%s port>%hu\n",
+                    timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                    (UINT32)eventTime.tv_usec, eventName,
+                    protoName, portNumber);
+          break;
+      }
+    case JOIN_EVENT:
+    case LEAVE_EVENT:
+      {
+          // get "eventTime"
+          struct timeval eventTime;
+          UINT32 temp32;
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_sec = ntohl(temp32);
+          index += sizeof(INT32);
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_usec = ntohl(temp32);
+          index += sizeof(INT32);
+          // get "groupPort"
+          UINT16 temp16;
+          memcpy(&temp16, buffer+index, sizeof(INT16));
+          UINT16 groupPort = ntohs(temp16);
+          index += sizeof(INT16);
+          // get "groupAddrType"
+          ProtoAddress::Type addrType;
+          switch (buffer[index++])
+          {
+          case MgenMsg::IPv4:
+            addrType = ProtoAddress::IPv4;
+            break;
+          case MgenMsg::IPv6:
+            addrType = ProtoAddress::IPv6;
+            break;
+          default:
+            DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type\n");
+            return false;
+          }
+          // get "groupAddrLen"
+          unsigned int addrLen = (unsigned int)buffer[index++];
+          ProtoAddress groupAddr;
+          // get "groupAddr"
+          groupAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
+          index += addrLen;
+          // get "ifaceNameLen"
+          unsigned int ifaceNameLen = (UINT8)buffer[index++];
+          char ifaceName[256];
+          memcpy(ifaceName, buffer+index, ifaceNameLen);
+          ifaceName[ifaceNameLen] = '\0';
+          // Output text log format
+          eventName = (JOIN_EVENT == eventType) ? "JOIN" : "LEAVE";
+          time_t timeSec = eventTime.tv_sec;
+          struct tm timeStruct;
+          struct tm* timePtr = MgenMsg::GetTimeStruct(&timeSec, local_time, &timeStruct);
+          Mgen::Log(log_file, "%02d:%02d:%02d.%06lu %s group>%s",
+                    timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                    (UINT32)eventTime.tv_usec, eventName,
+                    groupAddr.GetHostString(hostString, 64));
+          if (ifaceNameLen) Mgen::Log(log_file, " interface>%s", ifaceName);
+          if (groupPort)
+            Mgen::Log(log_file, " port>%hu\n", groupPort);
+          else
+            Mgen::Log(log_file, "\n");
+          break;
+      }
+    case START_EVENT:
+    case STOP_EVENT:
+      {
+          eventName = (START_EVENT == eventType) ? "START" : "STOP";
+          // get "eventTime"
+          struct timeval eventTime;
+          UINT32 temp32;
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_sec = ntohl(temp32);
+          index += sizeof(INT32);
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_usec = ntohl(temp32);
+          index += sizeof(INT32);
+          time_t timeSec = eventTime.tv_sec;
+          struct tm timeStruct;
+          struct tm* timePtr = MgenMsg::GetTimeStruct(&timeSec, local_time, &timeStruct);
+          Mgen::Log(log_file, "%02d:%02d:%02d.%06lu %s\n",
+                    timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                    (UINT32)eventTime.tv_usec, eventName);
+          break;
+      }
+    case ON_EVENT:
+    case ACCEPT_EVENT:
+    case CONNECT_EVENT:
+    case DISCONNECT_EVENT:
+    case OFF_EVENT:
+    case SHUTDOWN_EVENT:
+      {
+          // get "eventTime"
+          struct timeval eventTime;
+          UINT32 temp32;
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_sec = ntohl(temp32);
+          index += sizeof(INT32);
+          memcpy(&temp32, buffer+index, sizeof(INT32));
+          eventTime.tv_usec = ntohl(temp32);
+          index += sizeof(INT32);
+          time_t timeSec = eventTime.tv_sec;
+          struct tm timeStruct;
+          struct tm* timePtr = MgenMsg::GetTimeStruct(&timeSec, local_time, &timeStruct);
+
+          // get "srcPort"
+          UINT16 temp16;
+          memcpy(&temp16, buffer+index, sizeof(INT16));
+          UINT16 port = ntohs(temp16);
+          index += sizeof(INT16);
+
+          // get "srcAddrType"
+          ProtoAddress::Type addrType;
+          switch (buffer[index++])
+          {
+          case MgenMsg::IPv4:
+            addrType = ProtoAddress::IPv4;
+            break;
+          case MgenMsg::IPv6:
+            addrType = ProtoAddress::IPv6;
+            break;
+          default:
+            DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type:%d\n",
+                 buffer[index-1]);
+            return false;
+          }
+          // get "srcAddrLen"
+          unsigned int addrLen = (unsigned int)buffer[index++];
+          ProtoAddress addr;
+          // get "srcAddr"
+          addr.SetRawHostAddress(addrType, buffer+index, addrLen);
+          index += addrLen;
+          addr.SetPort(port);
+          // get "dstPort"
+          memcpy(&temp16,buffer+index,sizeof(INT16));
+          UINT16 dstPort = ntohs(temp16);
+          index += sizeof(INT16);
+
+          // get "flow_id" (it might not exist - its' how we
+          // are differentiating between clients and servers
+          // for now)
+          UINT32 flow_id = 0;
+          memcpy(&temp32,buffer+index,sizeof(UINT32));
+          flow_id = ntohl(temp32);
+          index += sizeof(UINT32);
+
+          ProtoAddress hostAddr;
+          // get "hostPort"
+          if ((index+4) <= recordLength)
+          {
+              memcpy(&temp16, buffer+index, sizeof(INT16));
+              UINT16 hostPort = ntohs(temp16);
+              index += sizeof(INT16);
+              // get "hostAddrType"
+              switch (buffer[index++])
+              {
+              case MgenMsg::IPv4:
+                addrType = ProtoAddress::IPv4;
+                break;
+              case MgenMsg::IPv6:
+                addrType = ProtoAddress::IPv6;
+                break;
+              default:
+                addrType = ProtoAddress::INVALID;
+                break;
+              }
+              // get "hostAddrLen"
+              addrLen = (unsigned int)buffer[index++];
+
+              if (index+addrLen <= recordLength)
+              {
+                  if (ProtoAddress::INVALID != addrType && addrLen)
+                  {
+                      // get "hostAddr"
+                      hostAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
+                      index += addrLen;
+                      hostAddr.SetPort(hostPort);
+                  }
+              }
+          }
+
+          // Let's just keep it verbose and clear...
+          switch (eventType)
+          {
+          case ON_EVENT:
+            Mgen::Log(log_file, "%02d:%02d:%02d.%06lu ON flow>%lu srcPort>%hu dst>%s/%hu",
+                      timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                      (UINT32)eventTime.tv_usec,
+                      flow_id,dstPort,addr.GetHostString(hostString, 64),addr.GetPort());
+            break;
+          case ACCEPT_EVENT:
+            Mgen::Log(log_file, "%02d:%02d:%02d.%06lu ACCEPT src>%s/%hu dstPort>%hu",
+                      timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                      (UINT32)eventTime.tv_usec,
+                      addr.GetHostString(hostString, 64),addr.GetPort(),dstPort);
+            break;
+          case CONNECT_EVENT:
+            Mgen::Log(log_file, "%02d:%02d:%02d.%06lu CONNECT flow>%lu srcPort>%hu dst>%s/%hu",
+                      timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                      (UINT32)eventTime.tv_usec,
+                      flow_id,dstPort,addr.GetHostString(hostString, 64),addr.GetPort());
+            break;
+          case DISCONNECT_EVENT:
+            if (flow_id)
+              Mgen::Log(log_file, "%02d:%02d:%02d.%06lu DISCONNECT flow>%lu dst>%s/%hu srcPort>%hu",
+                        timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                        (UINT32)eventTime.tv_usec,
+                        flow_id,addr.GetHostString(hostString, 64),addr.GetPort(),
+                        dstPort);
+            else
+              Mgen::Log(log_file, "%02d:%02d:%02d.%06lu DISCONNECT src>%s/%hu dstPort>%hu",
+                        timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                        (UINT32)eventTime.tv_usec,
+                        addr.GetHostString(hostString, 64),addr.GetPort(),
+                        dstPort);
+            break;
+          case SHUTDOWN_EVENT:
+            if (flow_id)
+              Mgen::Log(log_file, "%02d:%02d:%02d.%06lu SHUTDOWN flow>%lu dst>%s/%hu srcPort>%hu",
+                        timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                        (UINT32)eventTime.tv_usec,
+                        flow_id,addr.GetHostString(hostString, 64),addr.GetPort(),
+                        dstPort);
+            else
+              Mgen::Log(log_file, "%02d:%02d:%02d.%06lu SHUTDOWN src>%s/%hu dstPort>%hu",
+                        timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                        (UINT32)eventTime.tv_usec,
+                        addr.GetHostString(hostString, 64),addr.GetPort(),
+                        dstPort);
+            break;
+          case OFF_EVENT:
+            if (flow_id)
+              Mgen::Log(log_file, "%02d:%02d:%02d.%06lu OFF flow>%lu srcPort>%hu dst>%s/%hu",
+                        timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                        (UINT32)eventTime.tv_usec,
+                        flow_id,dstPort,
+                        addr.GetHostString(hostString, 64),addr.GetPort());
+            else
+              Mgen::Log(log_file, "%02d:%02d:%02d.%06lu OFF src>%s/%hu dstPort>%hu",
+                        timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                        (UINT32)eventTime.tv_usec,
+                        addr.GetHostString(hostString, 64),addr.GetPort(),dstPort);
+            break;
+          default:
+            DMSG(0,"Mgen::ConvertBinaryLog Invalid event type.\n");
+          }
+          if (hostAddr.IsValid())
+            Mgen::Log(log_file,"host>%s/%hu",
+                      hostAddr.GetHostString(hostString, 64),hostAddr.GetPort());
+          Mgen::Log(log_file,"\n");
+          break;
+      }
+    default:
+      DMSG(0, "Mgen::ConvertBinaryLog() invalid event type\n");
+      return false;
+    }  // end switch(eventType)
+    return true;
+}  // end MgenLogConverter::ConvertRecord()
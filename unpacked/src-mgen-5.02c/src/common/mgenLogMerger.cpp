@@ -0,0 +1,532 @@
+#include "mgenLogMerger.h"
+#include "mgenGlobals.h"  // for binary log record types
+
+#include <string.h>
+#ifdef MGEN_LOG_MERGE
+#include <sys/time.h>  // for gettimeofday()
+#endif // MGEN_LOG_MERGE
+
+MgenLogMerger::MgenLogMerger()
+ : log_file(NULL), log_stream(NULL), log_binary(false), log_flush(false),
+   source_list(NULL), ref_time(-1.0)
+{
+#ifdef MGEN_LOG_MERGE
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+    merger_idle = stopping = false;
+#endif // MGEN_LOG_MERGE
+}
+
+MgenLogMerger::~MgenLogMerger()
+{
+    Close();
+#ifdef MGEN_LOG_MERGE
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+#endif // MGEN_LOG_MERGE
+}
+
+bool MgenLogMerger::IsSupported()
+{
+#ifdef MGEN_LOG_MERGE
+    return true;
+#else
+    return false;
+#endif // if/else MGEN_LOG_MERGE
+}  // end MgenLogMerger::IsSupported()
+
+#ifdef MGEN_LOG_MERGE
+
+MgenLogMerger::Source::Source(MgenLogMerger& theMerger, bool isPrimary)
+ : merger(theMerger), stream(NULL), primary(isPrimary), attached(true),
+   closed(false), header(false), last_time(-1.0), head(NULL), tail(NULL),
+   next(NULL), partial(NULL), partial_len(0), partial_max(0)
+{
+}
+
+MgenLogMerger::Source::~Source()
+{
+    while (NULL != head)
+    {
+        Entry* entry = head;
+        head = head->next;
+        delete[] (char*)entry;
+    }
+    if (NULL != partial) delete[] partial;
+}
+
+FILE* MgenLogMerger::Open(FILE* logFile, bool binary, bool flush)
+{
+    Close();
+    if (NULL == logFile) return NULL;
+    Source* source = new Source(*this, true);
+    if (NULL == source)
+    {
+        DMSG(0, "MgenLogMerger::Open() new source error: %s\n", GetErrorString());
+        return NULL;
+    }
+    // (only the primary source writes the binary log header)
+    source->header = binary;
+    log_file = logFile;
+    log_binary = binary;
+    log_flush = flush;
+    merger_idle = stopping = false;
+    ref_time = -1.0;
+    if (NULL == (log_stream = OpenStream(source)))
+    {
+        delete source;
+        log_file = NULL;
+        return NULL;
+    }
+    source_list = source;
+
+    if (0 != pthread_create(&thread_id, NULL, DoThreadStart, this))
+    {
+        DMSG(0, "MgenLogMerger::Open() pthread_create() error: %s\n", GetErrorString());
+        // (StreamClose() deletes a detached source and leaves "logFile" open)
+        source_list = NULL;
+        source->attached = false;
+        fclose(log_stream);
+        log_stream = NULL;
+        log_file = NULL;
+        return NULL;
+    }
+    return log_stream;
+}  // end MgenLogMerger::Open()
+
+FILE* MgenLogMerger::OpenSource()
+{
+    if (NULL == log_stream) return NULL;
+    Source* source = new Source(*this, false);
+    if (NULL == source)
+    {
+        DMSG(0, "MgenLogMerger::OpenSource() new source error: %s\n", GetErrorString());
+        return NULL;
+    }
+    FILE* stream = OpenStream(source);
+    if (NULL == stream)
+    {
+        delete source;
+        return NULL;
+    }
+    pthread_mutex_lock(&mutex);
+    source->next = source_list;
+    source_list = source;
+    pthread_mutex_unlock(&mutex);
+    return stream;
+}  // end MgenLogMerger::OpenSource()
+
+FILE* MgenLogMerger::OpenStream(Source* source)
+{
+#ifdef LINUX
+    cookie_io_functions_t streamFuncs;
+    streamFuncs.read = NULL;
+    streamFuncs.write = StreamWrite;
+    streamFuncs.seek = NULL;
+    streamFuncs.close = StreamClose;
+    source->stream = fopencookie(source, "w", streamFuncs);
+#else
+    source->stream = funopen(source, NULL, StreamWrite, NULL, StreamClose);
+#endif // if/else LINUX
+    if (NULL == source->stream)
+    {
+        DMSG(0, "MgenLogMerger::OpenStream() stream open error: %s\n", GetErrorString());
+        return NULL;
+    }
+    // Text is passed on a line at a time so it is queued promptly
+    // (binary records are split from whatever is written)
+    if (log_binary)
+        setvbuf(source->stream, NULL, _IONBF, 0);
+    else
+        setvbuf(source->stream, NULL, _IOLBF, 4096);
+    return source->stream;
+}  // end MgenLogMerger::OpenStream()
+
+void MgenLogMerger::Close()
+{
+    // StreamClose() does the actual shutdown
+    if (NULL != log_stream) fclose(log_stream);
+}  // end MgenLogMerger::Close()
+
+double MgenLogMerger::GetTime()
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return ((double)now.tv_sec + 1.0e-06 * (double)now.tv_usec);
+}  // end MgenLogMerger::GetTime()
+
+// Returns the "HH:MM:SS.usec" time of day a text log line begins with
+// (or -1.0 if it has none)
+double MgenLogMerger::ParseTextTime(const char* text, unsigned int len)
+{
+    if (len < 8) return -1.0;
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        if ((2 == i) || (5 == i))
+        {
+            if (':' != text[i]) return -1.0;
+        }
+        else if ((text[i] < '0') || (text[i] > '9'))
+        {
+            return -1.0;
+        }
+    }
+    double theTime = 3600.0 * (10 * (text[0] - '0') + (text[1] - '0')) +
+                     60.0 * (10 * (text[3] - '0') + (text[4] - '0')) +
+                     (double)(10 * (text[6] - '0') + (text[7] - '0'));
+    if ((len > 8) && ('.' == text[8]))
+    {
+        double scale = 0.1;
+        for (unsigned int i = 9; (i < len) && (text[i] >= '0') && (text[i] <= '9'); i++)
+        {
+            theTime += scale * (double)(text[i] - '0');
+            scale *= 0.1;
+        }
+    }
+    return theTime;
+}  // end MgenLogMerger::ParseTextTime()
+
+MgenLogMerger::Entry* MgenLogMerger::NewEntry(const char* data, unsigned int len, double theTime)
+{
+    Entry* entry = (Entry*)(new char[sizeof(Entry) + len]);
+    if (NULL == entry)
+    {
+        DMSG(0, "MgenLogMerger::NewEntry() new entry error: %s\n", GetErrorString());
+        return NULL;
+    }
+    entry->time = theTime;
+    entry->len = len;
+    entry->next = NULL;
+    memcpy((char*)(entry + 1), data, len);
+    return entry;
+}  // end MgenLogMerger::NewEntry()
+
+// Splits the source's buffered output into text lines or binary log
+// records.  If "final" is set, any incomplete remainder is an entry too.
+MgenLogMerger::Entry* MgenLogMerger::Split(Source& source, bool final)
+{
+    Entry* entryList = NULL;
+    Entry** last = &entryList;
+    unsigned int offset = 0;
+    while (offset < source.partial_len)
+    {
+        const char* ptr = source.partial + offset;
+        unsigned int avail = source.partial_len - offset;
+        unsigned int len = avail;
+        double theTime = -1.0;
+        if (log_binary)
+        {
+            if (source.header && ('m' == ptr[0]))
+            {
+                // "mgen version=..." header line plus NULL character
+                const char* end = (const char*)memchr(ptr, '\0', avail);
+                if (NULL != end)
+                    len = end - ptr + 1;
+                else if (!final)
+                    break;
+                theTime = 0.0;  // (precedes all records)
+            }
+            else if (avail >= 4)
+            {
+                // <eventType><reserved><recordLength><eventTime(sec,usec)>...
+                UINT16 recordLength;
+                memcpy(&recordLength, ptr + 2, sizeof(UINT16));
+                len = 4 + ntohs(recordLength);
+                if (len > avail)
+                {
+                    if (!final) break;
+                    len = avail;
+                }
+                else
+                {
+                    // SEND records hold the message itself (after the TCP
+                    // message length), whose tx_time is the event time
+                    // (<msgSize><version><flags><flowId><seqNum><txTime>...)
+                    unsigned int timeOffset = 4;
+                    if (SEND_EVENT == (UINT8)ptr[0])
+                        timeOffset += ((TCP == (UINT8)ptr[1]) ? 4 : 0) + 12;
+                    if (len >= (timeOffset + 8))
+                    {
+                        UINT32 sec, usec;
+                        memcpy(&sec, ptr + timeOffset, sizeof(UINT32));
+                        memcpy(&usec, ptr + timeOffset + 4, sizeof(UINT32));
+                        theTime = (double)ntohl(sec) + 1.0e-06 * (double)ntohl(usec);
+                    }
+                }
+            }
+            else if (!final)
+            {
+                break;
+            }
+            source.header = false;
+        }
+        else
+        {
+            const char* end = (const char*)memchr(ptr, '\n', avail);
+            if (NULL != end)
+                len = end - ptr + 1;
+            else if (!final)
+                break;
+            theTime = ParseTextTime(ptr, len);
+        }
+        Entry* entry = NewEntry(ptr, len, theTime);
+        if (NULL != entry)
+        {
+            *last = entry;
+            last = &entry->next;
+        }
+        offset += len;
+    }
+    if (0 != offset)
+    {
+        source.partial_len -= offset;
+        memmove(source.partial, source.partial + offset, source.partial_len);
+    }
+    return entryList;
+}  // end MgenLogMerger::Split()
+
+void MgenLogMerger::Enqueue(Source& source, Entry* entryList)
+{
+    double now = GetTime();
+    while (NULL != entryList)
+    {
+        Entry* entry = entryList;
+        entryList = entry->next;
+        double ref = (source.last_time >= 0.0) ? source.last_time : ref_time;
+        if (entry->time < 0.0)
+        {
+            // (output without a time stays after the source's previous entry)
+            entry->time = ref;
+        }
+        else if (!log_binary && (ref >= 0.0))
+        {
+            // Text times are times of day, so keep them continuous across midnight
+            while (entry->time < (ref - 43200.0)) entry->time += 86400.0;
+            while (entry->time > (ref + 43200.0)) entry->time -= 86400.0;
+        }
+        source.last_time = entry->time;
+        if (entry->time > ref_time) ref_time = entry->time;
+        entry->arrival = now;
+        entry->next = NULL;
+        if (NULL != source.tail)
+            source.tail->next = entry;
+        else
+            source.head = entry;
+        source.tail = entry;
+    }
+}  // end MgenLogMerger::Enqueue()
+
+#ifdef LINUX
+ssize_t MgenLogMerger::StreamWrite(void* cookie, const char* buffer, size_t size)
+#else
+int MgenLogMerger::StreamWrite(void* cookie, const char* buffer, int size)
+#endif // if/else LINUX
+{
+    Source* source = (Source*)cookie;
+    MgenLogMerger& merger = source->merger;
+    if ((source->partial_len + (unsigned int)size) > source->partial_max)
+    {
+        unsigned int newMax = (0 != source->partial_max) ? (source->partial_max << 1) : 4096;
+        while (newMax < (source->partial_len + (unsigned int)size)) newMax <<= 1;
+        char* newBuffer = new char[newMax];
+        if (NULL == newBuffer)
+        {
+            DMSG(0, "MgenLogMerger::StreamWrite() new buffer error: %s\n", GetErrorString());
+            return 0;
+        }
+        if (NULL != source->partial)
+        {
+            memcpy(newBuffer, source->partial, source->partial_len);
+            delete[] source->partial;
+        }
+        source->partial = newBuffer;
+        source->partial_max = newMax;
+    }
+    memcpy(source->partial + source->partial_len, buffer, size);
+    source->partial_len += size;
+    Entry* entryList = merger.Split(*source, false);
+    if (NULL == entryList) return size;
+    pthread_mutex_lock(&merger.mutex);
+    if (source->attached)
+    {
+        // The merge thread only needs waking when a queue was empty
+        bool wasEmpty = (NULL == source->head);
+        merger.Enqueue(*source, entryList);
+        if (wasEmpty && merger.merger_idle)
+            pthread_cond_signal(&merger.cond);
+        entryList = NULL;
+    }
+    pthread_mutex_unlock(&merger.mutex);
+    while (NULL != entryList)
+    {
+        // (detached source output is discarded)
+        Entry* entry = entryList;
+        entryList = entry->next;
+        delete[] (char*)entry;
+    }
+    return size;
+}  // end MgenLogMerger::StreamWrite()
+
+int MgenLogMerger::StreamClose(void* cookie)
+{
+    Source* source = (Source*)cookie;
+    MgenLogMerger& merger = source->merger;
+    Entry* entryList = merger.Split(*source, true);
+    pthread_mutex_lock(&merger.mutex);
+    source->stream = NULL;
+    if (!source->attached)
+    {
+        pthread_mutex_unlock(&merger.mutex);
+        while (NULL != entryList)
+        {
+            Entry* entry = entryList;
+            entryList = entry->next;
+            delete[] (char*)entry;
+        }
+        delete source;
+        return 0;
+    }
+    merger.Enqueue(*source, entryList);
+    source->closed = true;
+    pthread_cond_signal(&merger.cond);
+    if (!source->primary)
+    {
+        // (the merge thread deletes it once its entries are written)
+        pthread_mutex_unlock(&merger.mutex);
+        return 0;
+    }
+    // Write all remaining entries and stop the merge thread
+    merger.stopping = true;
+    pthread_mutex_unlock(&merger.mutex);
+    pthread_join(merger.thread_id, NULL);
+    pthread_mutex_lock(&merger.mutex);
+    Source* next = merger.source_list;
+    merger.source_list = NULL;
+    while (NULL != next)
+    {
+        Source* current = next;
+        next = next->next;
+        if (current->closed)
+        {
+            delete current;
+        }
+        else
+        {
+            // (its owner's fclose() will delete it)
+            current->attached = false;
+            current->next = NULL;
+        }
+    }
+    pthread_mutex_unlock(&merger.mutex);
+    int result = 0;
+    if ((stdout != merger.log_file) && (stderr != merger.log_file))
+        result = fclose(merger.log_file);
+    else
+        fflush(merger.log_file);
+    merger.log_file = NULL;
+    merger.log_stream = NULL;
+    return result;
+}  // end MgenLogMerger::StreamClose()
+
+void* MgenLogMerger::DoThreadStart(void* arg)
+{
+    ((MgenLogMerger*)arg)->Run();
+    return NULL;
+}  // end MgenLogMerger::DoThreadStart()
+
+void MgenLogMerger::Run()
+{
+    const unsigned int BATCH_MAX = 256;
+    const double HOLDBACK = 1.0e-06 * (double)HOLDBACK_USEC;
+    pthread_mutex_lock(&mutex);
+    while (true)
+    {
+        // Take the earliest queued entries that are ready as a batch
+        double now = GetTime();
+        double wakeTime = now + HOLDBACK;
+        Entry* batch = NULL;
+        Entry** last = &batch;
+        unsigned int count = 0;
+        while (count < BATCH_MAX)
+        {
+            Source* minSource = NULL;
+            bool waiting = false;  // an open source has nothing queued
+            Source** prev = &source_list;
+            while (NULL != *prev)
+            {
+                Source* source = *prev;
+                if (NULL != source->head)
+                {
+                    if ((NULL == minSource) || (source->head->time < minSource->head->time))
+                        minSource = source;
+                }
+                else if (source->closed && !source->primary)
+                {
+                    *prev = source->next;
+                    delete source;
+                    continue;
+                }
+                else if (!source->closed)
+                {
+                    waiting = true;
+                }
+                prev = &source->next;
+            }
+            if (NULL == minSource) break;
+            Entry* entry = minSource->head;
+            if (waiting && !stopping)
+            {
+                double releaseTime = entry->arrival + HOLDBACK;
+                if (releaseTime > now)
+                {
+                    wakeTime = releaseTime;
+                    break;
+                }
+            }
+            if (NULL == (minSource->head = entry->next))
+                minSource->tail = NULL;
+            entry->next = NULL;
+            *last = entry;
+            last = &entry->next;
+            count++;
+        }
+        if (NULL != batch)
+        {
+            pthread_mutex_unlock(&mutex);
+            while (NULL != batch)
+            {
+                Entry* entry = batch;
+                batch = entry->next;
+                if (fwrite((char*)(entry + 1), 1, entry->len, log_file) < entry->len)
+                    DMSG(0, "MgenLogMerger::Run() fwrite() error: %s\n", GetErrorString());
+                delete[] (char*)entry;
+            }
+            if (log_flush) fflush(log_file);
+            pthread_mutex_lock(&mutex);
+            continue;
+        }
+        if (stopping) break;  // (everything is written)
+        struct timespec timeout;
+        timeout.tv_sec = (time_t)wakeTime;
+        timeout.tv_nsec = (long)(1.0e+09 * (wakeTime - (double)timeout.tv_sec));
+        if (timeout.tv_nsec >= 1000000000) timeout.tv_nsec = 999999999;
+        merger_idle = true;
+        pthread_cond_timedwait(&cond, &mutex, &timeout);
+        merger_idle = false;
+    }
+    pthread_mutex_unlock(&mutex);
+    fflush(log_file);
+}  // end MgenLogMerger::Run()
+
+#else
+
+FILE* MgenLogMerger::Open(FILE* logFile, bool binary, bool flush)
+{
+    DMSG(0, "MgenLogMerger::Open() error: log merging not supported on this system\n");
+    return NULL;
+}
+
+FILE* MgenLogMerger::OpenSource() {return NULL;}
+void MgenLogMerger::Close() {}
+
+#endif // if/else MGEN_LOG_MERGE
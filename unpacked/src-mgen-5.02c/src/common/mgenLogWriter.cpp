@@ -0,0 +1,461 @@
+#include "mgenLogWriter.h"
+#include "mgenPayload.h"
+
+#include <string.h>
+#ifdef MGEN_ASYNC_LOG
+#include <sys/time.h>  // for gettimeofday()
+#include <unistd.h>    // for usleep()
+#endif // MGEN_ASYNC_LOG
+
+MgenLogWriter::MgenLogWriter()
+ : log_file(NULL), log_stream(NULL), detach(false), drop_on_full(false), log_flush(false),
+   ring(NULL), ring_mask(0), ring_head(0), ring_tail(0),
+   record_count(0), wait_count(0), drop_count(0)
+{
+#ifdef MGEN_ASYNC_LOG
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+    writer_idle = stopping = false;
+    sync_request = sync_done = 0;
+#endif // MGEN_ASYNC_LOG
+}
+
+MgenLogWriter::~MgenLogWriter()
+{
+    Close();
+#ifdef MGEN_ASYNC_LOG
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+#endif // MGEN_ASYNC_LOG
+}
+
+bool MgenLogWriter::IsSupported()
+{
+#ifdef MGEN_ASYNC_LOG
+    return true;
+#else
+    return false;
+#endif // if/else MGEN_ASYNC_LOG
+}  // end MgenLogWriter::IsSupported()
+
+#ifdef MGEN_ASYNC_LOG
+
+FILE* MgenLogWriter::Open(FILE* logFile, unsigned int bufferSize, bool dropOnFull, bool flush)
+{
+    Close();
+    if (NULL == logFile) return NULL;
+    // Ring size is a power of two so indices can simply wrap
+    UINT32 ringSize = BUFFER_SIZE_MIN;
+    while ((ringSize < bufferSize) && (ringSize < 0x40000000))
+        ringSize <<= 1;
+    if (NULL == (ring = new char[ringSize]))
+    {
+        DMSG(0, "MgenLogWriter::Open() new ring error: %s\n", GetErrorString());
+        return NULL;
+    }
+    ring_mask = ringSize - 1;
+    ring_head = ring_tail = 0;
+    record_count = wait_count = drop_count = 0;
+    log_file = logFile;
+    detach = false;
+    drop_on_full = dropOnFull;
+    log_flush = flush;
+    writer_idle = stopping = false;
+    sync_request = sync_done = 0;
+
+#ifdef LINUX
+    cookie_io_functions_t streamFuncs;
+    streamFuncs.read = NULL;
+    streamFuncs.write = StreamWrite;
+    streamFuncs.seek = NULL;
+    streamFuncs.close = StreamClose;
+    log_stream = fopencookie(this, "w", streamFuncs);
+#else
+    log_stream = funopen(this, NULL, StreamWrite, NULL, StreamClose);
+#endif // if/else LINUX
+    if (NULL == log_stream)
+    {
+        DMSG(0, "MgenLogWriter::Open() stream open error: %s\n", GetErrorString());
+        delete[] ring;
+        ring = NULL;
+        log_file = NULL;
+        return NULL;
+    }
+    // Each stdio write call is passed to StreamWrite() as it is made
+    // so that text stays in order with the event records
+    setvbuf(log_stream, NULL, _IONBF, 0);
+
+    if (0 != pthread_create(&thread_id, NULL, DoThreadStart, this))
+    {
+        DMSG(0, "MgenLogWriter::Open() pthread_create() error: %s\n", GetErrorString());
+        // (StreamClose() leaves "logFile" open when "log_file" is NULL)
+        log_file = NULL;
+        fclose(log_stream);
+        delete[] ring;
+        ring = NULL;
+        return NULL;
+    }
+    return log_stream;
+}  // end MgenLogWriter::Open()
+
+void MgenLogWriter::Close()
+{
+    // StreamClose() does the actual shutdown
+    if (NULL != log_stream) fclose(log_stream);
+}  // end MgenLogWriter::Close()
+
+FILE* MgenLogWriter::Detach()
+{
+    if (NULL == log_stream) return NULL;
+    FILE* theFile = log_file;
+    detach = true;
+    fclose(log_stream);
+    detach = false;
+    return theFile;
+}  // end MgenLogWriter::Detach()
+
+void MgenLogWriter::Sync()
+{
+    if (NULL == log_stream) return;
+    pthread_mutex_lock(&mutex);
+    UINT32 request = ++sync_request;
+    pthread_cond_broadcast(&cond);
+    while ((INT32)(sync_done - request) < 0)
+        pthread_cond_wait(&cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+}  // end MgenLogWriter::Sync()
+
+#ifdef LINUX
+ssize_t MgenLogWriter::StreamWrite(void* cookie, const char* buffer, size_t size)
+#else
+int MgenLogWriter::StreamWrite(void* cookie, const char* buffer, int size)
+#endif // if/else LINUX
+{
+    MgenLogWriter* writer = (MgenLogWriter*)cookie;
+    if (NULL == writer->ring) return 0;
+    size_t offset = 0;
+    while (offset < (size_t)size)
+    {
+        UINT32 len = (UINT32)(size - offset);
+        if (len > TEXT_MAX) len = TEXT_MAX;
+        // (text records always wait for room)
+        Record* record = writer->Reserve(RecordLength(len), false);
+        record->type = TEXT;
+        record->buffer_len = len;
+        memcpy((char*)(record + 1), buffer + offset, len);
+        writer->Commit(record);
+        offset += len;
+    }
+    return size;
+}  // end MgenLogWriter::StreamWrite()
+
+int MgenLogWriter::StreamClose(void* cookie)
+{
+    MgenLogWriter* writer = (MgenLogWriter*)cookie;
+    writer->log_stream = NULL;
+    if (NULL == writer->log_file) return 0;  // (writer thread never started)
+    // Write any remaining records and stop the writer thread
+    pthread_mutex_lock(&writer->mutex);
+    writer->stopping = true;
+    pthread_cond_broadcast(&writer->cond);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread_id, NULL);
+    int result = 0;
+    if (!writer->detach && (stdout != writer->log_file) && (stderr != writer->log_file))
+        result = fclose(writer->log_file);
+    else
+        fflush(writer->log_file);
+    writer->log_file = NULL;
+    delete[] writer->ring;
+    writer->ring = NULL;
+    if ((0 != writer->wait_count) || (0 != writer->drop_count))
+        DMSG(0, "MgenLogWriter: %lu records logged, producer waited %lu times, %lu records dropped\n",
+             writer->record_count, writer->wait_count, writer->drop_count);
+    else
+        DMSG(2, "MgenLogWriter: %lu records logged\n", writer->record_count);
+    return result;
+}  // end MgenLogWriter::StreamClose()
+
+// Returns space for a record of "length" bytes (with the "length"
+// field set) or NULL if it was dropped
+MgenLogWriter::Record* MgenLogWriter::Reserve(UINT32 length, bool canDrop)
+{
+    UINT32 ringSize = ring_mask + 1;
+    if (length > (ringSize >> 1))
+    {
+        drop_count++;  // (never fits)
+        return NULL;
+    }
+    // Space up to the end of the ring is padded when the record doesn't fit
+    UINT32 offset = ring_head & ring_mask;
+    UINT32 pad = ((ringSize - offset) < length) ? (ringSize - offset) : 0;
+    bool waited = false;
+    while ((ringSize - (ring_head - __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE))) < (pad + length))
+    {
+        if (canDrop && drop_on_full)
+        {
+            drop_count++;
+            return NULL;
+        }
+        if (!waited)
+        {
+            wait_count++;
+            waited = true;
+        }
+        WakeWriter(true);
+        usleep(100);
+    }
+    if (0 != pad)
+    {
+        Record* padRecord = (Record*)(ring + offset);
+        padRecord->type = PAD;
+        padRecord->length = pad;
+        __atomic_store_n(&ring_head, ring_head + pad, __ATOMIC_RELEASE);
+    }
+    Record* record = (Record*)(ring + (ring_head & ring_mask));
+    record->length = length;
+    return record;
+}  // end MgenLogWriter::Reserve()
+
+void MgenLogWriter::Commit(Record* record)
+{
+    __atomic_store_n(&ring_head, ring_head + record->length, __ATOMIC_RELEASE);
+    record_count++;
+    WakeWriter(false);
+}  // end MgenLogWriter::Commit()
+
+// The writer thread wakes up on its own every LOG_INTERVAL so it is only
+// signaled (when idle) if the ring is filling up, to keep batches large
+void MgenLogWriter::WakeWriter(bool force)
+{
+    if (!force && ((ring_head - __atomic_load_n(&ring_tail, __ATOMIC_RELAXED)) < ((ring_mask + 1) >> 2)))
+        return;
+    if (__atomic_load_n(&writer_idle, __ATOMIC_RELAXED))
+    {
+        pthread_mutex_lock(&mutex);
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+}  // end MgenLogWriter::WakeWriter()
+
+void* MgenLogWriter::DoThreadStart(void* arg)
+{
+    ((MgenLogWriter*)arg)->Run();
+    return NULL;
+}  // end MgenLogWriter::DoThreadStart()
+
+void MgenLogWriter::Run()
+{
+    const long LOG_INTERVAL = 10000;  // usec
+    while (true)
+    {
+        UINT32 tail = ring_tail;
+        UINT32 head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+        if (tail != head)
+        {
+            // Write everything pending as one batch
+            while (tail != head)
+            {
+                Record* record = (Record*)(ring + (tail & ring_mask));
+                if (PAD != record->type) WriteRecord(record);
+                tail += record->length;
+                __atomic_store_n(&ring_tail, tail, __ATOMIC_RELEASE);
+            }
+            if (log_flush) fflush(log_file);
+            continue;
+        }
+        pthread_mutex_lock(&mutex);
+        if (__atomic_load_n(&ring_head, __ATOMIC_ACQUIRE) != ring_tail)
+        {
+            pthread_mutex_unlock(&mutex);
+            continue;
+        }
+        // The ring is empty, so any Sync() or Close() request is done
+        if (sync_done != sync_request)
+        {
+            fflush(log_file);
+            sync_done = sync_request;
+            pthread_cond_broadcast(&cond);
+        }
+        if (stopping)
+        {
+            pthread_mutex_unlock(&mutex);
+            break;
+        }
+        struct timeval now;
+        gettimeofday(&now, NULL);
+        struct timespec timeout;
+        timeout.tv_sec = now.tv_sec;
+        timeout.tv_nsec = (now.tv_usec + LOG_INTERVAL) * 1000;
+        if (timeout.tv_nsec >= 1000000000)
+        {
+            timeout.tv_sec++;
+            timeout.tv_nsec -= 1000000000;
+        }
+        __atomic_store_n(&writer_idle, true, __ATOMIC_RELAXED);
+        pthread_cond_timedwait(&cond, &mutex, &timeout);
+        __atomic_store_n(&writer_idle, false, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&mutex);
+    }
+}  // end MgenLogWriter::Run()
+
+#else
+
+FILE* MgenLogWriter::Open(FILE* logFile, unsigned int bufferSize, bool dropOnFull, bool flush)
+{
+    DMSG(0, "MgenLogWriter::Open() error: asynchronous logging not supported on this system\n");
+    return NULL;
+}
+
+void MgenLogWriter::Close() {}
+FILE* MgenLogWriter::Detach() {return NULL;}
+void MgenLogWriter::Sync() {}
+MgenLogWriter::Record* MgenLogWriter::Reserve(UINT32 length, bool canDrop) {return NULL;}
+void MgenLogWriter::Commit(Record* record) {}
+
+#endif // if/else MGEN_ASYNC_LOG
+
+void MgenLogWriter::SaveAddress(Address& a, const ProtoAddress& theAddr)
+{
+    a.type = (UINT8)theAddr.GetType();
+    a.len = 0;
+    a.port = 0;
+    if (theAddr.IsValid() && (theAddr.GetLength() <= sizeof(a.addr)))
+    {
+        a.len = (UINT8)theAddr.GetLength();
+        a.port = theAddr.GetPort();
+        memcpy(a.addr, theAddr.GetRawHostAddress(), a.len);
+    }
+}  // end MgenLogWriter::SaveAddress()
+
+void MgenLogWriter::RestoreAddress(const Address& a, ProtoAddress& theAddr)
+{
+    if (0 != a.len)
+    {
+        theAddr.SetRawHostAddress((ProtoAddress::Type)a.type, a.addr, a.len);
+        theAddr.SetPort(a.port);
+    }
+}  // end MgenLogWriter::RestoreAddress()
+
+bool MgenLogWriter::LogSendEvent(MgenMsg&              theMsg,
+                                 int                   options,
+                                 const char*           msgBuffer,
+                                 const struct timeval& theTime,
+                                 const struct timeval* txStamp)
+{
+    // Binary SEND records hold this much of the message buffer
+    // (as computed in MgenMsg::LogSendEvent())
+    UINT16 bufferLen = 0;
+    if ((0 != (options & BINARY)) && (NULL != msgBuffer))
+    {
+        bufferLen = 12 + theMsg.dst_addr.GetLength() + theMsg.packet_header_len;
+        if (theMsg.host_addr.IsValid())
+            bufferLen += theMsg.host_addr.GetLength() + 4;
+    }
+    return LogEvent(SEND, theMsg, options, msgBuffer, bufferLen, theTime, txStamp);
+}  // end MgenLogWriter::LogSendEvent()
+
+bool MgenLogWriter::LogRecvEvent(MgenMsg&              theMsg,
+                                 int                   options,
+                                 const char*           msgBuffer,
+                                 const struct timeval& theTime,
+                                 const struct timeval* rxStamp)
+{
+    // Binary RECV records hold this much of the message buffer
+    // (as computed in MgenMsg::LogRecvEvent())
+    UINT16 bufferLen = 0;
+    if ((0 != (options & BINARY)) && (NULL != msgBuffer))
+        bufferLen = theMsg.packet_header_len + theMsg.GetPayloadLen();
+    return LogEvent(RECV, theMsg, options, msgBuffer, bufferLen, theTime, rxStamp);
+}  // end MgenLogWriter::LogRecvEvent()
+
+bool MgenLogWriter::LogEvent(RecordType            type,
+                             MgenMsg&              theMsg,
+                             int                   options,
+                             const char*           msgBuffer,
+                             UINT16                bufferLen,
+                             const struct timeval& theTime,
+                             const struct timeval* stampTime)
+{
+    UINT16 payloadLen = theMsg.GetPayloadLen();
+    Record* record = Reserve(RecordLength(payloadLen + bufferLen), true);
+    if (NULL == record) return false;
+    record->type = type;
+    record->options = options;
+    record->buffer_len = bufferLen;
+    record->payload_len = payloadLen;
+    record->msg_len = theMsg.msg_len;
+    record->packet_header_len = theMsg.packet_header_len;
+    record->flags = theMsg.flags;
+    record->protocol = (UINT8)theMsg.protocol;
+    record->gps_status = (UINT8)theMsg.gps_status;
+    record->has_stamp = (NULL != stampTime) ? 1 : 0;
+    record->flow_id = theMsg.flow_id;
+    record->seq_num = theMsg.seq_num;
+    record->mgen_msg_len = theMsg.mgen_msg_len;
+    record->altitude = theMsg.altitude;
+    record->latitude = theMsg.latitude;
+    record->longitude = theMsg.longitude;
+    record->event_time = theTime;
+    record->tx_time = theMsg.tx_time;
+    if (NULL != stampTime) record->stamp = *stampTime;
+    SaveAddress(record->src_addr, theMsg.src_addr);
+    SaveAddress(record->dst_addr, theMsg.dst_addr);
+    SaveAddress(record->host_addr, theMsg.host_addr);
+    char* data = (char*)(record + 1);
+    if (0 != payloadLen)
+        memcpy(data, theMsg.payload->GetRaw(), payloadLen);
+    if (0 != bufferLen)
+        memcpy(data + payloadLen, msgBuffer, bufferLen);
+    Commit(record);
+    return true;
+}  // end MgenLogWriter::LogEvent()
+
+// (Called by the writer thread)
+void MgenLogWriter::WriteRecord(Record* record)
+{
+    char* data = (char*)(record + 1);
+    if (TEXT == record->type)
+    {
+        fwrite(data, 1, record->buffer_len, log_file);
+        return;
+    }
+    MgenMsg msg;
+    msg.msg_len = record->msg_len;
+    msg.packet_header_len = record->packet_header_len;
+    msg.flags = record->flags;
+    msg.protocol = (Protocol)record->protocol;
+    msg.gps_status = (MgenMsg::GPSStatus)record->gps_status;
+    msg.flow_id = record->flow_id;
+    msg.seq_num = record->seq_num;
+    msg.mgen_msg_len = record->mgen_msg_len;
+    msg.altitude = record->altitude;
+    msg.latitude = record->latitude;
+    msg.longitude = record->longitude;
+    msg.tx_time = record->tx_time;
+    RestoreAddress(record->src_addr, msg.src_addr);
+    RestoreAddress(record->dst_addr, msg.dst_addr);
+    RestoreAddress(record->host_addr, msg.host_addr);
+    if (0 != record->payload_len)
+    {
+        msg.payload = new MgenPayload();
+        msg.payload->SetRaw(data, record->payload_len);
+    }
+    char* msgBuffer = (0 != record->buffer_len) ? (data + record->payload_len) : NULL;
+    const struct timeval* stampTime = record->has_stamp ? &record->stamp : NULL;
+    bool logBinary = (0 != (record->options & BINARY));
+    bool localTime = (0 != (record->options & LOCAL_TIME));
+    // (The writer thread flushes the log file per batch instead)
+    if (SEND == record->type)
+    {
+        msg.LogSendEvent(log_file, logBinary, localTime, msgBuffer,
+                         false, record->event_time, stampTime);
+    }
+    else
+    {
+        msg.LogRecvEvent(log_file, logBinary, localTime,
+                         0 != (record->options & LOG_DATA),
+                         0 != (record->options & LOG_GPS_DATA),
+                         msgBuffer, false, record->event_time, stampTime);
+    }
+}  // end MgenLogWriter::WriteRecord()
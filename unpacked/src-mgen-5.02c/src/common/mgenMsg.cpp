@@ -31,7 +31,9 @@
  ********************************************************************/
 #include "mgenGlobals.h"
 #include "mgenMsg.h"
+#include "mgenCrc32.h"
 #include "mgen.h"
+#include "mgenLogConverter.h"
 
 #include <string.h>
 #include <time.h>
@@ -44,7 +46,7 @@ MgenMsg::MgenMsg()
     mp_payload(NULL),mp_payload_len(0),
     protocol(INVALID_PROTOCOL),
     msg_error(ERROR_NONE),
-    compute_crc(true)
+    compute_crc(true), msg_template(NULL)
 {
 
 }
@@ -99,6 +101,9 @@ UINT16 MgenMsg::Pack(char* buffer,UINT16 bufferLen, bool includeChecksum,UINT32&
     ASSERT(sizeof(INT16) == 2);
     ASSERT(sizeof(INT32) == 4);
     
+    if ((NULL != msg_template) && msg_template->Matches(*this, bufferLen, includeChecksum))
+        return msg_template->Pack(*this, buffer, tx_checksum);
+    
     UINT16 msgLen = bufferLen;
 
     UINT16 temp16 = htons(msg_len);
@@ -558,31 +563,155 @@ void MgenMsg::ComputeCRC32(UINT32& checksum,
                            const UINT8* buffer, 
                            UINT32               bufferLength)
 {
-    static int totNumBytes;
-    
-    if (checksum == 0) {
+    // (no static state here, since MgenWorker threads compute CRCs concurrently)
+    if (checksum == 0) 
         checksum = CRC32_XINIT;
-        totNumBytes = 0;
-    }
     
-    totNumBytes += bufferLength;
-    DMSG(2,"Calcing %d\n",totNumBytes); 
+    DMSG(2,"Calcing %lu\n", (unsigned long)bufferLength); 
     
-    for (UINT32 i = 0; i < bufferLength; i++)
-      checksum = CRC32_TABLE[(checksum ^ *buffer++) & 0xFFL] ^ (checksum >> 8);
+    checksum = MgenCrc32::Update(checksum, buffer, bufferLength);
     
 }  // end MgenMsg::ComputeCRC()
 
 UINT32 MgenMsg::ComputeCRC32(const UINT8* buffer, 
                              UINT32               bufferLength)
 {
-    UINT32 result = CRC32_XINIT;
-    for (UINT32 i = 0; i < bufferLength; i++)
-      result = CRC32_TABLE[(result ^ *buffer++) & 0xFFL] ^ (result >> 8);
+    UINT32 result = MgenCrc32::Update(CRC32_XINIT, buffer, bufferLength);
     // return XOR out value 
     return (result ^ CRC32_XOROT);
 }  // end MgenMsg::ComputeCRC()
 
+MgenMsgTemplate::MgenMsgTemplate()
+ : msg_buffer(NULL), msg_len(0), msg_flags(0), packet_header_len(0), 
+   checksum(false), stale(true), valid(false),
+   crc_prefix(0), crc_suffix(0)
+{
+    memset(crc_shift, 0, sizeof(crc_shift));
+}
+
+MgenMsgTemplate::~MgenMsgTemplate()
+{
+    if (NULL != msg_buffer)
+    {
+        delete[] msg_buffer;
+        msg_buffer = NULL;
+    }
+}
+
+bool MgenMsgTemplate::Init(MgenMsg& theMsg, bool includeChecksum)
+{
+    stale = false;
+    valid = false;
+#ifdef RANDOM_FILL
+    return false;  // the fill differs for each message
+#endif // RANDOM_FILL
+    UINT16 msgLen = theMsg.GetMsgLen();
+    if ((msgLen < MIN_SIZE) || (msgLen > MAX_SIZE)) return false;
+    if (NULL == msg_buffer)
+    {
+        if (NULL == (msg_buffer = new char[MAX_SIZE]))
+        {
+            DMSG(0, "MgenMsgTemplate::Init() new msg_buffer error: %s\n", GetErrorString());
+            return false;
+        }
+    }
+    // Pack a copy as the transport would, restoring the message flags
+    UINT8 savedFlags = theMsg.flags;
+    theMsg.SetFlag(MgenMsg::LAST_BUFFER);
+    UINT32 txChecksum = 0;
+    UINT16 len = theMsg.Pack(msg_buffer, msgLen, includeChecksum, txChecksum);
+    bool hasChecksum = theMsg.FlagIsSet(MgenMsg::CHECKSUM);
+    theMsg.flags = savedFlags;
+    if ((len != msgLen) || (includeChecksum && !hasChecksum)) return false;
+    
+    if (includeChecksum)
+    {
+        // The CRC32 register update is linear in the register and data, 
+        // so the register after the constant bytes following the patched
+        // fields is the "crc_shift" of its value before them, xor'd with 
+        // "crc_suffix".  The shift operator is built by squaring the
+        // one zero byte operator.
+        crc_prefix = MgenCrc32::Update(MgenMsg::CRC32_XINIT, (UINT8*)msg_buffer, SEQ_OFFSET);
+        UINT32 suffixLen = msgLen - PATCH_END - 4;
+        crc_suffix = MgenCrc32::Update(0, (UINT8*)msg_buffer + PATCH_END, suffixLen);
+        UINT32 op[32], tmp[32];
+        for (unsigned int i = 0; i < 32; i++)
+        {
+            UINT32 bit = (UINT32)1 << i;
+            op[i] = MgenMsg::CRC32_TABLE[bit & 0xFF] ^ (bit >> 8);
+            crc_shift[i] = bit;
+        }
+        while (0 != suffixLen)
+        {
+            if (0 != (suffixLen & 0x01))
+            {
+                for (unsigned int i = 0; i < 32; i++)
+                    crc_shift[i] = ApplyCRC32Shift(op, crc_shift[i]);
+            }
+            suffixLen >>= 1;
+            if (0 != suffixLen)
+            {
+                for (unsigned int i = 0; i < 32; i++)
+                    tmp[i] = ApplyCRC32Shift(op, op[i]);
+                memcpy(op, tmp, sizeof(op));
+            }
+        }
+    }
+    msg_len = msgLen;
+    msg_flags = savedFlags | MgenMsg::LAST_BUFFER;
+    packet_header_len = theMsg.packet_header_len;
+    host_addr = theMsg.host_addr;
+    checksum = includeChecksum;
+    valid = true;
+    return true;
+}  // end MgenMsgTemplate::Init()
+
+bool MgenMsgTemplate::Matches(const MgenMsg& theMsg, UINT16 bufferLen, bool includeChecksum) const
+{
+    if (!valid || (bufferLen != msg_len) || (includeChecksum != checksum))
+        return false;
+    // (i.e., LAST_BUFFER set as for the template)
+    if (theMsg.flags != msg_flags)
+        return false;
+    if (theMsg.host_addr.IsValid())
+        return host_addr.IsValid() && host_addr.IsEqual(theMsg.host_addr);
+    else
+        return !host_addr.IsValid();
+}  // end MgenMsgTemplate::Matches()
+
+UINT16 MgenMsgTemplate::Pack(MgenMsg& theMsg, char* buffer, UINT32& txChecksum) const
+{
+    memcpy(buffer, msg_buffer, msg_len);
+    UINT32 temp32 = htonl(theMsg.seq_num);
+    memcpy(buffer+SEQ_OFFSET, &temp32, sizeof(INT32));
+    temp32 = htonl(theMsg.tx_time.tv_sec);
+    memcpy(buffer+SEQ_OFFSET+4, &temp32, sizeof(INT32));
+    temp32 = htonl(theMsg.tx_time.tv_usec);
+    memcpy(buffer+SEQ_OFFSET+8, &temp32, sizeof(INT32));
+    theMsg.packet_header_len = packet_header_len;
+    if (checksum)
+    {
+        theMsg.SetFlag(MgenMsg::CHECKSUM);
+        theMsg.ClearFlag(MgenMsg::LAST_BUFFER);
+        UINT32 crc = MgenCrc32::Update(crc_prefix, (UINT8*)buffer+SEQ_OFFSET, PATCH_LEN);
+        txChecksum = ApplyCRC32Shift(crc_shift, crc) ^ crc_suffix;
+    }
+    return msg_len;
+}  // end MgenMsgTemplate::Pack()
+
+// Applies the GF(2) 32x32 matrix "shift" (one column per register bit) to "crc"
+UINT32 MgenMsgTemplate::ApplyCRC32Shift(const UINT32* shift, UINT32 crc)
+{
+    UINT32 result = 0;
+    while (0 != crc)
+    {
+        if (0 != (crc & 0x01)) result ^= *shift;
+        crc >>= 1;
+        shift++;
+    }
+    return result;
+}  // end MgenMsgTemplate::ApplyCRC32Shift()
+
 const UINT32 MgenMsg::CRC32_XINIT = 0xFFFFFFFFL; // initial value
 const UINT32 MgenMsg::CRC32_XOROT = 0xFFFFFFFFL; // final xor value 
 
@@ -772,17 +901,15 @@ bool MgenMsg::LogRecvError(FILE*                    logFile,
         timeStruct.tm_hour = timeStruct.tm_hour % 24;
         struct tm* timePtr = &timeStruct;
 #else
-	struct tm* timePtr;
-	if (local_time)
-	  timePtr = localtime((time_t*)&theTime.tv_sec);
-	else
-	  timePtr = gmtime((time_t*)&theTime.tv_sec);
-
+        time_t timeSec = theTime.tv_sec;
+        struct tm timeStruct;
+        struct tm* timePtr = GetTimeStruct(&timeSec, local_time, &timeStruct);
 #endif // if/else _WIN32_WCE
+        char hostString[64];
         Mgen::Log(logFile, "%02d:%02d:%02d.%06lu RERR type>%s src>%s/%hu\n",
                 timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
                 (UINT32)theTime.tv_usec, errorString,
-                src_addr.GetHostString(), src_addr.GetPort());
+                src_addr.GetHostString(hostString, 64), src_addr.GetPort());
         
     }
     if (flush)  fflush(logFile);
@@ -919,65 +1046,64 @@ bool MgenMsg::LogTcpConnectionEvent(FILE*     logFile,
         timeStruct.tm_hour = timeStruct.tm_hour % 24;
         struct tm* timePtr = &timeStruct;
 #else
-        struct tm* timePtr;
-        if (local_time)
-          timePtr = localtime((time_t*)&theTime.tv_sec);
-        else
-          timePtr = gmtime((time_t*)&theTime.tv_sec);
-        
+        time_t timeSec = theTime.tv_sec;
+        struct tm timeStruct;
+        struct tm* timePtr = GetTimeStruct(&timeSec, local_time, &timeStruct);
 #endif // if/else _WIN32_WCE
         Mgen::Log(logFile, "%02d:%02d:%02d.%06lu ",
                   timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
                   (UINT32)theTime.tv_usec);
         
+        char hostString[64];
+        
         switch (eventType)
         {
         case ACCEPT_EVENT:
           {
               Mgen::Log(logFile,"ACCEPT src>%s/%hu dstPort>%hu", 
-                       addr.GetHostString(),addr.GetPort(),src_addr.GetPort());
+                       addr.GetHostString(hostString, 64),addr.GetPort(),src_addr.GetPort());
               break;
           }
         case ON_EVENT:
           {
               Mgen::Log(logFile,"ON flow>%lu srcPort>%hu dst>%s/%hu ",
-                        flow_id,src_addr.GetPort(),addr.GetHostString(),addr.GetPort());
+                        flow_id,src_addr.GetPort(),addr.GetHostString(hostString, 64),addr.GetPort());
               break;
           }
         case CONNECT_EVENT:
           {
               Mgen::Log(logFile,"CONNECT flow>%lu srcPort>%hu dst>%s/%hu ",
-                        flow_id,src_addr.GetPort(),addr.GetHostString(),addr.GetPort());
+                        flow_id,src_addr.GetPort(),addr.GetHostString(hostString, 64),addr.GetPort());
               break;
           }
         case DISCONNECT_EVENT:
           {
               if (isClient)
                 Mgen::Log(logFile,"DISCONNECT flow>%lu srcPort>%hu dst>%s/%hu ",
-                          flow_id,src_addr.GetPort(),addr.GetHostString(),addr.GetPort());
+                          flow_id,src_addr.GetPort(),addr.GetHostString(hostString, 64),addr.GetPort());
               else
                 Mgen::Log(logFile,"DISCONNECT src>%s/%hu dstPort>%hu ",
-                          addr.GetHostString(),addr.GetPort(),src_addr.GetPort());
+                          addr.GetHostString(hostString, 64),addr.GetPort(),src_addr.GetPort());
               break;
           }
         case SHUTDOWN_EVENT:
           {
               if (isClient)
                 Mgen::Log(logFile,"SHUTDOWN flow>%lu srcPort>%hu dst>%s/%hu ",
-                          flow_id,src_addr.GetPort(),addr.GetHostString(),addr.GetPort());
+                          flow_id,src_addr.GetPort(),addr.GetHostString(hostString, 64),addr.GetPort());
               else
                 Mgen::Log(logFile,"SHUTDOWN src>%s/%hu dstPort>%hu",
-                          addr.GetHostString(),addr.GetPort(),src_addr.GetPort());
+                          addr.GetHostString(hostString, 64),addr.GetPort(),src_addr.GetPort());
               break;
           }
         case OFF_EVENT:
           {
               if (isClient)
                 Mgen::Log(logFile,"OFF flow>%lu srcPort>%u dst>%s/%hu ",
-                          flow_id,src_addr.GetPort(),addr.GetHostString(),addr.GetPort());
+                          flow_id,src_addr.GetPort(),addr.GetHostString(hostString, 64),addr.GetPort());
               else
                 Mgen::Log(logFile,"OFF src>%s/%hu dstPort>%hu ",
-                          addr.GetHostString(),addr.GetPort(),src_addr.GetPort());
+                          addr.GetHostString(hostString, 64),addr.GetPort(),src_addr.GetPort());
               break;
           }
         default:
@@ -987,7 +1113,7 @@ bool MgenMsg::LogTcpConnectionEvent(FILE*     logFile,
         } // end switch (eventType)
         if (host_addr.IsValid())
         {
-            Mgen::Log(logFile, " host>%s/%hu\n", host_addr.GetHostString(), 
+            Mgen::Log(logFile, " host>%s/%hu\n", host_addr.GetHostString(hostString, 64), 
                       host_addr.GetPort());      
         }
         else
@@ -1001,6 +1127,46 @@ bool MgenMsg::LogTcpConnectionEvent(FILE*     logFile,
     
 }  // end MgenMsg::LogTcpConnectionEvent()
 
+// Thread-safe localtime()/gmtime() for the log methods
+struct tm* MgenMsg::GetTimeStruct(const time_t* timeSec, bool local_time, struct tm* timeStruct)
+{
+#if defined(_WIN32_WCE)
+    timeStruct->tm_hour = (int)(*timeSec / 3600);
+    UINT32 hourSecs = 3600 * timeStruct->tm_hour;
+    timeStruct->tm_min = (int)((*timeSec - hourSecs) / 60);
+    timeStruct->tm_sec = (int)(*timeSec - hourSecs - (60*timeStruct->tm_min));
+    timeStruct->tm_hour = timeStruct->tm_hour % 24;
+    return timeStruct;
+#elif defined(WIN32)
+    // (the Windows C runtime keeps these results per thread)
+    *timeStruct = *(local_time ? localtime(timeSec) : gmtime(timeSec));
+    return timeStruct;
+#else
+    return (local_time ? localtime_r(timeSec, timeStruct) : gmtime_r(timeSec, timeStruct));
+#endif // if/elif/else _WIN32_WCE/WIN32
+}  // end MgenMsg::GetTimeStruct()
+
+// Logs a "<name>>hh:mm:ss.usec " text log field
+void MgenMsg::LogStamp(FILE* logFile, const char* name, bool local_time, const struct timeval& theTime)
+{
+#ifdef _WIN32_WCE
+    struct tm timeStruct;
+    timeStruct.tm_hour = theTime.tv_sec / 3600;
+    UINT32 hourSecs = 3600 * timeStruct.tm_hour;
+    timeStruct.tm_min = (theTime.tv_sec - hourSecs) / 60;
+    timeStruct.tm_sec = theTime.tv_sec - hourSecs - (60*timeStruct.tm_min);
+    timeStruct.tm_hour = timeStruct.tm_hour % 24;
+    struct tm* timePtr = &timeStruct;
+#else
+    time_t timeSec = theTime.tv_sec;
+    struct tm timeStruct;
+    struct tm* timePtr = GetTimeStruct(&timeSec, local_time, &timeStruct);
+#endif // if/else _WIN32_WCE
+    Mgen::Log(logFile, "%s>%02d:%02d:%02d.%06lu ", name,
+              timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
+              (UINT32)theTime.tv_usec);
+}  // end MgenMsg::LogStamp()
+
 bool MgenMsg::LogRecvEvent(FILE*                    logFile,
                            bool                     logBinary, 
                            bool                     local_time,
@@ -1008,7 +1174,8 @@ bool MgenMsg::LogRecvEvent(FILE*                    logFile,
 			   bool                     log_gps_data,
                            char*                    msgBuffer,
                            bool                     flush,
-                           const struct timeval&    theTime)
+                           const struct timeval&    theTime,
+                           const struct timeval*    rxStamp)
 {	      
 
     if (logBinary)
@@ -1098,20 +1265,18 @@ bool MgenMsg::LogRecvEvent(FILE*                    logFile,
         timeStruct.tm_hour = timeStruct.tm_hour % 24;
         struct tm* timePtr = &timeStruct;
 #else
-        struct tm* timePtr;
-        if (local_time)
-          timePtr = localtime((time_t*)&theTime.tv_sec);
-        else
-          timePtr = gmtime((time_t*)&theTime.tv_sec);
-        
+        time_t timeSec = theTime.tv_sec;
+        struct tm timeStruct;
+        struct tm* timePtr = GetTimeStruct(&timeSec, local_time, &timeStruct);
 #endif // if/else _WIN32_WCE
         Mgen::Log(logFile, "%02d:%02d:%02d.%06lu ",
                   timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
                   (UINT32)theTime.tv_usec);
         
+        char hostString[64];
         Mgen::Log(logFile,"RECV proto>%s flow>%lu seq>%lu src>%s/%hu ",
                   MgenEvent::GetStringFromProtocol(protocol),
-                  flow_id, seq_num, src_addr.GetHostString(), 
+                  flow_id, seq_num, src_addr.GetHostString(hostString, 64), 
                   src_addr.GetPort());
 #ifdef _WIN32_WCE
         struct tm timeStruct;
@@ -1122,21 +1287,19 @@ bool MgenMsg::LogRecvEvent(FILE*                    logFile,
         timeStruct.tm_hour = timeStruct.tm_hour % 24;
         struct tm* timePtr = &timeStruct;
 #else
-        if (local_time)
-          timePtr = localtime((time_t*)&tx_time.tv_sec);
-        else
-          timePtr = gmtime((time_t*)&tx_time.tv_sec);
-        
+        timeSec = tx_time.tv_sec;
+        timePtr = GetTimeStruct(&timeSec, local_time, &timeStruct);
 #endif // if/else _WIN32_WCE
         Mgen::Log(logFile, "dst>%s/%hu ",
-                  dst_addr.GetHostString(), dst_addr.GetPort());
+                  dst_addr.GetHostString(hostString, 64), dst_addr.GetPort());
         Mgen::Log(logFile,"sent>%02d:%02d:%02d.%06lu size>%u ",
                   timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
                   (UINT32)tx_time.tv_usec, msg_len);
+        if (NULL != rxStamp) LogStamp(logFile, "rxStamp", local_time, *rxStamp);
         // Here we are looking at the message's host_addr
         if (host_addr.IsValid())
         {
-            Mgen::Log(logFile, "host>%s/%hu ", host_addr.GetHostString(),
+            Mgen::Log(logFile, "host>%s/%hu ", host_addr.GetHostString(hostString, 64),
                       host_addr.GetPort());      
         }
         
@@ -1199,7 +1362,8 @@ bool MgenMsg::LogSendEvent(FILE*    logFile,
                            bool     local_time,
                            char*    msgBuffer,
                            bool     flush,
-                           const struct timeval& theTime)
+                           const struct timeval& theTime,
+                           const struct timeval* txStamp)
 {
     if (logBinary)
     {
@@ -1271,24 +1435,22 @@ bool MgenMsg::LogSendEvent(FILE*    logFile,
         timeStruct.tm_hour = timeStruct.tm_hour % 24;
         struct tm* timePtr = &timeStruct;
 #else
-        struct tm* timePtr;
-        if (local_time)
-          timePtr = localtime((time_t*)&theTime.tv_sec);
-        else
-          timePtr = gmtime((time_t*)&theTime.tv_sec);
-        
+        time_t timeSec = theTime.tv_sec;
+        struct tm timeStruct;
+        struct tm* timePtr = GetTimeStruct(&timeSec, local_time, &timeStruct);
 #endif // if/else _WIN32_WCE
         
         Mgen::Log(logFile, "%02d:%02d:%02d.%06lu ",
                   timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
                   (UINT32)theTime.tv_usec); 
         
+        char hostString[64];
         Mgen::Log(logFile,"SEND proto>%s flow>%lu seq>%lu srcPort>%hu dst>%s/%hu",
                   MgenEvent::GetStringFromProtocol(protocol),
                   flow_id, 
                   seq_num, 	// jm:  seq_num uninitialized here - at least can be...
                   src_addr.GetPort(),
-                  dst_addr.GetHostString(), dst_addr.GetPort());
+                  dst_addr.GetHostString(hostString, 64), dst_addr.GetPort());
         if (protocol == TCP)
         {
             Mgen::Log(logFile," size>%lu ",mgen_msg_len);
@@ -1297,10 +1459,11 @@ bool MgenMsg::LogSendEvent(FILE*    logFile,
         {
             Mgen::Log(logFile," size>%u ",msg_len);
         }
+        if (NULL != txStamp) LogStamp(logFile, "txStamp", local_time, *txStamp);
         
         if (host_addr.IsValid())
         {
-            Mgen::Log(logFile, "host>%s/%hu\n", host_addr.GetHostString(), 
+            Mgen::Log(logFile, "host>%s/%hu\n", host_addr.GetHostString(hostString, 64), 
                       host_addr.GetPort());      
         }
         else
@@ -1528,570 +1691,7 @@ const char *MgenMsg::GetPayloadRaw() {
 
 bool MgenMsg::ConvertBinaryLog(const char* path,Mgen& mgen)
 {
-    FILE* log_file = mgen.GetLogFile();
-    bool local_time = mgen.GetLocalTime();
-    bool log_flush = mgen.GetLogFlush();
-    bool log_data = mgen.GetLogData();
-    bool log_gps_data = mgen.GetLogGpsData();
-
-    if (NULL == log_file) return false;
-    FILE* file = fopen(path, "rb");
-    if (!file)
-    {
-        DMSG(0, "Mgen::ConvertFile() fopen() Error: %s\n", GetErrorString());   
-        return false;    
-    }
-    const unsigned int BINARY_RECORD_MAX = 1024;  // maximum record size
-    char buffer[BINARY_RECORD_MAX];
-    const char* eventName;
-    // Read ASCII binary log header line
-    // The first four characters should be "mgen"
-    if (fread(buffer, 1, 4, file) < 4)
-    {
-        DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
-        return false;
-    }
-    if (strncmp("mgen", buffer, 4) != 0)
-    {
-        DMSG(0, "Mgen::ConvertBinaryLog() error: invalid mgen log file\n");
-        return false;
-    }
-    
-    // Read remainder of header line, including terminating NULL
-    unsigned int index = 3;
-    while ('\0' != buffer[index])
-    {
-        index++;
-        if (fread(buffer+index, 1, 1, file) < 1)
-        {
-            DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
-            return false;
-        }
-    }
-    
-    // Confirm log file "version" and "type"
-    char* ptr = strstr(buffer, "version=");
-    if (ptr)
-    {
-        // Just look at major version number for moment
-        int version;
-        if (1 == sscanf(ptr, "version=%d", &version))
-        {
-            if (version != 4 && version != 5)
-            {
-                DMSG(0, "Mgen::ConvertBinaryLog() invalid log file version\n"); 
-                return false;   
-            }            
-        }
-        else
-        {
-            DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"version\" value\n"); 
-            return false;  
-        }                
-    }
-    else
-    {
-        DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"version\" label\n"); 
-        return false;  
-    }
-    ptr = strstr(ptr, "type=");
-    if (ptr)
-    {
-        char fileType[128];
-        if (1 == sscanf(ptr, "type=%s", fileType))
-        {
-            if (strcmp(fileType, "binary_log"))
-            {
-                DMSG(0, "Mgen::ConvertBinaryLog() invalid log file type\n"); 
-                return false; 
-            }
-        }
-        else
-        {
-            DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"type\" value\n"); 
-            return false; 
-        }
-    }
-    else
-    {
-        DMSG(0, "Mgen::ConvertBinaryLog() error finding log \"type\" label\n"); 
-        return false;
-    }    
-    
-    // Now loop, reading in records one by one, and output text format
-    while (1)
-    {
-        // 1) Read record header (4 bytes)
-        char header[4];
-        if (fread(header, 1, 4, file) < 4)
-        {
-            if (feof(file))
-            {
-                break;
-            }
-            else
-            {
-                DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
-                fclose(file);
-                return false;
-            }   
-        }
-        LogEventType eventType = (LogEventType)header[0];
-        Protocol theProtocol = (Protocol)header[1];
-        UINT16 recordLength;
-        memcpy(&recordLength, header+2, sizeof(INT16));
-        recordLength = ntohs(recordLength);
-        if (recordLength > BINARY_RECORD_MAX)
-        {
-            DMSG(0, "Mgen::ConvertBinaryLog() record len:%hu exceeds maximum length\n", recordLength);
-            fclose(file);
-            return false;  
-        }
-        // 2) Read the entire record
-        if (fread(buffer, 1, recordLength, file) < recordLength)
-        {
-            DMSG(0, "Mgen::ConvertBinaryLog() fread() error: %s\n", GetErrorString());
-            fclose(file);
-            return false;
-        }
-        // 3) Convert the record to text
-        unsigned int index = 0;
-        switch (eventType)
-        {
-        case RECV_EVENT:
-          {
-              // get "eventTime"
-              struct timeval eventTime;
-              UINT32 temp32;
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_sec = ntohl(temp32);
-              index += sizeof(INT32);
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_usec = ntohl(temp32);
-              index += sizeof(INT32);
-#ifdef _WIN32_WCE
-              struct tm timeStruct;
-              timeStruct.tm_hour = eventTime.tv_sec / 3600;
-              UINT32 hourSecs = 3600 * timeStruct.tm_hour;
-              timeStruct.tm_min = (eventTime.tv_sec - hourSecs) / 60;
-              timeStruct.tm_sec = eventTime.tv_sec - hourSecs - (60*timeStruct.tm_min);
-              timeStruct.tm_hour = timeStruct.tm_hour % 24;
-              struct tm* timePtr = &timeStruct;
-#else            
-              struct tm* timePtr;
-              if (local_time)
-                timePtr = localtime((time_t*)&eventTime.tv_sec);
-              else
-                timePtr = gmtime((time_t*)&eventTime.tv_sec);
-              
-#endif // if/else _WIN32_WCE
-              // get "srcPort"
-              UINT16 temp16;
-              memcpy(&temp16, buffer+index, sizeof(INT16));
-              UINT16 srcPort = ntohs(temp16);
-              index += sizeof(INT16);
-              // get "srcAddrType"
-              ProtoAddress::Type addrType;
-              switch (buffer[index++])
-              {
-              case MgenMsg::IPv4:
-                addrType = ProtoAddress::IPv4;
-                break;
-              case MgenMsg::IPv6:
-                addrType = ProtoAddress::IPv6;
-                break;
-              default:
-                DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type:%d\n",
-                     buffer[index-1]);
-                fclose(file);
-                return false;   
-              }
-              // get "srcAddrLen"
-              unsigned int addrLen = (unsigned int)buffer[index++];
-              ProtoAddress srcAddr;
-              // get "srcAddr"
-              srcAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
-              index += addrLen;
-              srcAddr.SetPort(srcPort);
-              
-              // The remainder of the record corresponds to the message content
-              MgenMsg msg;
-              msg.SetProtocol(theProtocol);
-              msg.SetSrcAddr(srcAddr);
-              msg.SetTxTime(eventTime);
-              msg.Unpack(buffer+index, recordLength - index, false, log_data);
-              msg.LogRecvEvent(log_file, false, local_time, log_data, log_gps_data, NULL, log_flush,eventTime);
-              
-              break;
-          }
-        case SEND_EVENT:
-          {
-
-              MgenMsg msg;
-              // get tcp mgen_msg_len
-              if (theProtocol == TCP)
-              {
-                  UINT32 temp32;
-                  memcpy(&temp32,buffer+index,sizeof(INT32));
-                  msg.SetMgenMsgLen(ntohl(temp32));
-                  index += sizeof(UINT32);
-                  
-              }
-              msg.SetProtocol(theProtocol);
-              msg.Unpack(buffer+index, recordLength, false, log_data);
-              msg.LogSendEvent(log_file,false, local_time, NULL, log_flush, msg.tx_time);
-              break;
-          }
-        case LISTEN_EVENT:
-        case IGNORE_EVENT:
-          {
-              eventName = (LISTEN_EVENT == eventType) ? "LISTEN" : "IGNORE";
-              unsigned int index = 0;
-              // get "eventTime"
-              struct timeval eventTime;
-              UINT32 temp32;
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_sec = ntohl(temp32);
-              index += sizeof(INT32);
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_usec = ntohl(temp32);
-              index += sizeof(INT32);
-              // get "protocol"
-              const char* protoName = 
-                MgenBaseEvent::GetStringFromProtocol((Protocol)buffer[index++]);
-              // skip "reserved" field
-              index++;
-              // get "portNumber"
-              UINT16 temp16;
-              memcpy(&temp16, buffer+index, sizeof(INT16));
-              UINT16 portNumber = ntohs(temp16);
-              // Output text log format
-#ifdef _WIN32_WCE
-              struct tm timeStruct;
-              timeStruct.tm_hour = eventTime.tv_sec / 3600;
-              UINT32 hourSecs = 3600 * timeStruct.tm_hour;
-              timeStruct.tm_min = (eventTime.tv_sec - hourSecs) / 60;
-              timeStruct.tm_sec = eventTime.tv_sec - hourSecs - (60*timeStruct.tm_min);
-              timeStruct.tm_hour = timeStruct.tm_hour % 24;
-              struct tm* timePtr = &timeStruct;
-#else            
-              struct tm* timePtr;
-              if (local_time)
-                timePtr = localtime((time_t*)&eventTime.tv_sec);
-              else
-                timePtr = gmtime((time_t*)&eventTime.tv_sec);
-              
-#endif // if/else _WIN32_WCE
-              Mgen::Log(log_file, "%02d:%02d:%02d.%06lu %s proto>%s port>%hu\n",
-                        timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                        (UINT32)eventTime.tv_usec, eventName,
-                        protoName, portNumber);
-              break;   
-          }
-        case JOIN_EVENT:
-        case LEAVE_EVENT:
-          {
-              unsigned int index = 0;
-              // get "eventTime"
-              struct timeval eventTime;
-              UINT32 temp32;
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_sec = ntohl(temp32);
-              index += sizeof(INT32);
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_usec = ntohl(temp32);
-              index += sizeof(INT32);
-              // get "groupPort"
-              UINT16 temp16;
-              memcpy(&temp16, buffer+index, sizeof(INT16));
-              UINT16 groupPort = ntohs(temp16);
-              index += sizeof(INT16);
-              // get "groupAddrType"
-              ProtoAddress::Type addrType;
-              switch (buffer[index++])
-              {
-              case MgenMsg::IPv4:
-                addrType = ProtoAddress::IPv4;
-                break;
-              case MgenMsg::IPv6:
-                addrType = ProtoAddress::IPv6;
-                break;
-              default:
-                DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type\n");
-                fclose(file);
-                return false;   
-              }
-              // get "groupAddrLen"
-              unsigned int addrLen = (unsigned int)buffer[index++];
-              ProtoAddress groupAddr;
-              // get "groupAddr"
-              groupAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
-              index += addrLen;
-              // get "ifaceNameLen"
-              unsigned int ifaceNameLen = buffer[index++];
-              char ifaceName[128];
-              memcpy(ifaceName, buffer+index, ifaceNameLen);
-              ifaceName[ifaceNameLen] = '\0';
-              // Output text log format
-              eventName = (JOIN_EVENT == eventType) ? "JOIN" : "LEAVE";
-#ifdef _WIN32_WCE
-              struct tm timeStruct;
-              timeStruct.tm_hour = eventTime.tv_sec / 3600;
-              UINT32 hourSecs = 3600 * timeStruct.tm_hour;
-              timeStruct.tm_min = (eventTime.tv_sec - hourSecs) / 60;
-              timeStruct.tm_sec = eventTime.tv_sec - hourSecs - (60*timeStruct.tm_min);
-              timeStruct.tm_hour = timeStruct.tm_hour % 24;
-              struct tm* timePtr = &timeStruct;
-#else            
-              struct tm* timePtr;
-              if (local_time)
-                timePtr = localtime((time_t*)&eventTime.tv_sec);
-              else
-                timePtr = gmtime((time_t*)&eventTime.tv_sec);
-              
-#endif // if/else _WIN32_WCE
-              Mgen::Log(log_file, "%02d:%02d:%02d.%06lu %s group>%s",
-                        timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                        (UINT32)eventTime.tv_usec, eventName,
-                        groupAddr.GetHostString());
-              if (ifaceNameLen) Mgen::Log(log_file, " interface>%s", ifaceName);
-              if (groupPort)
-                Mgen::Log(log_file, " port>%hu\n", groupPort);
-              else
-                Mgen::Log(log_file, "\n");
-              break;
-          }
-        case START_EVENT:
-        case STOP_EVENT:
-          {
-              eventName = (START_EVENT == eventType) ? "START" : "STOP";
-              unsigned int index = 0;
-              // get "eventTime"
-              struct timeval eventTime;
-              UINT32 temp32;
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_sec = ntohl(temp32);
-              index += sizeof(INT32);
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_usec = ntohl(temp32);
-              index += sizeof(INT32);
-#ifdef _WIN32_WCE
-              struct tm timeStruct;
-              timeStruct.tm_hour = eventTime.tv_sec / 3600;
-              UINT32 hourSecs = 3600 * timeStruct.tm_hour;
-              timeStruct.tm_min = (eventTime.tv_sec - hourSecs) / 60;
-              timeStruct.tm_sec = eventTime.tv_sec - hourSecs - (60*timeStruct.tm_min);
-              timeStruct.tm_hour = timeStruct.tm_hour % 24;
-              struct tm* timePtr = &timeStruct;
-#else            
-              struct tm* timePtr;
-              if (local_time)
-                timePtr = localtime((time_t*)&eventTime.tv_sec);
-              else
-                timePtr = gmtime((time_t*)&eventTime.tv_sec);
-              
-#endif // if/else _WIN32_WCE
-              Mgen::Log(log_file, "%02d:%02d:%02d.%06lu %s\n",
-                        timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                        (UINT32)eventTime.tv_usec, eventName);
-              break;
-          }
-        case ON_EVENT:
-        case ACCEPT_EVENT:
-        case CONNECT_EVENT:
-        case DISCONNECT_EVENT:
-        case OFF_EVENT:
-        case SHUTDOWN_EVENT:
-          {
-              // get "eventTime"
-              struct timeval eventTime;
-              UINT32 temp32;
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_sec = ntohl(temp32);
-              index += sizeof(INT32);
-              memcpy(&temp32, buffer+index, sizeof(INT32));
-              eventTime.tv_usec = ntohl(temp32);
-              index += sizeof(INT32);
-#ifdef _WIN32_WCE
-              struct tm timeStruct;
-              timeStruct.tm_hour = eventTime.tv_sec / 3600;
-              UINT32 hourSecs = 3600 * timeStruct.tm_hour;
-              timeStruct.tm_min = (eventTime.tv_sec - hourSecs) / 60;
-              timeStruct.tm_sec = eventTime.tv_sec - hourSecs - (60*timeStruct.tm_min);
-              timeStruct.tm_hour = timeStruct.tm_hour % 24;
-              struct tm* timePtr = &timeStruct;
-#else            
-              struct tm* timePtr;
-              if (local_time)
-                timePtr = localtime((time_t*)&eventTime.tv_sec);
-              else
-                timePtr = gmtime((time_t*)&eventTime.tv_sec);
-              
-#endif // if/else _WIN32_WCE
-              
-              // get "srcPort"
-              UINT16 temp16;
-              memcpy(&temp16, buffer+index, sizeof(INT16));
-              UINT16 port = ntohs(temp16);
-              index += sizeof(INT16);
-              
-              // get "srcAddrType"
-              ProtoAddress::Type addrType;
-              switch (buffer[index++])
-              {
-              case MgenMsg::IPv4:
-                addrType = ProtoAddress::IPv4;
-                break;
-              case MgenMsg::IPv6:
-                addrType = ProtoAddress::IPv6;
-                break;
-              default:
-                DMSG(0, "Mgen::ConvertBinaryLog() unknown source address type:%d\n",
-                     buffer[index-1]);
-                fclose(file);
-                return false;   
-              }
-              // get "srcAddrLen"
-              unsigned int addrLen = (unsigned int)buffer[index++];
-              ProtoAddress addr;
-              // get "srcAddr"
-              addr.SetRawHostAddress(addrType, buffer+index, addrLen);
-              index += addrLen;
-              addr.SetPort(port);
-              // get "dstPort"
-              memcpy(&temp16,buffer+index,sizeof(INT16));
-              UINT16 dstPort = ntohs(temp16);
-              index += sizeof(INT16);              
-              
-              // get "flow_id" (it might not exist - its' how we
-              // are differentiating between clients and servers
-              // for now)
-              UINT32 flow_id = 0;
-              memcpy(&temp32,buffer+index,sizeof(UINT32));
-              flow_id = ntohl(temp32);
-              index += sizeof(UINT32);	    
-              
-              ProtoAddress hostAddr;
-              // get "hostPort"
-              if ((index+4) <= recordLength)
-              {
-                  
-                  memcpy(&temp16, buffer+index, sizeof(INT16));
-                  UINT16 hostPort = ntohs(temp16);
-                  index += sizeof(INT16);
-                  // get "hostAddrType"
-                  switch (buffer[index++])
-                  {
-                  case MgenMsg::IPv4:
-                    addrType = ProtoAddress::IPv4;
-                    break;
-                  case MgenMsg::IPv6:
-                    addrType = ProtoAddress::IPv6;
-                    break;
-                  default:
-                    addrType = ProtoAddress::INVALID;
-                    break;
-                  }
-                  // get "hostAddrLen"
-                  addrLen = (unsigned int)buffer[index++];
-                  
-                  if (index+addrLen <= recordLength)
-                  {
-                      if (ProtoAddress::INVALID != addrType && addrLen)
-                      {
-                          // get "hostAddr"
-                          hostAddr.SetRawHostAddress(addrType, buffer+index, addrLen);
-                          index += addrLen;
-                          hostAddr.SetPort(hostPort);
-                      }
-                  }
-              }
-              
-              // Let's just keep it verbose and clear...
-              switch (eventType) 
-              {
-              case ON_EVENT:
-                Mgen::Log(log_file, "%02d:%02d:%02d.%06lu ON flow>%lu srcPort>%hu dst>%s/%hu",
-                          timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                          (UINT32)eventTime.tv_usec,
-                          flow_id,dstPort,addr.GetHostString(),addr.GetPort());
-                break;
-              case ACCEPT_EVENT:
-                Mgen::Log(log_file, "%02d:%02d:%02d.%06lu ACCEPT src>%s/%hu dstPort>%hu",
-                          timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                          (UINT32)eventTime.tv_usec,
-                          addr.GetHostString(),addr.GetPort(),dstPort);
-                
-                break;
-              case CONNECT_EVENT:
-                Mgen::Log(log_file, "%02d:%02d:%02d.%06lu CONNECT flow>%lu srcPort>%hu dst>%s/%hu",
-                          timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                          (UINT32)eventTime.tv_usec,
-                          flow_id,dstPort,addr.GetHostString(),addr.GetPort());
-                break;
-              case DISCONNECT_EVENT:
-                if (flow_id)
-                  Mgen::Log(log_file, "%02d:%02d:%02d.%06lu DISCONNECT flow>%lu dst>%s/%hu srcPort>%hu",
-                            timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                            (UINT32)eventTime.tv_usec,
-                            flow_id,addr.GetHostString(),addr.GetPort(),
-                            dstPort);
-                else
-                  Mgen::Log(log_file, "%02d:%02d:%02d.%06lu DISCONNECT src>%s/%hu dstPort>%hu",
-                            timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                            (UINT32)eventTime.tv_usec,
-                            addr.GetHostString(),addr.GetPort(),
-                            dstPort);
-                
-                break;
-                
-              case SHUTDOWN_EVENT:
-                if (flow_id)
-                  Mgen::Log(log_file, "%02d:%02d:%02d.%06lu SHUTDOWN flow>%lu dst>%s/%hu srcPort>%hu",
-                            timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                            (UINT32)eventTime.tv_usec,
-                            flow_id,addr.GetHostString(),addr.GetPort(),
-                            dstPort);
-                else
-                  Mgen::Log(log_file, "%02d:%02d:%02d.%06lu SHUTDOWN src>%s/%hu dstPort>%hu",
-                            timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                            (UINT32)eventTime.tv_usec,
-                            addr.GetHostString(),addr.GetPort(),
-                            dstPort);
-                
-                break;
-                
-              case OFF_EVENT:
-                if (flow_id)
-                  Mgen::Log(log_file, "%02d:%02d:%02d.%06lu OFF flow>%lu srcPort>%hu dst>%s/%hu",
-                            timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                            (UINT32)eventTime.tv_usec,
-                            flow_id,dstPort,
-                            addr.GetHostString(),addr.GetPort());
-                else
-                  Mgen::Log(log_file, "%02d:%02d:%02d.%06lu OFF src>%s/%hu dstPort>%hu",
-                            timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec, 
-                            (UINT32)eventTime.tv_usec,
-                            addr.GetHostString(),addr.GetPort(),dstPort);
-                
-                break;
-              default:
-                DMSG(0,"Mgen::ConvertBinaryLog Invalid event type.\n");
-              }
-              if (hostAddr.IsValid()) 		
-                Mgen::Log(log_file,"host>%s/%hu",
-                          hostAddr.GetHostString(),hostAddr.GetPort());	   	  
-              Mgen::Log(log_file,"\n");
-              
-              break;
-          }
-        default:
-          DMSG(0, "Mgen::ConvertBinaryLog() invalid event type\n");
-          fclose(file);
-          return false;
-        }  // end switch(eventType)
-    }  // end while(1)
-    fclose(file);
-    return true;
+    MgenLogConverter converter;
+    return converter.Convert(path, mgen);
 }  // end MgenMsg::ConvertBinaryLog()
 
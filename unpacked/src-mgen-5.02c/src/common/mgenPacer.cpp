@@ -0,0 +1,130 @@
+#include "mgenPacer.h"
+#include "mgen.h"
+
+#include <string.h>
+#include <ctype.h>  // for toupper()
+#include <math.h>
+
+MgenPacer::MgenPacer()
+ : pace_mode(OFF)
+{
+    Reset();
+}
+
+MgenPacer::~MgenPacer()
+{
+}
+
+MgenPacer::Mode MgenPacer::GetModeFromString(const char* string)
+{
+    // convert to upper case for case-insensitivity
+    char temp[8];
+    unsigned int len = strlen(string);
+    len = len < 7 ? len : 7;
+    unsigned int i;
+    for (i = 0 ; i < len; i++)
+      temp[i] = toupper(string[i]);
+    temp[i] = '\0';
+    if (0 == len)
+        return (Mode)-1;
+    else if (!strncmp("OFF", temp, len))
+        return OFF;
+    else if (!strncmp("SPIN", temp, len))
+        return SPIN;
+    else if (!strncmp("TXTIME", temp, len))
+        return TXTIME;
+    else if (!strncmp("ETF", temp, len))
+        return ETF;
+    else
+        return (Mode)-1;
+}  // end MgenPacer::GetModeFromString()
+
+const char* MgenPacer::GetStringFromMode(Mode mode)
+{
+    switch (mode)
+    {
+        case SPIN:
+            return "SPIN";
+        case TXTIME:
+            return "TXTIME";
+        case ETF:
+            return "ETF";
+        default:
+            return "OFF";
+    }
+}  // end MgenPacer::GetStringFromMode()
+
+void MgenPacer::SpinUntil(const ProtoTime& schedTime)
+{
+    ProtoTime currentTime;
+    do
+    {
+        currentTime.GetCurrentTime();
+    } while (ProtoTime::Delta(schedTime, currentTime) > 0.0);
+}  // end MgenPacer::SpinUntil()
+
+void MgenPacer::Update(double error)
+{
+    if (0 == error_count)
+    {
+        error_min = error_max = error;
+    }
+    else if (error < error_min)
+    {
+        error_min = error;
+    }
+    else if (error > error_max)
+    {
+        error_max = error;
+    }
+    error_count++;
+    error_sum += error;
+    error_sum_sq += error * error;
+    double usec = 1.0e+06 * ((error < 0.0) ? -error : error);
+    unsigned int bucket = 0;
+    while ((bucket < (HISTOGRAM_BUCKETS - 1)) && (usec >= (double)(0x01UL << bucket)))
+        bucket++;
+    error_hist[bucket]++;
+}  // end MgenPacer::Update()
+
+void MgenPacer::Report(FILE* outFile, UINT32 flowId, bool localTime)
+{
+    if (NULL == outFile) return;
+    struct timeval currentTime;
+    ProtoSystemTime(currentTime);
+    time_t timeSec = currentTime.tv_sec;
+    struct tm timeStruct;
+    struct tm* timePtr = MgenMsg::GetTimeStruct(&timeSec, localTime, &timeStruct);
+    double mean = 0.0;
+    double stdev = 0.0;
+    if (0 != error_count)
+    {
+        mean = error_sum / (double)error_count;
+        double variance = (error_sum_sq / (double)error_count) - (mean * mean);
+        if (variance > 0.0) stdev = sqrt(variance);
+    }
+    Mgen::Log(outFile, "%02d:%02d:%02d.%06lu PACE flow>%lu mode>%s count>%lu late>%lu "
+              "error>%.6f/%.6f/%.6f stdev>%.6f errHist>",
+              timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+              (UINT32)currentTime.tv_usec, (unsigned long)flowId,
+              GetStringFromMode(pace_mode), error_count, late_count,
+              error_min, mean, error_max, stdev);
+    // "<usec>:<count>" for non-empty buckets, as for STATS histograms
+    bool first = true;
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        if (0 == error_hist[i]) continue;
+        Mgen::Log(outFile, "%s%lu:%lu", first ? "" : ",",
+                  (unsigned long)(0x01UL << i), (unsigned long)error_hist[i]);
+        first = false;
+    }
+    Mgen::Log(outFile, "\n");
+    fflush(outFile);
+}  // end MgenPacer::Report()
+
+void MgenPacer::Reset()
+{
+    error_count = late_count = 0;
+    error_min = error_max = error_sum = error_sum_sq = 0.0;
+    memset(error_hist, 0, sizeof(error_hist));
+}  // end MgenPacer::Reset()
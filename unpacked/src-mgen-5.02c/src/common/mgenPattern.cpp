@@ -3,6 +3,7 @@
 #include "mgenMsg.h"
 #include "mgenPattern.h"
 #include "mgenEvent.h"
+#include "mgenScript.h"
 
 #include <string.h>
 #include <stdio.h>   
@@ -562,6 +563,107 @@ bool MgenPattern::InitFromString(MgenPattern::Type theType, const char* string,
     }  // end switch(type)
     return true;
 }  // end MgenPattern::InitFromString()
+
+bool MgenPattern::Pack(MgenScriptRecord& record) const
+{
+    record.PutUINT8((UINT8)type);
+    switch (type)
+    {
+        case PERIODIC:
+        case POISSON:
+        case JITTER:
+            record.PutDouble(interval_ave);
+            record.PutUINT32(pkt_size_min);
+            record.PutUINT32(pkt_size_max);
+            record.PutUINT8(unlimitedRate ? 1 : 0);
+            if (JITTER == type)
+            {
+                record.PutDouble(jitter_min);
+                record.PutDouble(jitter_max);
+            }
+            break;
+        case BURST:
+            record.PutUINT8((UINT8)burst_type);
+            record.PutDouble(interval_ave);
+            if ((NULL == burst_pattern) || !burst_pattern->Pack(record))
+                return false;
+            record.PutUINT8((UINT8)burst_duration_type);
+            record.PutDouble(burst_duration_ave);
+            break;
+        default:
+            // (CLONE patterns are left to InitFromString())
+            return false;
+    }
+    return record.IsOk();
+}  // end MgenPattern::Pack()
+
+bool MgenPattern::Unpack(MgenScriptRecord& record)
+{
+    UINT8 temp8;
+    if (!record.GetUINT8(temp8)) return false;
+    type = (Type)temp8;
+    switch (type)
+    {
+        case PERIODIC:
+        case POISSON:
+        case JITTER:
+        {
+            interval_remainder = 0.0;
+            UINT32 sizeMin, sizeMax;
+            record.GetDouble(interval_ave);
+            record.GetUINT32(sizeMin);
+            record.GetUINT32(sizeMax);
+            record.GetUINT8(temp8);
+            pkt_size_min = sizeMin;
+            pkt_size_max = sizeMax;
+            unlimitedRate = (0 != temp8);
+            if (JITTER == type)
+            {
+                record.GetDouble(jitter_min);
+                record.GetDouble(jitter_max);
+            }
+            break;
+        }
+        case BURST:
+        {
+            record.GetUINT8(temp8);
+            burst_type = (Burst)temp8;
+            record.GetDouble(interval_ave);
+            if (!burst_pattern)
+            {
+                if (!(burst_pattern = new MgenPattern()))
+                {
+                    DMSG(0, "MgenPattern::Unpack(BURST) Error: pattern allocation: %s\n",
+                            GetErrorString());
+                    return false;
+                }
+            }
+            if (!burst_pattern->Unpack(record)) return false;
+            record.GetUINT8(temp8);
+            burst_duration_type = (Duration)temp8;
+            if (!record.GetDouble(burst_duration_ave)) return false;
+            switch (burst_duration_type)
+            {
+                case FIXED:
+                    burst_duration = burst_duration_ave;
+                    break;
+                case EXPONENTIAL:
+                    burst_duration = ExponentialRand(burst_duration_ave);
+                    break;
+                default:
+                    DMSG(0, "MgenPattern::Unpack(BURST) error: invalid burst duration type.\n");
+                    return false;
+            }
+            interval_remainder = burst_duration;
+            last_time.tv_sec = last_time.tv_usec = 0;
+            break;
+        }
+        default:
+            DMSG(0, "MgenPattern::Unpack() error: invalid pattern type\n");
+            return false;
+    }
+    return record.IsOk();
+}  // end MgenPattern::Unpack()
 #ifdef _HAVE_PCAP
 bool MgenPattern::OpenPcapDevice()
 {
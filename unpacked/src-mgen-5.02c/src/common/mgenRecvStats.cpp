@@ -0,0 +1,219 @@
+#include "mgenRecvStats.h"
+#include "mgen.h"
+
+#include <string.h>
+
+MgenRecvStats::Flow::Flow(const char* theKey)
+ : flow_id(0), protocol(INVALID_PROTOCOL), rx_count(0), rx_bytes(0.0),
+   first_seq(0), max_seq(0), late_count(0), dup_count(0),
+   latency_min(0.0), latency_max(0.0), latency_sum(0.0),
+   last_transit(0.0), jitter(0.0), report_bytes(0.0)
+{
+    memcpy(key, theKey, KEY_SIZE);
+    memset(seq_mask, 0, sizeof(seq_mask));
+    memset(latency_hist, 0, sizeof(latency_hist));
+    memset(iat_hist, 0, sizeof(iat_hist));
+    first_rx.tv_sec = first_rx.tv_usec = 0;
+    last_rx = report_time = first_rx;
+}
+
+void MgenRecvStats::Flow::MakeKey(char* key, MgenMsg& theMsg)
+{
+    memset(key, 0, KEY_SIZE);
+    UINT32 flowId = htonl(theMsg.GetFlowId());
+    memcpy(key, &flowId, sizeof(UINT32));
+    key[4] = (char)theMsg.GetProtocol();
+    unsigned int index = 5;
+    const ProtoAddress* addrList[2] = {&theMsg.GetSrcAddr(), &theMsg.GetDstAddr()};
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        const ProtoAddress& addr = *addrList[i];
+        key[index] = (char)addr.GetType();
+        if (addr.IsValid())
+        {
+            unsigned int addrLen = addr.GetLength();
+            memcpy(key + index + 1, addr.GetRawHostAddress(), (addrLen < 16) ? addrLen : 16);
+            UINT16 port = htons(addr.GetPort());
+            memcpy(key + index + 17, &port, sizeof(UINT16));
+        }
+        index += 1 + 16 + 2;
+    }
+}  // end MgenRecvStats::Flow::MakeKey()
+
+bool MgenRecvStats::Flow::MarkSeq(UINT32 seq)
+{
+    UINT32 index = seq % SEQ_WINDOW;
+    UINT32 bit = 0x01UL << (index & 31);
+    if (0 != (seq_mask[index >> 5] & bit)) return true;
+    seq_mask[index >> 5] |= bit;
+    return false;
+}  // end MgenRecvStats::Flow::MarkSeq()
+
+MgenRecvStats::MgenRecvStats()
+ : flow_count(0), last_flow(NULL)
+{
+}
+
+MgenRecvStats::~MgenRecvStats()
+{
+    Reset();
+}
+
+void MgenRecvStats::Reset()
+{
+    flow_tree.Destroy();
+    flow_count = 0;
+    last_flow = NULL;
+}  // end MgenRecvStats::Reset()
+
+// Returns the histogram bucket for a time value
+unsigned int MgenRecvStats::GetBucket(double seconds)
+{
+    if (seconds <= 0.0) return 0;
+    double usec = seconds * 1.0e+06;
+    if (usec >= 2147483648.0) return (HISTOGRAM_BUCKETS - 1);
+    UINT32 value = (UINT32)usec;
+    unsigned int bucket = 0;
+    while (0 != value)
+    {
+        bucket++;
+        value >>= 1;
+    }
+    return bucket;
+}  // end MgenRecvStats::GetBucket()
+
+void MgenRecvStats::Update(MgenMsg& theMsg, const struct timeval& rxTime)
+{
+    char key[Flow::KEY_SIZE];
+    Flow::MakeKey(key, theMsg);
+    Flow* flow = last_flow;
+    if ((NULL == flow) || (0 != memcmp(key, flow->key, Flow::KEY_SIZE)))
+    {
+        flow = flow_tree.Find(key, Flow::KEY_SIZE << 3);
+        if (NULL == flow)
+        {
+            if (NULL == (flow = new Flow(key)))
+            {
+                DMSG(0, "MgenRecvStats::Update() new Flow error: %s\n", GetErrorString());
+                return;
+            }
+            flow->flow_id = theMsg.GetFlowId();
+            flow->protocol = theMsg.GetProtocol();
+            flow->src_addr = theMsg.GetSrcAddr();
+            flow->dst_addr = theMsg.GetDstAddr();
+            flow_tree.Insert(*flow);
+            flow_count++;
+        }
+        last_flow = flow;
+    }
+
+    const struct timeval& txTime = theMsg.GetTxTime();
+    double transit = (double)(rxTime.tv_sec - txTime.tv_sec) +
+                     1.0e-06 * (double)((long)rxTime.tv_usec - (long)txTime.tv_usec);
+    UINT32 seq = theMsg.GetSeqNum();
+    if (0 == flow->rx_count)
+    {
+        flow->first_seq = flow->max_seq = seq;
+        flow->MarkSeq(seq);
+        flow->first_rx = flow->report_time = rxTime;
+        flow->latency_min = flow->latency_max = transit;
+    }
+    else
+    {
+        if (seq > flow->max_seq)
+        {
+            // Clear the window bits of the seq numbers skipped over
+            if ((seq - flow->max_seq) >= Flow::SEQ_WINDOW)
+                memset(flow->seq_mask, 0, sizeof(flow->seq_mask));
+            else
+                for (UINT32 s = flow->max_seq + 1; s != seq; s++)
+                    flow->seq_mask[(s % Flow::SEQ_WINDOW) >> 5] &= ~(0x01UL << (s & 31));
+            flow->MarkSeq(seq);
+            flow->max_seq = seq;
+        }
+        else
+        {
+            flow->late_count++;
+            // (seq numbers older than the window are counted as unique)
+            if (((flow->max_seq - seq) < Flow::SEQ_WINDOW) && flow->MarkSeq(seq))
+                flow->dup_count++;
+            if (seq < flow->first_seq) flow->first_seq = seq;
+        }
+        double interval = (double)(rxTime.tv_sec - flow->last_rx.tv_sec) +
+                          1.0e-06 * (double)((long)rxTime.tv_usec - (long)flow->last_rx.tv_usec);
+        flow->iat_hist[GetBucket(interval)]++;
+        double delta = transit - flow->last_transit;
+        if (delta < 0.0) delta = -delta;
+        flow->jitter += (delta - flow->jitter) / 16.0;
+        if (transit < flow->latency_min)
+            flow->latency_min = transit;
+        else if (transit > flow->latency_max)
+            flow->latency_max = transit;
+    }
+    flow->rx_count++;
+    flow->rx_bytes += theMsg.GetMsgLen();
+    flow->last_rx = rxTime;
+    flow->last_transit = transit;
+    flow->latency_sum += transit;
+    flow->latency_hist[GetBucket(transit)]++;
+}  // end MgenRecvStats::Update()
+
+// Logs "<name>><usec>:<count>,..." for non-empty buckets, where
+// <usec> is the bucket's (exclusive) upper bound
+void MgenRecvStats::LogHistogram(FILE* outFile, const char* name, const UINT32* hist)
+{
+    Mgen::Log(outFile, " %s>", name);
+    bool first = true;
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        if (0 == hist[i]) continue;
+        Mgen::Log(outFile, "%s%lu:%lu", first ? "" : ",",
+                  (unsigned long)(0x01UL << i), (unsigned long)hist[i]);
+        first = false;
+    }
+}  // end MgenRecvStats::LogHistogram()
+
+void MgenRecvStats::Report(FILE* outFile, bool localTime, bool markInterval)
+{
+    if (NULL == outFile) return;
+    struct timeval currentTime;
+    ProtoSystemTime(currentTime);
+    time_t timeSec = currentTime.tv_sec;
+    struct tm timeStruct;
+    struct tm* timePtr = MgenMsg::GetTimeStruct(&timeSec, localTime, &timeStruct);
+    char srcString[64], dstString[64];
+    FlowTree::Iterator iterator(flow_tree);
+    Flow* flow;
+    while (NULL != (flow = iterator.GetNextItem()))
+    {
+        unsigned long expected = (unsigned long)(flow->max_seq - flow->first_seq) + 1;
+        unsigned long unique = flow->rx_count - flow->dup_count;
+        unsigned long lost = (expected > unique) ? (expected - unique) : 0;
+        double interval = (double)(currentTime.tv_sec - flow->report_time.tv_sec) +
+                          1.0e-06 * (double)((long)currentTime.tv_usec - (long)flow->report_time.tv_usec);
+        double rate = (interval > 0.0) ?
+                        ((8.0e-03 * (flow->rx_bytes - flow->report_bytes)) / interval) : 0.0;
+        if (markInterval)
+        {
+            flow->report_bytes = flow->rx_bytes;
+            flow->report_time = currentTime;
+        }
+        Mgen::Log(outFile, "%02d:%02d:%02d.%06lu STATS flow>%lu proto>%s src>%s/%hu dst>%s/%hu "
+                  "recv>%lu bytes>%.0f lost>%lu late>%lu dup>%lu rate>%.3f "
+                  "latency>%.6f/%.6f/%.6f jitter>%.6f",
+                  timePtr->tm_hour, timePtr->tm_min, timePtr->tm_sec,
+                  (UINT32)currentTime.tv_usec,
+                  (unsigned long)flow->flow_id,
+                  MgenEvent::GetStringFromProtocol(flow->protocol),
+                  flow->src_addr.GetHostString(srcString, 64), flow->src_addr.GetPort(),
+                  flow->dst_addr.GetHostString(dstString, 64), flow->dst_addr.GetPort(),
+                  flow->rx_count, flow->rx_bytes, lost, flow->late_count,
+                  flow->dup_count, rate,
+                  flow->latency_min, flow->latency_sum / (double)flow->rx_count,
+                  flow->latency_max, flow->jitter);
+        LogHistogram(outFile, "latHist", flow->latency_hist);
+        LogHistogram(outFile, "iatHist", flow->iat_hist);
+        Mgen::Log(outFile, "\n");
+    }
+    fflush(outFile);
+}  // end MgenRecvStats::Report()
@@ -0,0 +1,187 @@
+/*
+ * This program times MGEN script loading and transport lookups as the
+ * number of flows grows, to check that their per-item cost stays flat
+ * (i.e. the flow and transport indexes are working).  For each flow
+ * count, it:
+ *
+ *   1) Parses an "ON" script line for each flow and then a "MOD" line
+ *      for each flow (each line looks up its flow by id),
+ *   2) Creates a UDP transport per flow (distinct source ports) and a
+ *      TCP transport per flow (distinct destinations), then looks each
+ *      one up by source port, destination address and socket.
+ *
+ * Usage: mgenScaleBench [flows <count>]
+ *
+ * (The default flow counts are 1000 and 10000.  Nothing is started, so
+ *  no sockets are opened and no messages are sent.)
+ */
+
+#include "mgen.h"
+#include "protoDispatcher.h"
+#include "protoTime.h"
+
+#include <stdio.h>
+#include <stdlib.h>  // for atoi()
+#include <string.h>
+
+static const UINT16 BASE_PORT = 10000;
+
+static void SetDstAddr(ProtoAddress& addr, unsigned int index)
+{
+    char host[32];
+    sprintf(host, "10.%u.%u.%u", (index >> 16) & 0xff, (index >> 8) & 0xff, index & 0xff);
+    addr.ResolveFromString(host);
+    addr.SetPort(5000);
+}  // end SetDstAddr()
+
+static double Elapsed(const ProtoTime& start)
+{
+    ProtoTime now;
+    now.GetCurrentTime();
+    return ProtoTime::Delta(now, start);
+}  // end Elapsed()
+
+// Returns false on error
+static bool Run(unsigned int flowCount)
+{
+    ProtoDispatcher dispatcher;
+    Mgen mgen(dispatcher, dispatcher);
+    char line[256];
+    ProtoTime start;
+    double elapsed;
+
+    printf("%-8u", flowCount);
+
+    // 1) Script loading
+    start.GetCurrentTime();
+    for (unsigned int i = 0; i < flowCount; i++)
+    {
+        sprintf(line, "0.0 ON %u UDP SRC %u DST 10.%u.%u.%u/5000 PERIODIC [1 512]",
+                i + 1, BASE_PORT + (i % 50000), (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+        if (!mgen.ParseEvent(line, i + 1)) return false;
+    }
+    elapsed = Elapsed(start);
+    printf(" %10.3f", 1.0e+06 * elapsed / (double)flowCount);
+    start.GetCurrentTime();
+    for (unsigned int i = 0; i < flowCount; i++)
+    {
+        sprintf(line, "1.0 MOD %u PERIODIC [2 512]", flowCount - i);
+        if (!mgen.ParseEvent(line, flowCount + i + 1)) return false;
+    }
+    elapsed = Elapsed(start);
+    printf(" %10.3f", 1.0e+06 * elapsed / (double)flowCount);
+    fflush(stdout);
+
+    // 2) Transport lookups
+    unsigned int portCount = (flowCount < 50000) ? flowCount : 50000;
+    MgenTransport** udpList = new MgenTransport*[portCount];
+    MgenTransport** tcpList = new MgenTransport*[flowCount];
+    ProtoAddress noAddr, dstAddr;
+    start.GetCurrentTime();
+    for (unsigned int i = 0; i < portCount; i++)
+    {
+        if (NULL == (udpList[i] = mgen.GetMgenTransport(UDP, BASE_PORT + i, noAddr, NULL)))
+        {
+            delete[] tcpList;
+            delete[] udpList;
+            return false;
+        }
+    }
+    for (unsigned int i = 0; i < flowCount; i++)
+    {
+        SetDstAddr(dstAddr, i);
+        if (NULL == (tcpList[i] = mgen.GetMgenTransport(TCP, 0, dstAddr, NULL)))
+        {
+            delete[] tcpList;
+            delete[] udpList;
+            return false;
+        }
+    }
+    elapsed = Elapsed(start);
+    printf(" %10.3f", 1.0e+06 * elapsed / (double)(portCount + flowCount));
+    fflush(stdout);
+
+    bool result = true;
+    start.GetCurrentTime();
+    for (unsigned int i = 0; i < portCount; i++)
+    {
+        if (udpList[i] != mgen.FindMgenTransport(UDP, BASE_PORT + i, noAddr, false, NULL, NULL))
+            result = false;
+    }
+    elapsed = Elapsed(start);
+    printf(" %10.3f", 1.0e+06 * elapsed / (double)portCount);
+    start.GetCurrentTime();
+    for (unsigned int i = 0; i < flowCount; i++)
+    {
+        SetDstAddr(dstAddr, i);
+        if (tcpList[i] != mgen.FindMgenTransport(TCP, 0, dstAddr, false, NULL, NULL))
+            result = false;
+    }
+    elapsed = Elapsed(start);
+    printf(" %10.3f", 1.0e+06 * elapsed / (double)flowCount);
+    start.GetCurrentTime();
+    for (unsigned int i = 0; i < flowCount; i++)
+    {
+        if (tcpList[i] != mgen.FindMgenTransportBySocket(*tcpList[i]->GetSocket()))
+            result = false;
+    }
+    elapsed = Elapsed(start);
+    printf(" %10.3f\n", 1.0e+06 * elapsed / (double)flowCount);
+    if (!result)
+        fprintf(stderr, "mgenScaleBench: transport lookup mismatch\n");
+    delete[] tcpList;
+    delete[] udpList;
+    return result;
+}  // end Run()
+
+void Usage()
+{
+    fprintf(stderr, "Usage: mgenScaleBench [flows <count>]\n");
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int countList[] = {1000, 10000};
+    unsigned int countCount = sizeof(countList) / sizeof(unsigned int);
+
+    int i = 1;
+    while (i < argc)
+    {
+        if ((i + 1) >= argc)
+        {
+            Usage();
+            return -1;
+        }
+        const char* cmd = argv[i++];
+        const char* val = argv[i++];
+        if (!strcmp(cmd, "flows"))
+        {
+            int count = atoi(val);
+            if (count <= 0)
+            {
+                fprintf(stderr, "mgenScaleBench: invalid flow count\n");
+                return -1;
+            }
+            countList[0] = count;
+            countCount = 1;
+        }
+        else
+        {
+            Usage();
+            return -1;
+        }
+    }
+
+    printf("(usec per item)\n");
+    printf("%-8s %10s %10s %10s %10s %10s %10s\n",
+           "flows", "ON", "MOD", "create", "srcPort", "dstAddr", "socket");
+    for (unsigned int c = 0; c < countCount; c++)
+    {
+        if (!Run(countList[c]))
+        {
+            fprintf(stderr, "mgenScaleBench: error at %u flows\n", countList[c]);
+            return -1;
+        }
+    }
+    return 0;
+}  // end main()
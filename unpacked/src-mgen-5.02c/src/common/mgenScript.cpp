@@ -0,0 +1,399 @@
+#include "mgenScript.h"
+#include "mgen.h"
+#include "mgenEvent.h"
+#include "mgenVersion.h"
+
+#include <string.h>
+#include <stdint.h>  // for uint64_t
+#ifdef UNIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // UNIX
+
+MgenScriptRecord::MgenScriptRecord(char* buffer, unsigned int bufferLen)
+ : put_buffer(buffer), get_buffer(buffer), buffer_len(bufferLen),
+   index(0), ok(true)
+{
+}
+
+MgenScriptRecord::MgenScriptRecord(const char* buffer, unsigned int bufferLen)
+ : put_buffer(NULL), get_buffer(buffer), buffer_len(bufferLen),
+   index(0), ok(true)
+{
+}
+
+bool MgenScriptRecord::PutUINT8(UINT8 value)
+{
+    if (!Reserve(sizeof(UINT8))) return false;
+    put_buffer[index++] = (char)value;
+    return true;
+}  // end MgenScriptRecord::PutUINT8()
+
+bool MgenScriptRecord::PutUINT16(UINT16 value)
+{
+    if (!Reserve(sizeof(UINT16))) return false;
+    UINT16 temp16 = htons(value);
+    memcpy(put_buffer+index, &temp16, sizeof(UINT16));
+    index += sizeof(UINT16);
+    return true;
+}  // end MgenScriptRecord::PutUINT16()
+
+bool MgenScriptRecord::PutUINT32(UINT32 value)
+{
+    if (!Reserve(sizeof(UINT32))) return false;
+    UINT32 temp32 = htonl(value);
+    memcpy(put_buffer+index, &temp32, sizeof(UINT32));
+    index += sizeof(UINT32);
+    return true;
+}  // end MgenScriptRecord::PutUINT32()
+
+bool MgenScriptRecord::PutDouble(double value)
+{
+    // (the IEEE 754 bits, most significant word first)
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(double));
+    PutUINT32((UINT32)(bits >> 32));
+    return PutUINT32((UINT32)(bits & 0xffffffff));
+}  // end MgenScriptRecord::PutDouble()
+
+bool MgenScriptRecord::PutData(const char* data, unsigned int len)
+{
+    if (!Reserve(len)) return false;
+    memcpy(put_buffer+index, data, len);
+    index += len;
+    return true;
+}  // end MgenScriptRecord::PutData()
+
+bool MgenScriptRecord::GetUINT8(UINT8& value)
+{
+    if (!Reserve(sizeof(UINT8))) return false;
+    value = (UINT8)get_buffer[index++];
+    return true;
+}  // end MgenScriptRecord::GetUINT8()
+
+bool MgenScriptRecord::GetUINT16(UINT16& value)
+{
+    if (!Reserve(sizeof(UINT16))) return false;
+    UINT16 temp16;
+    memcpy(&temp16, get_buffer+index, sizeof(UINT16));
+    value = ntohs(temp16);
+    index += sizeof(UINT16);
+    return true;
+}  // end MgenScriptRecord::GetUINT16()
+
+bool MgenScriptRecord::GetUINT32(UINT32& value)
+{
+    if (!Reserve(sizeof(UINT32))) return false;
+    UINT32 temp32;
+    memcpy(&temp32, get_buffer+index, sizeof(UINT32));
+    value = ntohl(temp32);
+    index += sizeof(UINT32);
+    return true;
+}  // end MgenScriptRecord::GetUINT32()
+
+bool MgenScriptRecord::GetDouble(double& value)
+{
+    UINT32 high, low;
+    GetUINT32(high);
+    if (!GetUINT32(low)) return false;
+    uint64_t bits = ((uint64_t)high << 32) | (uint64_t)low;
+    memcpy(&value, &bits, sizeof(double));
+    return true;
+}  // end MgenScriptRecord::GetDouble()
+
+bool MgenScriptRecord::GetData(const char*& data, unsigned int len)
+{
+    if (!Reserve(len)) return false;
+    data = get_buffer + index;
+    index += len;
+    return true;
+}  // end MgenScriptRecord::GetData()
+
+
+const char* const MgenBinaryScript::FILE_TYPE = "binary_script";
+
+MgenBinaryScript::MgenBinaryScript()
+ : file_data(NULL), file_size(0), read_offset(0), read_error(false)
+{
+#ifndef UNIX
+    file_buffer = NULL;
+#endif // !UNIX
+}
+
+MgenBinaryScript::~MgenBinaryScript()
+{
+    Close();
+}
+
+// Checks the "mgen version=<version> type=binary_script" header line
+bool MgenBinaryScript::CheckHeader(const char* buffer, unsigned int len)
+{
+    const char* end = (const char*)memchr(buffer, '\0', len);
+    if ((NULL == end) || (0 != strncmp(buffer, "mgen ", 5))) return false;
+    const char* ptr = strstr(buffer, "type=");
+    char fileType[64];
+    if ((NULL == ptr) || (1 != sscanf(ptr, "type=%63s", fileType)))
+        return false;
+    return (0 == strcmp(fileType, FILE_TYPE));
+}  // end MgenBinaryScript::CheckHeader()
+
+bool MgenBinaryScript::IsBinaryScript(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file) return false;
+    char buffer[128];
+    size_t len = fread(buffer, sizeof(char), sizeof(buffer), file);
+    fclose(file);
+    return CheckHeader(buffer, (unsigned int)len);
+}  // end MgenBinaryScript::IsBinaryScript()
+
+bool MgenBinaryScript::WriteRecord(FILE*         file,
+                                   RecordType    type,
+                                   unsigned int  lineCount,
+                                   const char*   data,
+                                   unsigned int  len)
+{
+    if (len > 0xffff)
+    {
+        DMSG(0, "MgenBinaryScript::WriteRecord() error: record too long at line: %u\n", lineCount);
+        return false;
+    }
+    char header[RECORD_HEADER_LEN];
+    MgenScriptRecord record(header, RECORD_HEADER_LEN);
+    record.PutUINT8((UINT8)type);
+    record.PutUINT8(0);  // reserved
+    record.PutUINT16((UINT16)len);
+    record.PutUINT32((UINT32)lineCount);
+    if ((1 != fwrite(header, RECORD_HEADER_LEN, 1, file)) ||
+        (1 != fwrite(data, len, 1, file)))
+    {
+        DMSG(0, "MgenBinaryScript::WriteRecord() fwrite() error: %s\n", GetErrorString());
+        return false;
+    }
+    return true;
+}  // end MgenBinaryScript::WriteRecord()
+
+bool MgenBinaryScript::Compile(const char* scriptPath, const char* binPath)
+{
+    FILE* scriptFile = fopen(scriptPath, "r");
+    if (!scriptFile)
+    {
+        DMSG(0, "MgenBinaryScript::Compile() fopen(%s) error: %s\n", scriptPath, GetErrorString());
+        return false;
+    }
+    FILE* binFile = fopen(binPath, "wb");
+    if (!binFile)
+    {
+        DMSG(0, "MgenBinaryScript::Compile() fopen(%s) error: %s\n", binPath, GetErrorString());
+        fclose(scriptFile);
+        return false;
+    }
+    // write header line plus NULL character
+    char header[128];
+    sprintf(header, "mgen version=%s type=%s\n", MGEN_VERSION, FILE_TYPE);
+    bool result = (1 == fwrite(header, strlen(header)+1, 1, binFile));
+
+    // Read script file line by line as Mgen::ParseScript() does
+    Mgen::FastReader reader;
+    unsigned int lineCount = 0;
+    unsigned int lines = 0;
+    char lineBuffer[Mgen::SCRIPT_LINE_MAX+1];
+    char fieldBuffer[Mgen::SCRIPT_LINE_MAX+1];
+    char eventBuffer[2*Mgen::SCRIPT_LINE_MAX];
+    while (result)
+    {
+        lineCount += lines;  // for grouped (continued) lines
+        unsigned int len = Mgen::SCRIPT_LINE_MAX;
+        Mgen::FastReader::Result readResult =
+            reader.ReadlineContinue(scriptFile, lineBuffer, &len, &lines);
+        if (Mgen::FastReader::DONE == readResult)
+        {
+            break;
+        }
+        else if (Mgen::FastReader::ERROR_ == readResult)
+        {
+            DMSG(0, "MgenBinaryScript::Compile() error: script file read error\n");
+            result = false;
+            break;
+        }
+        lineCount++;
+        lines--;
+        const char* ptr = lineBuffer;
+        while ((' ' == *ptr) || ('\t' == *ptr)) ptr++;
+        // Skip comment and blank lines
+        if (('#' == *ptr) || (1 != sscanf(ptr, "%s", fieldBuffer))) continue;
+        // MGEN event lines are "[<eventTime>] {ON|MOD|OFF} <flowId> ..."
+        // (everything else is left to Mgen::ParseEvent() at load time)
+        bool isEvent = false;
+        if (Mgen::INVALID_COMMAND == Mgen::GetCommandFromString(fieldBuffer))
+        {
+            double eventTime;
+            if (1 == sscanf(fieldBuffer, "%lf", &eventTime))
+            {
+                ptr += strlen(fieldBuffer);
+                while ((' ' == *ptr) || ('\t' == *ptr)) ptr++;
+                if (1 != sscanf(ptr, "%s", fieldBuffer)) fieldBuffer[0] = '\0';
+            }
+            isEvent = (MgenEvent::INVALID_TYPE != MgenEvent::GetTypeFromString(fieldBuffer));
+        }
+        if (isEvent)
+        {
+            MgenEvent theEvent;
+            if (!theEvent.InitFromString(lineBuffer))
+            {
+                DMSG(0, "MgenBinaryScript::Compile() error: invalid mgen script line: %u\n", lineCount);
+                result = false;
+                break;
+            }
+            MgenScriptRecord record(eventBuffer, sizeof(eventBuffer));
+            if (theEvent.Pack(record))
+            {
+                result = WriteRecord(binFile, MGEN_EVENT, lineCount,
+                                     eventBuffer, record.GetLength());
+                continue;
+            }
+            // else store it as a script line
+        }
+        result = WriteRecord(binFile, SCRIPT_LINE, lineCount,
+                             lineBuffer, strlen(lineBuffer) + 1);
+    }
+    fclose(scriptFile);
+    if (0 != fclose(binFile))
+    {
+        DMSG(0, "MgenBinaryScript::Compile() fclose() error: %s\n", GetErrorString());
+        result = false;
+    }
+    if (!result) remove(binPath);
+    return result;
+}  // end MgenBinaryScript::Compile()
+
+bool MgenBinaryScript::Open(const char* path)
+{
+    Close();
+#ifdef UNIX
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        DMSG(0, "MgenBinaryScript::Open() open() error: %s\n", GetErrorString());
+        return false;
+    }
+    struct stat buf;
+    if (0 != fstat(fd, &buf))
+    {
+        DMSG(0, "MgenBinaryScript::Open() fstat() error: %s\n", GetErrorString());
+        close(fd);
+        return false;
+    }
+    file_size = buf.st_size;
+    if (0 != file_size)
+    {
+        void* addr = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == addr)
+        {
+            DMSG(0, "MgenBinaryScript::Open() mmap() error: %s\n", GetErrorString());
+            close(fd);
+            file_size = 0;
+            return false;
+        }
+#ifdef MADV_SEQUENTIAL
+        madvise(addr, file_size, MADV_SEQUENTIAL);
+#endif // MADV_SEQUENTIAL
+        file_data = (const char*)addr;
+    }
+    close(fd);  // (the mapping stays valid)
+#else
+    // Other systems read the file into memory
+    FILE* file = fopen(path, "rb");
+    if (!file)
+    {
+        DMSG(0, "MgenBinaryScript::Open() fopen() error: %s\n", GetErrorString());
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (0 != file_size)
+    {
+        file_buffer = new char[file_size];
+        if ((NULL == file_buffer) || (fread(file_buffer, 1, file_size, file) < file_size))
+        {
+            DMSG(0, "MgenBinaryScript::Open() fread() error: %s\n", GetErrorString());
+            if (NULL != file_buffer) delete[] file_buffer;
+            file_buffer = NULL;
+            file_size = 0;
+            fclose(file);
+            return false;
+        }
+        file_data = file_buffer;
+    }
+    fclose(file);
+#endif // if/else UNIX
+    unsigned int headerMax = (file_size < 128) ? (unsigned int)file_size : 128;
+    if ((NULL == file_data) || !CheckHeader(file_data, headerMax))
+    {
+        DMSG(0, "MgenBinaryScript::Open() error: invalid binary script header\n");
+        Close();
+        return false;
+    }
+    read_offset = strlen(file_data) + 1;
+    read_error = false;
+    return true;
+}  // end MgenBinaryScript::Open()
+
+void MgenBinaryScript::Close()
+{
+    if (NULL != file_data)
+    {
+#ifdef UNIX
+        munmap((void*)file_data, file_size);
+#else
+        delete[] file_buffer;
+        file_buffer = NULL;
+#endif // if/else UNIX
+        file_data = NULL;
+    }
+    file_size = 0;
+    read_offset = 0;
+}  // end MgenBinaryScript::Close()
+
+bool MgenBinaryScript::GetNextRecord(RecordType&    type,
+                                     unsigned int&  lineCount,
+                                     const char*&   data,
+                                     unsigned int&  len)
+{
+    if ((NULL == file_data) || (read_offset >= file_size)) return false;
+    if ((file_size - read_offset) < RECORD_HEADER_LEN)
+    {
+        read_error = true;
+        return false;
+    }
+    MgenScriptRecord header(file_data + read_offset, RECORD_HEADER_LEN);
+    UINT8 recordType, reserved;
+    UINT16 recordLength;
+    UINT32 recordLine;
+    header.GetUINT8(recordType);
+    header.GetUINT8(reserved);
+    header.GetUINT16(recordLength);
+    header.GetUINT32(recordLine);
+    read_offset += RECORD_HEADER_LEN;
+    if ((file_size - read_offset) < recordLength)
+    {
+        read_error = true;
+        return false;
+    }
+    type = (RecordType)recordType;
+    lineCount = recordLine;
+    data = file_data + read_offset;
+    len = recordLength;
+    read_offset += recordLength;
+    // (script lines must be NULL terminated)
+    if ((SCRIPT_LINE == type) && ((0 == len) || ('\0' != data[len-1])))
+    {
+        read_error = true;
+        return false;
+    }
+    return true;
+}  // end MgenBinaryScript::GetNextRecord()
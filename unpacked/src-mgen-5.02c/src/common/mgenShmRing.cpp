@@ -0,0 +1,355 @@
+#include "mgenShmRing.h"
+
+#include <string.h>
+#ifdef MGEN_SHM_RING
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif // MGEN_SHM_RING
+
+MgenShmRing::MgenShmRing()
+ : header(NULL), ring(NULL), ring_mask(0), map_size(0), producer(false),
+   reserve_pad(0), peek_length(0), data_fd(-1), space_fd(-1), socket_fd(-1)
+{
+}
+
+MgenShmRing::~MgenShmRing()
+{
+    Close();
+}
+
+bool MgenShmRing::IsSupported()
+{
+#ifdef MGEN_SHM_RING
+    return true;
+#else
+    return false;
+#endif // if/else MGEN_SHM_RING
+}  // end MgenShmRing::IsSupported()
+
+#ifdef MGEN_SHM_RING
+
+bool MgenShmRing::Map(int memFd, size_t mapSize, bool init)
+{
+    void* addr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (MAP_FAILED == addr)
+    {
+        DMSG(0, "MgenShmRing::Map() mmap() error: %s\n", GetErrorString());
+        return false;
+    }
+    header = (Header*)addr;
+    ring = (char*)addr + sizeof(Header);
+    map_size = mapSize;
+    if (init)
+    {
+        memset(header, 0, sizeof(Header));
+        header->magic = MAGIC;
+        header->version = VERSION;
+        header->size = (UINT32)(mapSize - sizeof(Header));
+        // (the consumer starts out waiting for data)
+        header->consumer_waiting = 1;
+    }
+    else if ((MAGIC != header->magic) || (VERSION != header->version) ||
+             (header->size != (mapSize - sizeof(Header))) ||
+             (0 != (header->size & (header->size - 1))))
+    {
+        DMSG(0, "MgenShmRing::Map() error: invalid ring header\n");
+        Close();
+        return false;
+    }
+    ring_mask = header->size - 1;
+    return true;
+}  // end MgenShmRing::Map()
+
+bool MgenShmRing::Connect(const char* path, unsigned int size, bool isProducer)
+{
+    Close();
+    UINT32 ringSize = SIZE_MIN;
+    while ((ringSize < size) && (ringSize < 0x40000000)) ringSize <<= 1;
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        DMSG(0, "MgenShmRing::Connect() error: socket path too long\n");
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if ((socket_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+    {
+        DMSG(0, "MgenShmRing::Connect() socket() error: %s\n", GetErrorString());
+        return false;
+    }
+    if (0 != connect(socket_fd, (struct sockaddr*)&addr, sizeof(addr)))
+    {
+        DMSG(0, "MgenShmRing::Connect() connect(%s) error: %s\n", path, GetErrorString());
+        Close();
+        return false;
+    }
+    int memFd = memfd_create("mgen_ring", MFD_CLOEXEC);
+    if (memFd < 0)
+    {
+        DMSG(0, "MgenShmRing::Connect() memfd_create() error: %s\n", GetErrorString());
+        Close();
+        return false;
+    }
+    size_t mapSize = sizeof(Header) + ringSize;
+    if ((0 != ftruncate(memFd, mapSize)) || !Map(memFd, mapSize, true))
+    {
+        DMSG(0, "MgenShmRing::Connect() ring allocation error: %s\n", GetErrorString());
+        close(memFd);
+        Close();
+        return false;
+    }
+    data_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    space_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((data_fd < 0) || (space_fd < 0))
+    {
+        DMSG(0, "MgenShmRing::Connect() eventfd() error: %s\n", GetErrorString());
+        close(memFd);
+        Close();
+        return false;
+    }
+    producer = isProducer;
+
+    // Pass the ring and event descriptors to the application
+    Hello hello;
+    hello.magic = MAGIC;
+    hello.version = VERSION;
+    hello.mgen_producer = producer ? 1 : 0;
+    hello.size = ringSize;
+    struct iovec iov;
+    iov.iov_base = &hello;
+    iov.iov_len = sizeof(hello);
+    int fdList[3] = {memFd, data_fd, space_fd};
+    char control[CMSG_SPACE(sizeof(fdList))];
+    memset(control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fdList));
+    memcpy(CMSG_DATA(cmsg), fdList, sizeof(fdList));
+    ssize_t result;
+    do
+    {
+        result = sendmsg(socket_fd, &msg, 0);
+    } while ((result < 0) && (EINTR == errno));
+    close(memFd);  // (the mapping stays valid)
+    if (result != (ssize_t)sizeof(hello))
+    {
+        DMSG(0, "MgenShmRing::Connect() sendmsg() error: %s\n", GetErrorString());
+        Close();
+        return false;
+    }
+    return true;
+}  // end MgenShmRing::Connect()
+
+bool MgenShmRing::Accept(int sock)
+{
+    Close();
+    Hello hello;
+    struct iovec iov;
+    iov.iov_base = &hello;
+    iov.iov_len = sizeof(hello);
+    int fdList[3];
+    char control[CMSG_SPACE(sizeof(fdList))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t result;
+    do
+    {
+        result = recvmsg(sock, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+    } while ((result < 0) && (EINTR == errno));
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if ((NULL == cmsg) || (SOL_SOCKET != cmsg->cmsg_level) ||
+        (SCM_RIGHTS != cmsg->cmsg_type) || (cmsg->cmsg_len != CMSG_LEN(sizeof(fdList))))
+    {
+        DMSG(0, "MgenShmRing::Accept() error: no ring descriptors received\n");
+        return false;
+    }
+    memcpy(fdList, CMSG_DATA(cmsg), sizeof(fdList));
+    data_fd = fdList[1];
+    space_fd = fdList[2];
+    if ((result != (ssize_t)sizeof(hello)) || (MAGIC != hello.magic) ||
+        (VERSION != hello.version) || !Map(fdList[0], sizeof(Header) + hello.size, false))
+    {
+        DMSG(0, "MgenShmRing::Accept() error: invalid ring\n");
+        close(fdList[0]);
+        Close();
+        return false;
+    }
+    close(fdList[0]);
+    producer = (0 == hello.mgen_producer);
+    return true;
+}  // end MgenShmRing::Accept()
+
+void MgenShmRing::Close()
+{
+    if (NULL != header)
+    {
+        munmap((void*)header, map_size);
+        header = NULL;
+        ring = NULL;
+    }
+    if (data_fd >= 0) close(data_fd);
+    if (space_fd >= 0) close(space_fd);
+    if (socket_fd >= 0) close(socket_fd);
+    data_fd = space_fd = socket_fd = -1;
+    map_size = 0;
+    reserve_pad = peek_length = 0;
+}  // end MgenShmRing::Close()
+
+void MgenShmRing::Signal(int fd)
+{
+    uint64_t one = 1;
+    while ((write(fd, &one, sizeof(one)) < 0) && (EINTR == errno));
+}  // end MgenShmRing::Signal()
+
+void MgenShmRing::ClearEvent()
+{
+    uint64_t count;
+    while ((read(GetEventDescriptor(), &count, sizeof(count)) < 0) && (EINTR == errno));
+}  // end MgenShmRing::ClearEvent()
+
+bool MgenShmRing::Wait(int timeoutMsec)
+{
+    struct pollfd pfd;
+    pfd.fd = GetEventDescriptor();
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int result;
+    do
+    {
+        result = poll(&pfd, 1, timeoutMsec);
+    } while ((result < 0) && (EINTR == errno));
+    if (result < 0)
+    {
+        DMSG(0, "MgenShmRing::Wait() poll() error: %s\n", GetErrorString());
+        return false;
+    }
+    if (result > 0) ClearEvent();
+    return true;
+}  // end MgenShmRing::Wait()
+
+// The "waiting" flags are set (or cleared) and the other side's index
+// rechecked with sequentially consistent operations, so a side that
+// goes to wait is always signaled by the next Commit() or Consume()
+char* MgenShmRing::Reserve(unsigned int len)
+{
+    UINT32 ringSize = ring_mask + 1;
+    UINT32 length = RecordLength(len);
+    if (length > (ringSize >> 1)) return NULL;  // (never fits)
+    UINT32 head = header->head;
+    UINT32 offset = head & ring_mask;
+    UINT32 pad = ((ringSize - offset) < length) ? (ringSize - offset) : 0;
+    if ((ringSize - (head - __atomic_load_n(&header->tail, __ATOMIC_ACQUIRE))) < (pad + length))
+    {
+        __atomic_store_n(&header->producer_waiting, 1, __ATOMIC_SEQ_CST);
+        if ((ringSize - (head - __atomic_load_n(&header->tail, __ATOMIC_SEQ_CST))) < (pad + length))
+            return NULL;
+        __atomic_store_n(&header->producer_waiting, 0, __ATOMIC_RELAXED);
+    }
+    if (0 != pad)
+    {
+        UINT32 padLength = PAD;
+        memcpy(ring + offset, &padLength, sizeof(UINT32));
+    }
+    reserve_pad = pad;
+    return (ring + ((head + pad) & ring_mask) + 8);
+}  // end MgenShmRing::Reserve()
+
+void MgenShmRing::Commit(unsigned int len)
+{
+    UINT32 head = header->head + reserve_pad;
+    UINT32 msgLen = len;
+    memcpy(ring + (head & ring_mask), &msgLen, sizeof(UINT32));
+    __atomic_store_n(&header->head, head + RecordLength(len), __ATOMIC_SEQ_CST);
+    reserve_pad = 0;
+    if (__atomic_exchange_n(&header->consumer_waiting, 0, __ATOMIC_SEQ_CST))
+        Signal(data_fd);
+}  // end MgenShmRing::Commit()
+
+void MgenShmRing::RequestSpaceEvent()
+{
+    // (a waiting producer is signaled by the consumer's next Consume())
+    if (0 == __atomic_load_n(&header->producer_waiting, __ATOMIC_SEQ_CST))
+        Signal(space_fd);
+}  // end MgenShmRing::RequestSpaceEvent()
+
+const char* MgenShmRing::Peek(unsigned int& len)
+{
+    UINT32 tail = header->tail;
+    while (true)
+    {
+        if (__atomic_load_n(&header->head, __ATOMIC_ACQUIRE) == tail)
+        {
+            __atomic_store_n(&header->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&header->head, __ATOMIC_SEQ_CST) == tail)
+                return NULL;
+            __atomic_store_n(&header->consumer_waiting, 0, __ATOMIC_RELAXED);
+        }
+        UINT32 offset = tail & ring_mask;
+        UINT32 msgLen;
+        memcpy(&msgLen, ring + offset, sizeof(UINT32));
+        if (PAD == msgLen)
+        {
+            // Skip to the start of the ring
+            tail += (ring_mask + 1) - offset;
+            __atomic_store_n(&header->tail, tail, __ATOMIC_RELEASE);
+            continue;
+        }
+        len = msgLen;
+        peek_length = RecordLength(msgLen);
+        return (ring + offset + 8);
+    }
+}  // end MgenShmRing::Peek()
+
+void MgenShmRing::Consume()
+{
+    __atomic_store_n(&header->tail, header->tail + peek_length, __ATOMIC_SEQ_CST);
+    peek_length = 0;
+    if (__atomic_exchange_n(&header->producer_waiting, 0, __ATOMIC_SEQ_CST))
+        Signal(space_fd);
+}  // end MgenShmRing::Consume()
+
+#else
+
+bool MgenShmRing::Connect(const char* path, unsigned int size, bool producer)
+{
+    DMSG(0, "MgenShmRing::Connect() error: shared memory rings not supported on this system\n");
+    return false;
+}
+
+bool MgenShmRing::Accept(int sock)
+{
+    DMSG(0, "MgenShmRing::Accept() error: shared memory rings not supported on this system\n");
+    return false;
+}
+
+void MgenShmRing::Close() {}
+void MgenShmRing::ClearEvent() {}
+bool MgenShmRing::Wait(int timeoutMsec) {return false;}
+char* MgenShmRing::Reserve(unsigned int len) {return NULL;}
+void MgenShmRing::Commit(unsigned int len) {}
+void MgenShmRing::RequestSpaceEvent() {}
+const char* MgenShmRing::Peek(unsigned int& len) {return NULL;}
+void MgenShmRing::Consume() {}
+
+#endif // if/else MGEN_SHM_RING
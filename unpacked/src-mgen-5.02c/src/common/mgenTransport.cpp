@@ -18,7 +18,7 @@
 #endif // UNIX
 
 MgenTransportList::MgenTransportList()
-  :  head(NULL), tail(NULL)
+  :  head(NULL), tail(NULL), head_order(0), tail_order(0)
 {
 }
 
@@ -39,6 +39,10 @@ void MgenTransportList::Destroy()
         
     }
     head = tail = NULL;   
+    port_index.Destroy();
+    dst_index.Destroy();
+    socket_index.Destroy();
+    head_order = tail_order = 0;
     
 }  // end MgenTransportList::Destroy()
 
@@ -46,24 +50,39 @@ void MgenTransportList::Prepend(MgenTransport* mgenTransport)
 {
     mgenTransport->prev = NULL;
     if ((mgenTransport->next = head))
+    {
       head->prev = mgenTransport;
+      mgenTransport->list_order = --head_order;
+    }
     else
+    {
       tail = mgenTransport;
+      mgenTransport->list_order = head_order = tail_order = 0;
+    }
     head = mgenTransport;
+    Index(mgenTransport);
 }  // end MgenTransportList::Prepend()
 
 void MgenTransportList::Append(MgenTransport* mgenTransport)
 {
     mgenTransport->next = NULL;
     if ((mgenTransport->prev = tail))
+    {
       tail->next = mgenTransport;
+      mgenTransport->list_order = ++tail_order;
+    }
     else
+    {
       head = mgenTransport;
+      mgenTransport->list_order = head_order = tail_order = 0;
+    }
     tail = mgenTransport;
+    Index(mgenTransport);
 }  // end MgenTransportList::Append()
 
 void MgenTransportList::Remove(MgenTransport* mgenTransport)
 {
+    Unindex(mgenTransport);
     if (mgenTransport->prev)
       mgenTransport->prev->next = mgenTransport->next;
     else
@@ -74,13 +93,64 @@ void MgenTransportList::Remove(MgenTransport* mgenTransport)
       tail = mgenTransport->prev;
 }  // end MgenTransportList::Remove()
 
+unsigned int MgenTransportList::MakePortKey(char* key, Protocol theProtocol, UINT16 srcPort)
+{
+    key[0] = (char)theProtocol;
+    memcpy(key + 1, &srcPort, sizeof(UINT16));
+    return (1 + sizeof(UINT16));
+}  // end MgenTransportList::MakePortKey()
+
+unsigned int MgenTransportList::MakeDstKey(char* key, Protocol theProtocol, const ProtoAddress& dstAddr)
+{
+    key[0] = (char)theProtocol;
+    key[1] = (char)dstAddr.GetType();
+    UINT16 port = dstAddr.GetPort();
+    memcpy(key + 2, &port, sizeof(UINT16));
+    unsigned int addrLen = dstAddr.GetLength();
+    if (addrLen > 16) addrLen = 16;
+    memcpy(key + 4, dstAddr.GetRawHostAddress(), addrLen);
+    return (4 + addrLen);
+}  // end MgenTransportList::MakeDstKey()
+
+void MgenTransportList::Index(MgenTransport* mgenTransport)
+{
+    mgenTransport->list = this;
+    char key[MgenHashIndex::KEY_MAX];
+    unsigned int keyLen = MakePortKey(key, mgenTransport->GetProtocol(), mgenTransport->srcPort);
+    port_index.Insert(key, keyLen, *mgenTransport);
+    if (mgenTransport->dstAddress.IsValid())
+    {
+        keyLen = MakeDstKey(key, mgenTransport->GetProtocol(), mgenTransport->dstAddress);
+        dst_index.Insert(key, keyLen, *mgenTransport);
+    }
+    const ProtoSocket* socket = mgenTransport->GetSocket();
+    if (NULL != socket)
+        socket_index.Insert((const char*)&socket, sizeof(socket), *mgenTransport);
+}  // end MgenTransportList::Index()
+
+void MgenTransportList::Unindex(MgenTransport* mgenTransport)
+{
+    char key[MgenHashIndex::KEY_MAX];
+    unsigned int keyLen = MakePortKey(key, mgenTransport->GetProtocol(), mgenTransport->srcPort);
+    port_index.Remove(key, keyLen, *mgenTransport);
+    if (mgenTransport->dstAddress.IsValid())
+    {
+        keyLen = MakeDstKey(key, mgenTransport->GetProtocol(), mgenTransport->dstAddress);
+        dst_index.Remove(key, keyLen, *mgenTransport);
+    }
+    const ProtoSocket* socket = mgenTransport->GetSocket();
+    if (NULL != socket)
+        socket_index.Remove((const char*)&socket, sizeof(socket), *mgenTransport);
+    mgenTransport->list = NULL;
+}  // end MgenTransportList::Unindex()
+
 
 ///////////////////////////////////////////////////////////
 // MgenTransport::MgenTransport() implementation
 
 MgenTransport::MgenTransport(Mgen& theMgen,
                              Protocol theProtocol)
-  : prev(NULL), next(NULL), 
+  : prev(NULL), next(NULL), list(NULL), list_order(0), 
     srcPort(0), dstPort(0),    
     protocol(theProtocol),
     reference_count(0),
@@ -95,7 +165,7 @@ MgenTransport::MgenTransport(Mgen& theMgen,
 MgenTransport::MgenTransport(Mgen& theMgen,
                              Protocol theProtocol,
                              UINT16 thePort)
-  : prev(NULL), next(NULL),
+  : prev(NULL), next(NULL), list(NULL), list_order(0),
     srcPort(thePort),dstPort(0),    
     protocol(theProtocol),
     reference_count(0),
@@ -110,7 +180,7 @@ MgenTransport::MgenTransport(Mgen& theMgen,
                              Protocol theProtocol,
                              UINT16 thePort,
                              const ProtoAddress& theAddress)
-  : prev(NULL), next(NULL), 
+  : prev(NULL), next(NULL), list(NULL), list_order(0), 
     srcPort(thePort),dstPort(0),
     protocol(theProtocol),
     reference_count(0),
@@ -127,6 +197,22 @@ MgenTransport::~MgenTransport()
 {
 
 }
+
+void MgenTransport::SetDstAddr(const ProtoAddress& theAddress)
+{
+    MgenTransportList* theList = list;
+    if (theList) theList->Unindex(this);
+    dstAddress = theAddress;
+    if (theList) theList->Index(this);
+}  // end MgenTransport::SetDstAddr()
+
+void MgenTransport::SetSrcPort(UINT16 thePort)
+{
+    MgenTransportList* theList = list;
+    if (theList) theList->Unindex(this);
+    srcPort = thePort;
+    if (theList) theList->Index(this);
+}  // end MgenTransport::SetSrcPort()
 void MgenTransport::AppendFlow(MgenFlow* const theFlow)
 {
 
@@ -267,6 +353,23 @@ bool MgenTransport::SendPendingMessage()
     
 }  // end MgenTransport::SendPendingMessage()
 
+MessageStatus MgenTransport::SendMessageBatch(MgenMsg*            msgArray,
+                                             unsigned int&       count,
+                                             const ProtoAddress& dst_addr)
+{
+    char txBuffer[MAX_SIZE];
+    MessageStatus result = MSG_SEND_OK;
+    unsigned int sent = 0;
+    while (sent < count)
+    {
+        result = SendMessage(msgArray[sent], dst_addr, txBuffer);
+        if (MSG_SEND_OK != result) break;
+        sent++;
+    }
+    count = sent;
+    return result;
+}  // end MgenTransport::SendMessageBatch()
+
 void MgenTransport::RemoveFromPendingList()
 {
 
@@ -292,8 +395,18 @@ void MgenTransport::RemoveFromPendingList()
         
 }  // end MgenTransport::RemoveFromPendingList()
 
-void MgenTransport::LogEvent(LogEventType eventType,MgenMsg* theMsg,const struct timeval& theTime,char* buffer )
+void MgenTransport::LogEvent(LogEventType eventType,MgenMsg* theMsg,const struct timeval& theTime,char* buffer,
+                             const struct timeval* stampTime)
 {
+    MgenRecvStats* recvStats = mgen.GetRecvStats();
+    if ((RECV_EVENT == eventType) && (NULL != recvStats))
+    {
+        theMsg->SetProtocol(protocol);
+        if (!theMsg->GetDstAddr().IsValid())
+            theMsg->SetDstAddr(dstAddress);
+        recvStats->Update(*theMsg, (NULL != stampTime) ? *stampTime : theTime);
+    }
+
     if (!(mgen.GetLogFile()))
       return;  
 
@@ -307,26 +420,39 @@ void MgenTransport::LogEvent(LogEventType eventType,MgenMsg* theMsg,const struct
       {
           if (mgen.GetLogTx())
           {
-              theMsg->LogSendEvent(mgen.GetLogFile(),
-                                   mgen.GetLogBinary(),
-                                   mgen.GetLocalTime(),
-                                   buffer,
-                                   mgen.GetLogFlush(),
-                                   theTime);
+              MgenLogWriter* logWriter = mgen.GetLogWriter();
+              if (NULL != logWriter)
+                  logWriter->LogSendEvent(*theMsg, mgen.GetLogOptions(), buffer, theTime, stampTime);
+              else
+                  theMsg->LogSendEvent(mgen.GetLogFile(),
+                                       mgen.GetLogBinary(),
+                                       mgen.GetLocalTime(),
+                                       buffer,
+                                       mgen.GetLogFlush(),
+                                       theTime,
+                                       stampTime);
           }
           break;
       }
     case RECV_EVENT:
       {
           theMsg->SetProtocol(protocol);
-          theMsg->LogRecvEvent(mgen.GetLogFile(),
-                               mgen.GetLogBinary(), 
-                               mgen.GetLocalTime(), 
-			       mgen.GetLogData(),
-			       mgen.GetLogGpsData(),
-                               buffer, 
-                               mgen.GetLogFlush(),
-                               theTime);
+          if (mgen.GetLogRx())
+          {
+              MgenLogWriter* logWriter = mgen.GetLogWriter();
+              if (NULL != logWriter)
+                  logWriter->LogRecvEvent(*theMsg, mgen.GetLogOptions(), buffer, theTime, stampTime);
+              else
+                  theMsg->LogRecvEvent(mgen.GetLogFile(),
+                                       mgen.GetLogBinary(), 
+                                       mgen.GetLocalTime(), 
+                                       mgen.GetLogData(),
+                                       mgen.GetLogGpsData(),
+                                       buffer, 
+                                       mgen.GetLogFlush(),
+                                       theTime,
+                                       stampTime);
+          }
 
           // Don't we want rapr to get the message regardless of logging??
           // Could this possibly have been broken too? strange... ljt
@@ -659,7 +785,7 @@ bool MgenSocketTransport::Open(ProtoAddress::Type addrType, bool bindOnOpen)
       }
 
     // Reset src port in case it was os generated 
-    srcPort = GetSocketPort();
+    SetSrcPort(GetSocketPort());
     
     if (tx_buffer)
       socket.SetTxBufferSize(tx_buffer);
@@ -740,7 +866,9 @@ MgenUdpTransport::MgenUdpTransport(Mgen& theMgen,
                                    Protocol theProtocol,
                                    UINT16        thePort)
   : MgenSocketTransport(theMgen,theProtocol,thePort),
-    group_count(0),connect(false)
+    group_count(0),connect(false),
+    batch_buffer(NULL),batch_buffer_size(0),
+    tx_stamps(false),pace_pending_head(0),pace_pending_count(0)
 {
     socket.SetListener(this,&MgenUdpTransport::OnEvent);
 }
@@ -751,7 +879,9 @@ MgenUdpTransport::MgenUdpTransport(Mgen& theMgen,
                                    UINT16        thePort,
                                    const ProtoAddress&        theDstAddress)
   : MgenSocketTransport(theMgen,theProtocol,thePort,theDstAddress),
-    group_count(0),connect(false)
+    group_count(0),connect(false),
+    batch_buffer(NULL),batch_buffer_size(0),
+    tx_stamps(false),pace_pending_head(0),pace_pending_count(0)
 {
     socket.SetListener(this,&MgenUdpTransport::OnEvent);
 
@@ -764,7 +894,11 @@ MgenUdpTransport::MgenUdpTransport(Mgen& theMgen,
 
 MgenUdpTransport::~MgenUdpTransport()
 {
-
+    if (NULL != batch_buffer)
+    {
+        delete[] batch_buffer;
+        batch_buffer = NULL;
+    }
 }
 
 bool MgenUdpTransport::SetMulticastInterface(const char* interfaceName)
@@ -789,6 +923,25 @@ bool MgenUdpTransport::Open(ProtoAddress::Type addrType, bool bindOnOpen)
 {
     if (MgenSocketTransport::Open(addrType,bindOnOpen))
     {
+        // Kernel transmit timestamps are only needed for SEND logging
+        // and the schedule error stats of TXTIME (or ETF) paced flows
+        MgenPacer::Mode paceMode = mgen.GetPaceMode();
+        bool paceTxTime = ((MgenPacer::TXTIME == paceMode) || (MgenPacer::ETF == paceMode));
+        if (1 == reference_count)
+        {
+            bool txStamps = (mgen.GetTimestamp() && mgen.GetLogTx()) || paceTxTime;
+            tx_stamps = false;
+            if (mgen.GetTimestamp() || paceTxTime)
+            {
+                if (socket.EnableTimestamping(txStamps, mgen.GetTimestampHw()))
+                    tx_stamps = txStamps;
+                else if (mgen.GetTimestamp())
+                    DMSG(0,"MgenUdpTransport::Open() Warning: kernel timestamps not available.\n");
+            }
+            pace_pending_count = 0;
+            if (paceTxTime && !socket.EnableTxTime(MgenPacer::ETF == paceMode))
+                DMSG(0,"MgenUdpTransport::Open() Warning: SO_TXTIME not available (flows use SPIN pacing).\n");
+        }
         if (connect && !socket.Connect(dstAddress))
         {
             DMSG(0,"MgenUdpTransport::Open() Error: Failed to connect udp socket.\n");
@@ -896,8 +1049,20 @@ void MgenUdpTransport::OnEvent(ProtoSocket& theSocket, ProtoSocket::Event theEve
           char buffer[MAX_SIZE];
           unsigned int len = MAX_SIZE;
           ProtoAddress srcAddr;
+          ProtoTime rxTime;
+          bool timestamp = mgen.GetTimestamp();
+          if (tx_stamps)
+          {
+              // Take any transmit timestamps SendMessage() missed
+              // (they make the socket "readable" until read)
+              UINT32 txId;
+              ProtoTime txTime;
+              while (theSocket.RecvTxTimestamp(txId, txTime))
+                OnTxTimestamp(txId, txTime);
+          }
 
-          while (theSocket.RecvFrom(buffer, len, srcAddr))
+          while (timestamp ? theSocket.RecvFrom(buffer, len, srcAddr, rxTime) :
+                             theSocket.RecvFrom(buffer, len, srcAddr))
           {
               if (len == 0) break;
 
@@ -906,7 +1071,7 @@ void MgenUdpTransport::OnEvent(ProtoSocket& theSocket, ProtoSocket::Event theEve
               // so we need to set it in the msg here
 
               theMsg.SetSrcAddr(srcAddr);
-              if (mgen.GetLogFile())
+              if (mgen.GetLogFile() || mgen.GetRecvStats())
               {
                   struct timeval currentTime;
                   ProtoSystemTime(currentTime);
@@ -934,7 +1099,8 @@ void MgenUdpTransport::OnEvent(ProtoSocket& theSocket, ProtoSocket::Event theEve
                       if (theMsg.GetError())
                         LogEvent(RERR_EVENT,&theMsg,currentTime);
                       else 
-                        LogEvent(RECV_EVENT,&theMsg,currentTime,buffer);
+                        LogEvent(RECV_EVENT,&theMsg,currentTime,buffer,
+                                 timestamp ? &rxTime.GetTimeVal() : NULL);
                   }
                   else {
                       LogEvent(RERR_EVENT,&theMsg,currentTime);
@@ -957,6 +1123,16 @@ void MgenUdpTransport::OnEvent(ProtoSocket& theSocket, ProtoSocket::Event theEve
 }  // end MgenUdpTransport::OnEvent()
 
 MessageStatus MgenUdpTransport::SendMessage(MgenMsg& theMsg,const ProtoAddress& dst_addr,char* txBuffer) 
+{
+    return SendMessageAt(theMsg, dst_addr, txBuffer, ProtoTime());
+} // end MgenUdpTransport::SendMessage
+
+// A zero "launchTime" sends the message now.  Otherwise, the socket must have
+// SO_TXTIME enabled and the message tx time is its launch time (if later).
+MessageStatus MgenUdpTransport::SendMessageAt(MgenMsg&            theMsg,
+                                              const ProtoAddress& dst_addr,
+                                              char*               txBuffer,
+                                              const ProtoTime&    launchTime) 
 {
     
     // Udp packets are single shot and larger than
@@ -964,9 +1140,13 @@ MessageStatus MgenUdpTransport::SendMessage(MgenMsg& theMsg,const ProtoAddress&
     UINT32 txChecksum = 0;
     theMsg.SetFlag(MgenMsg::LAST_BUFFER);
 
-    struct timeval currentTime;
-    ProtoSystemTime(currentTime);
-    theMsg.SetTxTime(currentTime);
+    ProtoTime currentTime;
+    currentTime.GetCurrentTime();
+    bool launch = !launchTime.IsZero() && socket.TxTimeEnabled();
+    if (launch && (launchTime > currentTime))
+        theMsg.SetTxTime(launchTime.GetTimeVal());
+    else
+        theMsg.SetTxTime(currentTime.GetTimeVal());
 
     unsigned int len = theMsg.Pack(txBuffer,theMsg.GetMsgLen(),mgen.GetChecksumEnable(),txChecksum);
     if (len == 0) 
@@ -975,7 +1155,9 @@ MessageStatus MgenUdpTransport::SendMessage(MgenMsg& theMsg,const ProtoAddress&
     if (mgen.GetChecksumEnable() && theMsg.FlagIsSet(MgenMsg::CHECKSUM)) 
       theMsg.WriteChecksum(txChecksum,(unsigned char*)txBuffer,(UINT32)len);
 
-    bool result = socket.SendTo(txBuffer,len,dst_addr);
+    UINT32 txId = socket.GetTxStampId();
+    bool result = launch ? socket.SendAt(txBuffer,len,dst_addr,launchTime) :
+                           socket.SendTo(txBuffer,len,dst_addr);
 
     // If result is true but numBytes == 0 
     // we had an EWOULDBLOCK condition
@@ -994,11 +1176,160 @@ MessageStatus MgenUdpTransport::SendMessage(MgenMsg& theMsg,const ProtoAddress&
 	  return MSG_SEND_FAILED;
       }
 
-    LogEvent(SEND_EVENT,&theMsg,theMsg.GetTxTime(),txBuffer);
+    if (launch && tx_stamps)
+    {
+        // Remember the launch time until the message's tx timestamp arrives
+        if (PACE_PENDING_MAX == pace_pending_count)
+        {
+            pace_pending_head = (pace_pending_head + 1) % PACE_PENDING_MAX;
+            pace_pending_count--;
+        }
+        PacePending& pending = pace_pending[(pace_pending_head + pace_pending_count) % PACE_PENDING_MAX];
+        pending.tx_id = txId;
+        pending.flow_id = theMsg.GetFlowId();
+        pending.launch_time = launchTime;
+        pace_pending_count++;
+    }
+
+    // The kernel (software) transmit timestamp is usually queued by the
+    // time sendto() returns.  Later ones (e.g., NIC hardware stamps, or
+    // those of messages held for a launch time) are not logged
+    const struct timeval* txStamp = NULL;
+    ProtoTime txTime;
+    if (tx_stamps)
+    {
+        UINT32 stampId;
+        ProtoTime stampTime;
+        while (socket.RecvTxTimestamp(stampId, stampTime))
+        {
+            OnTxTimestamp(stampId, stampTime);
+            if ((stampId == txId) && mgen.GetTimestamp())
+            {
+                txTime = stampTime;
+                txStamp = &txTime.GetTimeVal();
+            }
+        }
+    }
+    LogEvent(SEND_EVENT,&theMsg,theMsg.GetTxTime(),txBuffer,txStamp);
     messages_sent++;
     return MSG_SEND_OK;
 
-} // end MgenUdpTransport::SendMessage
+} // end MgenUdpTransport::SendMessageAt
+
+void MgenUdpTransport::OnTxTimestamp(UINT32 txId, const ProtoTime& txTime)
+{
+    // Stamps arrive in send order, so pending launch times before
+    // this one will not be stamped (e.g., a dropped stamp)
+    while (0 != pace_pending_count)
+    {
+        PacePending& pending = pace_pending[pace_pending_head];
+        INT32 delta = (INT32)(txId - pending.tx_id);
+        if (delta < 0) return;  // (not a paced message)
+        pace_pending_head = (pace_pending_head + 1) % PACE_PENDING_MAX;
+        pace_pending_count--;
+        if (0 == delta)
+        {
+            MgenFlow* flow = mgen.GetFlowList().FindFlowById(pending.flow_id);
+            if (NULL != flow)
+                flow->AccessPacer().Update(ProtoTime::Delta(txTime, pending.launch_time));
+            return;
+        }
+    }
+}  // end MgenUdpTransport::OnTxTimestamp()
+
+MessageStatus MgenUdpTransport::SendMessageBatch(MgenMsg*            msgArray,
+                                                 unsigned int&       count,
+                                                 const ProtoAddress& dst_addr)
+{
+    if (count > Mgen::TX_BATCH_MAX) count = Mgen::TX_BATCH_MAX;
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < count; i++)
+        total += msgArray[i].GetMsgLen();
+    if (total > batch_buffer_size)
+    {
+        if (NULL != batch_buffer) delete[] batch_buffer;
+        if (NULL == (batch_buffer = new char[total]))
+        {
+            DMSG(0, "MgenUdpTransport::SendMessageBatch() new batch_buffer error: %s\n", GetErrorString());
+            batch_buffer_size = 0;
+            count = 0;
+            return MSG_SEND_FAILED;
+        }
+        batch_buffer_size = total;
+    }
+
+    // Pack the messages back-to-back, each with its own tx time
+    const char* bufferArray[Mgen::TX_BATCH_MAX];
+    unsigned int lenArray[Mgen::TX_BATCH_MAX];
+    ProtoAddress dstArray[Mgen::TX_BATCH_MAX];
+    bool connected = socket.IsConnected();
+    char* ptr = batch_buffer;
+    unsigned int packed = 0;
+    while (packed < count)
+    {
+        MgenMsg& theMsg = msgArray[packed];
+        UINT32 txChecksum = 0;
+        theMsg.SetFlag(MgenMsg::LAST_BUFFER);
+        struct timeval currentTime;
+        ProtoSystemTime(currentTime);
+        theMsg.SetTxTime(currentTime);
+        unsigned int len = theMsg.Pack(ptr,theMsg.GetMsgLen(),mgen.GetChecksumEnable(),txChecksum);
+        if (len == 0) break;  // no room
+        if (mgen.GetChecksumEnable() && theMsg.FlagIsSet(MgenMsg::CHECKSUM)) 
+          theMsg.WriteChecksum(txChecksum,(unsigned char*)ptr,(UINT32)len);
+        bufferArray[packed] = ptr;
+        lenArray[packed] = len;
+        if (!connected) dstArray[packed] = dst_addr;
+        ptr += len;
+        packed++;
+    }
+    if (0 == packed)
+    {
+        count = 0;
+        return MSG_SEND_FAILED;
+    }
+
+    UINT32 txId = socket.GetTxStampId();
+    unsigned int sent = packed;
+    bool result = socket.SendBatch(bufferArray, lenArray, connected ? NULL : dstArray, sent);
+    if (!result)
+    {
+        DMSG(PL_WARN,"MgenUdpTransport::SendMessageBatch() socket.SendBatch() error: %s\n", GetErrorString());
+        count = 0;
+        return MSG_SEND_FAILED;
+    }
+
+    // Match any kernel transmit timestamps to the sent messages (see SendMessage())
+    ProtoTime stampArray[Mgen::TX_BATCH_MAX];
+    bool stampValid[Mgen::TX_BATCH_MAX];
+    memset(stampValid, 0, sent*sizeof(bool));
+    if (tx_stamps)
+    {
+        UINT32 stampId;
+        ProtoTime txTime;
+        while (socket.RecvTxTimestamp(stampId, txTime))
+        {
+            OnTxTimestamp(stampId, txTime);
+            UINT32 index = stampId - txId;
+            if ((index < sent) && mgen.GetTimestamp())
+            {
+                stampArray[index] = txTime;
+                stampValid[index] = true;
+            }
+        }
+    }
+    for (unsigned int i = 0; i < sent; i++)
+    {
+        const struct timeval* txStamp = stampValid[i] ? &stampArray[i].GetTimeVal() : NULL;
+        LogEvent(SEND_EVENT,&msgArray[i],msgArray[i].GetTxTime(),(char*)bufferArray[i],txStamp);
+    }
+    messages_sent += sent;
+
+    MessageStatus status = (sent < count) ? ((sent < packed) ? MSG_SEND_BLOCKED : MSG_SEND_FAILED) : MSG_SEND_OK;
+    count = sent;
+    return status;
+
+} // end MgenUdpTransport::SendMessageBatch
 
 bool MgenUdpTransport::Listen(UINT16 port,ProtoAddress::Type addrType, bool bindOnOpen)
 {
@@ -1017,6 +1348,8 @@ MgenTcpTransport::MgenTcpTransport(Mgen& theMgen,
     tx_msg(),
     tx_buffer_index(0),tx_buffer_pending(0),
     tx_msg_offset(0),tx_fragment_pending(0),tx_checksum(0),
+    tx_vector_count(0),tx_vector_index(0),tx_vector_offset(0),
+    tx_vector_zero_copy(-1),tx_zero_copy(false),
     rx_msg(), rx_buffer_index(0),
     rx_fragment_pending(0),rx_msg_index(0),
     rx_checksum(0)
@@ -1051,7 +1384,7 @@ void MgenTcpTransport::OnEvent(ProtoSocket& theSocket,ProtoSocket::Event theEven
           while (1)
           {
               unsigned int numBytes = tx_buffer_pending; 
-              if (theSocket.Send(tx_msg_buffer + tx_buffer_index, numBytes))
+              if (SendTxVector(numBytes))
               {
                   // if we had an error, let socket notification
                   // tell us when to try again.
@@ -1216,7 +1549,7 @@ MessageStatus MgenTcpTransport::SendMessage(MgenMsg& theMsg,const ProtoAddress&
     while (1)
     {
         unsigned int numBytes = tx_buffer_pending;   
-        if (socket.Send(tx_msg_buffer+tx_buffer_index,numBytes))
+        if (SendTxVector(numBytes))
         {
             // If we had an error, let socket notification tell 
             // us when to try again...
@@ -1231,17 +1564,9 @@ MessageStatus MgenTcpTransport::SendMessage(MgenMsg& theMsg,const ProtoAddress&
             tx_buffer_pending -= numBytes;
             tx_fragment_pending -= numBytes;
             
-            // Still more to send in buffer.
+            // Still more of the fragment to send
             if (tx_buffer_pending)
                 continue;
-        
-            // We sent the whole buffer.  Get the next part of
-            // the fragment
-            if (0 == tx_buffer_pending && tx_fragment_pending)
-            {
-                SetupNextTxBuffer();
-                if (tx_buffer_pending) continue;
-            }
  
             // See if there are any more mgen msg fragments to send
             if (tx_buffer_pending == 0 && tx_fragment_pending == 0)
@@ -1364,6 +1689,8 @@ void MgenTcpTransport::ResetTxMsgState()
 {  
     tx_msg_buffer[0] = '\0';
     tx_buffer_index = tx_buffer_pending = tx_msg_offset = tx_fragment_pending = tx_checksum = 0;
+    tx_vector_count = tx_vector_index = tx_vector_offset = 0;
+    tx_vector_zero_copy = -1;
     tx_msg.SetMgenMsgLen(0);
     tx_msg.SetMsgLen(0);
     tx_msg.SetFlowId(0);
@@ -1448,6 +1775,7 @@ bool MgenTcpTransport::Open(ProtoAddress::Type addrType, bool bindOnOpen)
     }
     if (MgenSocketTransport::Open(addrType,bindOnOpen))
     {
+        EnableZeroCopy();
         if (IsClient())
         {
             if (!socket.Connect(dstAddress))
@@ -1508,6 +1836,7 @@ bool MgenTcpTransport::Accept(ProtoSocket& theSocket)
         if (tos) socket.SetTOS(tos);
         if (df != DF_DEFAULT) socket.SetFragmentation(df);
         // no ttl or multicast interface for tcp sockets   
+        EnableZeroCopy();
         reference_count++; 
         SetDstAddr(socket.GetDestination()); 
         IsClient(false);
@@ -1598,13 +1927,6 @@ bool MgenTcpTransport::GetNextTxBuffer(unsigned int numBytes)
     tx_buffer_index += numBytes;
     tx_buffer_pending -= numBytes;
     tx_fragment_pending -= numBytes;
-
-    // If there is more of the mgen message fragment 
-    // to send, set up the next buffer
-    if (0 == tx_buffer_pending && tx_fragment_pending)
-    {
-        SetupNextTxBuffer();
-    }
     
     // We've sent the whole fragment & its buffers.
     // See if there is are any more mgen msg fragments.
@@ -1645,65 +1967,158 @@ bool MgenTcpTransport::GetNextTxBuffer(unsigned int numBytes)
     
 } // MgenTcpTransport::GetNextTxBuffer()
 
-void MgenTcpTransport::SetupNextTxBuffer()
+/**
+ * Lays out the rest of the current fragment (after the packed first
+ * buffer) as a vector of pieces, so the fragment goes to the socket in
+ * gathered sends instead of one send per TX_BUFFER_SIZE buffer.  The
+ * pieces repeat the packed buffer (as sending a buffer at a time did)
+ * and the checksum, computed over the pieces as they're laid out, is a
+ * piece of its own.  With zero copy sends (see the ZEROCOPY command),
+ * the repeats of a large fragment are a single piece of static zero 
+ * fill instead, since tx_msg_buffer is repacked before the kernel is
+ * done sending from it.
+ */
+void MgenTcpTransport::SetupTxVector()
 {
-
-    // last buffer in fragment with room for checksum?
-    if ((mgen.GetChecksumEnable() && (tx_fragment_pending  <= (TX_BUFFER_SIZE - 4)))
-        || (!mgen.GetChecksumEnable() && (tx_fragment_pending <= TX_BUFFER_SIZE)))
+    static const char ZERO_FILL[MAX_FRAG_SIZE] = {0};
+    
+    tx_vector_buffer[0] = tx_msg_buffer;
+    tx_vector_len[0] = tx_buffer_pending;
+    tx_vector_count = 1;
+    tx_vector_index = tx_vector_offset = 0;
+    tx_vector_zero_copy = -1;
+    
+    // (a fragment that fits one buffer has its checksum packed already)
+    // (tx_msg.msg_len is the fragment length)
+    unsigned int remaining = tx_msg.msg_len - tx_buffer_pending;
+    if (0 == remaining) return;
+    tx_msg_offset += remaining;
+    tx_buffer_pending = tx_msg.msg_len;
+    
+    bool checksum = mgen.GetChecksumEnable();
+    if (checksum && (remaining < 4))
     {
-        tx_buffer_pending = tx_fragment_pending;
-        tx_msg.SetFlag(MgenMsg::LAST_BUFFER);
-
-        if (mgen.GetChecksumEnable())
-          CalcTxChecksum();
-
-        tx_msg.ClearFlag(MgenMsg::LAST_BUFFER);
-            
-        if (mgen.GetChecksumEnable()) 
-          tx_msg.WriteChecksum(tx_checksum, (unsigned char*)tx_msg_buffer, tx_fragment_pending);
-
+        DMSG(0,"MgenTcpTransport::SetupTxVector() Not enough room for checksum!\n");
+        checksum = false;
     }
-    else 
+    // (completions aren't signaled with every dispatcher, so they're read here)
+    if (tx_zero_copy && (0 != socket.GetZeroCopyPending()))
+        socket.RecvZeroCopyCompletions();
+    if (tx_zero_copy && socket.ZeroCopyCopied())
     {
-        // Create room for checksum.
-
-        if (mgen.GetChecksumEnable() && ((tx_fragment_pending - TX_BUFFER_SIZE) < 4))
-            tx_buffer_pending = tx_fragment_pending - 4;
-        else
-            tx_buffer_pending = TX_BUFFER_SIZE;
-        
-        if (mgen.GetChecksumEnable())
-          CalcTxChecksum();
+        // (e.g. loopback, where zero copy only adds overhead)
+        DMSG(1,"MgenTcpTransport::SetupTxVector() kernel copied zero copy sends, using regular sends.\n");
+        tx_zero_copy = false;
     }
-    tx_buffer_index = 0;
-    tx_msg_offset += tx_buffer_pending;
-
-} // MgenTcpTransport::SetupNextTxBuffer()
+    unsigned int zeroCopyMin = mgen.GetZeroCopyMin();
+    unsigned int fillLen = checksum ? (remaining - 4) : remaining;
+    if (tx_zero_copy && (0 != zeroCopyMin) && (tx_msg.msg_len >= zeroCopyMin) && (0 != fillLen))
+    {
+        unsigned int len = fillLen;
+        if (checksum)
+          tx_msg.ComputeCRC32(tx_checksum,(unsigned char*)ZERO_FILL,len);
+        tx_vector_zero_copy = tx_vector_count;
+        tx_vector_buffer[tx_vector_count] = ZERO_FILL;
+        tx_vector_len[tx_vector_count++] = len;
+    }
+    else
+    {
+        while (remaining > 0)
+        {
+            // (the same buffers as sending a buffer at a time, 
+            // leaving room for the checksum in the last one)
+            unsigned int len;
+            if ((checksum && (remaining <= (TX_BUFFER_SIZE - 4))) ||
+                (!checksum && (remaining <= TX_BUFFER_SIZE)))
+                len = checksum ? (remaining - 4) : remaining;
+            else if (checksum && (((int)remaining - TX_BUFFER_SIZE) < 4))
+                len = remaining - 4;
+            else
+                len = TX_BUFFER_SIZE;
+            if (0 == len) break;
+            if (checksum)
+              tx_msg.ComputeCRC32(tx_checksum,(unsigned char*)tx_msg_buffer,len);
+            tx_vector_buffer[tx_vector_count] = tx_msg_buffer;
+            tx_vector_len[tx_vector_count++] = len;
+            remaining -= len;
+            if (checksum && (4 == remaining)) break;
+        }
+    }
+    if (checksum)
+    {
+        tx_msg.WriteChecksum(tx_checksum,(unsigned char*)tx_checksum_buffer,4);
+        tx_vector_buffer[tx_vector_count] = tx_checksum_buffer;
+        tx_vector_len[tx_vector_count++] = 4;
+    }
+    
+} // MgenTcpTransport::SetupTxVector()
 
-void MgenTcpTransport::CalcTxChecksum()
+/**
+ * Sends as much of the fragment's remaining pieces as the socket
+ * takes (the zero copy piece, if any, is sent by itself) and sets
+ * "numBytes" to the number of bytes sent.
+ */
+bool MgenTcpTransport::SendTxVector(unsigned int& numBytes)
 {
-    if (tx_msg.FlagIsSet(MgenMsg::LAST_BUFFER))
+    if (0 == tx_buffer_pending)
     {
-        if (tx_buffer_pending < 4) 
+        numBytes = 0;  // (nothing packed yet)
+        return true;
+    }
+    unsigned int first = tx_vector_index;
+    unsigned int last = tx_vector_count;
+    bool zeroCopy = false;
+    if (tx_vector_zero_copy >= 0)
+    {
+        if ((int)first < tx_vector_zero_copy)
         {
-            DMSG(0,"MgenMsg::PackBuffer Not enough room for checksum!\n");
-            return;
+            last = tx_vector_zero_copy;
+        }
+        else if ((int)first == tx_vector_zero_copy)
+        {
+            last = first + 1;
+            zeroCopy = tx_zero_copy;
         }
-        
-        // Don't calc buffer where checksum will be
-        tx_msg.ComputeCRC32(tx_checksum,
-                            (unsigned char*)tx_msg_buffer,
-                            tx_buffer_pending - 4);
-    }
-    else {
-        tx_msg.ComputeCRC32(tx_checksum,
-                            (unsigned char*)tx_msg_buffer,
-                            tx_buffer_pending);
-        
     }
+    const char* bufferArray[TX_VECTOR_MAX];
+    unsigned int lenArray[TX_VECTOR_MAX];
+    unsigned int count = 0;
+    for (unsigned int i = first; i < last; i++)
+    {
+        unsigned int offset = (i == first) ? tx_vector_offset : 0;
+        bufferArray[count] = tx_vector_buffer[i] + offset;
+        lenArray[count++] = tx_vector_len[i] - offset;
+    }
+    if (!socket.SendVector(bufferArray, lenArray, count, numBytes, zeroCopy))
+      return false;
+    
+    // Advance through the pieces sent
+    unsigned int sent = numBytes;
+    while ((0 != sent) && (tx_vector_index < tx_vector_count))
+    {
+        unsigned int pieceRemaining = tx_vector_len[tx_vector_index] - tx_vector_offset;
+        if (sent < pieceRemaining)
+        {
+            tx_vector_offset += sent;
+            break;
+        }
+        sent -= pieceRemaining;
+        tx_vector_index++;
+        tx_vector_offset = 0;
+    }
+    return true;
+    
+} // MgenTcpTransport::SendTxVector()
 
-} // MgenTcpTransport::CalcTxChecksum()
+void MgenTcpTransport::EnableZeroCopy()
+{
+    tx_zero_copy = false;
+    if (0 == mgen.GetZeroCopyMin()) return;
+    if (socket.EnableZeroCopy())
+      tx_zero_copy = true;
+    else
+      DMSG(0,"MgenTcpTransport::EnableZeroCopy() Warning: zero copy sends not available.\n");
+} // MgenTcpTransport::EnableZeroCopy()
 
 UINT16 MgenTcpTransport::GetNextTxFragment()
 {
@@ -1776,6 +2191,8 @@ UINT16 MgenTcpTransport::GetNextTxFragment()
           // no more to send
           tx_buffer_pending = 0;
 	  }
+    if (tx_buffer_pending)
+      SetupTxVector();
 
     return tx_msg.msg_len;
     
@@ -1851,7 +2268,7 @@ void MgenTcpTransport::CopyMsgBuffer(unsigned int numBytes,unsigned int bufferIn
         ((rx_msg.GetMsgLen() == rx_msg_index) 
          && (rx_msg_index <= TX_BUFFER_SIZE)))
     {
-        if (mgen.GetLogFile()) 
+        if (mgen.GetLogFile() || mgen.GetRecvStats()) 
         {
             if (rx_msg_index <= TX_BUFFER_SIZE) 
               rx_msg.Unpack(rx_msg_buffer,rx_msg_index,mgen.GetChecksumForce(),mgen.GetLogData());
@@ -1921,7 +2338,7 @@ void MgenSinkTransport::HandleMgenMessage(const char* buffer, unsigned int len,c
     MgenMsg theMsg;
     theMsg.SetSrcAddr(srcAddr);
     
-    if (NULL != mgen.GetLogFile())
+    if ((NULL != mgen.GetLogFile()) || (NULL != mgen.GetRecvStats()))
     {
         struct timeval currentTime;
         ProtoSystemTime(currentTime);
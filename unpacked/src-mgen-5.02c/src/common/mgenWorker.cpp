@@ -0,0 +1,209 @@
+#include "mgenWorker.h"
+
+#include <string.h>
+
+MgenWorker::Message::Message(Type theType, const char* theText)
+ : type(theType), text(NULL), line_count(0), cmd(Mgen::INVALID_COMMAND),
+   override(false), log_stream(NULL), mgen_event(NULL), next(NULL)
+{
+    if (NULL != theText)
+    {
+        if (NULL != (text = new char[strlen(theText) + 1]))
+            strcpy(text, theText);
+    }
+}
+
+MgenWorker::Message::~Message()
+{
+    if (NULL != text) delete[] text;
+    if (NULL != mgen_event) delete mgen_event;
+}
+
+MgenWorker::MgenWorker(unsigned int index)
+ : mgen(dispatcher, dispatcher), worker_index(index), running(false),
+   queue_head(NULL), queue_tail(NULL), prompt_pending(false)
+{
+    ProtoDispatcher::Init(queue_mutex);
+    // Workers only log their flows' events (the main Mgen logs START/STOP)
+    mgen.SetLogSession(false);
+    dispatcher.SetPromptCallback(DoPrompt, this);
+}
+
+MgenWorker::~MgenWorker()
+{
+    Stop();
+    ProtoDispatcher::Destroy(queue_mutex);
+}
+
+bool MgenWorker::Start()
+{
+    if (running) return true;
+    if (!dispatcher.StartThread())
+    {
+        DMSG(0, "MgenWorker::Start() error: worker %u thread not started\n", worker_index);
+        return false;
+    }
+    running = true;
+    return Post(new Message(Message::START, NULL));
+}  // end MgenWorker::Start()
+
+void MgenWorker::Stop()
+{
+    if (running)
+    {
+        // Stop the worker Mgen from this thread while its thread is
+        // suspended, then stop the thread itself
+        dispatcher.SuspendThread();
+        ProcessQueue();
+        mgen.Stop();
+        dispatcher.ResumeThread();
+        dispatcher.Stop();
+        running = false;
+    }
+    else
+    {
+        mgen.Stop();
+    }
+}  // end MgenWorker::Stop()
+
+bool MgenWorker::PostEvent(const char* lineBuffer, unsigned int lineCount)
+{
+    Message* msg = new Message(Message::EVENT, lineBuffer);
+    if ((NULL != msg) && (NULL != msg->text)) msg->line_count = lineCount;
+    return Post(msg);
+}  // end MgenWorker::PostEvent()
+
+bool MgenWorker::PostMgenEvent(MgenEvent* theEvent, unsigned int lineCount)
+{
+    Message* msg = new Message(Message::MGEN_EVENT, NULL);
+    if (NULL != msg)
+    {
+        msg->mgen_event = theEvent;
+        msg->line_count = lineCount;
+    }
+    else
+    {
+        delete theEvent;
+    }
+    return Post(msg);
+}  // end MgenWorker::PostMgenEvent()
+
+bool MgenWorker::PostCommand(Mgen::Command cmd, const char* arg, bool override)
+{
+    Message* msg = new Message(Message::COMMAND, arg);
+    if (NULL != msg)
+    {
+        msg->cmd = cmd;
+        msg->override = override;
+    }
+    return Post(msg);
+}  // end MgenWorker::PostCommand()
+
+bool MgenWorker::PostLogFile(FILE* logStream)
+{
+    Message* msg = new Message(Message::LOG_FILE, NULL);
+    if (NULL != msg)
+        msg->log_stream = logStream;
+    else if (NULL != logStream)
+        fclose(logStream);
+    return Post(msg);
+}  // end MgenWorker::PostLogFile()
+
+bool MgenWorker::Post(Message* msg)
+{
+    if (NULL == msg)
+    {
+        DMSG(0, "MgenWorker::Post() new message error: %s\n", GetErrorString());
+        return false;
+    }
+    if (!running)
+    {
+        bool result = Process(*msg);
+        delete msg;
+        return result;
+    }
+    ProtoDispatcher::Lock(queue_mutex);
+    if (NULL != queue_tail)
+        queue_tail->next = msg;
+    else
+        queue_head = msg;
+    queue_tail = msg;
+    // (the thread is only prompted once until it takes the queue)
+    bool prompt = !prompt_pending;
+    prompt_pending = true;
+    ProtoDispatcher::Unlock(queue_mutex);
+    if (prompt && !dispatcher.PromptThread())
+    {
+        DMSG(0, "MgenWorker::Post() error: worker %u thread prompt failed\n", worker_index);
+        return false;
+    }
+    return true;
+}  // end MgenWorker::Post()
+
+void MgenWorker::DoPrompt(const void* clientData)
+{
+    ((MgenWorker*)clientData)->ProcessQueue();
+}  // end MgenWorker::DoPrompt()
+
+void MgenWorker::ProcessQueue()
+{
+    ProtoDispatcher::Lock(queue_mutex);
+    Message* next = queue_head;
+    queue_head = queue_tail = NULL;
+    prompt_pending = false;
+    ProtoDispatcher::Unlock(queue_mutex);
+    while (NULL != next)
+    {
+        Message* msg = next;
+        next = next->next;
+        Process(*msg);
+        delete msg;
+    }
+}  // end MgenWorker::ProcessQueue()
+
+bool MgenWorker::Process(Message& msg)
+{
+    switch (msg.type)
+    {
+        case Message::EVENT:
+            if (NULL == msg.text) return false;
+            if (!mgen.ParseEvent(msg.text, msg.line_count))
+            {
+                DMSG(0, "MgenWorker::Process() error: worker %u invalid mgen script line: %u\n",
+                     worker_index, msg.line_count);
+                return false;
+            }
+            break;
+        case Message::MGEN_EVENT:
+        {
+            // (the worker's Mgen takes ownership of the event)
+            MgenEvent* theEvent = msg.mgen_event;
+            msg.mgen_event = NULL;
+            if (!mgen.InsertMgenEvent(theEvent, msg.line_count))
+            {
+                DMSG(0, "MgenWorker::Process() error: worker %u invalid mgen script line: %u\n",
+                     worker_index, msg.line_count);
+                return false;
+            }
+            break;
+        }
+        case Message::COMMAND:
+            if (!mgen.OnCommand(msg.cmd, msg.text, msg.override))
+            {
+                DMSG(0, "MgenWorker::Process() error: worker %u command failed\n", worker_index);
+                return false;
+            }
+            break;
+        case Message::LOG_FILE:
+            mgen.SetLogFile(msg.log_stream);
+            break;
+        case Message::START:
+            if (!mgen.Start())
+            {
+                DMSG(0, "MgenWorker::Process() error: worker %u start failed\n", worker_index);
+                return false;
+            }
+            break;
+    }
+    return true;
+}  // end MgenWorker::Process()